@@ -0,0 +1,835 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Native command line generator of weather radar wind profiles from polar volumes.
+ *
+ * Takes the same configuration file and options as wrwp_main and writes the same profiles,
+ * but without the start-up of the python interpreter and the rave python modules. The
+ * conversion of the profiles to ODIM-H5 ver2.1 is only available in wrwp_main.
+ * @file
+ * @date 2026-10-18
+ */
+#define _GNU_SOURCE /* nftw */
+#include "wrwp.h"
+#include "wrwp_shm.h"
+#include "wrwp_image.h"
+#include "rave_debug.h"
+#include "rave_io.h"
+#include "rave_simplexml.h"
+#include "hlhdf.h"
+#include <ctype.h>
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Name of the configuration file
+ */
+#define WRWP_CONFIG_NAME "wrwp_config.xml"
+
+/**
+ * Maximum number of distinct radars published to shared memory in one run
+ */
+#define WRWP_MAX_RINGS 64
+
+/**
+ * The type of an option value
+ */
+typedef enum {
+  WrwpOptionType_STRING = 0, /**< a string */
+  WrwpOptionType_INT,        /**< an integer */
+  WrwpOptionType_DOUBLE,     /**< a floating point value */
+  WrwpOptionType_FLAG        /**< set if given, takes no value */
+} WrwpOptionType;
+
+/**
+ * The options, defaults come from the configuration file
+ */
+typedef struct {
+  char* infiles;      /**< comma separated input files */
+  char* outpath;      /**< output directory, ends with / */
+  char* outfname;     /**< output file name if one input file */
+  char* quantities;   /**< fields to generate */
+  char* wrwpmethod;   /**< SMHI or KNMI */
+  int dmin, dmax, nmin_wnd, nmin_ref, ngapbin, ngapmin, maxnstd, dz, hmax, nodata_VP, undetect_VP;
+  double emin, emax, econdmax, hthr, nimin, maxvdiff, vmin, ff_max, gain_VP, offset_VP;
+  int setOdim21;      /**< ODIM-H5 ver2.1 output, only supported by wrwp_main */
+  int shm;            /**< publish to shared memory */
+  int shm_slots;      /**< slots per shared memory ring */
+  int verbose;        /**< verbose logging */
+  int help;           /**< print the usage */
+} WrwpOptions;
+
+/**
+ * Describes an option on the command line and, if param is set, in the configuration file
+ */
+typedef struct {
+  const char* name;    /**< the long option */
+  const char* param;   /**< the name of the param in the configuration file or NULL */
+  WrwpOptionType type; /**< the type of the value */
+  size_t offset;       /**< offset of the value in WrwpOptions */
+  const char* help;    /**< the help text */
+} WrwpOptionDef;
+
+#define WRWP_OPTION(name, param, type, help) {#name, param, type, offsetof(WrwpOptions, name), help}
+
+/**
+ * All options, in the same order as in wrwp_main
+ */
+static const WrwpOptionDef WRWP_OPTIONS[] = {
+  WRWP_OPTION(infiles, NULL, WrwpOptionType_STRING, "Name of polar volume input files (including path), comma separated, must be in ODIM-H5 format. - reads one volume from stdin."),
+  WRWP_OPTION(outpath, NULL, WrwpOptionType_STRING, "The path to the directory where the vertical profiles are written."),
+  WRWP_OPTION(outfname, NULL, WrwpOptionType_STRING, "Selected filename for vertical profile, only if one input file is given. - writes the profile to stdout."),
+  WRWP_OPTION(quantities, "QUANTITIES", WrwpOptionType_STRING, "Comma separated list of quantities."),
+  WRWP_OPTION(wrwpmethod, "METHOD", WrwpOptionType_STRING, "Method used for deriving WRWP. Currently SMHI and KNMI are supported."),
+  WRWP_OPTION(dmin, "DMIN", WrwpOptionType_INT, "Minimum distance for deriving a profile [m]."),
+  WRWP_OPTION(dmax, "DMAX", WrwpOptionType_INT, "Maximum distance for deriving a profile [m]."),
+  WRWP_OPTION(nmin_wnd, "NMIN_WND", WrwpOptionType_INT, "Minimum sample size for wind."),
+  WRWP_OPTION(nmin_ref, "NMIN_REF", WrwpOptionType_INT, "Minimum sample size for reflectivity."),
+  WRWP_OPTION(emin, "EMIN", WrwpOptionType_DOUBLE, "Minimum elevation angle [deg]."),
+  WRWP_OPTION(emax, "EMAX", WrwpOptionType_DOUBLE, "Maximum elevation angle [deg]."),
+  WRWP_OPTION(econdmax, "ECONDMAX", WrwpOptionType_DOUBLE, "KNMI method: Conditional maximum elevation angle [deg]."),
+  WRWP_OPTION(hthr, "HTHR", WrwpOptionType_DOUBLE, "KNMI method: Height threshold below which conditional maximum elevation angle is employed [m]."),
+  WRWP_OPTION(nimin, "NIMIN", WrwpOptionType_DOUBLE, "KNMI method: Minimum Nyquist interval for use of scan [m/s]."),
+  WRWP_OPTION(ngapbin, "NGAPBIN", WrwpOptionType_INT, "KNMI method: Number of azimuth sector bins for detecting gaps."),
+  WRWP_OPTION(ngapmin, "NGAPMIN", WrwpOptionType_INT, "KNMI method: Minimum number of samples within an azimuth sector bin."),
+  WRWP_OPTION(maxnstd, "MAXNSTD", WrwpOptionType_INT, "KNMI method: Maximum number standard deviations of residuals to include samples."),
+  WRWP_OPTION(maxvdiff, "MAXVDIFF", WrwpOptionType_DOUBLE, "KNMI method: Maximum deviation of a sample to the fit [m/s]."),
+  WRWP_OPTION(vmin, "VMIN", WrwpOptionType_DOUBLE, "Radial velocity threshold [m/s]."),
+  WRWP_OPTION(ff_max, "FF_MAX", WrwpOptionType_DOUBLE, "Maximum allowed calculated layer velocity [m/s]."),
+  WRWP_OPTION(dz, "DZ", WrwpOptionType_INT, "Height interval for the generated vertical profile [m]."),
+  WRWP_OPTION(hmax, "HMAX", WrwpOptionType_INT, "Maximum height of the generated vertical profile [m]."),
+  WRWP_OPTION(nodata_VP, "NODATA_VP", WrwpOptionType_INT, "Nodata value for vertical profile."),
+  WRWP_OPTION(undetect_VP, "UNDETECT_VP", WrwpOptionType_INT, "Undetect value for vertical profile."),
+  WRWP_OPTION(gain_VP, "GAIN_VP", WrwpOptionType_DOUBLE, "Gain value for vertical profile."),
+  WRWP_OPTION(offset_VP, "OFFSET_VP", WrwpOptionType_DOUBLE, "Offset value for vertical profile."),
+  WRWP_OPTION(setOdim21, NULL, WrwpOptionType_FLAG, "Converts the VP to ver2.1, only supported by wrwp_main."),
+  WRWP_OPTION(shm, NULL, WrwpOptionType_FLAG, "Also publishes each profile in the POSIX shared memory ring buffer wrwp_<NOD> of the radar."),
+  WRWP_OPTION(shm_slots, NULL, WrwpOptionType_INT, "Number of profiles kept in each shared memory ring."),
+  WRWP_OPTION(verbose, NULL, WrwpOptionType_FLAG, "Enables verbose logging and verbose printing of some info to the terminal."),
+  WRWP_OPTION(help, NULL, WrwpOptionType_FLAG, "Shows this help message and exits.")
+};
+
+#define WRWP_NUMBER_OF_OPTIONS (sizeof(WRWP_OPTIONS) / sizeof(WRWP_OPTIONS[0]))
+
+/**
+ * The log file, NULL until the output directory is known
+ */
+static FILE* wrwp_logfile = NULL;
+
+/**
+ * If debug messages are logged
+ */
+static int wrwp_logdebug = 0;
+
+/**
+ * Where the messages to the user are printed, stderr when the profile is written to stdout
+ */
+static FILE* wrwp_console = NULL;
+
+/*@{ Private functions */
+/**
+ * Appends a message to the log file in the same format as the python logging module, e.g.
+ * 2026-10-18 12:00:00,123 INFO message
+ * @param[in] level - INFO or DEBUG
+ * @param[in] fmt - the printf format
+ */
+static void WrwpMain_log(const char* level, const char* fmt, ...)
+{
+  struct timeval tv;
+  struct tm tm;
+  char stamp[32];
+  va_list ap;
+
+  if (wrwp_logfile == NULL || (!wrwp_logdebug && strcmp(level, "DEBUG") == 0)) {
+    return;
+  }
+  gettimeofday(&tv, NULL);
+  localtime_r(&tv.tv_sec, &tm);
+  strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+  fprintf(wrwp_logfile, "%s,%03d %s ", stamp, (int)(tv.tv_usec / 1000), level);
+  va_start(ap, fmt);
+  vfprintf(wrwp_logfile, fmt, ap);
+  va_end(ap);
+  fputc('\n', wrwp_logfile);
+  fflush(wrwp_logfile);
+}
+
+/**
+ * Sets an option from its string value
+ * @param[in] options - the options
+ * @param[in] def - the option
+ * @param[in] value - the value, NULL for flags
+ * @returns 1 on success, 0 if the value is not valid for the type
+ */
+static int WrwpMain_setOption(WrwpOptions* options, const WrwpOptionDef* def, const char* value)
+{
+  void* field = (char*)options + def->offset;
+  char* end = NULL;
+
+  switch (def->type) {
+  case WrwpOptionType_STRING:
+    free(*(char**)field);
+    *(char**)field = strdup(value);
+    return (*(char**)field != NULL);
+  case WrwpOptionType_INT: {
+    long v = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || v < INT_MIN || v > INT_MAX) {
+      fprintf(stderr, "option --%s: invalid integer value: '%s'\n", def->name, value);
+      return 0;
+    }
+    *(int*)field = (int)v;
+    return 1;
+  }
+  case WrwpOptionType_DOUBLE:
+    *(double*)field = strtod(value, &end);
+    if (end == value || *end != '\0') {
+      fprintf(stderr, "option --%s: invalid floating-point value: '%s'\n", def->name, value);
+      return 0;
+    }
+    return 1;
+  case WrwpOptionType_FLAG:
+    *(int*)field = 1;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Returns the directory of the executable with a trailing /, the default output directory
+ * @param[out] dir - the directory, PATH_MAX characters
+ */
+static void WrwpMain_getExecutableDir(char* dir)
+{
+  ssize_t len = readlink("/proc/self/exe", dir, PATH_MAX - 1);
+  char* slash = NULL;
+  if (len <= 0) {
+    strcpy(dir, "./");
+    return;
+  }
+  dir[len] = '\0';
+  slash = strrchr(dir, '/');
+  slash[1] = '\0';
+}
+
+/**
+ * The configuration file found under /etc/baltrad, set by \ref WrwpMain_findConfig
+ */
+static char wrwp_etcconfig[PATH_MAX];
+
+/**
+ * nftw callback that stops at the first configuration file
+ */
+static int WrwpMain_findConfig(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+  if (type == FTW_F && strcmp(path + ftw->base, WRWP_CONFIG_NAME) == 0) {
+    snprintf(wrwp_etcconfig, sizeof(wrwp_etcconfig), "%s", path);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Locates the configuration file the same way as wrwp_main: the current directory, WRWP_CONFIG_FILE,
+ * ../config relative to the executable and finally anywhere under /etc/baltrad.
+ * @param[in] exedir - the directory of the executable
+ * @param[out] path - the configuration file, PATH_MAX characters
+ * @returns 1 if found, otherwise 0
+ */
+static int WrwpMain_getConfigPath(const char* exedir, char* path)
+{
+  const char* env = getenv("WRWP_CONFIG_FILE");
+  if (access(WRWP_CONFIG_NAME, F_OK) == 0) {
+    strcpy(path, WRWP_CONFIG_NAME);
+    return 1;
+  }
+  if (env != NULL && access(env, F_OK) == 0) {
+    snprintf(path, PATH_MAX, "%s", env);
+    return 1;
+  }
+  snprintf(path, PATH_MAX, "%s../config/" WRWP_CONFIG_NAME, exedir);
+  if (access(path, F_OK) == 0) {
+    return 1;
+  }
+  wrwp_etcconfig[0] = '\0';
+  if (nftw("/etc/baltrad", WrwpMain_findConfig, 16, FTW_PHYS) == 1) {
+    strcpy(path, wrwp_etcconfig);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Reads the defaults of the options from the configuration file
+ * @param[in] options - the options
+ * @param[in] path - the configuration file
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpMain_readConfig(WrwpOptions* options, const char* path)
+{
+  SimpleXmlNode_t* root = SimpleXmlNode_parseFile(path);
+  int i = 0, result = 1;
+  size_t j = 0;
+
+  if (root == NULL) {
+    fprintf(stderr, "Failed to parse configuration file %s\n", path);
+    return 0;
+  }
+  for (i = 0; result && i < SimpleXmlNode_getNumberOfChildren(root); i++) {
+    SimpleXmlNode_t* param = SimpleXmlNode_getChild(root, i);
+    const char* name = SimpleXmlNode_getAttribute(param, "name");
+    SimpleXmlNode_t* value = SimpleXmlNode_getChildByName(param, "value");
+    if (name != NULL && value != NULL && SimpleXmlNode_getText(value) != NULL) {
+      for (j = 0; j < WRWP_NUMBER_OF_OPTIONS; j++) {
+        if (WRWP_OPTIONS[j].param != NULL && strcmp(WRWP_OPTIONS[j].param, name) == 0) {
+          result = WrwpMain_setOption(options, &WRWP_OPTIONS[j], SimpleXmlNode_getText(value));
+        }
+      }
+    }
+    RAVE_OBJECT_RELEASE(value);
+    RAVE_OBJECT_RELEASE(param);
+  }
+  RAVE_OBJECT_RELEASE(root);
+  return result;
+}
+
+/**
+ * Parses the command line, the options use the same names as in wrwp_main
+ * @param[in] options - the options
+ * @param[in] argc - argc
+ * @param[in] argv - argv
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpMain_parseArguments(WrwpOptions* options, int argc, char** argv)
+{
+  struct option longopts[WRWP_NUMBER_OF_OPTIONS + 1];
+  size_t i = 0;
+  int c = 0, index = 0;
+
+  for (i = 0; i < WRWP_NUMBER_OF_OPTIONS; i++) {
+    longopts[i].name = WRWP_OPTIONS[i].name;
+    longopts[i].has_arg = (WRWP_OPTIONS[i].type == WrwpOptionType_FLAG) ? no_argument : required_argument;
+    longopts[i].flag = NULL;
+    longopts[i].val = 0;
+  }
+  memset(&longopts[WRWP_NUMBER_OF_OPTIONS], 0, sizeof(struct option));
+
+  while ((c = getopt_long(argc, argv, "h", longopts, &index)) != -1) {
+    if (c == 'h') {
+      options->help = 1;
+    } else if (c != 0 || !WrwpMain_setOption(options, &WRWP_OPTIONS[index], optarg)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Prints the usage
+ * @param[in] progname - the program name
+ */
+static void WrwpMain_printUsage(const char* progname)
+{
+  size_t i = 0;
+  printf("usage: %s --infiles <infile/s> --outpath <path to profiles> [args] [h]\n", progname);
+  printf("Generates weather radar wind profiles directly from polar volumes.\n");
+  printf("Adjustable parameters are stored in wrwp_config.xml but can of course also be changed from the command line.\n\n");
+  printf("Options:\n");
+  for (i = 0; i < WRWP_NUMBER_OF_OPTIONS; i++) {
+    printf("  --%-13s %s\n", WRWP_OPTIONS[i].name, WRWP_OPTIONS[i].help);
+  }
+}
+
+/**
+ * Prints the parameter settings like wrwp_main does with --verbose
+ * @param[in] options - the options
+ */
+static void WrwpMain_printSettings(WrwpOptions* options)
+{
+  const char* q = options->quantities;
+  int refl = (q == NULL || strstr(q, "DBZH") != NULL || strstr(q, "NZ") != NULL);
+  int wnd = (q == NULL || strstr(q, "ff") != NULL || strstr(q, "dd") != NULL || strstr(q, "UWND") != NULL ||
+             strstr(q, "VWND") != NULL || strstr(q, "NV") != NULL);
+
+  fprintf(wrwp_console, "\nSelected vertical profile parameter settings\n");
+  fprintf(wrwp_console, "----------------------------------------------\n");
+  fprintf(wrwp_console, "Quantities in the generated vertical profile: %s\n", q != NULL ? q : "ff, ff_dev, dd, NV, DBZH, DBZH_dev, NZ");
+  fprintf(wrwp_console, "WRWP method used: %s\n", options->wrwpmethod);
+  fprintf(wrwp_console, "Minimum distance for vertical profile, dmin: %d [m]\n", options->dmin);
+  fprintf(wrwp_console, "Maximum distance for vertical profile, dmax: %d [m]\n", options->dmax);
+  fprintf(wrwp_console, "Minimum elevation angle used in vertical profile, emin: %g [deg]\n", options->emin);
+  fprintf(wrwp_console, "Maximum elevation angle used in the vertical profile, emax: %g [deg]\n", options->emax);
+  if (options->wrwpmethod != NULL && strcmp(options->wrwpmethod, "KNMI") == 0) {
+    fprintf(wrwp_console, "Conditional maximum elevation angle used in the vertical profile, econdmax: %g [deg]\n", options->econdmax);
+    fprintf(wrwp_console, "Height threshold below which conditional maximum elevation angle is employed in the vertical profile, hthr: %g [m]\n", options->hthr);
+    fprintf(wrwp_console, "Number of azimuth sector bins for detecting gaps used in the vertical profile, ngapbin: %d\n", options->ngapbin);
+    fprintf(wrwp_console, "Minimum number of samples within an azimuth sector bin used in the vertical profile, ngapmin: %d\n", options->ngapmin);
+    fprintf(wrwp_console, "Maximum number standard deviations of residuals to include samples used in the vertical profile, maxnstd: %d\n", options->maxnstd);
+    fprintf(wrwp_console, "Maximum deviation of a sample to the fit used in the vertical profile, maxvdiff: %g [m/s]\n", options->maxvdiff);
+  }
+  fprintf(wrwp_console, "Height interval for vertical profile, dz: %d [m]\n", options->dz);
+  fprintf(wrwp_console, "Maximum height for vertical profile, hmax: %d [m]\n", options->hmax);
+  if (wnd) {
+    fprintf(wrwp_console, "Minimum sample size required for wind in the vertical profile, nmin_wnd: %d\n", options->nmin_wnd);
+    fprintf(wrwp_console, "Radial velocity threshold for vertical profile, vmin: %g [m/s]\n", options->vmin);
+    fprintf(wrwp_console, "Maximum allowed layer velocity for vertical profile, ff_max: %g [m/s]\n", options->ff_max);
+    fprintf(wrwp_console, "Minimum Nyquist interval used in the vertical profile, emax: %g [m/s]\n", options->nimin);
+  }
+  if (refl) {
+    fprintf(wrwp_console, "Minimum sample size required for reflectivity in the vertical profile, nmin_ref: %d\n", options->nmin_ref);
+  }
+  fprintf(wrwp_console, "Nodata value, nodata_VP: %d\n", options->nodata_VP);
+  fprintf(wrwp_console, "Undetect value, undetect_VP: %d\n", options->undetect_VP);
+  fprintf(wrwp_console, "Gain value, gain_VP: %g\n", options->gain_VP);
+  fprintf(wrwp_console, "Offset value, offset_VP: %g\n", options->offset_VP);
+}
+
+/**
+ * Creates the directory and its parents if they do not exist
+ * @param[in] path - the directory
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpMain_makeDirs(const char* path)
+{
+  char tmp[PATH_MAX];
+  char* p = NULL;
+  snprintf(tmp, sizeof(tmp), "%s", path);
+  for (p = tmp + 1; *p != '\0'; p++) {
+    if (*p == '/') {
+      *p = '\0';
+      if (mkdir(tmp, 0777) != 0 && errno != EEXIST) {
+        return 0;
+      }
+      *p = '/';
+    }
+  }
+  return (mkdir(tmp, 0777) == 0 || errno == EEXIST);
+}
+
+/**
+ * Creates the locked generator from the options
+ * @param[in] options - the options
+ * @returns the generator or NULL on failure
+ */
+static Wrwp_t* WrwpMain_createWrwp(WrwpOptions* options)
+{
+  Wrwp_t* wrwp = RAVE_OBJECT_NEW(&Wrwp_TYPE);
+  if (wrwp == NULL) {
+    return NULL;
+  }
+  Wrwp_setDMIN(wrwp, options->dmin);
+  Wrwp_setDMAX(wrwp, options->dmax);
+  Wrwp_setNMIN_WND(wrwp, options->nmin_wnd);
+  Wrwp_setNMIN_REF(wrwp, options->nmin_ref);
+  Wrwp_setEMIN(wrwp, options->emin);
+  Wrwp_setEMAX(wrwp, options->emax);
+  Wrwp_setECONDMAX(wrwp, options->econdmax);
+  Wrwp_setHTHR(wrwp, options->hthr);
+  Wrwp_setNIMIN(wrwp, options->nimin);
+  Wrwp_setNGAPBIN(wrwp, options->ngapbin);
+  Wrwp_setNGAPMIN(wrwp, options->ngapmin);
+  Wrwp_setMAXNSTD(wrwp, options->maxnstd);
+  Wrwp_setMAXVDIFF(wrwp, options->maxvdiff);
+  Wrwp_setVMIN(wrwp, options->vmin);
+  Wrwp_setFF_MAX(wrwp, options->ff_max);
+  Wrwp_setDZ(wrwp, options->dz);
+  Wrwp_setHMAX(wrwp, options->hmax);
+  Wrwp_setNODATA_VP(wrwp, options->nodata_VP);
+  Wrwp_setUNDETECT_VP(wrwp, options->undetect_VP);
+  Wrwp_setGAIN_VP(wrwp, options->gain_VP);
+  Wrwp_setOFFSET_VP(wrwp, options->offset_VP);
+  Wrwp_lock(wrwp);
+  return wrwp;
+}
+
+/**
+ * Returns the NOD of a source, or the RAD or WMO if it has none
+ * @param[in] source - the source
+ * @param[out] nod - the identifier, "unknown" if none is found
+ * @param[in] len - the size of nod
+ */
+static void WrwpMain_getNod(const char* source, char* nod, size_t len)
+{
+  static const char* keys[] = {"NOD:", "RAD:", "WMO:"};
+  size_t i = 0;
+  for (i = 0; source != NULL && i < sizeof(keys) / sizeof(keys[0]); i++) {
+    const char* p = strstr(source, keys[i]);
+    if (p != NULL && (p == source || p[-1] == ',')) {
+      snprintf(nod, len, "%.*s", (int)strcspn(p + 4, ","), p + 4);
+      return;
+    }
+  }
+  snprintf(nod, len, "unknown");
+}
+
+/**
+ * A shared memory ring of a radar
+ */
+typedef struct {
+  char name[64];   /**< the segment name */
+  WrwpShm_t* shm;  /**< the ring */
+} WrwpMainRing;
+
+/**
+ * Generates the profile of a volume, publishes it if wanted and returns it
+ * @param[in] options - the options
+ * @param[in] wrwp - the generator
+ * @param[in] ctx - the context
+ * @param[in] pvol - the volume
+ * @param[in] rings - the shared memory rings, WRWP_MAX_RINGS entries
+ * @returns the profile or NULL on failure
+ */
+static VerticalProfile_t* WrwpMain_generate(WrwpOptions* options, Wrwp_t* wrwp, WrwpContext_t* ctx,
+                                            PolarVolume_t* pvol, WrwpMainRing* rings)
+{
+  VerticalProfile_t* vp = NULL;
+  WrwpResult_t* result = NULL;
+  WrwpMainRing* ring = NULL;
+  char nod[32], name[64];
+  int i = 0;
+
+  if (!options->shm) {
+    return Wrwp_generateWithContext(wrwp, ctx, pvol, options->wrwpmethod, options->quantities);
+  }
+  WrwpMain_getNod(PolarVolume_getSource(pvol), nod, sizeof(nod));
+  snprintf(name, sizeof(name), "wrwp_%s", nod);
+  for (i = 0; i < WRWP_MAX_RINGS && ring == NULL; i++) {
+    if (rings[i].shm == NULL) {
+      rings[i].shm = RAVE_OBJECT_NEW(&WrwpShm_TYPE);
+      if (rings[i].shm == NULL || !WrwpShm_create(rings[i].shm, name, Wrwp_getHMAX(wrwp) / Wrwp_getDZ(wrwp),
+                                                  Wrwp_getDZ(wrwp), options->quantities, options->shm_slots)) {
+        RAVE_OBJECT_RELEASE(rings[i].shm);
+        return NULL;
+      }
+      strcpy(rings[i].name, name);
+    }
+    if (strcmp(rings[i].name, name) == 0) {
+      ring = &rings[i];
+    }
+  }
+  if (ring == NULL) {
+    return NULL;
+  }
+  result = Wrwp_generateResult(wrwp, ctx, pvol, options->wrwpmethod, options->quantities);
+  if (result != NULL && WrwpShm_publish(ring->shm, result) != 0) {
+    vp = Wrwp_createProfile(wrwp, result, pvol);
+  }
+  RAVE_OBJECT_RELEASE(result);
+  return vp;
+}
+
+/**
+ * Reads a stream until its end, used for images on stdin
+ * @param[in] stream - the stream
+ * @param[out] size - the number of bytes read
+ * @returns the content, to be released with free, or NULL on failure
+ */
+static void* WrwpMain_readStream(FILE* stream, size_t* size)
+{
+  size_t capacity = 1 << 20, n = 0;
+  char* data = malloc(capacity);
+  while (data != NULL && (n = fread(data + *size, 1, capacity - *size, stream)) > 0) {
+    *size += n;
+    if (*size == capacity) {
+      char* tmp = realloc(data, capacity * 2);
+      if (tmp == NULL) {
+        free(data);
+        return NULL;
+      }
+      data = tmp;
+      capacity *= 2;
+    }
+  }
+  if (data != NULL && ferror(stream)) {
+    free(data);
+    return NULL;
+  }
+  return data;
+}
+
+/**
+ * Opens an input file, - is an ODIM-H5 image on stdin
+ * @param[in] filename - the file
+ * @returns the loaded rave io or NULL on failure
+ */
+static RaveIO_t* WrwpMain_open(const char* filename)
+{
+  RaveIO_t* result = NULL;
+  void* image = NULL;
+  size_t size = 0;
+  if (strcmp(filename, "-") != 0) {
+    return RaveIO_open(filename, 0, NULL);
+  }
+  image = WrwpMain_readStream(stdin, &size);
+  if (image != NULL) {
+    result = WrwpImage_open(image, size);
+  }
+  free(image);
+  return result;
+}
+
+/**
+ * Saves the profile, - writes it as an ODIM-H5 image to stdout
+ * @param[in] vp - the profile
+ * @param[in] outfile - the file
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpMain_save(VerticalProfile_t* vp, const char* outfile)
+{
+  RaveIO_t* raveio = NULL;
+  void* image = NULL;
+  size_t size = 0;
+  int result = 0;
+  if (strcmp(outfile, "-") == 0) {
+    if (WrwpImage_save((RaveCoreObject*)vp, &image, &size)) {
+      result = (fwrite(image, 1, size, stdout) == size && fflush(stdout) == 0);
+    }
+    RAVE_FREE(image);
+    return result;
+  }
+  raveio = RAVE_OBJECT_NEW(&RaveIO_TYPE);
+  if (raveio != NULL && RaveIO_setObject(raveio, (RaveCoreObject*)vp)) {
+    result = RaveIO_save(raveio, outfile);
+  }
+  RAVE_OBJECT_RELEASE(raveio);
+  return result;
+}
+
+/**
+ * Generates and writes the profile of one input file
+ * @returns 1 on success, 0 if no profile could be generated or written
+ */
+static int WrwpMain_processFile(WrwpOptions* options, Wrwp_t* wrwp, WrwpContext_t* ctx, const char* filename,
+                                WrwpMainRing* rings)
+{
+  RaveIO_t* raveio = NULL;
+  RaveCoreObject* object = NULL;
+  VerticalProfile_t* vp = NULL;
+  char nod[32], product[16], outfile[PATH_MAX];
+  struct timeval start, end;
+  int result = 0, setOdim21 = options->setOdim21;
+  size_t i = 0;
+
+  WrwpMain_log("INFO", "Starting generation of vertical profile from polar volume: %s", filename);
+
+  raveio = WrwpMain_open(filename);
+  if (raveio != NULL) {
+    object = RaveIO_getObject(raveio);
+  }
+  if (object == NULL || !RAVE_OBJECT_CHECK_TYPE(object, &PolarVolume_TYPE)) {
+    fprintf(stderr, "Must call wrwp with a polar volume as input, check polar file: %s\n", filename);
+    WrwpMain_log("ERROR", "Must call wrwp with polar volume as input, check polar file: %s", filename);
+    goto done;
+  }
+  if (RaveIO_getOdimVersion(raveio) == RaveIO_ODIM_Version_2_1 && RaveIO_getH5radVersion(raveio) == RaveIO_ODIM_H5rad_Version_2_1) {
+    setOdim21 = 1; /* only for this file, the next input may be ver2.2 */
+    WrwpMain_log("INFO", "Input volume according to ODIM-H5 ver2.1 implies an output vertical profile with ver2.1");
+  }
+  if (setOdim21) {
+    fprintf(stderr, "Vertical profiles according to ODIM-H5 ver2.1 are only supported by wrwp_main, skipping %s\n", filename);
+    goto done;
+  }
+  gettimeofday(&start, NULL);
+  vp = WrwpMain_generate(options, wrwp, ctx, (PolarVolume_t*)object, rings);
+  if (vp == NULL) {
+    WrwpMain_log("INFO", "No vertical profile could be generated from polar volume: %s, check input volume and wrwp parameter settings\n", filename);
+    fprintf(wrwp_console, "No vertical profile could be generated from polar volume: %s, check input volume and wrwp parameter settings\n\n", filename);
+    goto done;
+  }
+
+  /* Filename based on data from the generated profile */
+  WrwpMain_getNod(VerticalProfile_getSource(vp), nod, sizeof(nod));
+  snprintf(product, sizeof(product), "%s", VerticalProfile_getProduct(vp) != NULL ? VerticalProfile_getProduct(vp) : "vp");
+  for (i = 0; product[i] != '\0'; i++) {
+    product[i] = (char)tolower((unsigned char)product[i]);
+  }
+  if (options->outfname != NULL && strcmp(options->outfname, "-") == 0) {
+    strcpy(outfile, "-");
+  } else if (options->outfname == NULL) {
+    snprintf(outfile, sizeof(outfile), "%s%s_%s_%sT%sZ.h5", options->outpath, nod, product,
+             VerticalProfile_getDate(vp), VerticalProfile_getTime(vp));
+  } else {
+    snprintf(outfile, sizeof(outfile), "%s%s", options->outpath, options->outfname);
+  }
+
+  if (!WrwpMain_save(vp, outfile)) {
+    WrwpMain_log("INFO", "Failed to write ver2.2 vertical profile to disk: \n%s", outfile);
+    goto done;
+  }
+  gettimeofday(&end, NULL);
+  WrwpMain_log("DEBUG", "Succeded in writing generated ver 2.2 vertical profile to disk: %s", outfile);
+  WrwpMain_log("DEBUG", "Total generation time for ver 2.2 vertical profile: %f s",
+               (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+  WrwpMain_log("INFO", "Finished generating ver 2.2 vertical profile, file: %s\n", outfile);
+  result = 1;
+done:
+  RAVE_OBJECT_RELEASE(vp);
+  RAVE_OBJECT_RELEASE(object);
+  RAVE_OBJECT_RELEASE(raveio);
+  return result;
+}
+/*@} End of Private functions */
+
+int main(int argc, char** argv)
+{
+  WrwpOptions options;
+  WrwpMainRing rings[WRWP_MAX_RINGS];
+  Wrwp_t* wrwp = NULL;
+  WrwpContext_t* ctx = NULL;
+  char exedir[PATH_MAX], config[PATH_MAX], logname[PATH_MAX];
+  char* files = NULL;
+  char* file = NULL;
+  char* saveptr = NULL;
+  const char** failures = NULL;
+  struct timeval start, end;
+  double elapsed = 0.0;
+  size_t len = 0;
+  int i = 0, nfiles = 0, nfailures = 0, exitcode = 1;
+
+  memset(&options, 0, sizeof(options));
+  memset(rings, 0, sizeof(rings));
+  options.shm_slots = 16;
+
+  Rave_initializeDebugger();
+  Rave_setDebugLevel(Rave_Debug_Silent);
+  HL_init();
+  HL_disableErrorReporting();
+  HL_disableHdf5ErrorReporting();
+
+  WrwpMain_getExecutableDir(exedir);
+  if (!WrwpMain_getConfigPath(exedir, config)) {
+    printf("Can not find any wrwp configuration file. Neither environment variable WRWP_CONFIG_FILE has been set, nothing is found in %s../config/" WRWP_CONFIG_NAME " and nothing could be found under /etc/baltrad\n", exedir);
+    printf("You can always try to run this binary with WRWP_CONFIG_FILE=/path/to/wrwp_config.xml %s ...\n", argv[0]);
+    return 127;
+  }
+  if (!WrwpMain_readConfig(&options, config) || !WrwpMain_parseArguments(&options, argc, argv)) {
+    return 2;
+  }
+  if (options.help || options.infiles == NULL) {
+    WrwpMain_printUsage(argv[0]);
+    return 0;
+  }
+  if (options.verbose) {
+    Rave_setDebugLevel(Rave_Debug_Info);
+  }
+
+  /* Putting a file extension to the selected filename just in case... */
+  wrwp_console = (options.outfname != NULL && strcmp(options.outfname, "-") == 0) ? stderr : stdout;
+  if (options.outfname != NULL && strcmp(options.outfname, "-") != 0 && (strlen(options.outfname) < 3 || strcmp(options.outfname + strlen(options.outfname) - 3, ".h5") != 0)) {
+    char* tmp = malloc(strlen(options.outfname) + 4);
+    sprintf(tmp, "%s.h5", options.outfname);
+    free(options.outfname);
+    options.outfname = tmp;
+  }
+  if (options.outpath == NULL) {
+    options.outpath = strdup(exedir);
+  } else {
+    if (!WrwpMain_makeDirs(options.outpath)) {
+      fprintf(stderr, "Failed to create output directory %s: %s\n", options.outpath, strerror(errno));
+      goto done;
+    }
+    len = strlen(options.outpath);
+    if (len == 0 || options.outpath[len - 1] != '/') {
+      char* tmp = malloc(len + 2);
+      sprintf(tmp, "%s/", options.outpath);
+      free(options.outpath);
+      options.outpath = tmp;
+    }
+  }
+  snprintf(logname, sizeof(logname), "%s/wrwp_log.log", options.outpath);
+  wrwp_logfile = fopen(logname, "a");
+  wrwp_logdebug = options.verbose;
+
+  fprintf(wrwp_console, "\nGenerating vertical profile/s from volume/s:\n");
+  files = strdup(options.infiles);
+  for (file = strtok_r(files, ",", &saveptr); file != NULL; file = strtok_r(NULL, ",", &saveptr)) {
+    fprintf(wrwp_console, "%s\n", file);
+  }
+  if (options.verbose) {
+    WrwpMain_printSettings(&options);
+  }
+
+  if (options.outfname != NULL && strchr(options.infiles, ',') != NULL) {
+    fprintf(stderr, "Several infiles given, but only one outfile. Run again with only one infile and one outfile or avoid specifying a name so the code can define names.\n");
+    WrwpMain_log("ERROR", "Several infiles given, but only one outfile. Run again with only one infile and one outfile or avoid specifying a name so that the code can define names.");
+    goto done;
+  }
+
+  /* The same generator and context is used for all files */
+  wrwp = WrwpMain_createWrwp(&options);
+  ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+  if (wrwp == NULL || ctx == NULL) {
+    fprintf(stderr, "Failed to create the wrwp generator\n");
+    goto done;
+  }
+
+  fprintf(wrwp_console, "\nGenerated vertical profile/s has ODIM version 2.2\n");
+  fprintf(wrwp_console, "Vertical profile/s will be placed in directory: %s\n", options.outpath);
+
+  /* A failing file does not stop the others, the failures are listed in the summary */
+  failures = malloc(sizeof(const char*) * (strlen(options.infiles) / 2 + 1));
+  if (failures == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    goto done;
+  }
+  strcpy(files, options.infiles);
+  gettimeofday(&start, NULL);
+  for (file = strtok_r(files, ",", &saveptr); file != NULL; file = strtok_r(NULL, ",", &saveptr)) {
+    nfiles++;
+    if (!WrwpMain_processFile(&options, wrwp, ctx, file, rings)) {
+      failures[nfailures++] = file;
+    }
+  }
+  gettimeofday(&end, NULL);
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+
+  fprintf(wrwp_console, "\nProcessed %d volume/s in %.2f s (%.2f volumes/s) using 1 job/s, %d failed\n",
+          nfiles, elapsed, nfiles / (elapsed > 1e-6 ? elapsed : 1e-6), nfailures);
+  WrwpMain_log("INFO", "Processed %d volume/s in %.2f s (%.2f volumes/s) using 1 job/s, %d failed",
+               nfiles, elapsed, nfiles / (elapsed > 1e-6 ? elapsed : 1e-6), nfailures);
+  for (i = 0; i < nfailures; i++) {
+    fprintf(wrwp_console, "  %s: No vertical profile could be generated or written\n", failures[i]);
+    WrwpMain_log("INFO", "Failed %s: No vertical profile could be generated or written", failures[i]);
+  }
+  exitcode = (nfailures == 0) ? 0 : 1;
+
+done:
+  for (i = 0; i < WRWP_MAX_RINGS; i++) {
+    RAVE_OBJECT_RELEASE(rings[i].shm);
+  }
+  RAVE_OBJECT_RELEASE(ctx);
+  RAVE_OBJECT_RELEASE(wrwp);
+  if (wrwp_logfile != NULL) {
+    fclose(wrwp_logfile);
+  }
+  free(failures);
+  free(files);
+  for (i = 0; i < (int)WRWP_NUMBER_OF_OPTIONS; i++) {
+    if (WRWP_OPTIONS[i].type == WrwpOptionType_STRING) {
+      free(*(char**)((char*)&options + WRWP_OPTIONS[i].offset));
+    }
+  }
+  return exitcode;
+}
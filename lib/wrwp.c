@@ -44,6 +44,7 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
  * @date 2025-05-22, inserted KNMI algorithms for screening data going into the wind profile fit.*/
 
 #include "wrwp.h"
+#include "wrwp_kernels.h"
 #include "vertical_profile.h"
 #include "rave_debug.h"
 #include "rave_alloc.h"
@@ -54,6 +55,23 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #include "rave_utilities.h"
 #include "rave_datetime.h"
 
+/**
+ * Size of the buffer holding the used elevation angles (how/angles)
+ */
+#define WRWP_ANGLES_LENGTH 100
+
+/**
+ * Maximum number of unique tasks (how/task) that are collected
+ */
+#define WRWP_MAX_TASKS 15
+
+/**
+ * Wavelength [cm] and squared dielectric factor |K|^2 of water used when converting the reflectivity of
+ * biological echoes to a reflectivity per volume [cm2/km3]
+ */
+#define WRWP_BIO_WAVELENGTH 5.3
+#define WRWP_BIO_DIELECTRIC 0.93
+
 /**
  * Represents one wrwp generator
  */
@@ -81,6 +99,288 @@ struct _Wrwp_t
   double gain_VP; /**< Gain for VP fields */
   double offset_VP; /**< Offset for VP fields */
   double undetect_VP; /**<Undetect for VP fields */
+  WrwpSamplePrecision precision; /**< Precision used when storing the gathered samples */
+  int dealias; /**< If the radial winds are dealiased against a first guess of each layer */
+  double bio_dbzmax; /**< Maximum reflectivity of biological echoes [dBZ] */
+  double bio_rcs; /**< Radar cross section of one biological scatterer [cm2] */
+  double bio_stdmin; /**< Minimum standard deviation of the radial winds of biological echoes [m/s] */
+  int locked; /**< If the configuration has been locked or not */
+};
+
+/**
+ * The information about one accepted scan that is used while generating a profile. The
+ * geometry (height of each bin and the bins sorted by layer) is calculated once per
+ * generation instead of once per layer.
+ */
+typedef struct WrwpInternal_ScanInfo {
+  PolarScan_t* scan;       /**< the scan */
+  PolarScanParam_t* vrad;  /**< the radial wind parameter or NULL if not used */
+  PolarScanParam_t* dbzh;  /**< the reflectivity parameter or NULL if not used */
+  double elangle;          /**< the elevation angle [rad] */
+  double NI;               /**< the Nyquist interval of the radial winds [m/s] */
+  long nbins;              /**< number of bins */
+  long nrays;              /**< number of rays */
+  double* h;               /**< height of each bin [m] */
+  double* d;               /**< distance of each bin along the surface [m] */
+  int* binLayer;           /**< layer index for each bin, -1 if outside the layers or the distance limits */
+  int* layerBins;          /**< the bin indexes sorted by layer */
+  int* layerStart;         /**< start index in layerBins for each layer, nlayers + 1 entries */
+  long binsCapacity;       /**< allocated size of h, d, binLayer and layerBins */
+  int layersCapacity;      /**< allocated size of layerStart */
+  int hasTarget;           /**< if only the gates within tr of a target are used, see \ref WrwpComposite_t */
+  double tx, ty;           /**< position of the radar relative to the target, east and north [m] */
+  double tr;               /**< radius around the target [m] */
+} WrwpInternal_ScanInfo;
+
+/**
+ * The metadata collected from the accepted scans
+ */
+typedef struct {
+  char* angles;                    /**< the used elevation angles, comma separated */
+  char* tasks[WRWP_MAX_TASKS];     /**< the unique tasks in order of appearance */
+  int ntasks;                      /**< number of unique tasks */
+  int nscans;                      /**< number of accepted scans */
+  RaveDateTime_t* startDT;         /**< the first start date/time */
+  RaveDateTime_t* endDT;           /**< the last end date/time */
+} WrwpInternal_Metadata;
+
+/**
+ * The moments of one layer that the profile values are derived from
+ */
+typedef struct {
+  int nv;          /**< number of wind samples used in the fit */
+  double x[NOC];   /**< the fitted wind model, valid if nv > 3 */
+  double chisq;    /**< mean squared residual of the fit */
+  int nz;          /**< number of reflectivity samples */
+  double zsum;     /**< sum of the reflectivity samples [Z] */
+  double zsqdev;   /**< sum of the squared deviations from the mean reflectivity [Z] */
+  int nvvp;        /**< number of wind samples in the fit of the extended VVP model, 0 if not fitted */
+  double xvvp[NOC_VVP]; /**< the fitted extended VVP model, valid if nvvp > 0 */
+  WrwpQuantileSketch zsketch; /**< the reflectivity samples, empty if no percentile is wanted */
+  int bio;         /**< if the biological echoes have been separated */
+  int nvbio;       /**< number of wind samples of biological echoes in the fit, 0 if not fitted */
+  double xbio[NOC]; /**< the wind model fitted to the biological echoes, valid if nvbio > 3 */
+  double chisqbio; /**< mean squared residual of the fit to the biological echoes */
+  int nzbio;       /**< number of reflectivity samples classified as biological */
+  int nzundetect;  /**< number of gates without echo, only counted when the biological echoes are wanted */
+  double zbiosum;  /**< sum of the reflectivity samples classified as biological [Z] */
+} WrwpInternal_LayerMoments;
+
+/**
+ * The partial state of one layer when the scans are streamed
+ */
+typedef struct {
+  WrwpNormalLanes wind; /**< SMHI: the partial sums of the normal equations */
+  int nv;               /**< number of wind samples */
+  double* A;            /**< KNMI: the design rows of the wind samples, NOC per sample */
+  double* v;            /**< KNMI: the wind samples */
+  int* sector;          /**< KNMI: the azimuth sector bin of each wind sample */
+  int capacity;         /**< KNMI: allocated number of samples */
+  int nz;               /**< number of reflectivity samples */
+  double zsum;          /**< sum of the reflectivity samples [Z] */
+  double zmean;         /**< mean of the reflectivity samples [Z] */
+  double zm2;           /**< sum of the squared deviations from zmean */
+  WrwpQuantileSketch zsketch; /**< the reflectivity samples, empty if no percentile is wanted */
+} WrwpInternal_StreamLayer;
+
+/**
+ * The state of a streamed generation, see \ref Wrwp_begin
+ */
+typedef struct {
+  int active;                      /**< if a stream has been started */
+  int isKnmi;                      /**< if the KNMI method is used */
+  int needWind;                    /**< if the wind moment is needed */
+  int needRefl;                    /**< if the reflectivity moment is needed */
+  int quantiles;                   /**< if the reflectivity percentiles are needed */
+  int useFloat;                    /**< if the samples are gathered in single precision */
+  int nlayers;                     /**< number of layers */
+  int dz;                          /**< height interval of the layers [m] */
+  RaveList_t* wantedFields;        /**< the wanted fields */
+  WrwpInternal_StreamLayer* layers; /**< the partial state of each layer */
+  int layersCapacity;              /**< allocated number of layers */
+  WrwpInternal_Metadata metadata;  /**< the metadata of the added scans */
+  PolarNavigator_t* polnav;        /**< the navigator, origin from the first accepted scan */
+  PolarScan_t* first;              /**< the first accepted scan */
+} WrwpInternal_Stream;
+
+/**
+ * The sums of the samples in one layer. Sums of disjoint sets of samples can be added to and
+ * subtracted from each other, e.g. to combine scans in a rolling window or thin layers into thicker ones.
+ */
+typedef struct {
+  WrwpNormalEquations wind; /**< the normal equations of the wind samples */
+  int nz;                   /**< number of reflectivity samples */
+  double zsum;              /**< sum of the reflectivity samples [Z] */
+  double zm2;               /**< sum of the squared deviations from the mean reflectivity [Z] */
+  WrwpQuantileSketch* zsketch; /**< the reflectivity samples, NULL if no percentile is wanted */
+} WrwpInternal_LayerSums;
+
+/**
+ * A scan in a rolling window, only the metadata and the contribution to each layer is kept
+ */
+typedef struct {
+  double elangle;                   /**< elevation angle [rad] */
+  char* task;                       /**< the how/task or NULL */
+  RaveDateTime_t* startDT;          /**< start date/time */
+  RaveDateTime_t* endDT;            /**< end date/time */
+  long endTime;                     /**< end time as seconds since 1970-01-01 */
+  WrwpInternal_LayerSums* layers; /**< the contribution to each layer */
+} WrwpInternal_WindowScan;
+
+/**
+ * Represents a rolling window of scans
+ */
+struct _WrwpWindow_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  Wrwp_t* wrwp;                     /**< the generator, locked */
+  long length;                      /**< length of the window [s] */
+  int needWind;                     /**< if the wind moment is needed */
+  int needRefl;                     /**< if the reflectivity moment is needed */
+  int quantiles;                    /**< if the reflectivity percentiles are needed */
+  int useFloat;                     /**< if the samples are gathered in single precision */
+  int nlayers;                      /**< number of layers */
+  RaveList_t* wantedFields;         /**< the wanted fields */
+  WrwpInternal_WindowScan* scans;   /**< the scans in the window, a ring buffer */
+  int head;                         /**< index of the oldest scan */
+  int nscans;                       /**< number of scans in the window */
+  int scansCapacity;                /**< allocated number of scans */
+  WrwpInternal_LayerSums* total;  /**< the total of all scans in the window */
+  int retired;                      /**< number of retired scans since the total was rebuilt */
+  PolarNavigator_t* polnav;         /**< the navigator */
+  PolarScan_t* latest;              /**< the latest added scan */
+};
+
+/**
+ * Number of retired scans after which the total of a window is rebuilt from the scans, bounds the
+ * rounding errors from subtracting the retired contributions.
+ */
+#define WRWP_WINDOW_REBUILD 64
+
+/**
+ * Maximum length of the how/nodes of a composite
+ */
+#define WRWP_NODES_LENGTH 256
+
+/**
+ * Represents a composite of several radars around a target
+ */
+struct _WrwpComposite_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  Wrwp_t* wrwp;                     /**< the generator, locked */
+  double lat;                       /**< latitude of the target [rad] */
+  double lon;                       /**< longitude of the target [rad] */
+  int needWind;                     /**< if the wind moment is needed */
+  int needRefl;                     /**< if the reflectivity moment is needed */
+  int quantiles;                    /**< if the reflectivity percentiles are needed */
+  int useFloat;                     /**< if the samples are gathered in single precision */
+  int nlayers;                      /**< number of layers */
+  RaveList_t* wantedFields;         /**< the wanted fields */
+  WrwpInternal_LayerSums* total;    /**< the total of all radars */
+  WrwpInternal_WindowScan* scans;   /**< the metadata of the used scans, layers is always NULL */
+  int nscans;                       /**< number of used scans */
+  int scansCapacity;                /**< allocated number of scans */
+  int nradars;                      /**< number of added radars */
+  char nodes[WRWP_NODES_LENGTH];    /**< the nodes of the added radars, e.g. 'seang','sehem' */
+  PolarNavigator_t* polnav;         /**< the navigator, origin at the target */
+  PolarVolume_t* first;             /**< the first added volume */
+};
+
+/**
+ * The grid of the torus mapping search when dealiasing. The coarse grid covers +- ff_max (at most
+ * WRWP_DEALIAS_MAX_POINTS points per component) and the fine grid covers +- one coarse step.
+ */
+#define WRWP_DEALIAS_COARSE_STEP 4.0
+#define WRWP_DEALIAS_FINE_POINTS 17
+#define WRWP_DEALIAS_MAX_POINTS 31
+
+/**
+ * A scan decoded once for a sweep over several configurations, see \ref Wrwp_generateConfigurations
+ */
+typedef struct {
+  PolarScan_t* scan;  /**< the scan */
+  double elangle;     /**< the elevation angle [rad] */
+  double NI;          /**< the Nyquist interval */
+  long nbins;         /**< number of bins */
+  long nrays;         /**< number of rays */
+  double* h;          /**< height of each bin [m] */
+  double* d;          /**< distance of each bin along the surface [m] */
+  int* binLayer;      /**< layer index for each bin in the configuration currently evaluated, -1 if not used */
+  int* raySector;     /**< azimuth sector of each ray, NULL if the profiles are not resolved by sector */
+} WrwpInternal_SweepScan;
+
+/**
+ * The valid samples of the decoded scans in the order they are gathered, i.e. scan by scan, ray by
+ * ray and bin by bin
+ */
+typedef struct {
+  int n;          /**< number of samples */
+  int capacity;   /**< allocated number of samples */
+  int* scan;      /**< index of the scan */
+  int* gate;      /**< ray * nbins + bin */
+  double* value;  /**< the radial wind [m/s] or the reflectivity [Z] */
+} WrwpInternal_SweepSamples;
+
+/**
+ * The scans and samples decoded once and shared by several profiles
+ */
+typedef struct {
+  WrwpInternal_SweepScan* scans; /**< the decoded scans */
+  int nscans;                    /**< number of decoded scans */
+  int capacity;                  /**< allocated number of scans */
+  WrwpInternal_SweepSamples wind; /**< the radial wind samples */
+  WrwpInternal_SweepSamples refl; /**< the reflectivity samples */
+} WrwpInternal_Sweep;
+
+/**
+ * Represents the execution context used by one thread when generating profiles
+ */
+struct _WrwpContext_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  double *A, *Atmp, *b, *v, *vfit, *az, *el, *z; /**< double precision buffers, NOR samples each */
+  float *fA, *fv, *faz, *fel, *fz; /**< single precision buffers, NOR samples each */
+  int* sector; /**< azimuth sector bin for each wind sample, NOR samples */
+  double *vvpA, *vvpb; /**< design rows (NOC_VVP per sample) and samples of the extended VVP model, NOR samples */
+  int vvp; /**< if the extended VVP model is fitted in the current generation */
+  double* unfold; /**< azimuth, elevation and Nyquist interval of the wind samples when dealiasing, NOR of each */
+  double* torus; /**< the sample groups of the torus mapping when dealiasing, NOR of C, S, ka and kb */
+  int dealias; /**< if the wind samples are dealiased in the current generation */
+  int quantiles; /**< if the reflectivity samples are added to a quantile sketch in the current generation */
+  double* bioA; /**< design columns (NOC) of the wind samples when separating the biological echoes, NOR of each */
+  double* biob; /**< the wind samples when separating the biological echoes, NOR samples */
+  int* bioFlag; /**< if the reflectivity at the gate of each wind sample is biological, NOR samples */
+  int bio; /**< if the biological echoes are separated in the current generation */
+  int nundetect; /**< number of gates without echo gathered for the current layer when separating the biological echoes */
+  WrwpInternal_ScanInfo* scans; /**< the accepted scans */
+  int nscans; /**< number of used entries in scans */
+  int scansCapacity; /**< allocated number of entries in scans */
+  WrwpInternal_Stream stream; /**< the state of a streamed generation */
+};
+
+/**
+ * Represents the derived profile as a struct of arrays
+ */
+struct _WrwpResult_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  int levels; /**< number of layers */
+  int interval; /**< height interval of the layers [m] */
+  int wanted[WrwpResultField_COUNT]; /**< if the field has been asked for */
+  double* data; /**< one column with levels values for each field, stored after each other */
+  RaveDateTime_t* startDT; /**< start date/time of the first scan */
+  RaveDateTime_t* endDT; /**< end date/time of the last scan */
+  char* angles; /**< comma separated list of the used elevation angles */
+  char* tasks; /**< comma separated list of the unique tasks, NULL if there were none */
+};
+
+/**
+ * The names of the result fields, in the same order as WrwpResultField
+ */
+static const char* WRWP_RESULT_FIELD_NAMES[WrwpResultField_COUNT] = {
+  "HGHT", "NV", "UWND", "VWND", "ff", "ff_dev", "dd", "DBZH", "DBZH_dev", "NZ", "div", "def", "ad",
+  "DBZH_p10", "DBZH_p50", "DBZH_p90", "eta", "dens", "ff_bio", "dd_bio", "bio_frac"
 };
 
 /*@{ Private functions */
@@ -112,6 +412,49 @@ static int Wrwp_constructor(RaveCoreObject* obj)
   wrwp->undetect_VP = UNDETECT_VP;
   wrwp->gain_VP = GAIN_VP; /* The gain cannot be initialized to 0.0! */
   wrwp->offset_VP = OFFSET_VP;
+  wrwp->precision = WrwpSamplePrecision_DOUBLE;
+  wrwp->dealias = 0;
+  wrwp->bio_dbzmax = BIO_DBZMAX;
+  wrwp->bio_rcs = BIO_RCS;
+  wrwp->bio_stdmin = BIO_STDMIN;
+  wrwp->locked = 0;
+  return 1;
+}
+
+/**
+ * Copy constructor, the copy will not be locked
+ */
+static int Wrwp_copyconstructor(RaveCoreObject* obj, RaveCoreObject* srcobj)
+{
+  Wrwp_t* this = (Wrwp_t*)obj;
+  Wrwp_t* src = (Wrwp_t*)srcobj;
+  this->dz = src->dz;
+  this->hmax = src->hmax;
+  this->dmin = src->dmin;
+  this->dmax = src->dmax;
+  this->nmin_wnd = src->nmin_wnd;
+  this->nmin_ref = src->nmin_ref;
+  this->emin = src->emin;
+  this->emax = src->emax;
+  this->econdmax = src->econdmax;
+  this->hthr = src->hthr;
+  this->nimin = src->nimin;
+  this->ngapbin = src->ngapbin;
+  this->ngapmin = src->ngapmin;
+  this->maxnstd = src->maxnstd;
+  this->maxvdiff = src->maxvdiff;
+  this->ff_max = src->ff_max;
+  this->vmin = src->vmin;
+  this->nodata_VP = src->nodata_VP;
+  this->gain_VP = src->gain_VP;
+  this->offset_VP = src->offset_VP;
+  this->undetect_VP = src->undetect_VP;
+  this->precision = src->precision;
+  this->dealias = src->dealias;
+  this->bio_dbzmax = src->bio_dbzmax;
+  this->bio_rcs = src->bio_rcs;
+  this->bio_stdmin = src->bio_stdmin;
+  this->locked = 0;
   return 1;
 }
 
@@ -122,962 +465,2098 @@ static void Wrwp_destructor(RaveCoreObject* obj)
 {
 }
 
-static int WrwpInternal_findAndAddAttribute(VerticalProfile_t* vp, PolarVolume_t* pvol, const char* name, double minSelAng, double maxSelAng)
+/**
+ * Returns if two generators have the same configuration, i.e. if they derive the same profiles.
+ * @param[in] a - a generator
+ * @param[in] b - another generator
+ * @returns 1 if all settings are equal, otherwise 0
+ */
+static int WrwpInternal_isSameConfiguration(Wrwp_t* a, Wrwp_t* b)
 {
-  int nscans = PolarVolume_getNumberOfScans(pvol);
-  int i = 0;
-  int found = 0;
-  double elangleForThisScan = 0.0;
-  
-  for (i = 0; i < nscans && found == 0; i++) {
-    PolarScan_t* scan = PolarVolume_getScan(pvol, i);
-    if (scan != NULL && PolarScan_hasAttribute(scan, name)) {
-        elangleForThisScan = PolarScan_getElangle(scan);
-        
-        /* Filter with respect to the selected min elangle and max elangle*/
-        if ((elangleForThisScan * RAD2DEG) >= minSelAng && (elangleForThisScan * RAD2DEG) <= maxSelAng) {
-          RaveAttribute_t* attr = PolarScan_getAttribute(scan, name);
-          VerticalProfile_addAttribute(vp, attr);
-          found = 1;
-          RAVE_OBJECT_RELEASE(attr);
-        }
-    }
-    RAVE_OBJECT_RELEASE(scan);
-  }
-  return found;
+  return a->dz == b->dz && a->hmax == b->hmax && a->dmin == b->dmin && a->dmax == b->dmax &&
+         a->nmin_wnd == b->nmin_wnd && a->nmin_ref == b->nmin_ref && a->emin == b->emin &&
+         a->emax == b->emax && a->econdmax == b->econdmax && a->hthr == b->hthr && a->nimin == b->nimin &&
+         a->ngapbin == b->ngapbin && a->ngapmin == b->ngapmin && a->maxnstd == b->maxnstd &&
+         a->maxvdiff == b->maxvdiff && a->ff_max == b->ff_max && a->vmin == b->vmin &&
+         a->nodata_VP == b->nodata_VP && a->gain_VP == b->gain_VP && a->offset_VP == b->offset_VP &&
+         a->undetect_VP == b->undetect_VP && a->precision == b->precision && a->dealias == b->dealias &&
+         a->bio_dbzmax == b->bio_dbzmax && a->bio_rcs == b->bio_rcs && a->bio_stdmin == b->bio_stdmin;
 }
 
-static int WrwpInternal_addDoubleAttribute(VerticalProfile_t* vp, const char* name, double value)
+/**
+ * Returns if the generator may be modified, logs an error if it has been locked.
+ * @param[in] self - self
+ * @returns 1 if the configuration may be changed, otherwise 0
+ */
+static int WrwpInternal_isModifiable(Wrwp_t* self)
 {
-  RaveAttribute_t* attr = RaveAttributeHelp_createDouble(name, value);
-  int result = 0;
-  if (attr != NULL) {
-    result = VerticalProfile_addAttribute(vp, attr);
+  if (self->locked) {
+    RAVE_ERROR0("Trying to modify a locked wrwp generator");
+    return 0;
   }
-  RAVE_OBJECT_RELEASE(attr);
-  return result;
+  return 1;
 }
 
-static int WrwpInternal_addStringAttribute(VerticalProfile_t* vp, const char* name, const char* value)
+/**
+ * Constructor
+ */
+static int WrwpContext_constructor(RaveCoreObject* obj)
 {
-  RaveAttribute_t* attr = RaveAttributeHelp_createString(name, value);
-  int result = 0;
-  if (attr != NULL) {
-    result = VerticalProfile_addAttribute(vp, attr);
-  }
-  RAVE_OBJECT_RELEASE(attr);
-  return result;
+  WrwpContext_t* ctx = (WrwpContext_t*)obj;
+  ctx->A = ctx->Atmp = ctx->b = ctx->v = ctx->vfit = ctx->az = ctx->el = ctx->z = NULL;
+  ctx->fA = ctx->fv = ctx->faz = ctx->fel = ctx->fz = NULL;
+  ctx->sector = NULL;
+  ctx->vvpA = ctx->vvpb = NULL;
+  ctx->unfold = ctx->torus = NULL;
+  ctx->bioA = ctx->biob = NULL;
+  ctx->bioFlag = NULL;
+  ctx->scans = NULL;
+  ctx->nscans = 0;
+  ctx->scansCapacity = 0;
+  memset(&ctx->stream, 0, sizeof(WrwpInternal_Stream));
+  return 1;
 }
- 
-static char* WrwpInternal_LastcharDel(char* name)
+
+/**
+ * Releases the references to the scans that has been used during a generation. The
+ * geometry arrays are kept so that they can be reused.
+ * @param[in] ctx - the context
+ */
+static void WrwpInternal_releaseScanInfos(WrwpContext_t* ctx)
 {
   int i = 0;
-  while(name[i] != '\0')
-  {
-  i++;       
+  for (i = 0; i < ctx->nscans; i++) {
+    RAVE_OBJECT_RELEASE(ctx->scans[i].scan);
+    RAVE_OBJECT_RELEASE(ctx->scans[i].vrad);
+    RAVE_OBJECT_RELEASE(ctx->scans[i].dbzh);
   }
-  name[i-1] = '\0';
-  return name;
+  ctx->nscans = 0;
 }
 
-/* Function that adds various quantities under a field's what in order to
-   better resemble the function existing in vertical profiles from N2 */
-static int WrwpInternal_addDoubleAttr2Field(RaveField_t* field, const char* name, double quantity)
+/**
+ * Clears the stream state of the context, allocated layer memory is kept so that it can be reused.
+ * @param[in] ctx - the context
+ */
+static void WrwpInternal_resetStream(WrwpContext_t* ctx)
 {
-  int result = 0;
-  RaveAttribute_t* attr = RaveAttributeHelp_createDouble(name, quantity);
-  result = RaveField_addAttribute(field, attr);
-  if (attr == NULL || !result) {
-    RAVE_ERROR1("Failed to add %s attribute to field", name);
-    goto done;
+  WrwpInternal_Stream* stream = &ctx->stream;
+  int i = 0;
+  RaveList_freeAndDestroy(&stream->wantedFields);
+  RAVE_FREE(stream->metadata.angles);
+  for (i = 0; i < stream->metadata.ntasks; i++) {
+    RAVE_FREE(stream->metadata.tasks[i]);
   }
-  RAVE_OBJECT_RELEASE(attr);
-done:
-  return result;
+  RAVE_OBJECT_RELEASE(stream->metadata.startDT);
+  RAVE_OBJECT_RELEASE(stream->metadata.endDT);
+  memset(&stream->metadata, 0, sizeof(WrwpInternal_Metadata));
+  RAVE_OBJECT_RELEASE(stream->polnav);
+  RAVE_OBJECT_RELEASE(stream->first);
+  stream->active = 0;
 }
 
 /**
- * Returns a tokenized list (or empty) of fields that is wanted
- * @param[in] fieldsToGenerate - the fields to generate
- * @returns the list of wanted fields
+ * Makes sure that the layer can hold the specified number of wind samples
+ * @param[in] layer - the layer
+ * @param[in] n - the number of samples
+ * @returns 1 on success, 0 on memory allocation failure
  */
-static RaveList_t* WrwpInternal_createFieldsList(const char* fieldsToGenerate)
+static int WrwpInternal_ensureStreamLayerCapacity(WrwpInternal_StreamLayer* layer, int n)
 {
-  RaveList_t* result = RaveUtilities_getTrimmedTokens(fieldsToGenerate, ',');
-  if (RaveList_size(result) == 0) {
-    RaveList_add(result, RAVE_STRDUP("ff"));
-    RaveList_add(result, RAVE_STRDUP("ff_dev"));
-    RaveList_add(result, RAVE_STRDUP("dd"));
-    RaveList_add(result, RAVE_STRDUP("NV"));
-    RaveList_add(result, RAVE_STRDUP("DBZH"));
-    RaveList_add(result, RAVE_STRDUP("DBZH_dev"));
-    RaveList_add(result, RAVE_STRDUP("NZ"));
+  if (n > layer->capacity) {
+    int ncapacity = layer->capacity == 0 ? 1024 : layer->capacity;
+    double *A = NULL, *v = NULL;
+    int* sector = NULL;
+    while (ncapacity < n) {
+      ncapacity *= 2;
+    }
+    A = RAVE_REALLOC(layer->A, sizeof(double) * ncapacity * NOC);
+    if (A == NULL) {
+      return 0;
+    }
+    layer->A = A;
+    v = RAVE_REALLOC(layer->v, sizeof(double) * ncapacity);
+    if (v == NULL) {
+      return 0;
+    }
+    layer->v = v;
+    sector = RAVE_REALLOC(layer->sector, sizeof(int) * ncapacity);
+    if (sector == NULL) {
+      return 0;
+    }
+    layer->sector = sector;
+    layer->capacity = ncapacity;
   }
-  return result;
+  return 1;
 }
 
 /**
- * Returns if the specified id exist as an id in the fieldIds.
- * @param[in] fieldIds - the list of ids
- * @param[in] id - the id to query for
- * @returns if the list of ids contains the specified id
+ * Reserves room in each layer of the stream for all wind samples that a scan can add, so that the
+ * samples can be folded into the layers without failing half way through the scan. Only the
+ * KNMI method keeps the samples.
+ * @param[in] stream - the stream
+ * @param[in] info - the scan information
+ * @returns 1 on success, 0 on memory allocation failure
  */
-static int WrwpInternal_containsField(RaveList_t* fieldIds, const char* id)
+static int WrwpInternal_reserveStreamLayers(WrwpInternal_Stream* stream, WrwpInternal_ScanInfo* info)
 {
-  int i = 0, n = 0;
-  n = RaveList_size(fieldIds);
-  for (i = 0; i < n; i++) {
-    if (RaveList_get(fieldIds, i) != NULL && strcmp((char*)RaveList_get(fieldIds, i), id) == 0) {
-      return 1;
-    }
+  int yindex = 0;
+  if (!stream->isKnmi || info->vrad == NULL) {
+    return 1;
   }
-  return 0;
-}
-/* Adds attributes under a fileds what */
-static int WrwpInternal_addNodataUndetectGainOffset(RaveField_t* field, double nodata, double undetect, double gain, double offset)
-{
-  if (!WrwpInternal_addDoubleAttr2Field(field, "what/nodata", nodata) ||
-      !WrwpInternal_addDoubleAttr2Field(field, "what/undetect", undetect) ||
-      !WrwpInternal_addDoubleAttr2Field(field, "what/gain", gain) ||
-      !WrwpInternal_addDoubleAttr2Field(field, "what/offset", offset)) {
-    return 0;
+  for (yindex = 0; yindex < stream->nlayers; yindex++) {
+    WrwpInternal_StreamLayer* layer = &stream->layers[yindex];
+    long n = info->nrays * (info->layerStart[yindex + 1] - info->layerStart[yindex]);
+    if (n > NOR - layer->nv) {
+      n = NOR - layer->nv;
+    }
+    if (!WrwpInternal_ensureStreamLayerCapacity(layer, layer->nv + (int)n)) {
+      return 0;
+    }
   }
   return 1;
 }
 
-/* Gathering of startdatetime and enddatetime */
-static RaveDateTime_t* WrwpInternal_getStartDateTimeFromScan(PolarScan_t* scan)
+/**
+ * Destructor
+ */
+static void WrwpContext_destructor(RaveCoreObject* obj)
 {
-  RaveDateTime_t* dt = RAVE_OBJECT_NEW(&RaveDateTime_TYPE);
-  RaveDateTime_t* result = NULL;
-  if (dt != NULL) {
-    if (!RaveDateTime_setDate(dt, PolarScan_getStartDate(scan)) ||
-        !RaveDateTime_setTime(dt, PolarScan_getStartTime(scan))) {
-      RAVE_WARNING0("Failed to initialize datetime object with start date/time");
-      goto done;
-    }
+  WrwpContext_t* ctx = (WrwpContext_t*)obj;
+  int i = 0;
+  WrwpInternal_releaseScanInfos(ctx);
+  WrwpInternal_resetStream(ctx);
+  for (i = 0; i < ctx->stream.layersCapacity; i++) {
+    RAVE_FREE(ctx->stream.layers[i].A);
+    RAVE_FREE(ctx->stream.layers[i].v);
+    RAVE_FREE(ctx->stream.layers[i].sector);
   }
-  result = RAVE_OBJECT_COPY(dt);
-done:
-  RAVE_OBJECT_RELEASE(dt);
-  return result;
+  RAVE_FREE(ctx->stream.layers);
+  for (i = 0; i < ctx->scansCapacity; i++) {
+    RAVE_FREE(ctx->scans[i].h);
+    RAVE_FREE(ctx->scans[i].d);
+    RAVE_FREE(ctx->scans[i].binLayer);
+    RAVE_FREE(ctx->scans[i].layerBins);
+    RAVE_FREE(ctx->scans[i].layerStart);
+  }
+  RAVE_FREE(ctx->scans);
+  RAVE_FREE(ctx->A);
+  RAVE_FREE(ctx->Atmp);
+  RAVE_FREE(ctx->b);
+  RAVE_FREE(ctx->v);
+  RAVE_FREE(ctx->vfit);
+  RAVE_FREE(ctx->az);
+  RAVE_FREE(ctx->el);
+  RAVE_FREE(ctx->z);
+  RAVE_FREE(ctx->vvpA);
+  RAVE_FREE(ctx->vvpb);
+  RAVE_FREE(ctx->unfold);
+  RAVE_FREE(ctx->torus);
+  RAVE_FREE(ctx->bioA);
+  RAVE_FREE(ctx->biob);
+  RAVE_FREE(ctx->bioFlag);
+  RAVE_FREE(ctx->fA);
+  RAVE_FREE(ctx->fv);
+  RAVE_FREE(ctx->faz);
+  RAVE_FREE(ctx->fel);
+  RAVE_FREE(ctx->fz);
+  RAVE_FREE(ctx->sector);
 }
 
-static RaveDateTime_t* WrwpInternal_getEndDateTimeFromScan(PolarScan_t* scan)
+/**
+ * Constructor
+ */
+static int WrwpResult_constructor(RaveCoreObject* obj)
 {
-  RaveDateTime_t* dt = RAVE_OBJECT_NEW(&RaveDateTime_TYPE);
-  RaveDateTime_t* result = NULL;
-  if (dt != NULL) {
-    if (!RaveDateTime_setDate(dt, PolarScan_getEndDate(scan)) ||
-        !RaveDateTime_setTime(dt, PolarScan_getEndTime(scan))) {
-      RAVE_WARNING0("Failed to initialize datetime object with end date/time");
-      goto done;
-    }
+  WrwpResult_t* res = (WrwpResult_t*)obj;
+  int i = 0;
+  res->levels = 0;
+  res->interval = 0;
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    res->wanted[i] = 0;
   }
-  result = RAVE_OBJECT_COPY(dt);
-done:
-  RAVE_OBJECT_RELEASE(dt);
-  return result;
+  res->data = NULL;
+  res->startDT = NULL;
+  res->endDT = NULL;
+  res->angles = NULL;
+  res->tasks = NULL;
+  return 1;
 }
 
-
-int WrwpInternal_getDoubleAttribute(RaveCoreObject* obj, const char* aname, double* tmpd) {
-  RaveAttribute_t* attr = NULL;
-  int ret = 0;
-
-  if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarVolume_TYPE)) {
-    attr = PolarVolume_getAttribute((PolarVolume_t*)obj, aname);
-  } else if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarScan_TYPE)) {
-    attr = PolarScan_getAttribute((PolarScan_t*)obj, aname);
-  } else if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarScanParam_TYPE)) {
-    attr = PolarScanParam_getAttribute((PolarScanParam_t*)obj, aname);
-  }
-  if (attr != NULL) {
-    ret = RaveAttribute_getDouble(attr, tmpd);
-  }
-  RAVE_OBJECT_RELEASE(attr);
-  return ret;
+/**
+ * Destructor
+ */
+static void WrwpResult_destructor(RaveCoreObject* obj)
+{
+  WrwpResult_t* res = (WrwpResult_t*)obj;
+  RAVE_FREE(res->data);
+  RAVE_OBJECT_RELEASE(res->startDT);
+  RAVE_OBJECT_RELEASE(res->endDT);
+  RAVE_FREE(res->angles);
+  RAVE_FREE(res->tasks);
 }
 
-
 /**
- * This function detects gaps in the azimuthal distribution. For this, a histogram of the azimuths of the available
- * velocity data is made using 'nGapBin' azimuth bins. Subsequently, the number of data points per azimuth
- * bin is determined. When two consecutive azimuth bins contain less than 'nGapMin' points, a gap is detected.
- * @param[in] az - the azimuths for which there is valid data
- * @param[in] Npnt - the number of azimuths in az
- * @param[in] nGapBin - the number of azimuth bins to use for detecting gaps (bin size is hence (360 / nGapBin)
- * @param[in] nGapMin - the minimum number of valid points within a bin necessary to avoid returning gap = 1
- * @returns true (1) when a gap is detected and false (0) when no gap is found.
+ * Allocates the sums of n layers in one block. The block is followed by one quantile sketch per
+ * layer only if the percentiles are wanted, so that the sums of a scan stay small otherwise. The
+ * block is released with RAVE_FREE.
+ * @param[in] n - the number of layers
+ * @param[in] quantiles - if the reflectivity percentiles are wanted
+ * @returns the zeroed sums or NULL on memory allocation failure
  */
-int WrwpInternal_azimuthGap(double *az, int Npnt, int nGapBin, int nGapMin)
+static WrwpInternal_LayerSums* WrwpInternal_createLayerSums(int n, int quantiles)
 {
-  int gap, Nsector[nGapBin], n, m;
-    
-  /*Initialize histogram.*/
-  gap = 0;
-  for (m = 0; m < nGapBin; m++) {
-    Nsector[m] = 0;
+  WrwpInternal_LayerSums* sums = NULL;
+  int i = 0;
+  if (n < 1) {
+    n = 1;
   }
-    
-  /*Collect histogram.*/
-  for (n = 0; n < Npnt; n++) {
-    m = (az[n] * RAD2DEG * nGapBin) / 360.0;
-    Nsector[m % nGapBin]++;
-  }
-    
-  /*Detect gaps.*/
-  gap = 0;
-  for (m = 0; m < nGapBin; m++) {
-    if ((Nsector[m] < nGapMin) && (Nsector[(m + 1) % nGapBin] < nGapMin)) {
-      gap = 1;
+  sums = RAVE_CALLOC((size_t)n, sizeof(WrwpInternal_LayerSums) + (quantiles ? sizeof(WrwpQuantileSketch) : 0));
+  if (sums != NULL && quantiles) {
+    WrwpQuantileSketch* sketches = (WrwpQuantileSketch*)(sums + n);
+    for (i = 0; i < n; i++) {
+      sums[i].zsketch = &sketches[i];
     }
   }
-    
-  return gap;
+  return sums;
 }
 
-
-/*@} End of Private functions */
-
-/*@{ Interface functions */
-void Wrwp_setDZ(Wrwp_t* self, int dz)
+/**
+ * Resets the sums of n layers, the sketches are emptied but kept
+ * @param[in] sums - the sums
+ * @param[in] n - the number of layers
+ */
+static void WrwpInternal_resetLayerSums(WrwpInternal_LayerSums* sums, int n)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->dz = dz;
+  int i = 0;
+  for (i = 0; i < n; i++) {
+    WrwpQuantileSketch* zsketch = sums[i].zsketch;
+    memset(&sums[i], 0, sizeof(WrwpInternal_LayerSums));
+    if (zsketch != NULL) {
+      WrwpKernel_initSketch(zsketch);
+      sums[i].zsketch = zsketch;
+    }
+  }
 }
 
-int Wrwp_getDZ(Wrwp_t* self)
+/**
+ * Releases the metadata and the layers of a scan in a rolling window
+ * @param[in] wscan - the scan
+ */
+static void WrwpInternal_clearWindowScan(WrwpInternal_WindowScan* wscan)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->dz;
+  RAVE_FREE(wscan->task);
+  RAVE_OBJECT_RELEASE(wscan->startDT);
+  RAVE_OBJECT_RELEASE(wscan->endDT);
+  RAVE_FREE(wscan->layers);
 }
 
-void Wrwp_setNODATA_VP(Wrwp_t* self, int nodata_VP)
+/**
+ * Removes all scans from the window
+ * @param[in] window - the window
+ */
+static void WrwpInternal_clearWindow(WrwpWindow_t* window)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->nodata_VP = nodata_VP;
+  int i = 0;
+  for (i = 0; i < window->nscans; i++) {
+    WrwpInternal_clearWindowScan(&window->scans[(window->head + i) % window->scansCapacity]);
+  }
+  window->head = 0;
+  window->nscans = 0;
+  window->retired = 0;
+  if (window->total != NULL) {
+    WrwpInternal_resetLayerSums(window->total, window->nlayers);
+  }
+  RAVE_OBJECT_RELEASE(window->latest);
 }
 
-int Wrwp_getNODATA_VP(Wrwp_t* self)
+/**
+ * Constructor
+ */
+static int WrwpWindow_constructor(RaveCoreObject* obj)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->nodata_VP;
+  WrwpWindow_t* window = (WrwpWindow_t*)obj;
+  window->wrwp = NULL;
+  window->length = 0;
+  window->needWind = window->needRefl = window->quantiles = window->useFloat = 0;
+  window->nlayers = 0;
+  window->wantedFields = NULL;
+  window->scans = NULL;
+  window->head = window->nscans = window->scansCapacity = 0;
+  window->total = NULL;
+  window->retired = 0;
+  window->latest = NULL;
+  window->polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  return (window->polnav != NULL);
 }
 
-void Wrwp_setUNDETECT_VP(Wrwp_t* self, int undetect_VP)
+/**
+ * Destructor
+ */
+static void WrwpWindow_destructor(RaveCoreObject* obj)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->undetect_VP = undetect_VP;
+  WrwpWindow_t* window = (WrwpWindow_t*)obj;
+  WrwpInternal_clearWindow(window);
+  RAVE_FREE(window->scans);
+  RAVE_FREE(window->total);
+  RaveList_freeAndDestroy(&window->wantedFields);
+  RAVE_OBJECT_RELEASE(window->polnav);
+  RAVE_OBJECT_RELEASE(window->wrwp);
 }
 
-int Wrwp_getUNDETECT_VP(Wrwp_t* self)
+/**
+ * Removes all radars from the composite
+ * @param[in] composite - the composite
+ */
+static void WrwpInternal_clearComposite(WrwpComposite_t* composite)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->undetect_VP;
+  int i = 0;
+  for (i = 0; i < composite->nscans; i++) {
+    WrwpInternal_clearWindowScan(&composite->scans[i]);
+  }
+  composite->nscans = 0;
+  composite->nradars = 0;
+  composite->nodes[0] = '\0';
+  if (composite->total != NULL) {
+    WrwpInternal_resetLayerSums(composite->total, composite->nlayers);
+  }
+  RAVE_OBJECT_RELEASE(composite->first);
 }
 
-void Wrwp_setGAIN_VP(Wrwp_t* self, double gain_VP)
+/**
+ * Constructor
+ */
+static int WrwpComposite_constructor(RaveCoreObject* obj)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  if (gain_VP == 0.0) {
-    RAVE_ERROR0("Trying to set gain to 0.0");
-    return;
-  }
-  self->gain_VP = gain_VP;
+  WrwpComposite_t* composite = (WrwpComposite_t*)obj;
+  composite->wrwp = NULL;
+  composite->lat = composite->lon = 0.0;
+  composite->needWind = composite->needRefl = composite->quantiles = composite->useFloat = 0;
+  composite->nlayers = 0;
+  composite->wantedFields = NULL;
+  composite->total = NULL;
+  composite->scans = NULL;
+  composite->nscans = composite->scansCapacity = 0;
+  composite->nradars = 0;
+  composite->nodes[0] = '\0';
+  composite->first = NULL;
+  composite->polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  return (composite->polnav != NULL);
 }
 
-double Wrwp_getGAIN_VP(Wrwp_t* self)
+/**
+ * Destructor
+ */
+static void WrwpComposite_destructor(RaveCoreObject* obj)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->gain_VP;
+  WrwpComposite_t* composite = (WrwpComposite_t*)obj;
+  WrwpInternal_clearComposite(composite);
+  RAVE_FREE(composite->scans);
+  RAVE_FREE(composite->total);
+  RaveList_freeAndDestroy(&composite->wantedFields);
+  RAVE_OBJECT_RELEASE(composite->polnav);
+  RAVE_OBJECT_RELEASE(composite->wrwp);
 }
 
-void Wrwp_setOFFSET_VP(Wrwp_t* self, double offset_VP)
+/**
+ * Makes sure that the sample buffers needed for a generation has been allocated. Buffers
+ * that already exist are reused, they are not cleared since only the first nv/nz samples
+ * are ever read.
+ * @param[in] ctx - the context
+ * @param[in] needWind - if the wind buffers are needed
+ * @param[in] needRefl - if the reflectivity buffers are needed
+ * @param[in] useFloat - if the single precision buffers are needed
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_ensureSampleBuffers(WrwpContext_t* ctx, int needWind, int needRefl, int useFloat)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->offset_VP = offset_VP;
+  if (needWind) {
+    if (ctx->A == NULL) ctx->A = RAVE_MALLOC(sizeof(double) * NOR * NOC);
+    if (ctx->Atmp == NULL) ctx->Atmp = RAVE_MALLOC(sizeof(double) * NOR * NOC);
+    if (ctx->b == NULL) ctx->b = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->v == NULL) ctx->v = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->vfit == NULL) ctx->vfit = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->az == NULL) ctx->az = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->el == NULL) ctx->el = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->sector == NULL) ctx->sector = RAVE_MALLOC(sizeof(int) * NOR);
+    if (ctx->A == NULL || ctx->Atmp == NULL || ctx->b == NULL || ctx->v == NULL ||
+        ctx->vfit == NULL || ctx->az == NULL || ctx->el == NULL || ctx->sector == NULL) {
+      return 0;
+    }
+    if (useFloat) {
+      if (ctx->fA == NULL) ctx->fA = RAVE_MALLOC(sizeof(float) * NOR * NOC);
+      if (ctx->fv == NULL) ctx->fv = RAVE_MALLOC(sizeof(float) * NOR);
+      if (ctx->faz == NULL) ctx->faz = RAVE_MALLOC(sizeof(float) * NOR);
+      if (ctx->fel == NULL) ctx->fel = RAVE_MALLOC(sizeof(float) * NOR);
+      if (ctx->fA == NULL || ctx->fv == NULL || ctx->faz == NULL || ctx->fel == NULL) {
+        return 0;
+      }
+    }
+  }
+  if (needRefl) {
+    if (useFloat) {
+      if (ctx->fz == NULL) ctx->fz = RAVE_MALLOC(sizeof(float) * NOR);
+      if (ctx->fz == NULL) {
+        return 0;
+      }
+    } else {
+      if (ctx->z == NULL) ctx->z = RAVE_MALLOC(sizeof(double) * NOR);
+      if (ctx->z == NULL) {
+        return 0;
+      }
+    }
+  }
+  return 1;
 }
 
-double Wrwp_getOFFSET_VP(Wrwp_t* self)
+/**
+ * Selects the optional stages of the layer fit in the current generation, the extended VVP model, the
+ * dealiasing, the reflectivity percentiles and the separation of the biological echoes, and makes sure
+ * that their buffers are allocated.
+ * @param[in] ctx - the context
+ * @param[in] vvp - if the extended VVP model should be fitted
+ * @param[in] dealias - if the wind samples should be dealiased
+ * @param[in] quantiles - if the reflectivity samples should be added to a quantile sketch
+ * @param[in] bio - if the biological echoes should be separated
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_ensureStageBuffers(WrwpContext_t* ctx, int vvp, int dealias, int quantiles, int bio)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->offset_VP;
+  ctx->vvp = 0;
+  ctx->dealias = 0;
+  ctx->quantiles = quantiles ? 1 : 0;
+  ctx->bio = 0;
+  ctx->nundetect = 0;
+  if (bio) {
+    if (ctx->bioA == NULL) ctx->bioA = RAVE_MALLOC(sizeof(double) * NOR * NOC);
+    if (ctx->biob == NULL) ctx->biob = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->bioFlag == NULL) ctx->bioFlag = RAVE_MALLOC(sizeof(int) * NOR);
+    if (ctx->bioA == NULL || ctx->biob == NULL || ctx->bioFlag == NULL) {
+      return 0;
+    }
+    ctx->bio = 1;
+  }
+  if (vvp) {
+    if (ctx->vvpA == NULL) ctx->vvpA = RAVE_MALLOC(sizeof(double) * NOR * NOC_VVP);
+    if (ctx->vvpb == NULL) ctx->vvpb = RAVE_MALLOC(sizeof(double) * NOR);
+    if (ctx->vvpA == NULL || ctx->vvpb == NULL) {
+      return 0;
+    }
+    ctx->vvp = 1;
+  }
+  if (dealias) {
+    if (ctx->unfold == NULL) ctx->unfold = RAVE_MALLOC(sizeof(double) * NOR * 3);
+    if (ctx->torus == NULL) ctx->torus = RAVE_MALLOC(sizeof(double) * NOR * 4);
+    if (ctx->unfold == NULL || ctx->torus == NULL) {
+      return 0;
+    }
+    ctx->dealias = 1;
+  }
+  return 1;
 }
 
-void Wrwp_setHMAX(Wrwp_t* self, int hmax)
+/**
+ * Returns the next free scan information entry in the context, grows the array if necessary.
+ * @param[in] ctx - the context
+ * @returns the scan information or NULL on memory allocation failure
+ */
+static WrwpInternal_ScanInfo* WrwpInternal_nextScanInfo(WrwpContext_t* ctx)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->hmax = hmax;
+  WrwpInternal_ScanInfo* info = NULL;
+  if (ctx->nscans >= ctx->scansCapacity) {
+    int ncapacity = ctx->scansCapacity == 0 ? 16 : ctx->scansCapacity * 2;
+    WrwpInternal_ScanInfo* scans = RAVE_REALLOC(ctx->scans, sizeof(WrwpInternal_ScanInfo) * ncapacity);
+    if (scans == NULL) {
+      return NULL;
+    }
+    memset(scans + ctx->scansCapacity, 0, sizeof(WrwpInternal_ScanInfo) * (ncapacity - ctx->scansCapacity));
+    ctx->scans = scans;
+    ctx->scansCapacity = ncapacity;
+  }
+  info = &ctx->scans[ctx->nscans++];
+  info->scan = NULL;
+  info->vrad = NULL;
+  info->dbzh = NULL;
+  info->hasTarget = 0;
+  return info;
 }
 
-int Wrwp_getHMAX(Wrwp_t* self)
+/**
+ * Returns the layer that the height belongs to, i.e. layer i if i*dz <= h < (i+1)*dz.
+ * @param[in] h - the height [m]
+ * @param[in] dz - the layer interval [m]
+ * @returns the layer index
+ */
+static int WrwpInternal_layerIndex(double h, int dz)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->hmax;
+  int l = (int)floor(h / dz);
+  /* Make sure that rounding does not put the bin in a neighbouring layer */
+  if ((double)l * dz > h) {
+    l--;
+  } else if ((double)(l + 1) * dz <= h) {
+    l++;
+  }
+  return l;
 }
 
-void Wrwp_setDMIN(Wrwp_t* self, int dmin)
+/**
+ * Calculates the height of each bin in the scan and sorts the bins that are within the distance
+ * limits into the atmospheric layers. A bin belongs to layer i if i*dz <= h < (i+1)*dz. Within a
+ * layer the bins are kept in increasing order so that the samples are gathered in the same order
+ * as when looping over all bins.
+ * @param[in] self - self
+ * @param[in] info - the scan information, scan and elangle must have been set
+ * @param[in] polnav - the navigator for the volume
+ * @param[in] nlayers - number of layers
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_prepareScanGeometry(Wrwp_t* self, WrwpInternal_ScanInfo* info, PolarNavigator_t* polnav, int nlayers)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->dmin = dmin;
+  long ib = 0;
+  int l = 0;
+  double rscale = PolarScan_getRscale(info->scan);
+
+  info->nbins = PolarScan_getNbins(info->scan);
+  info->nrays = PolarScan_getNrays(info->scan);
+
+  if (info->nbins > info->binsCapacity) {
+    RAVE_FREE(info->h);
+    RAVE_FREE(info->d);
+    RAVE_FREE(info->binLayer);
+    RAVE_FREE(info->layerBins);
+    info->binsCapacity = 0;
+    info->h = RAVE_MALLOC(sizeof(double) * info->nbins);
+    info->d = RAVE_MALLOC(sizeof(double) * info->nbins);
+    info->binLayer = RAVE_MALLOC(sizeof(int) * info->nbins);
+    info->layerBins = RAVE_MALLOC(sizeof(int) * info->nbins);
+    if (info->h == NULL || info->d == NULL || info->binLayer == NULL || info->layerBins == NULL) {
+      return 0;
+    }
+    info->binsCapacity = info->nbins;
+  }
+  if (nlayers + 1 > info->layersCapacity) {
+    RAVE_FREE(info->layerStart);
+    info->layersCapacity = 0;
+    info->layerStart = RAVE_MALLOC(sizeof(int) * (nlayers + 1));
+    if (info->layerStart == NULL) {
+      return 0;
+    }
+    info->layersCapacity = nlayers + 1;
+  }
+
+  for (l = 0; l <= nlayers; l++) {
+    info->layerStart[l] = 0;
+  }
+
+  for (ib = 0; ib < info->nbins; ib++) {
+    PolarNavigator_reToDh(polnav, (ib+0.5)*rscale, info->elangle, &info->d[ib], &info->h[ib]);
+    info->binLayer[ib] = -1;
+    if (info->d[ib] >= self->dmin && info->d[ib] <= self->dmax && info->h[ib] >= 0.0) {
+      l = WrwpInternal_layerIndex(info->h[ib], self->dz);
+      if (l >= 0 && l < nlayers) {
+        info->binLayer[ib] = l;
+        info->layerStart[l + 1]++;
+      }
+    }
+  }
+
+  /* Counting sort, keeps the bins in increasing order within each layer */
+  for (l = 0; l < nlayers; l++) {
+    info->layerStart[l + 1] += info->layerStart[l];
+  }
+  for (ib = 0; ib < info->nbins; ib++) {
+    if (info->binLayer[ib] >= 0) {
+      info->layerBins[info->layerStart[info->binLayer[ib]]++] = (int)ib;
+    }
+  }
+  for (l = nlayers; l > 0; l--) {
+    info->layerStart[l] = info->layerStart[l - 1];
+  }
+  info->layerStart[0] = 0;
+
+  return 1;
 }
 
-int Wrwp_getDMIN(Wrwp_t* self)
+static int WrwpInternal_findAndAddAttribute(VerticalProfile_t* vp, PolarVolume_t* pvol, const char* name, double minSelAng, double maxSelAng)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->dmin;
+  int nscans = PolarVolume_getNumberOfScans(pvol);
+  int i = 0;
+  int found = 0;
+  double elangleForThisScan = 0.0;
+  
+  for (i = 0; i < nscans && found == 0; i++) {
+    PolarScan_t* scan = PolarVolume_getScan(pvol, i);
+    if (scan != NULL && PolarScan_hasAttribute(scan, name)) {
+        elangleForThisScan = PolarScan_getElangle(scan);
+        
+        /* Filter with respect to the selected min elangle and max elangle*/
+        if ((elangleForThisScan * RAD2DEG) >= minSelAng && (elangleForThisScan * RAD2DEG) <= maxSelAng) {
+          RaveAttribute_t* attr = PolarScan_getAttribute(scan, name);
+          VerticalProfile_addAttribute(vp, attr);
+          found = 1;
+          RAVE_OBJECT_RELEASE(attr);
+        }
+    }
+    RAVE_OBJECT_RELEASE(scan);
+  }
+  return found;
 }
 
-void Wrwp_setDMAX(Wrwp_t* self, int dmax)
+static int WrwpInternal_addDoubleAttribute(VerticalProfile_t* vp, const char* name, double value)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->dmax = dmax;
+  RaveAttribute_t* attr = RaveAttributeHelp_createDouble(name, value);
+  int result = 0;
+  if (attr != NULL) {
+    result = VerticalProfile_addAttribute(vp, attr);
+  }
+  RAVE_OBJECT_RELEASE(attr);
+  return result;
 }
 
-int Wrwp_getDMAX(Wrwp_t* self)
+static int WrwpInternal_addStringAttribute(VerticalProfile_t* vp, const char* name, const char* value)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->dmax;
+  RaveAttribute_t* attr = RaveAttributeHelp_createString(name, value);
+  int result = 0;
+  if (attr != NULL) {
+    result = VerticalProfile_addAttribute(vp, attr);
+  }
+  RAVE_OBJECT_RELEASE(attr);
+  return result;
 }
-
-void Wrwp_setNMIN_WND(Wrwp_t* self, int nmin_wnd)
+ 
+static char* WrwpInternal_LastcharDel(char* name)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->nmin_wnd = nmin_wnd;
+  int i = 0;
+  while(name[i] != '\0')
+  {
+  i++;       
+  }
+  name[i-1] = '\0';
+  return name;
 }
 
-int Wrwp_getNMIN_WND(Wrwp_t* self)
+/* Function that adds various quantities under a field's what in order to
+   better resemble the function existing in vertical profiles from N2 */
+static int WrwpInternal_addDoubleAttr2Field(RaveField_t* field, const char* name, double quantity)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->nmin_wnd;
+  int result = 0;
+  RaveAttribute_t* attr = RaveAttributeHelp_createDouble(name, quantity);
+  result = RaveField_addAttribute(field, attr);
+  if (attr == NULL || !result) {
+    RAVE_ERROR1("Failed to add %s attribute to field", name);
+    goto done;
+  }
+  RAVE_OBJECT_RELEASE(attr);
+done:
+  return result;
 }
 
-void Wrwp_setNMIN_REF(Wrwp_t* self, int nmin_ref)
+/**
+ * Returns a tokenized list (or empty) of fields that is wanted
+ * @param[in] fieldsToGenerate - the fields to generate
+ * @returns the list of wanted fields
+ */
+static RaveList_t* WrwpInternal_createFieldsList(const char* fieldsToGenerate)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->nmin_ref = nmin_ref;
+  RaveList_t* result = RaveUtilities_getTrimmedTokens(fieldsToGenerate, ',');
+  if (RaveList_size(result) == 0) {
+    RaveList_add(result, RAVE_STRDUP("ff"));
+    RaveList_add(result, RAVE_STRDUP("ff_dev"));
+    RaveList_add(result, RAVE_STRDUP("dd"));
+    RaveList_add(result, RAVE_STRDUP("NV"));
+    RaveList_add(result, RAVE_STRDUP("DBZH"));
+    RaveList_add(result, RAVE_STRDUP("DBZH_dev"));
+    RaveList_add(result, RAVE_STRDUP("NZ"));
+  }
+  return result;
 }
 
-int Wrwp_getNMIN_REF(Wrwp_t* self)
+/**
+ * Returns if the specified id exist as an id in the fieldIds.
+ * @param[in] fieldIds - the list of ids
+ * @param[in] id - the id to query for
+ * @returns if the list of ids contains the specified id
+ */
+static int WrwpInternal_containsField(RaveList_t* fieldIds, const char* id)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->nmin_ref;
+  int i = 0, n = 0;
+  n = RaveList_size(fieldIds);
+  for (i = 0; i < n; i++) {
+    if (RaveList_get(fieldIds, i) != NULL && strcmp((char*)RaveList_get(fieldIds, i), id) == 0) {
+      return 1;
+    }
+  }
+  return 0;
 }
 
-void Wrwp_setEMIN(Wrwp_t* self, double emin)
+/**
+ * Returns if any field derived from the extended VVP model (div,def,ad) is wanted
+ * @param[in] fieldIds - the list of wanted fields
+ * @returns 1 if the extended VVP model has to be fitted, otherwise 0
+ */
+static int WrwpInternal_isVvpWanted(RaveList_t* fieldIds)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->emin = emin;
+  return (WrwpInternal_containsField(fieldIds, "div") ||
+          WrwpInternal_containsField(fieldIds, "def") ||
+          WrwpInternal_containsField(fieldIds, "ad"));
 }
 
-double Wrwp_getEMIN(Wrwp_t* self)
+/**
+ * Returns if any percentile of the reflectivity (DBZH_p10,DBZH_p50,DBZH_p90) is wanted
+ * @param[in] fieldIds - the list of wanted fields
+ * @returns 1 if the reflectivity samples have to be added to a quantile sketch, otherwise 0
+ */
+static int WrwpInternal_isQuantileWanted(RaveList_t* fieldIds)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->emin;
+  return (WrwpInternal_containsField(fieldIds, "DBZH_p10") ||
+          WrwpInternal_containsField(fieldIds, "DBZH_p50") ||
+          WrwpInternal_containsField(fieldIds, "DBZH_p90"));
 }
 
-void Wrwp_setEMAX(Wrwp_t* self, double emax)
+/**
+ * Returns if any field of the biological echoes (eta,dens,ff_bio,dd_bio,bio_frac) is wanted
+ * @param[in] fieldIds - the list of wanted fields
+ * @returns 1 if the biological echoes have to be separated, otherwise 0
+ */
+static int WrwpInternal_isBioWanted(RaveList_t* fieldIds)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->emax = emax;
+  return (WrwpInternal_containsField(fieldIds, "eta") ||
+          WrwpInternal_containsField(fieldIds, "dens") ||
+          WrwpInternal_containsField(fieldIds, "ff_bio") ||
+          WrwpInternal_containsField(fieldIds, "dd_bio") ||
+          WrwpInternal_containsField(fieldIds, "bio_frac"));
 }
 
-double Wrwp_getEMAX(Wrwp_t* self)
+/**
+ * Analyses the wanted fields and determines which moments that has to be gathered
+ * in order to produce them. HGHT does not depend on any moment at all.
+ * @param[in] fieldIds - the list of wanted fields
+ * The fields of the biological echoes need both moments.
+ * @param[out] needWind - set to 1 if any wind field (NV,UWND,VWND,ff,ff_dev,dd,div,def,ad) is wanted, otherwise 0
+ * @param[out] needRefl - set to 1 if any reflectivity field (DBZH,DBZH_dev,NZ,DBZH_p10,DBZH_p50,DBZH_p90) is wanted, otherwise 0
+ */
+static void WrwpInternal_getRequiredMoments(RaveList_t* fieldIds, int* needWind, int* needRefl)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->emax;
+  *needWind = (WrwpInternal_containsField(fieldIds, "NV") ||
+               WrwpInternal_containsField(fieldIds, "UWND") ||
+               WrwpInternal_containsField(fieldIds, "VWND") ||
+               WrwpInternal_containsField(fieldIds, "ff") ||
+               WrwpInternal_containsField(fieldIds, "ff_dev") ||
+               WrwpInternal_containsField(fieldIds, "dd") ||
+               WrwpInternal_isVvpWanted(fieldIds) ||
+               WrwpInternal_isBioWanted(fieldIds));
+  *needRefl = (WrwpInternal_containsField(fieldIds, "DBZH") ||
+               WrwpInternal_containsField(fieldIds, "DBZH_dev") ||
+               WrwpInternal_containsField(fieldIds, "NZ") ||
+               WrwpInternal_isQuantileWanted(fieldIds) ||
+               WrwpInternal_isBioWanted(fieldIds));
 }
 
-void Wrwp_setECONDMAX(Wrwp_t* self, double econdmax)
+/**
+ * Allocates the columns in the result block and marks the wanted fields. All columns are
+ * allocated in one contiguous block, also the ones that have not been asked for, so that
+ * the derivation can write every column without checking.
+ * @param[in] res - the result
+ * @param[in] levels - the number of layers
+ * @param[in] interval - the height interval [m]
+ * @param[in] fieldIds - the wanted fields
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_initResult(WrwpResult_t* res, int levels, int interval, RaveList_t* fieldIds)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->econdmax = econdmax;
+  int i = 0;
+  res->levels = levels;
+  res->interval = interval;
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    res->wanted[i] = WrwpInternal_containsField(fieldIds, WRWP_RESULT_FIELD_NAMES[i]);
+  }
+  res->data = RAVE_MALLOC(sizeof(double) * WrwpResultField_COUNT * (levels > 0 ? levels : 1));
+  return (res->data != NULL);
 }
 
-double Wrwp_getECONDMAX(Wrwp_t* self)
+/**
+ * Returns the column for the specified field in the result block
+ * @param[in] res - the result
+ * @param[in] field - the field
+ * @returns the column with levels values
+ */
+static double* WrwpInternal_resultColumn(WrwpResult_t* res, WrwpResultField field)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->econdmax;
+  return res->data + (size_t)field * res->levels;
 }
 
-void Wrwp_setHTHR(Wrwp_t* self, double hthr)
+/**
+ * Creates a field from a column in the result block if the field has been asked for. The whole
+ * column is copied into the field in one go.
+ * @param[in] res - the result
+ * @param[in] field - the field
+ * @param[in] type - the data type of the created field
+ * @param[out] out - the created field, left as NULL if the field not has been asked for
+ * @returns 1 on success or if the field not is wanted, 0 on failure
+ */
+static int WrwpInternal_createResultField(WrwpResult_t* res, WrwpResultField field, RaveDataType type, RaveField_t** out)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->hthr = hthr;
+  RaveField_t* rfield = NULL;
+  double* column = WrwpInternal_resultColumn(res, field);
+  int* icolumn = NULL;
+  int i = 0, ok = 0;
+
+  if (!res->wanted[field]) {
+    return 1;
+  }
+
+  rfield = RAVE_OBJECT_NEW(&RaveField_TYPE);
+  if (rfield == NULL) {
+    goto done;
+  }
+  if (type == RaveDataType_INT) {
+    icolumn = RAVE_MALLOC(sizeof(int) * (res->levels > 0 ? res->levels : 1));
+    if (icolumn == NULL) {
+      goto done;
+    }
+    for (i = 0; i < res->levels; i++) {
+      icolumn[i] = (int)column[i];
+    }
+    ok = RaveField_setData(rfield, 1, res->levels, icolumn, RaveDataType_INT);
+  } else {
+    ok = RaveField_setData(rfield, 1, res->levels, column, RaveDataType_DOUBLE);
+  }
+  if (ok) {
+    *out = RAVE_OBJECT_COPY(rfield);
+  }
+done:
+  RAVE_FREE(icolumn);
+  RAVE_OBJECT_RELEASE(rfield);
+  return ok;
 }
 
-double Wrwp_getHTHR(Wrwp_t* self)
+/* Adds attributes under a fileds what */
+static int WrwpInternal_addNodataUndetectGainOffset(RaveField_t* field, double nodata, double undetect, double gain, double offset)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->hthr;
+  if (!WrwpInternal_addDoubleAttr2Field(field, "what/nodata", nodata) ||
+      !WrwpInternal_addDoubleAttr2Field(field, "what/undetect", undetect) ||
+      !WrwpInternal_addDoubleAttr2Field(field, "what/gain", gain) ||
+      !WrwpInternal_addDoubleAttr2Field(field, "what/offset", offset)) {
+    return 0;
+  }
+  return 1;
 }
 
-void Wrwp_setNIMIN(Wrwp_t* self, double nimin)
+/* Gathering of startdatetime and enddatetime */
+static RaveDateTime_t* WrwpInternal_getStartDateTimeFromScan(PolarScan_t* scan)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->nimin = nimin;
+  RaveDateTime_t* dt = RAVE_OBJECT_NEW(&RaveDateTime_TYPE);
+  RaveDateTime_t* result = NULL;
+  if (dt != NULL) {
+    if (!RaveDateTime_setDate(dt, PolarScan_getStartDate(scan)) ||
+        !RaveDateTime_setTime(dt, PolarScan_getStartTime(scan))) {
+      RAVE_WARNING0("Failed to initialize datetime object with start date/time");
+      goto done;
+    }
+  }
+  result = RAVE_OBJECT_COPY(dt);
+done:
+  RAVE_OBJECT_RELEASE(dt);
+  return result;
 }
 
-double Wrwp_getNIMIN(Wrwp_t* self)
+static RaveDateTime_t* WrwpInternal_getEndDateTimeFromScan(PolarScan_t* scan)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->nimin;
+  RaveDateTime_t* dt = RAVE_OBJECT_NEW(&RaveDateTime_TYPE);
+  RaveDateTime_t* result = NULL;
+  if (dt != NULL) {
+    if (!RaveDateTime_setDate(dt, PolarScan_getEndDate(scan)) ||
+        !RaveDateTime_setTime(dt, PolarScan_getEndTime(scan))) {
+      RAVE_WARNING0("Failed to initialize datetime object with end date/time");
+      goto done;
+    }
+  }
+  result = RAVE_OBJECT_COPY(dt);
+done:
+  RAVE_OBJECT_RELEASE(dt);
+  return result;
 }
 
-void Wrwp_setNGAPBIN(Wrwp_t* self, int ngapbin)
-{
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->ngapbin = ngapbin;
+
+int WrwpInternal_getDoubleAttribute(RaveCoreObject* obj, const char* aname, double* tmpd) {
+  RaveAttribute_t* attr = NULL;
+  int ret = 0;
+
+  if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarVolume_TYPE)) {
+    attr = PolarVolume_getAttribute((PolarVolume_t*)obj, aname);
+  } else if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarScan_TYPE)) {
+    attr = PolarScan_getAttribute((PolarScan_t*)obj, aname);
+  } else if (RAVE_OBJECT_CHECK_TYPE(obj, &PolarScanParam_TYPE)) {
+    attr = PolarScanParam_getAttribute((PolarScanParam_t*)obj, aname);
+  }
+  if (attr != NULL) {
+    ret = RaveAttribute_getDouble(attr, tmpd);
+  }
+  RAVE_OBJECT_RELEASE(attr);
+  return ret;
 }
 
-int Wrwp_getNGAPBIN(Wrwp_t* self)
+/**
+ * Verifies that the inputs is a non empty list containing only polar volumes and polar scans
+ * @param[in] inputs - the inputs
+ * @returns 1 if the inputs can be used, otherwise 0
+ */
+static int WrwpInternal_validateInputs(RaveObjectList_t* inputs)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->ngapbin;
+  int i = 0, n = 0, result = 1;
+  if (inputs == NULL || (n = RaveObjectList_size(inputs)) <= 0) {
+    return 0;
+  }
+  for (i = 0; result && i < n; i++) {
+    RaveCoreObject* obj = RaveObjectList_get(inputs, i);
+    if (!RAVE_OBJECT_CHECK_TYPE(obj, &PolarVolume_TYPE) && !RAVE_OBJECT_CHECK_TYPE(obj, &PolarScan_TYPE)) {
+      result = 0;
+    }
+    RAVE_OBJECT_RELEASE(obj);
+  }
+  return result;
 }
 
-void Wrwp_setNGAPMIN(Wrwp_t* self, int ngapmin)
+/**
+ * Creates an input list containing the volume
+ * @param[in] inobj - the volume
+ * @returns the list or NULL on failure
+ */
+static RaveObjectList_t* WrwpInternal_createInputList(PolarVolume_t* inobj)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->ngapmin = ngapmin;
+  RaveObjectList_t* result = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (result == NULL || !RaveObjectList_add(result, (RaveCoreObject*)inobj)) {
+    RAVE_ERROR0("Failed to create input list");
+    RAVE_OBJECT_RELEASE(result);
+  }
+  return result;
 }
 
-int Wrwp_getNGAPMIN(Wrwp_t* self)
+/**
+ * Returns the radar location of an input
+ * @param[in] input - a polar volume or a polar scan
+ * @param[out] lat, lon, height - the location
+ */
+static void WrwpInternal_getInputLocation(RaveCoreObject* input, double* lat, double* lon, double* height)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->ngapmin;
+  if (RAVE_OBJECT_CHECK_TYPE(input, &PolarVolume_TYPE)) {
+    *lat = PolarVolume_getLatitude((PolarVolume_t*)input);
+    *lon = PolarVolume_getLongitude((PolarVolume_t*)input);
+    *height = PolarVolume_getHeight((PolarVolume_t*)input);
+  } else {
+    *lat = PolarScan_getLatitude((PolarScan_t*)input);
+    *lon = PolarScan_getLongitude((PolarScan_t*)input);
+    *height = PolarScan_getHeight((PolarScan_t*)input);
+  }
 }
 
-void Wrwp_setMAXNSTD(Wrwp_t* self, int maxnstd)
+/**
+ * Sets the location, source and nominal date and time of the profile from an input
+ * @param[in] vp - the vertical profile
+ * @param[in] input - a polar volume or a polar scan
+ */
+static void WrwpInternal_setProfileOrigin(VerticalProfile_t* vp, RaveCoreObject* input)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->maxnstd = maxnstd;
+  double lat = 0.0, lon = 0.0, height = 0.0;
+  WrwpInternal_getInputLocation(input, &lat, &lon, &height);
+  VerticalProfile_setLongitude(vp, lon);
+  VerticalProfile_setLatitude(vp, lat);
+  VerticalProfile_setHeight(vp, height);
+  if (RAVE_OBJECT_CHECK_TYPE(input, &PolarVolume_TYPE)) {
+    VerticalProfile_setSource(vp, PolarVolume_getSource((PolarVolume_t*)input));
+    VerticalProfile_setDate(vp, PolarVolume_getDate((PolarVolume_t*)input));
+    VerticalProfile_setTime(vp, PolarVolume_getTime((PolarVolume_t*)input));
+  } else {
+    VerticalProfile_setSource(vp, PolarScan_getSource((PolarScan_t*)input));
+    VerticalProfile_setDate(vp, PolarScan_getDate((PolarScan_t*)input));
+    VerticalProfile_setTime(vp, PolarScan_getTime((PolarScan_t*)input));
+  }
 }
 
-int Wrwp_getMAXNSTD(Wrwp_t* self)
+/**
+ * Returns if the scan should be used, i.e. if the elevation angle is within the limits and the scan
+ * not is marked as malfunctioning.
+ * @param[in] self - self
+ * @param[in] scan - the scan
+ * @param[out] task - the how/task of the scan or NULL if there is none, owned by the scan
+ * @returns 1 if the scan should be used, otherwise 0
+ */
+static int WrwpInternal_isScanAccepted(Wrwp_t* self, PolarScan_t* scan, char** task)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->maxnstd;
+  char* malfuncString = NULL;
+  double elangle = PolarScan_getElangle(scan) * RAD2DEG;
+  RaveAttribute_t* attr = NULL;
+
+  *task = NULL;
+  if (elangle < self->emin || elangle > self->emax) { /* We only use scans with emin <= elangle <= emax */
+    return 0;
+  }
+  attr = PolarScan_getAttribute(scan, "how/malfunc");
+  if (attr != NULL) {
+    RaveAttribute_getString(attr, &malfuncString);
+    RAVE_OBJECT_RELEASE(attr);
+  }
+  attr = PolarScan_getAttribute(scan, "how/task");
+  if (attr != NULL) {
+    RaveAttribute_getString(attr, task);
+    RAVE_OBJECT_RELEASE(attr);
+  }
+  return (malfuncString == NULL || strcmp(malfuncString, "False") == 0); /* Assuming malfuncString = NULL means no malfunc */
 }
 
-void Wrwp_setMAXVDIFF(Wrwp_t* self, double maxvdiff)
+/**
+ * Initializes the metadata
+ * @param[in] md - the metadata
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_initMetadata(WrwpInternal_Metadata* md)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->maxvdiff = maxvdiff;
+  memset(md, 0, sizeof(WrwpInternal_Metadata));
+  md->angles = RAVE_CALLOC((size_t)WRWP_ANGLES_LENGTH, sizeof(char));
+  return (md->angles != NULL);
 }
 
-double Wrwp_getMAXVDIFF(Wrwp_t* self)
+/**
+ * Releases everything in the metadata
+ * @param[in] md - the metadata
+ */
+static void WrwpInternal_clearMetadata(WrwpInternal_Metadata* md)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->maxvdiff;
+  int i = 0;
+  RAVE_FREE(md->angles);
+  for (i = 0; i < md->ntasks; i++) {
+    RAVE_FREE(md->tasks[i]);
+  }
+  RAVE_OBJECT_RELEASE(md->startDT);
+  RAVE_OBJECT_RELEASE(md->endDT);
+  memset(md, 0, sizeof(WrwpInternal_Metadata));
 }
 
-void Wrwp_setFF_MAX(Wrwp_t* self, double ff_max)
+/**
+ * Adds the elevation angle, the task and the start and end times of an accepted scan to the metadata.
+ * Angles and tasks that do not fit are dropped. The metadata is left unchanged on failure.
+ * @param[in] md - the metadata
+ * @param[in] elangle - the elevation angle [rad]
+ * @param[in] task - the how/task of the scan, may be NULL
+ * @param[in] startDT - the start date/time of the scan, may be NULL
+ * @param[in] endDT - the end date/time of the scan, may be NULL
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_addMetadata(WrwpInternal_Metadata* md, double elangle, const char* task, RaveDateTime_t* startDT, RaveDateTime_t* endDT)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->ff_max = ff_max;
+  char angle[16] = {'\0'};
+  int i = 0, found = 0;
+
+  /* The only step that may fail is done first */
+  if (task != NULL) {
+    for (i = 0; !found && i < md->ntasks; i++) {
+      found = (strcmp(md->tasks[i], task) == 0);
+    }
+    if (!found && md->ntasks < WRWP_MAX_TASKS) {
+      md->tasks[md->ntasks] = RAVE_STRDUP(task);
+      if (md->tasks[md->ntasks] == NULL) {
+        return 0;
+      }
+      md->ntasks++;
+    }
+  }
+
+  snprintf(angle, sizeof(angle), "%2.1f", elangle * RAD2DEG);
+  if (strlen(md->angles) + strlen(angle) + 1 < WRWP_ANGLES_LENGTH) {
+    if (md->nscans > 0) {
+      strcat(md->angles, ",");
+    }
+    strcat(md->angles, angle);
+  }
+
+  /* The combined period goes from the first start date/time to the last end date/time */
+  if (md->nscans == 0) {
+    md->startDT = RAVE_OBJECT_COPY(startDT);
+    md->endDT = RAVE_OBJECT_COPY(endDT);
+  } else {
+    if (startDT != NULL && (md->startDT == NULL || RaveDateTime_compare(startDT, md->startDT) < 0)) {
+      RAVE_OBJECT_RELEASE(md->startDT);
+      md->startDT = RAVE_OBJECT_COPY(startDT);
+    }
+    if (endDT != NULL && (md->endDT == NULL || RaveDateTime_compare(endDT, md->endDT) > 0)) {
+      RAVE_OBJECT_RELEASE(md->endDT);
+      md->endDT = RAVE_OBJECT_COPY(endDT);
+    }
+  }
+  md->nscans++;
+  return 1;
 }
 
-double Wrwp_getFF_MAX(Wrwp_t* self)
+/**
+ * Same as \ref WrwpInternal_addMetadata with the values taken from the scan.
+ * @param[in] md - the metadata
+ * @param[in] scan - the scan
+ * @param[in] task - the how/task of the scan, may be NULL
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_addScanMetadata(WrwpInternal_Metadata* md, PolarScan_t* scan, const char* task)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->ff_max;
+  RaveDateTime_t* startDT = WrwpInternal_getStartDateTimeFromScan(scan);
+  RaveDateTime_t* endDT = WrwpInternal_getEndDateTimeFromScan(scan);
+  int result = WrwpInternal_addMetadata(md, PolarScan_getElangle(scan), task, startDT, endDT);
+  RAVE_OBJECT_RELEASE(startDT);
+  RAVE_OBJECT_RELEASE(endDT);
+  return result;
 }
 
-void Wrwp_setVMIN(Wrwp_t* self, double vmin)
+/**
+ * Copies the collected metadata into the result.
+ * @param[in] md - the metadata
+ * @param[in] result - the result
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_copyMetadataToResult(WrwpInternal_Metadata* md, WrwpResult_t* result)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  self->vmin = vmin;
+  /* The unique how/task attributes are combined into one comma separated string, for radar data */
+  /* not having this attribute in their volumes, it will not be written */
+  char finalTasks[300] = {'\0'};
+  int i = 0, ok = 1;
+
+  for (i = 0; i < md->ntasks; i++) {
+    if (strlen(finalTasks) + strlen(md->tasks[i]) + 1 < sizeof(finalTasks)) {
+      if (finalTasks[0] != '\0') {
+        strcat(finalTasks, ",");
+      }
+      strcat(finalTasks, md->tasks[i]);
+    }
+  }
+  if (finalTasks[0] != '\0') {
+    result->tasks = RAVE_STRDUP(finalTasks);
+    ok = (result->tasks != NULL);
+  }
+  result->angles = RAVE_STRDUP(md->angles);
+  ok = ok && (result->angles != NULL);
+  result->startDT = RAVE_OBJECT_COPY(md->startDT);
+  result->endDT = RAVE_OBJECT_COPY(md->endDT);
+  return ok;
 }
 
-double Wrwp_getVMIN(Wrwp_t* self)
+/**
+ * Moves the collected metadata into the result, the metadata is cleared.
+ * @param[in] md - the metadata
+ * @param[in] result - the result
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_moveMetadataToResult(WrwpInternal_Metadata* md, WrwpResult_t* result)
 {
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  return self->vmin;
+  int ok = WrwpInternal_copyMetadataToResult(md, result);
+  WrwpInternal_clearMetadata(md);
+  return ok;
 }
 
-/* Main code for vertical profile generation */
-VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate)
+/**
+ * Adds an accepted scan to the scans in the context, picks the moments that should be used and
+ * sorts the bins into the layers.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] scan - the scan
+ * @param[in] pvol - the volume the scan belongs to, used for the how/NI fallback, may be NULL
+ * @param[in] polnav - the navigator
+ * @param[in] nlayers - number of layers
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] needWind - if the wind moment is needed
+ * @param[in] needRefl - if the reflectivity moment is needed
+ * @returns the scan information or NULL on memory allocation failure
+ */
+static WrwpInternal_ScanInfo* WrwpInternal_addScanInfo(Wrwp_t* self, WrwpContext_t* ctx, PolarScan_t* scan, PolarVolume_t* pvol,
+                                                      PolarNavigator_t* polnav, int nlayers, int isKnmi, int needWind, int needRefl)
 {
-  VerticalProfile_t* result = NULL;
-  PolarNavigator_t* polnav = NULL;
-  int nrhs = NRHS, lda = LDA, ldb = LDB;
-  int nscans = 0, nv, nz, i, iz, is, ib, ir, n, m, p;
-  int firstInit;
+  WrwpInternal_ScanInfo* info = WrwpInternal_nextScanInfo(ctx);
+  double NI = 0.0;
 
-  double gain, offset, nodata, undetect, val, NI, chisq, Vdifmax;
-  double d, h;
-  double alpha, beta, /*gamma,*/ vvel, vdir, vstd, zsum, zmean, zstd;
-  double centerOfLayer=0.0, u_wnd_comp=0.0, v_wnd_comp=0.0, vdir_rad=0.0;
-  int ysize = 0, yindex = 0;
-  int countAcceptedScans = 0; /* counter for accepted scans i.e. scans with elangle >= selected
-                                 minimum elevatiuon angle and <= selected maximum elevation angle and not being set as malfunc */
+  if (info == NULL) {
+    return NULL;
+  }
+  info->scan = RAVE_OBJECT_COPY(scan);
+  info->elangle = PolarScan_getElangle(scan);
 
-  const char* product = "VP";
+  // radial wind scans
+  if (needWind && (PolarScan_hasParameter(scan, "VRAD") || PolarScan_hasParameter(scan, "VRADH"))) {
+    if (PolarScan_hasParameter(scan, "VRAD")) {
+      info->vrad = PolarScan_getParameter(scan, "VRAD");
+    } else {
+      info->vrad = PolarScan_getParameter(scan, "VRADH");
+    }
+    if (!WrwpInternal_getDoubleAttribute((RaveCoreObject*)scan, "how/NI", &NI)) {
+      if (pvol == NULL || !WrwpInternal_getDoubleAttribute((RaveCoreObject*)pvol, "how/NI", &NI)) {
+        NI = fabs(PolarScanParam_getOffset(info->vrad));
+      }
+    }
+    info->NI = NI;
+    // KNMI algorithm: check for minimum Nyquist interval, unless the samples are dealiased
+    if (isKnmi && !ctx->dealias && NI < self->nimin) {
+      RAVE_OBJECT_RELEASE(info->vrad);
+    }
+  }
 
-  RaveDateTime_t *firstStartDT = NULL, *lastEndDT = NULL;
+  // reflectivity scans
+  if (needRefl && PolarScan_hasParameter(scan, "DBZH")) {
+    info->dbzh = PolarScan_getParameter(scan, "DBZH");
+  }
 
-  /* Field definitions */
-  RaveField_t *nv_field = NULL, *hght_field = NULL;
-  RaveField_t *uwnd_field = NULL, *vwnd_field = NULL;
-  RaveField_t *ff_field = NULL, *ff_dev_field = NULL, *dd_field = NULL;
-  RaveField_t *dbzh_field = NULL, *dbzh_dev_field = NULL, *nz_field = NULL;
+  if ((info->vrad != NULL || info->dbzh != NULL) &&
+      !WrwpInternal_prepareScanGeometry(self, info, polnav, nlayers)) {
+    return NULL;
+  }
+  return info;
+}
 
-  RaveList_t* wantedFields = NULL;
+/**
+ * Adds a radial wind sample to the sample buffers of the context
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] useFloat - if the samples should be stored in single precision
+ * @param[in] nv - number of samples already in the buffers
+ * @param[in] maxnv - maximum number of samples, the sample is ignored if the buffers are full
+ * @param[in] vs - the radial wind
+ * @param[in] azs - the azimuth [rad]
+ * @param[in] elangle - the elevation angle [rad]
+ * @param[in] d - the distance of the bin along the surface [m], only used by the extended VVP model
+ * @param[in] NI - the Nyquist interval [m/s], only used when dealiasing
+ * @returns the number of samples in the buffers
+ */
+static int WrwpInternal_addWindSample(Wrwp_t* self, WrwpContext_t* ctx, int isKnmi, int useFloat, int nv, int maxnv,
+                                      double vs, double azs, double elangle, double d, double NI)
+{
+  double a0, a1, a2;
+  if (nv >= maxnv) {
+    RAVE_ERROR0("NV too great, ignoring value");
+    return nv;
+  }
+  a0 = sin(azs);
+  a1 = cos(azs);
+  a2 = 1;
+  if (isKnmi) {
+      a0 *= cos(elangle);
+      a1 *= cos(elangle);
+      a2 *= sin(elangle);
+  }
+  if (!isKnmi) { /* column major, the third column is implicitly 1 */
+    if (useFloat) {
+      ctx->fv[nv] = (float)vs;
+      ctx->fA[nv] = (float)a0;
+      ctx->fA[NOR+nv] = (float)a1;
+    } else {
+      ctx->b[nv] = vs;
+      ctx->A[nv] = a0;
+      ctx->A[NOR+nv] = a1;
+    }
+  } else if (useFloat) {
+    ctx->fv[nv] = (float)vs;
+    ctx->faz[nv] = (float)azs;
+    ctx->fel[nv] = (float)elangle;
+    ctx->fA[nv*NOC] = (float)a0;
+    ctx->fA[nv*NOC+1] = (float)a1;
+    ctx->fA[nv*NOC+2] = (float)a2;
+  } else {
+    ctx->v[nv] = vs;
+    ctx->az[nv] = azs;
+    ctx->el[nv] = elangle;
+    ctx->A[nv*NOC] = a0;
+    ctx->A[nv*NOC+1] = a1;
+    ctx->A[nv*NOC+2] = a2;
+    ctx->b[nv] = vs;
+  }
+  if (isKnmi) { /* sector bin of the stored azimuth, used for the gap detection */
+    ctx->sector[nv] = WrwpKernel_sectorIndex(useFloat ? (double)ctx->faz[nv] : azs, self->ngapbin);
+  }
+  if (ctx->vvp) {
+    /* The mean wind and fall speed columns followed by the linear wind field terms. With u = u0 + ux*x + uy*y and
+       v = v0 + vx*x + vy*y the radial wind gets the term d*cos(el)/2 * (div + (vy-ux)*cos(2az) + (uy+vx)*sin(2az)).
+       All columns are projected on the beam with the elevation whatever the method, SMHI leaves cos(el) out of its
+       own mean wind columns which would otherwise bias the fitted divergence with the elevation of the samples. */
+    double k = d * cos(elangle) / 2.0;
+    double* row = ctx->vvpA + (size_t)nv * NOC_VVP;
+    row[0] = sin(azs) * cos(elangle);
+    row[1] = cos(azs) * cos(elangle);
+    row[2] = sin(elangle);
+    row[3] = k;
+    row[4] = k * cos(2 * azs);
+    row[5] = k * sin(2 * azs);
+    ctx->vvpb[nv] = vs;
+  }
+  if (ctx->bio) { /* the classification of the sample is set by the caller */
+    ctx->bioA[nv] = a0;
+    ctx->bioA[NOR+nv] = a1;
+    ctx->bioA[2*NOR+nv] = a2;
+    ctx->biob[nv] = vs;
+    ctx->bioFlag[nv] = 0;
+  }
+  if (ctx->dealias) {
+    ctx->unfold[nv] = azs;
+    ctx->unfold[NOR+nv] = elangle;
+    ctx->unfold[2*NOR+nv] = NI;
+  }
+  return nv + 1;
+}
 
-  RAVE_ASSERT((self != NULL), "self == NULL");
-  RAVE_ASSERT((self->gain_VP != 0.0), "gain_VP == 0.0");
+/**
+ * Adds a reflectivity sample to the sample buffers of the context
+ * @param[in] ctx - the context
+ * @param[in] useFloat - if the samples should be stored in single precision
+ * @param[in] nz - number of samples already in the buffers
+ * @param[in] maxnz - maximum number of samples, the sample is ignored if the buffers are full
+ * @param[in] z - the reflectivity [Z]
+ * @param[in,out] zsum - the sum of the samples that the sample is added to
+ * @returns the number of samples in the buffers
+ */
+static int WrwpInternal_addReflectivitySample(WrwpContext_t* ctx, int useFloat, int nz, int maxnz, double z, double* zsum)
+{
+  if (nz >= maxnz) {
+    RAVE_ERROR0("NZ too great, ignoring value");
+    return nz;
+  }
+  if (useFloat) {
+    ctx->fz[nz] = (float)z;
+    *zsum = *zsum + ctx->fz[nz];
+  } else {
+    ctx->z[nz] = z;
+    *zsum = *zsum + ctx->z[nz];
+  }
+  return nz + 1;
+}
 
-  wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+/**
+ * Returns if a gate is within the radius around the target, see \ref WrwpComposite_t. The
+ * earth is assumed to be flat between the radar and the target.
+ * @param[in] info - the scan
+ * @param[in] d - the distance of the gate along the surface [m]
+ * @param[in] sinaz, cosaz - sine and cosine of the azimuth of the ray
+ * @returns 1 if the gate is within the radius, otherwise 0
+ */
+static int WrwpInternal_isNearTarget(WrwpInternal_ScanInfo* info, double d, double sinaz, double cosaz)
+{
+  double x = info->tx + d * sinaz, y = info->ty + d * cosaz;
+  return (x * x + y * y <= info->tr * info->tr);
+}
 
-  if (WrwpInternal_containsField(wantedFields, "NV")) nv_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "HGHT")) hght_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "UWND")) uwnd_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "VWND")) vwnd_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "ff")) ff_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "ff_dev")) ff_dev_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "dd")) dd_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "DBZH")) dbzh_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "DBZH_dev")) dbzh_dev_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-  if (WrwpInternal_containsField(wantedFields, "NZ")) nz_field = RAVE_OBJECT_NEW(&RaveField_TYPE);
-
-  if ((WrwpInternal_containsField(wantedFields, "NV") && nv_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "HGHT") && hght_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "UWND") && uwnd_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "VWND") && vwnd_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "ff") && ff_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "ff_dev") && ff_dev_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "dd") && dd_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "DBZH") && dbzh_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "DBZH_dev") && dbzh_dev_field == NULL) ||
-      (WrwpInternal_containsField(wantedFields, "NZ") && nz_field == NULL))
-  {
-    RAVE_ERROR0("Failed to allocate memory for the resulting vp fields");
-    goto done;
+/**
+ * Gathers the radial wind samples of the scan that are within the layer into the sample buffers of
+ * the context. Within the scan the rays are traversed in order and the bins in increasing order. When
+ * the biological echoes are separated, each sample is classified from the reflectivity at the same gate.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] info - the scan
+ * @param[in] layer - the layer index
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] useFloat - if the samples should be stored in single precision
+ * @param[in] nv - number of samples already in the buffers
+ * @param[in] maxnv - maximum number of samples, samples above this are ignored
+ * @returns the number of samples in the buffers
+ */
+static int WrwpInternal_gatherWind(Wrwp_t* self, WrwpContext_t* ctx, WrwpInternal_ScanInfo* info, int layer,
+                                   int isKnmi, int useFloat, int nv, int maxnv)
+{
+  double gain = 0.0, offset = 0.0, nodata = 0.0, undetect = 0.0, val = 0.0, h = 0.0;
+  double zgain = 0.0, zoffset = 0.0, znodata = 0.0, zundetect = 0.0, zval = 0.0;
+  double sinaz = 0.0, cosaz = 0.0;
+  double elangleForThisScan = info->elangle;
+  long nrays = info->nrays, ir = 0;
+  int kstart = 0, kend = 0, k = 0, ib = 0, n = 0;
+  int useScan = (!isKnmi || (elangleForThisScan * RAD2DEG <= self->econdmax));
+  int classify = (ctx->bio && info->dbzh != NULL);
+
+  if (info->vrad == NULL) {
+    return nv;
+  }
+  kstart = info->layerStart[layer];
+  kend = info->layerStart[layer + 1];
+  if (kstart == kend) {
+    return nv;
   }
 
-  /* Set the spacing */
-  ysize = self->hmax / self->dz;
+  gain = PolarScanParam_getGain(info->vrad);
+  offset = PolarScanParam_getOffset(info->vrad);
+  nodata = PolarScanParam_getNodata(info->vrad);
+  undetect = PolarScanParam_getUndetect(info->vrad);
+  if (classify) {
+    zgain = PolarScanParam_getGain(info->dbzh);
+    zoffset = PolarScanParam_getOffset(info->dbzh);
+    znodata = PolarScanParam_getNodata(info->dbzh);
+    zundetect = PolarScanParam_getUndetect(info->dbzh);
+  }
 
-  if ((nv_field != NULL && !RaveField_createData(nv_field, 1, ysize, RaveDataType_INT)) ||
-      (hght_field != NULL && !RaveField_createData(hght_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (uwnd_field != NULL && !RaveField_createData(uwnd_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (vwnd_field != NULL && !RaveField_createData(vwnd_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (ff_field != NULL && !RaveField_createData(ff_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (ff_dev_field != NULL && !RaveField_createData(ff_dev_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (dd_field != NULL && !RaveField_createData(dd_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (dbzh_field != NULL && !RaveField_createData(dbzh_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (dbzh_dev_field != NULL && !RaveField_createData(dbzh_dev_field, 1, ysize, RaveDataType_DOUBLE)) ||
-      (nz_field != NULL && !RaveField_createData(nz_field, 1, ysize, RaveDataType_DOUBLE))) {
-    RAVE_ERROR0("Failed to allocate arrays for the resulting vp fields");
-    goto done;
+  for (ir = 0; ir < nrays; ir++) {
+    if (info->hasTarget) {
+      sinaz = sin(360./nrays*ir*DEG2RAD);
+      cosaz = cos(360./nrays*ir*DEG2RAD);
+    }
+    for (k = kstart; k < kend; k++) {
+      ib = info->layerBins[k];
+      if (info->hasTarget && !WrwpInternal_isNearTarget(info, info->d[ib], sinaz, cosaz)) {
+        continue;
+      }
+      h = info->h[ib];
+      PolarScanParam_getValue(info->vrad, ib, ir, &val);
+      if ((useScan || (h >= self->hthr)) &&
+          (val != nodata) &&
+          (val != undetect) &&
+          (fabs(offset + gain * val) >= self->vmin)) {
+        n = WrwpInternal_addWindSample(self, ctx, isKnmi, useFloat, nv, maxnv, offset+gain*val,
+                                       360./nrays*ir*DEG2RAD, elangleForThisScan, info->d[ib], info->NI);
+        if (classify && n > nv) {
+          PolarScanParam_getValue(info->dbzh, ib, ir, &zval);
+          ctx->bioFlag[nv] = (zval != znodata && zval != zundetect && zoffset + zgain * zval < self->bio_dbzmax);
+        }
+        nv = n;
+      }
+    }
   }
+  return nv;
+}
 
-  polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
-  PolarNavigator_setLat0(polnav, PolarVolume_getLatitude(inobj));
-  PolarNavigator_setLon0(polnav, PolarVolume_getLongitude(inobj));
-  PolarNavigator_setAlt0(polnav, PolarVolume_getHeight(inobj));
-	    
-  nscans = PolarVolume_getNumberOfScans (inobj);
-
-  // We use yindex for filling in the arrays even though we loop to hmax...
-  yindex = 0;
-
-  // Allocate memory, and initialize with zeros, for the char array holding the accepted elevation angles.
-  // Define and initialize also the accessory strings and the counter.
-  char *theUsedElevationAngles = RAVE_CALLOC((size_t)(100), sizeof (char));
-  char angle[6] = {'\0'};
-  char comma[2] = ",";
-  int firstAngleCounter = 0;
-  double acceptedAngle = 0.0;
-  
-  // Some definitions  and initializations of things used for putting a unique set of tasks into an array
-  #define len(A) (sizeof(A) / sizeof(A[0]))
-  char *taskArgs[] = {NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL};
-  int scanNumber = 0;
-  int foundTask = 0;
-  int ntask = 0;
-
-  // Loop over the atmospheric layers
-    // NOTE: looping over all height layers, and then looping over all elevations, azimuths, and ranges may be inefficient in terms of CPU use. With a little more memory use, this could be reduced. Not sure if this is at all relevant, but it could be an option to look into if necessary.
-  for (iz = 0; iz < self->hmax; iz += self->dz) {
-    /* allocate memory and initialize with zeros */
-    double *A = RAVE_CALLOC((size_t)(NOR*NOC), sizeof (double));
-    double *Atmp = RAVE_CALLOC((size_t)(NOR*NOC), sizeof (double));
-    double *b = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-    double *v = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-    double *vfit = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-    double *z = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-    double *az = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-    double *el = RAVE_CALLOC((size_t)(NOR), sizeof (double));
-
-    vdir = -9999.0;
-    vvel = -9999.0;
-    vstd = 0.0;
-    zsum = 0.0;
-    zmean = -9999.0;
-    zstd = 0.0;
-    nv = 0;
-    nz = 0;
-    
-    /* Define the center height of each vertical layer, this will later
-       become the HGHT array */
-    centerOfLayer = iz + (self->dz / 2.0);
-    firstInit = 0;
-
-    // Loop over scans in the polar volume
-    for (is = 0; is < nscans; is++) {
-      char* malfuncString = NULL;
-      char* taskString = NULL;
-      PolarScan_t* scan = PolarVolume_getScan(inobj, is);      
-      long nbins = PolarScan_getNbins(scan);
-      long nrays = PolarScan_getNrays(scan);
-      double rscale = PolarScan_getRscale(scan);
-      double elangleForThisScan = PolarScan_getElangle(scan);
-      
-      if (elangleForThisScan * RAD2DEG >= self->emin && elangleForThisScan * RAD2DEG <= self->emax) { /* We only do the calculation for scans with elangle >= the minimum one AND elangle <= the maximum one */
-        RaveDateTime_t* startDTofThisScan = WrwpInternal_getStartDateTimeFromScan(scan);
-        RaveDateTime_t* endDTofThisScan = WrwpInternal_getEndDateTimeFromScan(scan);        
-        RaveAttribute_t* malfuncattr = PolarScan_getAttribute(scan, "how/malfunc");
-        RaveAttribute_t* taskattr = PolarScan_getAttribute(scan, "how/task");
-
-        if (malfuncattr != NULL) {
-          RaveAttribute_getString(malfuncattr, &malfuncString); /* Set the malfuncString if attr is not NULL */
-          RAVE_OBJECT_RELEASE(malfuncattr);
-        }
+/**
+ * Gathers the reflectivity samples [Z] of the scan that are within the layer into the sample buffers
+ * of the context.
+ * @param[in] ctx - the context
+ * @param[in] info - the scan
+ * @param[in] layer - the layer index
+ * @param[in] useFloat - if the samples should be stored in single precision
+ * @param[in] nz - number of samples already in the buffers
+ * @param[in] maxnz - maximum number of samples, samples above this are ignored
+ * @param[in,out] zsum - the sum of the samples, the gathered samples are added in order
+ * @returns the number of samples in the buffers
+ */
+static int WrwpInternal_gatherReflectivity(WrwpContext_t* ctx, WrwpInternal_ScanInfo* info, int layer,
+                                           int useFloat, int nz, int maxnz, double* zsum)
+{
+  double gain = 0.0, offset = 0.0, nodata = 0.0, undetect = 0.0, val = 0.0;
+  double sinaz = 0.0, cosaz = 0.0;
+  long nrays = info->nrays, ir = 0;
+  int kstart = 0, kend = 0, k = 0, ib = 0;
 
-        if (taskattr != NULL) {
-          RaveAttribute_getString(taskattr, &taskString); /* Set the taskString if attr is not NULL */
-          RAVE_OBJECT_RELEASE(taskattr);
-        }
+  if (info->dbzh == NULL) {
+    return nz;
+  }
+  kstart = info->layerStart[layer];
+  kend = info->layerStart[layer + 1];
+  if (kstart == kend) {
+    return nz;
+  }
 
-        if (malfuncString == NULL || strcmp(malfuncString, "False") == 0) { /* Assuming malfuncString = NULL means no malfunc */
-          countAcceptedScans = countAcceptedScans + 1;
-
-          if (iz == 0) { /* Collect the elevation angles only for the first atmospheric layer */
-            acceptedAngle = elangleForThisScan * RAD2DEG;
-            sprintf(angle, "%2.1f", acceptedAngle);
-
-            if (firstAngleCounter == 0) {
-              strcat(theUsedElevationAngles, angle);
-              firstAngleCounter = 1;
-              taskArgs[scanNumber] = taskString;
-              scanNumber = scanNumber + 1; 
-            }
-            else {
-              strcat(theUsedElevationAngles, comma);
-              strcat(theUsedElevationAngles, angle);
-              for (ntask=0; ntask < len(taskArgs); ntask++) {
-                if (taskArgs[ntask]) {
-                  if (strcmp(taskArgs[ntask], taskString) == 0) {
-                    foundTask = 1;
-                    break;
-                  }
-                }
-              }
-              if (!foundTask) {
-                taskArgs[scanNumber] = taskString;
-                foundTask = 0; 
-              } 
-              scanNumber = scanNumber + 1;
-            }
-          }
-   
-          if (firstInit == 0 && iz==0) { /* We only perform the date time calc at first iz-iteration*/
-            /* Initialize using the first accepted scan and define 2 strings for the combined datetime */
-            firstStartDT = RAVE_OBJECT_COPY(startDTofThisScan);
-            lastEndDT = RAVE_OBJECT_COPY(endDTofThisScan);
-            firstInit = 1;
-          }
-          if (firstInit == 1 && countAcceptedScans > 1 && iz==0) {
-            if (RaveDateTime_compare(startDTofThisScan, firstStartDT) < 0) {
-              /* if start datetime of this scan is before the first saved start datetime, save this one instead */
-              RAVE_OBJECT_RELEASE(firstStartDT);
-              firstStartDT = RAVE_OBJECT_COPY(startDTofThisScan);
-            }
-            if (RaveDateTime_compare(endDTofThisScan, lastEndDT) > 0) {
-              /* If end datetime of this scan is after the last saved end datetime, save this one instead */
-              RAVE_OBJECT_RELEASE(lastEndDT);
-              lastEndDT = RAVE_OBJECT_COPY(endDTofThisScan);
-            }
-          }
-          // radial wind scans
-          if (PolarScan_hasParameter(scan, "VRAD") || PolarScan_hasParameter(scan, "VRADH")) {
-            PolarScanParam_t* vrad = NULL;
-            if (PolarScan_hasParameter(scan, "VRAD")) {
-              vrad = PolarScan_getParameter(scan, "VRAD");
-            } else {
-              vrad = PolarScan_getParameter(scan, "VRADH");
-            } 
-            gain = PolarScanParam_getGain(vrad);
-            offset = PolarScanParam_getOffset(vrad);
-            nodata = PolarScanParam_getNodata(vrad);
-            undetect = PolarScanParam_getUndetect(vrad);
-            
-            // KNMI algorithm: check for minimum Nyquist interval
-            NI = fabs(offset);
-            if (strcmp(wrwpMethod, "KNMI") == 0) {
-              if (!WrwpInternal_getDoubleAttribute((RaveCoreObject*)scan, "how/NI", &NI)) {
-                if (!WrwpInternal_getDoubleAttribute((RaveCoreObject*)inobj, "how/NI", &NI)) {
-                  NI = fabs(offset);
-                }
-              }
-            }
-            if ((strcmp(wrwpMethod, "KNMI") != 0) || (NI >= self->nimin)) {
-              for (ir = 0; ir < nrays; ir++) {
-                for (ib = 0; ib < nbins; ib++) {
-                  PolarNavigator_reToDh(polnav, (ib+0.5)*rscale, elangleForThisScan, &d, &h);
-                  PolarScanParam_getValue(vrad, ib, ir, &val);
-                  if (((strcmp(wrwpMethod, "KNMI") != 0) || (elangleForThisScan * RAD2DEG <= self->econdmax) || (h >= self->hthr)) && ((h >= iz) &&
-                      (h < iz + self->dz) &&
-                      (d >= self->dmin) &&
-                      (d <= self->dmax) &&
-                      (val != nodata) &&
-                      (val != undetect) &&
-                      (abs(offset + gain * val) >= self->vmin))) {
-                    if (nv < NOR) {
-                      *(v+nv) = offset+gain*val;
-                      *(az+nv) = 360./nrays*ir*DEG2RAD;
-                      *(el+nv) = elangleForThisScan;
-                      *(A+nv*NOC) = sin(*(az+nv));
-                      *(A+nv*NOC+1) = cos(*(az+nv));
-                      *(A+nv*NOC+2) = 1;
-                      if (strcmp(wrwpMethod, "KNMI") == 0) {
-                          *(A+nv*NOC) *= cos(elangleForThisScan);
-                          *(A+nv*NOC+1) *= cos(elangleForThisScan);
-                          *(A+nv*NOC+2) *= sin(elangleForThisScan);
-                      }
-                      *(b+nv) = *(v+nv);
-                      nv = nv+1;
-                    } else {
-                      RAVE_ERROR0("NV too great, ignoring value");
-                    }
-                  }
-                }
-              }
-            }
-            RAVE_OBJECT_RELEASE(vrad);
-          }
+  gain = PolarScanParam_getGain(info->dbzh);
+  offset = PolarScanParam_getOffset(info->dbzh);
+  nodata = PolarScanParam_getNodata(info->dbzh);
+  undetect = PolarScanParam_getUndetect(info->dbzh);
 
-          // reflectivity scans
-          if (PolarScan_hasParameter(scan, "DBZH")) {
-            PolarScanParam_t* dbz = PolarScan_getParameter(scan, "DBZH");
-            gain = PolarScanParam_getGain(dbz);
-            offset = PolarScanParam_getOffset(dbz);
-            nodata = PolarScanParam_getNodata(dbz);
-            undetect = PolarScanParam_getUndetect(dbz);
-
-            for (ir = 0; ir < nrays; ir++) {
-              for (ib = 0; ib < nbins; ib++) {
-                PolarNavigator_reToDh(polnav, (ib+0.5)*rscale, elangleForThisScan, &d, &h);
-                PolarScanParam_getValue (dbz, ib, ir, &val);
-                if ((h >= iz) &&
-                    (h < iz+self->dz) &&
-                    (d >= self->dmin) &&
-                    (d <= self->dmax) &&
-                    (val != nodata) &&
-                    (val != undetect)) {
-                  if (nz < NOR) {
-                    *(z+nz) = dBZ2Z(offset+gain*val);
-                    zsum = zsum + *(z+nz);
-                    nz = nz+1;
-                  } else {
-                    RAVE_ERROR0("NZ too great, ignoring value");
-                  }
-                }
-              }
-            }
-            RAVE_OBJECT_RELEASE(dbz);         
-          }        
-        }
-        RAVE_OBJECT_RELEASE(startDTofThisScan);
-        RAVE_OBJECT_RELEASE(endDTofThisScan);
-      }
-      RAVE_OBJECT_RELEASE(scan);  
-    }
-
-    if (countAcceptedScans == 0) { /* Emergency exit if no accepted scans were found */
-      result = NULL;               /* If this is the case, we don't bother with checking */
-      RAVE_FREE(A);                /* the same thing for the other atmospheric layers, */
-      RAVE_FREE(Atmp);             /* we skip it and return 0 directly */
-      RAVE_FREE(b);
-      RAVE_FREE(v);
-      RAVE_FREE(vfit);
-      RAVE_FREE(z);
-      RAVE_FREE(az);
-      RAVE_FREE(el);
-      RAVE_INFO0("Could not find any acceptable scans, dropping out...");
-      goto done;
+  for (ir = 0; ir < nrays; ir++) {
+    if (info->hasTarget) {
+      sinaz = sin(360./nrays*ir*DEG2RAD);
+      cosaz = cos(360./nrays*ir*DEG2RAD);
     }
-      
-    // KNMI processing: check for azimuth gaps
-    if (strcmp(wrwpMethod, "KNMI") == 0) {
-      if (WrwpInternal_azimuthGap(az, nv, self->ngapbin, self->ngapmin)) {
-        nv = 0;
+    for (k = kstart; k < kend; k++) {
+      ib = info->layerBins[k];
+      if (info->hasTarget && !WrwpInternal_isNearTarget(info, info->d[ib], sinaz, cosaz)) {
+        continue;
+      }
+      PolarScanParam_getValue (info->dbzh, ib, ir, &val);
+      if ((val != nodata) &&
+          (val != undetect)) {
+        nz = WrwpInternal_addReflectivitySample(ctx, useFloat, nz, maxnz, dBZ2Z(offset+gain*val), zsum);
+      } else if (val == undetect && ctx->bio) {
+        ctx->nundetect++;
       }
     }
+  }
+  return nz;
+}
 
-    /* Perform radial wind calculations and reflectivity calculations */
-    if (nv > 3) {
-      //***************************************************************
-      // fitting: y = gamma+alpha*sin(x+beta)                         *
-      // alpha -> amplitude                                           *
-      // beta -> phase shift                                          *
-      // gamma -> consider an y-shift due to the terminal velocity of *
-      //          falling rain drops                                  *
-      //***************************************************************
-      if (strcmp(wrwpMethod, "KNMI") == 0) {
-        // Do first fit
-        for (i = 0; i < (nv * NOC); i++) {
-          Atmp[i] = A[i];
-        }
-        LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', nv, NOC, nrhs, Atmp, lda, b, ldb);
-        
-        // Compute vfit and chi-squared
-        chisq = 0.0;
-        for (i = 0; i < nv; i++) {
-          vfit[i] = b[0] * sin(az[i]) * cos(el[i]) + b[1] * cos(az[i]) * cos(el[i]) + b[2] * sin(el[i]);
-          chisq += (v[i] - vfit[i]) * (v[i] - vfit[i]);
-        }
-        chisq /= (nv - NOC);
-        
-        // Remove outiers
-        if (self->maxnstd > 0) {
-          Vdifmax = self->maxnstd * sqrt(chisq);
-        } else {
-          Vdifmax = self->maxvdiff;
-        }
-        n = 0;
-        for (m = 0; m < nv; m++) {
-          if (fabs(v[m] - vfit[m]) < Vdifmax) {
-            v[n] = v[m];
-            b[n] = v[m];
-            az[n] = az[m];
-            el[n] = el[m];
-            for (p = 0; p < NOC; p++) {
-              Atmp[p + NOC * n] = A[p + NOC * m];
-            }
-            n++;
-          }
-        }
-        nv = n;
-          
-        if (nv > 3) {
-          // Check for azimuth gaps and redo fitting if no gaps are there
-          if (WrwpInternal_azimuthGap(az, nv, self->ngapbin, self->ngapmin)) {
-            nv = 0;
-          } else {
-            LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', nv, NOC, nrhs, Atmp, lda, b, ldb);
-            chisq = 0.0;
-            for (i = 0; i < nv; i++) {
-              vfit[i] = b[0] * sin(az[i]) * cos(el[i]) + b[1] * cos(az[i]) * cos(el[i]) + b[2] * sin(el[i]);
-              chisq += (v[i] - vfit[i]) * (v[i] - vfit[i]);
-            }
-            chisq /= (nv - NOC);
-          }
-        }
-      } else {
-        /* QR decomposition */
-        /*info = */
-        LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', NOR, NOC, nrhs, A, lda, b, ldb);
-        chisq = 0.0;
-        for (i = 0; i < nv; i++) {
-          vfit[i] = b[0] * sin(az[i]) + b[1] * cos(az[i]) + b[2];
-          chisq += (v[i] - vfit[i]) * (v[i] - vfit[i]);
-        }
-        chisq /= nv;
-      }
+/**
+ * Returns the sum of the squared deviations from the mean of the reflectivity samples in the buffers
+ * @param[in] ctx - the context
+ * @param[in] nz - number of samples
+ * @param[in] useFloat - if the samples are stored in single precision
+ * @param[in] mean - the mean
+ * @returns the sum of the squared deviations
+ */
+static double WrwpInternal_reflectivitySquaredDeviation(WrwpContext_t* ctx, int nz, int useFloat, double mean)
+{
+  double result = 0.0;
+  int i = 0;
+  for (i = 0; i < nz; i++) {
+    result = result + pow((useFloat ? (double)ctx->fz[i] : ctx->z[i]) - mean, 2);
+  }
+  return result;
+}
+
+/**
+ * Adds the reflectivity samples in the buffers to the quantile sketch
+ * @param[in] ctx - the context
+ * @param[in] nz - number of samples
+ * @param[in] useFloat - if the samples are stored in single precision
+ * @param[in,out] sketch - the sketch
+ */
+static void WrwpInternal_addToSketch(WrwpContext_t* ctx, int nz, int useFloat, WrwpQuantileSketch* sketch)
+{
+  if (useFloat) {
+    WrwpKernel_addToSketchFloat(sketch, nz, ctx->fz);
+  } else {
+    WrwpKernel_addToSketch(sketch, nz, ctx->z);
+  }
+}
+
+/**
+ * Fits the wind model with the KNMI method to the samples in the buffers of the context (A, b, v and
+ * sector in double precision). Layers with azimuth gaps are rejected, outliers are removed after the
+ * first fit and the fit is redone.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] nv - number of samples
+ * @param[out] x - the fitted parameters (NOC values)
+ * @param[out] chisq - the mean squared residual
+ * @returns number of samples used in the final fit, 0 if the layer was rejected
+ */
+static int WrwpInternal_fitKnmi(Wrwp_t* self, WrwpContext_t* ctx, int nv, double* x, double* chisq)
+{
+  int nrhs = NRHS, lda = LDA, ldb = LDB;
+  double Vdifmax = 0.0;
+
+  // check for azimuth gaps
+  if (WrwpKernel_sectorGap(nv, ctx->sector, self->ngapbin, self->ngapmin)) {
+    return 0;
+  }
+  if (nv <= 3) {
+    return nv;
+  }
+
+  //***************************************************************
+  // fitting: y = gamma+alpha*sin(x+beta)                         *
+  // alpha -> amplitude                                           *
+  // beta -> phase shift                                          *
+  // gamma -> consider an y-shift due to the terminal velocity of *
+  //          falling rain drops                                  *
+  //***************************************************************
+  // Do first fit
+  memcpy(ctx->Atmp, ctx->A, sizeof(double) * nv * NOC);
+  LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', nv, NOC, nrhs, ctx->Atmp, lda, ctx->b, ldb);
+
+  // Compute vfit and chi-squared from the design rows
+  *chisq = WrwpKernel_residuals(nv, ctx->A, ctx->b, ctx->v, ctx->vfit) / (nv - NOC);
+
+  // Remove outiers
+  if (self->maxnstd > 0) {
+    Vdifmax = self->maxnstd * sqrt(*chisq);
+  } else {
+    Vdifmax = self->maxvdiff;
+  }
+  nv = WrwpKernel_compactInliers(nv, ctx->A, ctx->vfit, Vdifmax, ctx->v, ctx->sector);
+
+  if (nv > 3) {
+    // Check for azimuth gaps and redo fitting if no gaps are there
+    if (WrwpKernel_sectorGap(nv, ctx->sector, self->ngapbin, self->ngapmin)) {
+      return 0;
     }
-        
-    if (nv > 3) {
-      /* parameter of the wind model */
-      alpha = sqrt(pow(*(b),2) + pow(*(b+1),2));
-      beta = atan2(*(b+1), *b);
-      //gamma = *(b+2);
-
-      /* wind velocity */
-      vvel = alpha;
-
-      /* wind direction */
-      vdir = 0;
-      if (alpha < 0) {
-        vdir = (M_PI/2-beta) * RAD2DEG;
-      } else if (alpha > 0) {
-        vdir = (3*M_PI/2-beta) * RAD2DEG;
-      }
-      if (vdir < 0) {
-        vdir = vdir + 360;
-      } else if (vdir > 360) {
-        vdir = vdir - 360;
-      }
+    memcpy(ctx->Atmp, ctx->A, sizeof(double) * nv * NOC);
+    memcpy(ctx->b, ctx->v, sizeof(double) * nv);
+    LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', nv, NOC, nrhs, ctx->Atmp, lda, ctx->b, ldb);
+    *chisq = WrwpKernel_residuals(nv, ctx->A, ctx->b, ctx->v, ctx->vfit) / (nv - NOC);
+  }
+  memcpy(x, ctx->b, sizeof(double) * NOC);
+  return nv;
+}
 
-      /* RMSE of the wind velocity*/
-      vstd = sqrt (chisq);
-      
-      /* Calculate the x-component (East) and y-component (North) of the wind 
-         velocity using the wind direction and the magnitude of the wind velocity */
-      vdir_rad = vdir * DEG2RAD;
-      u_wnd_comp = vvel * sin(vdir_rad - M_PI);
-      v_wnd_comp = vvel * cos(vdir_rad - M_PI);
+/**
+ * Dealiases the wind samples in the buffers of the context. A first guess of the wind is found with
+ * torus mapping, where each sample is mapped to the phase pi*v/NI so that folded samples coincide, and
+ * each sample is then unfolded to the multiple of 2*NI closest to the first guess. The samples are
+ * grouped in runs with the same azimuth, elevation and Nyquist interval, i.e. the bins of a ray, and
+ * the wind is searched on a coarse grid up to ff_max followed by a fine grid around the best candidate.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] useFloat - if the samples are stored in single precision
+ * @param[in] nv - number of samples
+ */
+static void WrwpInternal_dealiasLayer(Wrwp_t* self, WrwpContext_t* ctx, int isKnmi, int useFloat, int nv)
+{
+  const double *az = ctx->unfold, *el = ctx->unfold + NOR, *ni = ctx->unfold + 2*NOR;
+  double *C = ctx->torus, *S = ctx->torus + NOR, *ka = ctx->torus + 2*NOR, *kb = ctx->torus + 3*NOR;
+  double *v = ctx->vfit; /* scratch, the fit has not been done yet */
+  double u[WRWP_DEALIAS_MAX_POINTS], w[WRWP_DEALIAS_MAX_POINTS];
+  double work[4 * WRWP_DEALIAS_MAX_POINTS], scores[WRWP_DEALIAS_MAX_POINTS * WRWP_DEALIAS_MAX_POINTS];
+  double vmax = self->ff_max, bestU = 0.0, bestW = 0.0, best = 0.0, step = WRWP_DEALIAS_COARSE_STEP;
+  int i = 0, g = -1, n = 0, k = 0, pass = 0;
+
+  for (i = 0; i < nv; i++) {
+    v[i] = useFloat ? (double)ctx->fv[i] : (isKnmi ? ctx->v[i] : ctx->b[i]);
+    if (ni[i] <= 0.0) {
+      continue;
     }
+    if (g < 0 || az[i] != az[k] || el[i] != el[k] || ni[i] != ni[k]) {
+      g++;
+      k = i;
+      C[g] = S[g] = 0.0;
+      ka[g] = M_PI * cos(el[i]) * sin(az[i]) / ni[i];
+      kb[g] = M_PI * cos(el[i]) * cos(az[i]) / ni[i];
+    }
+    C[g] += cos(M_PI * v[i] / ni[i]);
+    S[g] += sin(M_PI * v[i] / ni[i]);
+  }
+  if (g < 0) {
+    return;
+  }
 
-    // reflectivity calculations
-    if (nz > 0) {
-      /* RMSE of the reflectivity */
-      for (i = 0; i < nz; i++) {
-        zstd = zstd + pow(*(z+i) - (zsum/nz),2);
+  if (vmax > WRWP_DEALIAS_COARSE_STEP * (WRWP_DEALIAS_MAX_POINTS / 2)) {
+    vmax = WRWP_DEALIAS_COARSE_STEP * (WRWP_DEALIAS_MAX_POINTS / 2);
+  }
+  for (pass = 0; pass < 2; pass++) {
+    double u0 = bestU, w0 = bestW;
+    n = (pass == 0) ? 2 * (int)ceil(vmax / step) + 1 : WRWP_DEALIAS_FINE_POINTS;
+    for (i = 0; i < n; i++) {
+      u[i] = u0 + (i - n / 2) * step;
+      w[i] = w0 + (i - n / 2) * step;
+    }
+    WrwpKernel_torusScores(g + 1, C, S, ka, kb, n, u, n, w, work, scores);
+    best = scores[0];
+    bestU = u[0];
+    bestW = w[0];
+    for (i = 1; i < n * n; i++) {
+      if (scores[i] > best) {
+        best = scores[i];
+        bestU = u[i / n];
+        bestW = w[i % n];
       }
-      zmean = Z2dBZ(zsum/nz);
-      zstd = sqrt(zstd/nz);
-      zstd = Z2dBZ(zstd);
     }
+    step = WRWP_DEALIAS_COARSE_STEP / (WRWP_DEALIAS_FINE_POINTS / 2);
+  }
+
+  if (WrwpKernel_unfold(nv, az, el, ni, bestU, bestW, v) == 0) {
+    return;
+  }
+  for (i = 0; i < nv; i++) {
+    if (useFloat) {
+      ctx->fv[i] = (float)v[i];
+    } else if (isKnmi) {
+      ctx->v[i] = v[i];
+      ctx->b[i] = v[i];
+    } else {
+      ctx->b[i] = v[i];
+    }
+  }
+  if (ctx->vvp) {
+    memcpy(ctx->vvpb, v, sizeof(double) * nv);
+  }
+  if (ctx->bio) {
+    memcpy(ctx->biob, v, sizeof(double) * nv);
+  }
+}
+
+/**
+ * Separates the biological echoes of the layer. The wind samples at gates with biological reflectivity
+ * are moved to the front of the biological buffers and the wind model of the method is fitted to them,
+ * and the reflectivity samples below bio_dbzmax are counted and summed.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] useFloat - if the reflectivity samples are stored in single precision
+ * @param[in] nv - number of wind samples
+ * @param[in] nz - number of reflectivity samples
+ * @param[in,out] m - the moments that the biological moments are set in
+ */
+static void WrwpInternal_separateBio(Wrwp_t* self, WrwpContext_t* ctx, int useFloat, int nv, int nz, WrwpInternal_LayerMoments* m)
+{
+  double zmax = dBZ2Z(self->bio_dbzmax);
+  int i = 0, k = 0;
+
+  for (i = 0; i < nv; i++) {
+    if (ctx->bioFlag[i]) {
+      ctx->bioA[k] = ctx->bioA[i];
+      ctx->bioA[NOR+k] = ctx->bioA[NOR+i];
+      ctx->bioA[2*NOR+k] = ctx->bioA[2*NOR+i];
+      ctx->biob[k] = ctx->biob[i];
+      k++;
+    }
+  }
+  m->nvbio = k;
+  if (k > 3) {
+    WrwpNormalEquations ne;
+    memset(&ne, 0, sizeof(ne));
+    WrwpKernel_accumulateNormalEquations(k, ctx->bioA, ctx->bioA+NOR, ctx->bioA+2*NOR, ctx->biob, &ne);
+    if (!WrwpKernel_solveNormalEquations(&ne, m->xbio, &m->chisqbio)) {
+      m->nvbio = 0;
+    }
+  }
 
-    /* Set the hght_field values */
-    if (hght_field != NULL) {
-      RaveField_setValue(hght_field, 0, yindex, centerOfLayer / 1000.0); /* in km */
+  for (i = 0; i < nz; i++) {
+    double z = useFloat ? (double)ctx->fz[i] : ctx->z[i];
+    if (z < zmax) {
+      m->nzbio++;
+      m->zbiosum += z;
     }
+  }
+  m->nzundetect = ctx->nundetect;
+  m->bio = 1;
+  ctx->nundetect = 0;
+}
 
-    /* If the number of points for wind is smaller than the threshold nmin_wnd or the calculated wind velocity is larger than */
-    /* threshold ff_max, set nodata, otherwise set values. */
-    if (((strcmp(wrwpMethod, "KNMI") != 0) && ((nv < self->nmin_wnd) || (vvel > self->ff_max))) || ((strcmp(wrwpMethod, "KNMI") == 0) && (nv <= 3))) {
-      if (nv_field != NULL) RaveField_setValue(nv_field, 0, yindex, -1.0); /* nodata for counter */
-      if (uwnd_field != NULL) RaveField_setValue(uwnd_field, 0, yindex, self->nodata_VP);
-      if (vwnd_field != NULL) RaveField_setValue(vwnd_field, 0, yindex, self->nodata_VP);
-      if (ff_field != NULL) RaveField_setValue(ff_field, 0, yindex, self->nodata_VP);
-      if (ff_dev_field != NULL) RaveField_setValue(ff_dev_field, 0, yindex, self->nodata_VP);
-      if (dd_field != NULL) RaveField_setValue(dd_field, 0, yindex, self->nodata_VP);
+/**
+ * Fits the extended VVP model to the samples in the VVP buffers of the context. All samples of the
+ * layer are used, the outlier removal of the KNMI method is not applied. The buffers are overwritten.
+ * @param[in] ctx - the context
+ * @param[in] nv - number of samples
+ * @param[out] x - the fitted parameters (NOC_VVP values)
+ * @returns nv on success, 0 if there are too few samples or the system is rank deficient
+ */
+static int WrwpInternal_fitVvp(WrwpContext_t* ctx, int nv, double* x)
+{
+  if (nv <= NOC_VVP) {
+    return 0;
+  }
+  if (LAPACKE_dgels(LAPACK_ROW_MAJOR, 'N', nv, NOC_VVP, NRHS, ctx->vvpA, NOC_VVP, ctx->vvpb, LDB) != 0) {
+    return 0;
+  }
+  memcpy(x, ctx->vvpb, sizeof(double) * NOC_VVP);
+  return nv;
+}
+
+/**
+ * Derives the moments of a layer from the samples in the sample buffers of the context
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] needWind - if the wind moment is needed
+ * @param[in] useFloat - if the samples are stored in single precision
+ * @param[in] nv - number of wind samples
+ * @param[in] nz - number of reflectivity samples
+ * @param[in] zsum - sum of the reflectivity samples
+ * @param[out] m - the moments
+ */
+static void WrwpInternal_fitLayer(Wrwp_t* self, WrwpContext_t* ctx, int isKnmi, int needWind, int useFloat,
+                                  int nv, int nz, double zsum, WrwpInternal_LayerMoments* m)
+{
+  memset(m, 0, sizeof(WrwpInternal_LayerMoments));
+  m->nv = nv;
+  if (needWind && ctx->dealias && nv > 0) {
+    WrwpInternal_dealiasLayer(self, ctx, isKnmi, useFloat, nv);
+  }
+  if (needWind && ctx->vvp) {
+    m->nvvp = WrwpInternal_fitVvp(ctx, nv, m->xvvp);
+  }
+  if (needWind && isKnmi) {
+    m->nv = WrwpInternal_fitKnmi(self, ctx, nv, m->x, &m->chisq);
+  } else if (nv > 3) {
+    /* Least squares fit from the sufficient statistics, the residual is given by the normal equations */
+    WrwpNormalEquations ne;
+    memset(&ne, 0, sizeof(ne));
+    if (useFloat) {
+      WrwpKernel_accumulateNormalEquationsFloat(nv, ctx->fA, ctx->fA+NOR, NULL, ctx->fv, &ne);
     } else {
-      if (nv_field != NULL) RaveField_setValue(nv_field, 0, yindex, nv);
-      if (uwnd_field != NULL) RaveField_setValue(uwnd_field, 0, yindex, (u_wnd_comp - self->offset_VP)/self->gain_VP);
-      if (vwnd_field != NULL) RaveField_setValue(vwnd_field, 0, yindex, (v_wnd_comp - self->offset_VP)/self->gain_VP);
-      if (ff_field != NULL) RaveField_setValue(ff_field, 0, yindex, (vvel - self->offset_VP)/self->gain_VP);
-      if (ff_dev_field != NULL) RaveField_setValue(ff_dev_field, 0, yindex, (vstd - self->offset_VP)/self->gain_VP);
-      if (dd_field != NULL) RaveField_setValue(dd_field, 0, yindex, (vdir - self->offset_VP)/self->gain_VP);
-    }
-
-    /* If the number of points for reflectivity is larger than threshold, set values, else set nodata */
-    if (nz < self->nmin_ref) {
-      if (nz_field != NULL) RaveField_setValue(nz_field, 0, yindex, -1.0);
-      if (dbzh_field != NULL) RaveField_setValue(dbzh_field, 0, yindex, self->nodata_VP);
-      if (dbzh_dev_field != NULL) RaveField_setValue(dbzh_dev_field, 0, yindex, self->nodata_VP);
+      WrwpKernel_accumulateNormalEquations(nv, ctx->A, ctx->A+NOR, NULL, ctx->b, &ne);
+    }
+    if (!WrwpKernel_solveNormalEquations(&ne, m->x, &m->chisq)) {
+      m->nv = 0;
+    }
+  }
+
+  m->nz = nz;
+  m->zsum = zsum;
+  if (nz > 0) {
+    m->zsqdev = WrwpInternal_reflectivitySquaredDeviation(ctx, nz, useFloat, zsum/nz);
+  }
+  if (nz > 0 && ctx->quantiles) {
+    WrwpInternal_addToSketch(ctx, nz, useFloat, &m->zsketch);
+  }
+  if (ctx->bio) {
+    WrwpInternal_separateBio(self, ctx, useFloat, needWind ? nv : 0, nz, m);
+  }
+}
+
+/**
+ * Derives the wind velocity, direction and components from a fitted wind model
+ * @param[in] x - the fitted wind model
+ * @param[out] vvel - the wind velocity [m/s]
+ * @param[out] vdir - the wind direction [deg]
+ * @param[out] u_wnd_comp - the east component of the wind [m/s]
+ * @param[out] v_wnd_comp - the north component of the wind [m/s]
+ */
+static void WrwpInternal_windFromModel(const double* x, double* vvel, double* vdir, double* u_wnd_comp, double* v_wnd_comp)
+{
+  double alpha = 0.0, beta = 0.0, vdir_rad = 0.0;
+
+  /* parameter of the wind model */
+  alpha = sqrt(pow(x[0],2) + pow(x[1],2));
+  beta = atan2(x[1], x[0]);
+  //gamma = x[2];
+
+  /* wind velocity */
+  *vvel = alpha;
+
+  /* wind direction */
+  *vdir = 0;
+  if (alpha < 0) {
+    *vdir = (M_PI/2-beta) * RAD2DEG;
+  } else if (alpha > 0) {
+    *vdir = (3*M_PI/2-beta) * RAD2DEG;
+  }
+  if (*vdir < 0) {
+    *vdir = *vdir + 360;
+  } else if (*vdir > 360) {
+    *vdir = *vdir - 360;
+  }
+
+  /* Calculate the x-component (East) and y-component (North) of the wind
+     velocity using the wind direction and the magnitude of the wind velocity */
+  vdir_rad = *vdir * DEG2RAD;
+  *u_wnd_comp = *vvel * sin(vdir_rad - M_PI);
+  *v_wnd_comp = *vvel * cos(vdir_rad - M_PI);
+}
+
+/**
+ * Derives the wind and reflectivity of one layer from its moments and stores them in the result.
+ * @param[in] self - self
+ * @param[in] result - the result
+ * @param[in] yindex - the layer index
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] m - the moments of the layer
+ */
+static void WrwpInternal_storeLayer(Wrwp_t* self, WrwpResult_t* result, int yindex, int isKnmi, const WrwpInternal_LayerMoments* m)
+{
+  double vvel = -9999.0, vdir = -9999.0, vstd = 0.0, zmean = -9999.0, zstd = 0.0;
+  double centerOfLayer = 0.0, u_wnd_comp = 0.0, v_wnd_comp = 0.0;
+  int nv = m->nv, nz = m->nz;
+
+  if (nv > 3) {
+    WrwpInternal_windFromModel(m->x, &vvel, &vdir, &u_wnd_comp, &v_wnd_comp);
+
+    /* RMSE of the wind velocity*/
+    vstd = sqrt (m->chisq);
+  }
+
+  // reflectivity calculations
+  if (nz > 0) {
+    /* RMSE of the reflectivity */
+    zmean = Z2dBZ(m->zsum/nz);
+    zstd = sqrt(m->zsqdev/nz);
+    zstd = Z2dBZ(zstd);
+  }
+
+  /* Set the height of the layer, the center of the layer */
+  centerOfLayer = yindex * result->interval + (result->interval / 2.0);
+  WrwpInternal_resultColumn(result, WrwpResultField_HGHT)[yindex] = centerOfLayer / 1000.0; /* in km */
+
+  /* If the number of points for wind is smaller than the threshold nmin_wnd or the calculated wind velocity is larger than */
+  /* threshold ff_max, set nodata, otherwise set values. */
+  if ((!isKnmi && ((nv < self->nmin_wnd) || (vvel > self->ff_max))) || (isKnmi && (nv <= 3))) {
+    WrwpInternal_resultColumn(result, WrwpResultField_NV)[yindex] = -1.0; /* nodata for counter */
+    WrwpInternal_resultColumn(result, WrwpResultField_UWND)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_VWND)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_FF)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_FF_DEV)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DD)[yindex] = self->nodata_VP;
+  } else {
+    WrwpInternal_resultColumn(result, WrwpResultField_NV)[yindex] = nv;
+    WrwpInternal_resultColumn(result, WrwpResultField_UWND)[yindex] = (u_wnd_comp - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_VWND)[yindex] = (v_wnd_comp - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_FF)[yindex] = (vvel - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_FF_DEV)[yindex] = (vstd - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DD)[yindex] = (vdir - self->offset_VP)/self->gain_VP;
+  }
+
+  /* If the number of points for reflectivity is larger than threshold, set values, else set nodata */
+  if (nz < self->nmin_ref) {
+    WrwpInternal_resultColumn(result, WrwpResultField_NZ)[yindex] = -1.0;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_DEV)[yindex] = self->nodata_VP;
+  } else {
+    WrwpInternal_resultColumn(result, WrwpResultField_NZ)[yindex] = nz;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH)[yindex] = (zmean - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_DEV)[yindex] = (zstd - self->offset_VP)/self->gain_VP;
+  }
+
+  /* The percentiles of the reflectivity from the quantile sketch, with the same sample threshold as the mean */
+  if (nz < self->nmin_ref || m->zsketch.n < self->nmin_ref || m->zsketch.n == 0) {
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P10)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P50)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P90)[yindex] = self->nodata_VP;
+  } else {
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P10)[yindex] = (WrwpKernel_sketchQuantile(&m->zsketch, 0.1) - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P50)[yindex] = (WrwpKernel_sketchQuantile(&m->zsketch, 0.5) - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DBZH_P90)[yindex] = (WrwpKernel_sketchQuantile(&m->zsketch, 0.9) - self->offset_VP)/self->gain_VP;
+  }
+
+  /* The biological echoes. The reflectivity per volume is averaged over all gates of the layer, where */
+  /* precipitation and gates without echo count as zero, and the density is only given when the radial */
+  /* winds of the biological echoes deviate enough from a uniform wind, precipitation is more uniform */
+  if (!m->bio || nz < self->nmin_ref) {
+    WrwpInternal_resultColumn(result, WrwpResultField_ETA)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DENS)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_BIO_FRAC)[yindex] = self->nodata_VP;
+  } else {
+    double factor = WRWP_BIO_DIELECTRIC * 1000.0 * pow(M_PI, 5) / pow(WRWP_BIO_WAVELENGTH, 4);
+    double eta = factor * m->zbiosum / (nz + m->nzundetect);
+    double dens = (m->nvbio > 3 && sqrt(m->chisqbio) >= self->bio_stdmin) ? eta / self->bio_rcs : 0.0;
+    WrwpInternal_resultColumn(result, WrwpResultField_ETA)[yindex] = (eta - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DENS)[yindex] = (dens - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_BIO_FRAC)[yindex] = ((double)m->nzbio / nz - self->offset_VP)/self->gain_VP;
+  }
+  if (m->nvbio > 3 && m->nvbio >= self->nmin_wnd) {
+    double bvel = 0.0, bdir = 0.0, bu = 0.0, bv = 0.0;
+    WrwpInternal_windFromModel(m->xbio, &bvel, &bdir, &bu, &bv);
+    if (bvel <= self->ff_max) {
+      WrwpInternal_resultColumn(result, WrwpResultField_FF_BIO)[yindex] = (bvel - self->offset_VP)/self->gain_VP;
+      WrwpInternal_resultColumn(result, WrwpResultField_DD_BIO)[yindex] = (bdir - self->offset_VP)/self->gain_VP;
     } else {
-      if (nz_field != NULL) RaveField_setValue(nz_field, 0, yindex, nz);
-      if (dbzh_field != NULL) RaveField_setValue(dbzh_field, 0, yindex, (zmean - self->offset_VP)/self->gain_VP);
-      if (dbzh_dev_field != NULL) RaveField_setValue(dbzh_dev_field, 0, yindex, (zstd - self->offset_VP)/self->gain_VP);
+      WrwpInternal_resultColumn(result, WrwpResultField_FF_BIO)[yindex] = self->nodata_VP;
+      WrwpInternal_resultColumn(result, WrwpResultField_DD_BIO)[yindex] = self->nodata_VP;
+    }
+  } else {
+    WrwpInternal_resultColumn(result, WrwpResultField_FF_BIO)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DD_BIO)[yindex] = self->nodata_VP;
+  }
+
+  /* Divergence and deformation from the extended VVP model, the fitted terms are div, vy-ux and uy+vx */
+  if (m->nvvp > 0 && m->nvvp >= self->nmin_wnd) {
+    double stretching = -m->xvvp[4], shearing = m->xvvp[5];
+    double deformation = sqrt(stretching * stretching + shearing * shearing);
+    double dilatation = 90.0 - 0.5 * atan2(shearing, stretching) * RAD2DEG; /* clockwise from north */
+    if (dilatation >= 180.0) {
+      dilatation = dilatation - 180.0;
+    }
+    WrwpInternal_resultColumn(result, WrwpResultField_DIV)[yindex] = (m->xvvp[3] - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DEF)[yindex] = (deformation - self->offset_VP)/self->gain_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_AD)[yindex] = (dilatation - self->offset_VP)/self->gain_VP;
+  } else {
+    WrwpInternal_resultColumn(result, WrwpResultField_DIV)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_DEF)[yindex] = self->nodata_VP;
+    WrwpInternal_resultColumn(result, WrwpResultField_AD)[yindex] = self->nodata_VP;
+  }
+}
+
+/**
+ * Collects the accepted scans of the inputs together with their metadata and geometry into the context.
+ * The scans of all inputs are treated as one logical volume, nothing is copied.
+ * @param[in] self - self
+ * @param[in] ctx - the context
+ * @param[in] inputs - the validated inputs
+ * @param[in] nlayers - number of layers
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] needWind - if the wind moment is needed
+ * @param[in] needRefl - if the reflectivity moment is needed
+ * @param[in] metadata - the metadata that the accepted scans are added to
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpInternal_collectScans(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, int nlayers,
+                                     int isKnmi, int needWind, int needRefl, WrwpInternal_Metadata* metadata)
+{
+  PolarNavigator_t* polnav = NULL;
+  RaveCoreObject* input = NULL;
+  PolarVolume_t* inobj = NULL; /* the volume that the current scan belongs to, NULL for a single scan */
+  int ninputs = RaveObjectList_size(inputs), ii = 0, nscans = 0, is = 0, result = 0;
+  double lat0 = 0.0, lon0 = 0.0, alt0 = 0.0;
+
+  polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  if (polnav == NULL) {
+    RAVE_ERROR0("Failed to create polar navigator");
+    goto done;
+  }
+  /* All inputs are assumed to come from the same radar, the first one defines the location */
+  input = RaveObjectList_get(inputs, 0);
+  WrwpInternal_getInputLocation(input, &lat0, &lon0, &alt0);
+  RAVE_OBJECT_RELEASE(input);
+  PolarNavigator_setLat0(polnav, lat0);
+  PolarNavigator_setLon0(polnav, lon0);
+  PolarNavigator_setAlt0(polnav, alt0);
+
+  // Collect the accepted scans together with their metadata and geometry once, the
+  // atmospheric layers are then derived from the cached scan information. The scans of
+  // all inputs are treated as one logical volume, nothing is copied.
+  for (ii = 0; ii < ninputs; ii++) {
+    input = RaveObjectList_get(inputs, ii);
+    inobj = RAVE_OBJECT_CHECK_TYPE(input, &PolarVolume_TYPE) ? (PolarVolume_t*)input : NULL;
+    nscans = (inobj != NULL) ? PolarVolume_getNumberOfScans(inobj) : 1;
+
+    for (is = 0; is < nscans; is++) {
+      char* taskString = NULL;
+      PolarScan_t* scan = (inobj != NULL) ? PolarVolume_getScan(inobj, is) : (PolarScan_t*)RAVE_OBJECT_COPY(input);
+
+      if (WrwpInternal_isScanAccepted(self, scan, &taskString)) {
+        if (!WrwpInternal_addScanMetadata(metadata, scan, taskString) ||
+            WrwpInternal_addScanInfo(self, ctx, scan, inobj, polnav, nlayers, isKnmi, needWind, needRefl) == NULL) {
+          RAVE_ERROR0("Failed to allocate memory for the scan information");
+          RAVE_OBJECT_RELEASE(scan);
+          goto done;
+        }
+      }
+      RAVE_OBJECT_RELEASE(scan);
     }
+    RAVE_OBJECT_RELEASE(input);
+    inobj = NULL;
+  }
+
+  result = 1;
+done:
+  RAVE_OBJECT_RELEASE(input);
+  RAVE_OBJECT_RELEASE(polnav);
+  return result;
+}
+
+/**
+ * Adds a field that has no dedicated setter to the profile, the quantity is set as what/quantity
+ * @param[in] vp - the vertical profile
+ * @param[in] field - the field
+ * @param[in] quantity - the quantity
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpInternal_addQuantityField(VerticalProfile_t* vp, RaveField_t* field, const char* quantity)
+{
+  RaveAttribute_t* attr = RaveAttributeHelp_createString("what/quantity", quantity);
+  int result = 0;
+  if (attr != NULL && RaveField_addAttribute(field, attr)) {
+    result = VerticalProfile_addField(vp, field);
+  }
+  RAVE_OBJECT_RELEASE(attr);
+  return result;
+}
 
-    RAVE_FREE(A);
-    RAVE_FREE(Atmp);
-    RAVE_FREE(b);
-    RAVE_FREE(v);
-    RAVE_FREE(vfit);
-    RAVE_FREE(z);
-    RAVE_FREE(az);
-    RAVE_FREE(el);
+/**
+ * Creates the vertical profile from the result block
+ * @param[in] self - self
+ * @param[in] block - the result block
+ * @param[in] origin - the polar volume or scan that the location, source and nominal time are taken from
+ * @returns the vertical profile or NULL on failure
+ */
+static VerticalProfile_t* WrwpInternal_createProfile(Wrwp_t* self, WrwpResult_t* block, RaveCoreObject* origin)
+{
+  VerticalProfile_t* result = NULL;
+  const char* product = "VP";
 
+  /* Field definitions */
+  RaveField_t *nv_field = NULL, *hght_field = NULL;
+  RaveField_t *uwnd_field = NULL, *vwnd_field = NULL;
+  RaveField_t *ff_field = NULL, *ff_dev_field = NULL, *dd_field = NULL;
+  RaveField_t *dbzh_field = NULL, *dbzh_dev_field = NULL, *nz_field = NULL;
+  RaveField_t *div_field = NULL, *def_field = NULL, *ad_field = NULL;
+  RaveField_t *p10_field = NULL, *p50_field = NULL, *p90_field = NULL;
+  RaveField_t *eta_field = NULL, *dens_field = NULL, *ff_bio_field = NULL, *dd_bio_field = NULL, *bio_frac_field = NULL;
 
-    yindex++;   
+  /* Each wanted column in the result block is copied into its field in one go */
+  if (!WrwpInternal_createResultField(block, WrwpResultField_NV, RaveDataType_INT, &nv_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_HGHT, RaveDataType_DOUBLE, &hght_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_UWND, RaveDataType_DOUBLE, &uwnd_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_VWND, RaveDataType_DOUBLE, &vwnd_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_FF, RaveDataType_DOUBLE, &ff_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_FF_DEV, RaveDataType_DOUBLE, &ff_dev_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DD, RaveDataType_DOUBLE, &dd_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DBZH, RaveDataType_DOUBLE, &dbzh_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DBZH_DEV, RaveDataType_DOUBLE, &dbzh_dev_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_NZ, RaveDataType_DOUBLE, &nz_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DIV, RaveDataType_DOUBLE, &div_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DEF, RaveDataType_DOUBLE, &def_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_AD, RaveDataType_DOUBLE, &ad_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DBZH_P10, RaveDataType_DOUBLE, &p10_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DBZH_P50, RaveDataType_DOUBLE, &p50_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DBZH_P90, RaveDataType_DOUBLE, &p90_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_ETA, RaveDataType_DOUBLE, &eta_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DENS, RaveDataType_DOUBLE, &dens_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_FF_BIO, RaveDataType_DOUBLE, &ff_bio_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_DD_BIO, RaveDataType_DOUBLE, &dd_bio_field) ||
+      !WrwpInternal_createResultField(block, WrwpResultField_BIO_FRAC, RaveDataType_DOUBLE, &bio_frac_field)) {
+    RAVE_ERROR0("Failed to allocate arrays for the resulting vp fields");
+    goto done;
   }
 
   if (uwnd_field) WrwpInternal_addNodataUndetectGainOffset(uwnd_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
@@ -1090,10 +2569,21 @@ VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char*
   if (dbzh_field) WrwpInternal_addNodataUndetectGainOffset(dbzh_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
   if (dbzh_dev_field) WrwpInternal_addNodataUndetectGainOffset(dbzh_dev_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
   if (nz_field) WrwpInternal_addNodataUndetectGainOffset(nz_field, -1.0, -1.0, 1.0, 0.0);
+  if (div_field) WrwpInternal_addNodataUndetectGainOffset(div_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (def_field) WrwpInternal_addNodataUndetectGainOffset(def_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (ad_field) WrwpInternal_addNodataUndetectGainOffset(ad_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (p10_field) WrwpInternal_addNodataUndetectGainOffset(p10_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (p50_field) WrwpInternal_addNodataUndetectGainOffset(p50_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (p90_field) WrwpInternal_addNodataUndetectGainOffset(p90_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (eta_field) WrwpInternal_addNodataUndetectGainOffset(eta_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (dens_field) WrwpInternal_addNodataUndetectGainOffset(dens_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (ff_bio_field) WrwpInternal_addNodataUndetectGainOffset(ff_bio_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (dd_bio_field) WrwpInternal_addNodataUndetectGainOffset(dd_bio_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
+  if (bio_frac_field) WrwpInternal_addNodataUndetectGainOffset(bio_frac_field, self->nodata_VP, self->undetect_VP, self->gain_VP, self->offset_VP);
 
   result = RAVE_OBJECT_NEW(&VerticalProfile_TYPE);
   if (result != NULL) {
-    VerticalProfile_setLevels(result, ysize);
+    VerticalProfile_setLevels(result, block->levels);
 
     /* Below are the fields that are possible to inject into the profile, note */
     /* that the presence of the nz_field violates the ODIM spec which defines only one sample size. */
@@ -1110,27 +2600,36 @@ VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char*
         (ff_dev_field != NULL && !VerticalProfile_setFFDev(result, ff_dev_field)) ||
         (dd_field != NULL && !VerticalProfile_setDD(result, dd_field)) ||
         (dbzh_field != NULL && !VerticalProfile_setDBZ(result, dbzh_field)) ||
-        (dbzh_dev_field != NULL && !VerticalProfile_setDBZDev(result, dbzh_dev_field))) {
+        (dbzh_dev_field != NULL && !VerticalProfile_setDBZDev(result, dbzh_dev_field)) ||
+        (div_field != NULL && !WrwpInternal_addQuantityField(result, div_field, "div")) ||
+        (def_field != NULL && !WrwpInternal_addQuantityField(result, def_field, "def")) ||
+        (ad_field != NULL && !WrwpInternal_addQuantityField(result, ad_field, "ad")) ||
+        (p10_field != NULL && !WrwpInternal_addQuantityField(result, p10_field, "DBZH_p10")) ||
+        (p50_field != NULL && !WrwpInternal_addQuantityField(result, p50_field, "DBZH_p50")) ||
+        (p90_field != NULL && !WrwpInternal_addQuantityField(result, p90_field, "DBZH_p90")) ||
+        (eta_field != NULL && !WrwpInternal_addQuantityField(result, eta_field, "eta")) ||
+        (dens_field != NULL && !WrwpInternal_addQuantityField(result, dens_field, "dens")) ||
+        (ff_bio_field != NULL && !WrwpInternal_addQuantityField(result, ff_bio_field, "ff_bio")) ||
+        (dd_bio_field != NULL && !WrwpInternal_addQuantityField(result, dd_bio_field, "dd_bio")) ||
+        (bio_frac_field != NULL && !WrwpInternal_addQuantityField(result, bio_frac_field, "bio_frac"))) {
       RAVE_ERROR0("Failed to set vertical profile fields");
       RAVE_OBJECT_RELEASE(result);
     }
   }
-  VerticalProfile_setLongitude(result, PolarVolume_getLongitude(inobj));
-  VerticalProfile_setLatitude(result, PolarVolume_getLatitude(inobj));
-  VerticalProfile_setHeight(result, PolarVolume_getHeight(inobj));
-  VerticalProfile_setSource(result, PolarVolume_getSource(inobj));
+  if (result == NULL) {
+    goto done;
+  }
+  WrwpInternal_setProfileOrigin(result, origin);
   VerticalProfile_setInterval(result, self->dz);
   VerticalProfile_setMinheight(result, 0);
   VerticalProfile_setMaxheight(result, self->hmax);
-  VerticalProfile_setDate(result, PolarVolume_getDate(inobj));
-  VerticalProfile_setTime(result, PolarVolume_getTime(inobj));
 
   /* Set the times and product, starttime is the starttime for the lowest elev
      endtime is the endtime for the highest elev. */
-  VerticalProfile_setStartDate(result, RaveDateTime_getDate(firstStartDT));
-  VerticalProfile_setStartTime(result, RaveDateTime_getTime(firstStartDT));
-  VerticalProfile_setEndDate(result, RaveDateTime_getDate(lastEndDT));
-  VerticalProfile_setEndTime(result, RaveDateTime_getTime(lastEndDT));
+  VerticalProfile_setStartDate(result, RaveDateTime_getDate(block->startDT));
+  VerticalProfile_setStartTime(result, RaveDateTime_getTime(block->startDT));
+  VerticalProfile_setEndDate(result, RaveDateTime_getDate(block->endDT));
+  VerticalProfile_setEndTime(result, RaveDateTime_getTime(block->endDT));
   VerticalProfile_setProduct(result, product);
    
   /* Supported but not included how attributes, add when needed*/
@@ -1153,56 +2652,2577 @@ VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char*
   //WrwpInternal_findAndAddAttribute(result, inobj, "how/software", self->emin, self->emax);
   //WrwpInternal_findAndAddAttribute(result, inobj, "how/system", self->emin, self->emax);
   
-  /*Dealing with the array of strings containing uniques how/task attribute
-    This is converted to a string that will represent the unique tasks for scans in the volume
-    Note that for radar data not having this attribute in their volumes, it will not be written 
-    Initialization of some useful variables */
-  ntask = len(taskArgs);
-  char finalTasks[300] = {'\0'};
-  int taskCount = 0;
-
-  for (i = 0; i < ntask; i++) {
-    if (taskArgs[i]) {
-      taskCount = taskCount + 1;
-      strcat(finalTasks, taskArgs[i]);
-      strcat(finalTasks, comma);
-    }
-  }
-  if (taskCount != 0) {
-    WrwpInternal_LastcharDel(finalTasks); 
-    WrwpInternal_addStringAttribute(result, "how/task", finalTasks);
+  /* The unique how/task attributes, not written for radar data not having this attribute in their volumes */
+  if (block->tasks != NULL) {
+    WrwpInternal_addStringAttribute(result, "how/task", block->tasks);
   }
   /* how attributes requested by Eprofile */
-  WrwpInternal_addStringAttribute(result, "how/angles", theUsedElevationAngles);
+  WrwpInternal_addStringAttribute(result, "how/angles", block->angles);
   WrwpInternal_addDoubleAttribute(result, "how/minrange", (double)Wrwp_getDMIN(self) / 1000.0); /* km */
   WrwpInternal_addDoubleAttribute(result, "how/maxrange", (double)Wrwp_getDMAX(self) / 1000.0); /* km */
-  RAVE_FREE(theUsedElevationAngles);
 
 done:
-  RAVE_OBJECT_RELEASE(polnav);
   RAVE_OBJECT_RELEASE(ff_field);
   RAVE_OBJECT_RELEASE(ff_dev_field);
   RAVE_OBJECT_RELEASE(dd_field);
   RAVE_OBJECT_RELEASE(dbzh_field);
   RAVE_OBJECT_RELEASE(dbzh_dev_field);
   RAVE_OBJECT_RELEASE(nz_field);
+  RAVE_OBJECT_RELEASE(div_field);
+  RAVE_OBJECT_RELEASE(def_field);
+  RAVE_OBJECT_RELEASE(ad_field);
+  RAVE_OBJECT_RELEASE(p10_field);
+  RAVE_OBJECT_RELEASE(p50_field);
+  RAVE_OBJECT_RELEASE(p90_field);
+  RAVE_OBJECT_RELEASE(eta_field);
+  RAVE_OBJECT_RELEASE(dens_field);
+  RAVE_OBJECT_RELEASE(ff_bio_field);
+  RAVE_OBJECT_RELEASE(dd_bio_field);
+  RAVE_OBJECT_RELEASE(bio_frac_field);
   RAVE_OBJECT_RELEASE(nv_field);
   RAVE_OBJECT_RELEASE(hght_field);
   RAVE_OBJECT_RELEASE(uwnd_field);
   RAVE_OBJECT_RELEASE(vwnd_field);
-  RAVE_OBJECT_RELEASE(firstStartDT);
-  RAVE_OBJECT_RELEASE(lastEndDT);
-  RaveList_freeAndDestroy(&wantedFields);
 
   return result;
 }
 
-/*@} End of Interface functions */
+/**
+ * Returns the date/time as seconds since 1970-01-01 00:00:00
+ * @param[in] dt - the date/time, may be NULL
+ * @param[out] seconds - the number of seconds
+ * @returns 1 on success, 0 if the date/time is missing or invalid
+ */
+static int WrwpInternal_getSeconds(RaveDateTime_t* dt, long* seconds)
+{
+  const char *date = NULL, *time = NULL;
+  int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+  long era = 0, yoe = 0, doy = 0, doe = 0;
 
-RaveCoreObjectType Wrwp_TYPE = {
-    "Wrwp",
-    sizeof(Wrwp_t),
-    Wrwp_constructor,
-    Wrwp_destructor
-};
+  if (dt == NULL) {
+    return 0;
+  }
+  date = RaveDateTime_getDate(dt);
+  time = RaveDateTime_getTime(dt);
+  if (date == NULL || time == NULL ||
+      sscanf(date, "%4d%2d%2d", &year, &month, &day) != 3 ||
+      sscanf(time, "%2d%2d%2d", &hour, &minute, &second) != 3) {
+    return 0;
+  }
+  /* Number of days since 1970-01-01 in the gregorian calendar, with years starting in march */
+  year -= (month <= 2);
+  era = (year >= 0 ? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  *seconds = (era * 146097 + doe - 719468) * 86400L + hour * 3600L + minute * 60L + second;
+  return 1;
+}
+
+/**
+ * Adds (sign = 1) or subtracts (sign = -1) the sums of a part of the samples to or from the total.
+ * The squared deviations of the reflectivity are combined using the means of the two parts.
+ * @param[in,out] total - the total
+ * @param[in] part - the sums of the part
+ * @param[in] sign - 1 to add, -1 to subtract
+ */
+static void WrwpInternal_combineLayerSums(WrwpInternal_LayerSums* total, const WrwpInternal_LayerSums* part, int sign)
+{
+  int i = 0;
+  if (part->wind.n > 0) {
+    total->wind.n += sign * part->wind.n;
+    for (i = 0; i < 6; i++) {
+      total->wind.aa[i] += sign * part->wind.aa[i];
+    }
+    for (i = 0; i < 3; i++) {
+      total->wind.ab[i] += sign * part->wind.ab[i];
+    }
+    total->wind.bb += sign * part->wind.bb;
+    if (total->wind.n <= 0) {
+      memset(&total->wind, 0, sizeof(WrwpNormalEquations)); /* No rounding errors left behind */
+    }
+  }
+
+  if (part->nz > 0) {
+    if (sign > 0) {
+      int n = total->nz + part->nz;
+      double delta = part->zsum / part->nz - (total->nz > 0 ? total->zsum / total->nz : 0.0);
+      total->zm2 += part->zm2 + delta * delta * ((double)total->nz * part->nz / n);
+      total->zsum += part->zsum;
+      total->nz = n;
+    } else if (total->nz <= part->nz) {
+      total->nz = 0;
+      total->zsum = 0.0;
+      total->zm2 = 0.0;
+    } else {
+      int n = total->nz - part->nz;
+      double zsum = total->zsum - part->zsum;
+      double delta = part->zsum / part->nz - zsum / n;
+      total->zm2 -= part->zm2 + delta * delta * ((double)n * part->nz / total->nz);
+      if (total->zm2 < 0.0) {
+        total->zm2 = 0.0;
+      }
+      total->zsum = zsum;
+      total->nz = n;
+    }
+  }
+  if (total->zsketch != NULL && part->zsketch != NULL) {
+    WrwpKernel_combineSketch(total->zsketch, part->zsketch, sign);
+  }
+}
 
+/**
+ * Derives the layer moments from the sums, the wind is fitted with the SMHI method.
+ * @param[in] sums - the sums of the layer
+ * @param[out] m - the moments
+ */
+static void WrwpInternal_momentsFromSums(const WrwpInternal_LayerSums* sums, WrwpInternal_LayerMoments* m)
+{
+  memset(m, 0, sizeof(WrwpInternal_LayerMoments));
+  m->nv = (int)sums->wind.n;
+  if (m->nv > 3 && !WrwpKernel_solveNormalEquations(&sums->wind, m->x, &m->chisq)) {
+    m->nv = 0;
+  }
+  m->nz = sums->nz;
+  m->zsum = sums->zsum;
+  m->zsqdev = sums->zm2;
+  if (sums->zsketch != NULL) {
+    m->zsketch = *sums->zsketch;
+  }
+}
+
+/**
+ * Derives the contribution of the scan to each layer of the window
+ * @param[in] window - the window
+ * @param[in] ctx - the context
+ * @param[in] scan - the scan
+ * @param[in] layers - the layers to fill in, nlayers entries
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_gatherWindowLayers(WrwpWindow_t* window, WrwpContext_t* ctx, PolarScan_t* scan, WrwpInternal_LayerSums* layers)
+{
+  WrwpInternal_ScanInfo* info = NULL;
+  int yindex = 0, n = 0;
+
+  PolarNavigator_setLat0(window->polnav, PolarScan_getLatitude(scan));
+  PolarNavigator_setLon0(window->polnav, PolarScan_getLongitude(scan));
+  PolarNavigator_setAlt0(window->polnav, PolarScan_getHeight(scan));
+
+  if (!WrwpInternal_ensureSampleBuffers(ctx, window->needWind, window->needRefl, window->useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, 0, 0, window->quantiles, 0) ||
+      (info = WrwpInternal_addScanInfo(window->wrwp, ctx, scan, NULL, window->polnav, window->nlayers,
+                                       0, window->needWind, window->needRefl)) == NULL) {
+    WrwpInternal_releaseScanInfos(ctx);
+    return 0;
+  }
+
+  WrwpInternal_resetLayerSums(layers, window->nlayers);
+  for (yindex = 0; yindex < window->nlayers; yindex++) {
+    WrwpInternal_LayerSums* layer = &layers[yindex];
+
+    n = WrwpInternal_gatherWind(window->wrwp, ctx, info, yindex, 0, window->useFloat, 0, NOR);
+    if (n > 0) {
+      if (window->useFloat) {
+        WrwpKernel_accumulateNormalEquationsFloat(n, ctx->fA, ctx->fA+NOR, NULL, ctx->fv, &layer->wind);
+      } else {
+        WrwpKernel_accumulateNormalEquations(n, ctx->A, ctx->A+NOR, NULL, ctx->b, &layer->wind);
+      }
+    }
+
+    n = WrwpInternal_gatherReflectivity(ctx, info, yindex, window->useFloat, 0, NOR, &layer->zsum);
+    if (n > 0) {
+      layer->nz = n;
+      layer->zm2 = WrwpInternal_reflectivitySquaredDeviation(ctx, n, window->useFloat, layer->zsum / n);
+      if (layer->zsketch != NULL) {
+        WrwpInternal_addToSketch(ctx, n, window->useFloat, layer->zsketch);
+      }
+    }
+  }
+  WrwpInternal_releaseScanInfos(ctx);
+  return 1;
+}
+
+/**
+ * Retires the oldest scan in the window and subtracts its contribution from the total. The total is
+ * rebuilt from the remaining scans every \ref WRWP_WINDOW_REBUILD retirements.
+ * @param[in] window - the window
+ */
+static void WrwpInternal_retireWindowScan(WrwpWindow_t* window)
+{
+  WrwpInternal_WindowScan* oldest = &window->scans[window->head];
+  int i = 0, yindex = 0;
+
+  for (yindex = 0; yindex < window->nlayers; yindex++) {
+    WrwpInternal_combineLayerSums(&window->total[yindex], &oldest->layers[yindex], -1);
+  }
+  WrwpInternal_clearWindowScan(oldest);
+  window->head = (window->head + 1) % window->scansCapacity;
+  window->nscans--;
+
+  if (++window->retired >= WRWP_WINDOW_REBUILD) {
+    WrwpInternal_resetLayerSums(window->total, window->nlayers);
+    for (i = 0; i < window->nscans; i++) {
+      WrwpInternal_WindowScan* wscan = &window->scans[(window->head + i) % window->scansCapacity];
+      for (yindex = 0; yindex < window->nlayers; yindex++) {
+        WrwpInternal_combineLayerSums(&window->total[yindex], &wscan->layers[yindex], 1);
+      }
+    }
+    window->retired = 0;
+  }
+}
+
+/**
+ * Makes sure that there is room for one more scan in the window, the ring buffer is unrolled when grown
+ * @param[in] window - the window
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_ensureWindowCapacity(WrwpWindow_t* window)
+{
+  if (window->nscans == window->scansCapacity) {
+    int ncapacity = window->scansCapacity == 0 ? 16 : window->scansCapacity * 2, i = 0;
+    WrwpInternal_WindowScan* scans = RAVE_CALLOC((size_t)ncapacity, sizeof(WrwpInternal_WindowScan));
+    if (scans == NULL) {
+      return 0;
+    }
+    for (i = 0; i < window->nscans; i++) {
+      scans[i] = window->scans[(window->head + i) % window->scansCapacity];
+    }
+    RAVE_FREE(window->scans);
+    window->scans = scans;
+    window->scansCapacity = ncapacity;
+    window->head = 0;
+  }
+  return 1;
+}
+
+/**
+ * Gathers the samples of each layer from the collected scans in the context into the sums of the layer.
+ * @param[in] self - self
+ * @param[in] ctx - the context with the collected scans
+ * @param[in] nlayers - number of layers
+ * @param[in] useFloat - if the samples are gathered in single precision
+ * @param[out] sums - the sums of each layer, nlayers entries
+ */
+static void WrwpInternal_gatherLayerSums(Wrwp_t* self, WrwpContext_t* ctx, int nlayers, int useFloat, WrwpInternal_LayerSums* sums)
+{
+  int yindex = 0, is = 0, nv = 0, nz = 0;
+  WrwpInternal_resetLayerSums(sums, nlayers);
+  for (yindex = 0; yindex < nlayers; yindex++) {
+    WrwpInternal_LayerSums* layer = &sums[yindex];
+    nv = 0;
+    nz = 0;
+    for (is = 0; is < ctx->nscans; is++) {
+      nv = WrwpInternal_gatherWind(self, ctx, &ctx->scans[is], yindex, 0, useFloat, nv, NOR);
+      nz = WrwpInternal_gatherReflectivity(ctx, &ctx->scans[is], yindex, useFloat, nz, NOR, &layer->zsum);
+    }
+    if (nv > 0) {
+      if (useFloat) {
+        WrwpKernel_accumulateNormalEquationsFloat(nv, ctx->fA, ctx->fA+NOR, NULL, ctx->fv, &layer->wind);
+      } else {
+        WrwpKernel_accumulateNormalEquations(nv, ctx->A, ctx->A+NOR, NULL, ctx->b, &layer->wind);
+      }
+    }
+    layer->nz = nz;
+    if (nz > 0) {
+      layer->zm2 = WrwpInternal_reflectivitySquaredDeviation(ctx, nz, useFloat, layer->zsum / nz);
+      if (layer->zsketch != NULL) {
+        WrwpInternal_addToSketch(ctx, nz, useFloat, layer->zsketch);
+      }
+    }
+  }
+}
+
+/**
+ * Adds the metadata of a used scan to the composite
+ * @param[in] composite - the composite
+ * @param[in] elangle - the elevation angle [rad]
+ * @param[in] task - the how/task of the scan, may be NULL
+ * @param[in] startDT - the start date/time of the scan, may be NULL
+ * @param[in] endDT - the end date/time of the scan, may be NULL
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_addCompositeScan(WrwpComposite_t* composite, double elangle, const char* task,
+                                         RaveDateTime_t* startDT, RaveDateTime_t* endDT)
+{
+  WrwpInternal_WindowScan* cscan = NULL;
+  if (composite->nscans == composite->scansCapacity) {
+    int ncapacity = composite->scansCapacity == 0 ? 16 : composite->scansCapacity * 2;
+    WrwpInternal_WindowScan* scans = RAVE_REALLOC(composite->scans, sizeof(WrwpInternal_WindowScan) * ncapacity);
+    if (scans == NULL) {
+      return 0;
+    }
+    composite->scans = scans;
+    composite->scansCapacity = ncapacity;
+  }
+  cscan = &composite->scans[composite->nscans];
+  memset(cscan, 0, sizeof(WrwpInternal_WindowScan));
+  cscan->elangle = elangle;
+  cscan->startDT = RAVE_OBJECT_COPY(startDT);
+  cscan->endDT = RAVE_OBJECT_COPY(endDT);
+  if (task != NULL && (cscan->task = RAVE_STRDUP(task)) == NULL) {
+    WrwpInternal_clearWindowScan(cscan);
+    return 0;
+  }
+  composite->nscans++;
+  return 1;
+}
+
+/**
+ * Removes the metadata of the scans added after the first nscans, used when adding a radar fails
+ * @param[in] composite - the composite
+ * @param[in] nscans - the number of scans to keep
+ */
+static void WrwpInternal_truncateCompositeScans(WrwpComposite_t* composite, int nscans)
+{
+  while (composite->nscans > nscans) {
+    WrwpInternal_clearWindowScan(&composite->scans[--composite->nscans]);
+  }
+}
+
+/**
+ * Appends nodes to the how/nodes of the composite, nodes that do not fit are dropped.
+ * @param[in] composite - the composite
+ * @param[in] nodes - the quoted and comma separated nodes, e.g. 'seang'
+ */
+static void WrwpInternal_appendCompositeNodes(WrwpComposite_t* composite, const char* nodes)
+{
+  size_t len = strlen(composite->nodes);
+  if (nodes[0] != '\0' && len + strlen(nodes) + 2 < WRWP_NODES_LENGTH) {
+    if (len > 0) {
+      strcat(composite->nodes, ",");
+    }
+    strcat(composite->nodes, nodes);
+  }
+}
+
+/**
+ * Returns the quoted node of a source string, e.g. 'seang' from WMO:02606,NOD:seang. Older sources
+ * without NOD are identified by RAD or WMO instead.
+ * @param[in] source - the source, may be NULL
+ * @param[out] node - the quoted node, empty if the source has neither NOD, RAD nor WMO
+ * @param[in] len - the size of node
+ */
+static void WrwpInternal_getQuotedNode(const char* source, char* node, size_t len)
+{
+  const char* ids[] = {"NOD:", "RAD:", "WMO:"};
+  const char* id = NULL;
+  int i = 0;
+  node[0] = '\0';
+  for (i = 0; source != NULL && id == NULL && i < 3; i++) {
+    id = strstr(source, ids[i]);
+  }
+  if (id != NULL) {
+    snprintf(node, len, "'%.*s'", (int)strcspn(id + 4, ","), id + 4);
+  }
+}
+
+/**
+ * Returns the greatest common divisor
+ */
+static int WrwpInternal_gcd(int a, int b)
+{
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/**
+ * Returns a clone of the generator with another layer interval and maximum height
+ * @param[in] self - self
+ * @param[in] dz - the layer interval
+ * @param[in] hmax - the maximum height
+ * @returns the clone or NULL on memory allocation failure
+ */
+static Wrwp_t* WrwpInternal_cloneWithLayers(Wrwp_t* self, int dz, int hmax)
+{
+  Wrwp_t* result = RAVE_OBJECT_CLONE(self);
+  if (result != NULL) {
+    Wrwp_setDZ(result, dz);
+    Wrwp_setHMAX(result, hmax);
+  }
+  return result;
+}
+
+/**
+ * Adds a sample to the decoded samples
+ * @param[in] samples - the samples
+ * @param[in] scan - index of the scan
+ * @param[in] gate - ray * nbins + bin
+ * @param[in] value - the value
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_addSweepSample(WrwpInternal_SweepSamples* samples, int scan, int gate, double value)
+{
+  if (samples->n == samples->capacity) {
+    int ncapacity = samples->capacity == 0 ? 65536 : samples->capacity * 2;
+    int *nscan = NULL, *ngate = NULL;
+    double* nvalue = NULL;
+    nscan = RAVE_REALLOC(samples->scan, sizeof(int) * ncapacity);
+    if (nscan == NULL) {
+      return 0;
+    }
+    samples->scan = nscan;
+    ngate = RAVE_REALLOC(samples->gate, sizeof(int) * ncapacity);
+    if (ngate == NULL) {
+      return 0;
+    }
+    samples->gate = ngate;
+    nvalue = RAVE_REALLOC(samples->value, sizeof(double) * ncapacity);
+    if (nvalue == NULL) {
+      return 0;
+    }
+    samples->value = nvalue;
+    samples->capacity = ncapacity;
+  }
+  samples->scan[samples->n] = scan;
+  samples->gate[samples->n] = gate;
+  samples->value[samples->n] = value;
+  samples->n++;
+  return 1;
+}
+
+/**
+ * Decodes the valid samples of the parameter in the bins that are used by any of the configurations
+ * @param[in] param - the parameter
+ * @param[in] sscan - the decoded scan
+ * @param[in] index - the index of the scan
+ * @param[in] used - if each bin is used by any configuration
+ * @param[in] toZ - if the values should be converted from dBZ to Z
+ * @param[in] samples - the samples that the valid samples are added to
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_decodeSweepSamples(PolarScanParam_t* param, WrwpInternal_SweepScan* sscan, int index,
+                                           const char* used, int toZ, WrwpInternal_SweepSamples* samples)
+{
+  double gain = PolarScanParam_getGain(param), offset = PolarScanParam_getOffset(param);
+  double nodata = PolarScanParam_getNodata(param), undetect = PolarScanParam_getUndetect(param);
+  double val = 0.0;
+  long ir = 0, ib = 0;
+
+  for (ir = 0; ir < sscan->nrays; ir++) {
+    for (ib = 0; ib < sscan->nbins; ib++) {
+      if (used[ib]) {
+        PolarScanParam_getValue(param, ib, ir, &val);
+        if (val != nodata && val != undetect &&
+            !WrwpInternal_addSweepSample(samples, index, (int)(ir * sscan->nbins + ib),
+                                         toZ ? dBZ2Z(offset+gain*val) : offset+gain*val)) {
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * Releases everything in the sweep
+ * @param[in] sweep - the sweep
+ */
+static void WrwpInternal_clearSweep(WrwpInternal_Sweep* sweep)
+{
+  int is = 0;
+  for (is = 0; is < sweep->nscans; is++) {
+    RAVE_OBJECT_RELEASE(sweep->scans[is].scan);
+    RAVE_FREE(sweep->scans[is].h);
+    RAVE_FREE(sweep->scans[is].d);
+    RAVE_FREE(sweep->scans[is].binLayer);
+    RAVE_FREE(sweep->scans[is].raySector);
+  }
+  RAVE_FREE(sweep->scans);
+  RAVE_FREE(sweep->wind.scan);
+  RAVE_FREE(sweep->wind.gate);
+  RAVE_FREE(sweep->wind.value);
+  RAVE_FREE(sweep->refl.scan);
+  RAVE_FREE(sweep->refl.gate);
+  RAVE_FREE(sweep->refl.value);
+  memset(sweep, 0, sizeof(WrwpInternal_Sweep));
+}
+
+/**
+ * Decodes the scans within the elevation limits once. Only the bins within the distance limits and below
+ * hmax are decoded and only the valid samples are kept.
+ * @param[in] sweep - the sweep, should be empty
+ * @param[in] inputs - list of polar volumes and/or polar scans
+ * @param[in] polnav - the navigator
+ * @param[in] emin - the minimum elevation angle [deg]
+ * @param[in] emax - the maximum elevation angle [deg]
+ * @param[in] dmin - the minimum distance [m]
+ * @param[in] dmax - the maximum distance [m]
+ * @param[in] hmax - the maximum height [m]
+ * @param[in] needWind - if the radial winds should be decoded
+ * @param[in] needRefl - if the reflectivities should be decoded
+ * @returns 1 on success, 0 on memory allocation failure
+ */
+static int WrwpInternal_decodeSweep(WrwpInternal_Sweep* sweep, RaveObjectList_t* inputs, PolarNavigator_t* polnav,
+                                    double emin, double emax, double dmin, double dmax, double hmax, int needWind, int needRefl)
+{
+  RaveCoreObject* input = NULL;
+  PolarVolume_t* inobj = NULL; /* the volume that the current scan belongs to, NULL for a single scan */
+  PolarScan_t* scan = NULL;
+  char* used = NULL;
+  long usedCapacity = 0, ib = 0;
+  int ninputs = RaveObjectList_size(inputs), ii = 0, is = 0, result = 0;
+
+  for (ii = 0; ii < ninputs; ii++) {
+    int nscansInput = 0;
+    input = RaveObjectList_get(inputs, ii);
+    inobj = RAVE_OBJECT_CHECK_TYPE(input, &PolarVolume_TYPE) ? (PolarVolume_t*)input : NULL;
+    nscansInput = (inobj != NULL) ? PolarVolume_getNumberOfScans(inobj) : 1;
+
+    for (is = 0; is < nscansInput; is++) {
+      WrwpInternal_SweepScan* sscan = NULL;
+      PolarScanParam_t* param = NULL;
+      double elangle = 0.0, rscale = 0.0;
+      int index = 0, ok = 1;
+
+      scan = (inobj != NULL) ? PolarVolume_getScan(inobj, is) : (PolarScan_t*)RAVE_OBJECT_COPY(input);
+      elangle = PolarScan_getElangle(scan) * RAD2DEG;
+      rscale = PolarScan_getRscale(scan);
+      if (elangle < emin || elangle > emax) {
+        RAVE_OBJECT_RELEASE(scan);
+        continue;
+      }
+      if (sweep->nscans == sweep->capacity) {
+        int ncapacity = sweep->capacity == 0 ? 16 : sweep->capacity * 2;
+        WrwpInternal_SweepScan* nscans = RAVE_REALLOC(sweep->scans, sizeof(WrwpInternal_SweepScan) * ncapacity);
+        if (nscans == NULL) {
+          RAVE_ERROR0("Failed to allocate memory for the scans");
+          goto done;
+        }
+        sweep->scans = nscans;
+        sweep->capacity = ncapacity;
+      }
+      index = sweep->nscans++;
+      sscan = &sweep->scans[index];
+      memset(sscan, 0, sizeof(WrwpInternal_SweepScan));
+      sscan->scan = scan; /* the reference is kept by the sweep */
+      scan = NULL;
+      sscan->elangle = PolarScan_getElangle(sscan->scan);
+      sscan->nbins = PolarScan_getNbins(sscan->scan);
+      sscan->nrays = PolarScan_getNrays(sscan->scan);
+      sscan->h = RAVE_MALLOC(sizeof(double) * (sscan->nbins > 0 ? sscan->nbins : 1));
+      sscan->d = RAVE_MALLOC(sizeof(double) * (sscan->nbins > 0 ? sscan->nbins : 1));
+      sscan->binLayer = RAVE_MALLOC(sizeof(int) * (sscan->nbins > 0 ? sscan->nbins : 1));
+      if (sscan->nbins > usedCapacity) {
+        RAVE_FREE(used);
+        used = RAVE_MALLOC(sizeof(char) * sscan->nbins);
+        usedCapacity = (used != NULL) ? sscan->nbins : 0;
+      }
+      if (sscan->h == NULL || sscan->d == NULL || sscan->binLayer == NULL || (sscan->nbins > 0 && used == NULL)) {
+        RAVE_ERROR0("Failed to allocate memory for the scan geometry");
+        goto done;
+      }
+      for (ib = 0; ib < sscan->nbins; ib++) {
+        PolarNavigator_reToDh(polnav, (ib+0.5)*rscale, sscan->elangle, &sscan->d[ib], &sscan->h[ib]);
+        used[ib] = (sscan->d[ib] >= dmin && sscan->d[ib] <= dmax && sscan->h[ib] >= 0.0 && sscan->h[ib] < hmax);
+      }
+
+      // radial wind scans, the Nyquist interval is kept for the KNMI method
+      if (needWind && (PolarScan_hasParameter(sscan->scan, "VRAD") || PolarScan_hasParameter(sscan->scan, "VRADH"))) {
+        param = PolarScan_getParameter(sscan->scan, PolarScan_hasParameter(sscan->scan, "VRAD") ? "VRAD" : "VRADH");
+        if (!WrwpInternal_getDoubleAttribute((RaveCoreObject*)sscan->scan, "how/NI", &sscan->NI)) {
+          if (inobj == NULL || !WrwpInternal_getDoubleAttribute((RaveCoreObject*)inobj, "how/NI", &sscan->NI)) {
+            sscan->NI = fabs(PolarScanParam_getOffset(param));
+          }
+        }
+        ok = WrwpInternal_decodeSweepSamples(param, sscan, index, used, 0, &sweep->wind);
+        RAVE_OBJECT_RELEASE(param);
+      }
+      // reflectivity scans
+      if (ok && needRefl && PolarScan_hasParameter(sscan->scan, "DBZH")) {
+        param = PolarScan_getParameter(sscan->scan, "DBZH");
+        ok = WrwpInternal_decodeSweepSamples(param, sscan, index, used, 1, &sweep->refl);
+        RAVE_OBJECT_RELEASE(param);
+      }
+      if (!ok) {
+        RAVE_ERROR0("Failed to allocate memory for the samples");
+        goto done;
+      }
+    }
+    RAVE_OBJECT_RELEASE(input);
+    inobj = NULL;
+  }
+  result = 1;
+done:
+  RAVE_FREE(used);
+  RAVE_OBJECT_RELEASE(scan);
+  RAVE_OBJECT_RELEASE(input);
+  return result;
+}
+
+/**
+ * Sorts the samples into the layers of the configuration, the order of the samples is kept within each layer.
+ * When the scans have a sector for each ray, the layers of each sector follow each other, i.e. the sample
+ * goes to bucket raySector * stride + binLayer.
+ * @param[in] self - the configuration
+ * @param[in] scans - the decoded scans, binLayer must have been set for the configuration
+ * @param[in] samples - the samples
+ * @param[in] isWind - if the samples are radial winds, the wind specific limits are then applied
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] nbuckets - number of layers in total
+ * @param[in] stride - number of layers per sector, only used when the scans have a sector for each ray
+ * @param[out] sampleLayer - the layer of each sample, -1 if not used, samples->n entries
+ * @param[out] layerStart - start index in order for each layer, nbuckets + 1 entries
+ * @param[out] order - the sample indexes sorted by layer, samples->n entries
+ */
+static void WrwpInternal_sortSweepSamples(Wrwp_t* self, WrwpInternal_SweepScan* scans, WrwpInternal_SweepSamples* samples,
+                                          int isWind, int isKnmi, int nbuckets, int stride, int* sampleLayer, int* layerStart, int* order)
+{
+  int i = 0, l = 0;
+
+  for (l = 0; l <= nbuckets; l++) {
+    layerStart[l] = 0;
+  }
+  for (i = 0; i < samples->n; i++) {
+    WrwpInternal_SweepScan* sscan = &scans[samples->scan[i]];
+    int ib = (int)(samples->gate[i] % sscan->nbins);
+    l = sscan->binLayer[ib];
+    if (l >= 0 && isWind) {
+      int useScan = (!isKnmi || (sscan->elangle * RAD2DEG <= self->econdmax));
+      if ((isKnmi && !self->dealias && sscan->NI < self->nimin) ||
+          !(useScan || (sscan->h[ib] >= self->hthr)) ||
+          !(fabs(samples->value[i]) >= self->vmin)) {
+        l = -1;
+      }
+    }
+    if (l >= 0 && sscan->raySector != NULL) {
+      l += sscan->raySector[samples->gate[i] / sscan->nbins] * stride;
+    }
+    sampleLayer[i] = l;
+    if (l >= 0) {
+      layerStart[l + 1]++;
+    }
+  }
+
+  /* Counting sort, same as for the bins in WrwpInternal_prepareScanGeometry */
+  for (l = 0; l < nbuckets; l++) {
+    layerStart[l + 1] += layerStart[l];
+  }
+  for (i = 0; i < samples->n; i++) {
+    if (sampleLayer[i] >= 0) {
+      order[layerStart[sampleLayer[i]]++] = i;
+    }
+  }
+  for (l = nbuckets; l > 0; l--) {
+    layerStart[l] = layerStart[l - 1];
+  }
+  layerStart[0] = 0;
+}
+
+/**
+ * Fits the layers of one profile from the sorted samples of a sweep and stores them in the result
+ * @param[in] self - the configuration
+ * @param[in] ctx - the context, the sample buffers must have been allocated
+ * @param[in] sweep - the sweep
+ * @param[in] isKnmi - if the KNMI method is used
+ * @param[in] needWind - if the wind moment is needed
+ * @param[in] useFloat - if the samples are gathered in single precision
+ * @param[in] windStart - start index in windOrder for each layer, see \ref WrwpInternal_sortSweepSamples
+ * @param[in] windOrder - the wind samples sorted by layer
+ * @param[in] reflStart - start index in reflOrder for each layer
+ * @param[in] reflOrder - the reflectivity samples sorted by layer
+ * @param[in] first - the index of the first layer of the profile among the sorted layers
+ * @param[in] result - the result block, initialized with the layers of the profile
+ */
+static void WrwpInternal_fitSweepLayers(Wrwp_t* self, WrwpContext_t* ctx, WrwpInternal_Sweep* sweep, int isKnmi, int needWind, int useFloat,
+                                        const int* windStart, const int* windOrder, const int* reflStart, const int* reflOrder,
+                                        int first, WrwpResult_t* result)
+{
+  int yindex = 0, i = 0;
+  for (yindex = 0; yindex < result->levels; yindex++) {
+    WrwpInternal_LayerMoments m;
+    double zsum = 0.0;
+    int nv = 0, nz = 0, l = first + yindex;
+    for (i = windStart[l]; i < windStart[l + 1]; i++) {
+      int idx = windOrder[i];
+      WrwpInternal_SweepScan* sscan = &sweep->scans[sweep->wind.scan[idx]];
+      long ir = sweep->wind.gate[idx] / sscan->nbins;
+      nv = WrwpInternal_addWindSample(self, ctx, isKnmi, useFloat, nv, NOR, sweep->wind.value[idx],
+                                      360./sscan->nrays*ir*DEG2RAD, sscan->elangle, sscan->d[sweep->wind.gate[idx] % sscan->nbins],
+                                      sscan->NI);
+    }
+    for (i = reflStart[l]; i < reflStart[l + 1]; i++) {
+      nz = WrwpInternal_addReflectivitySample(ctx, useFloat, nz, NOR, sweep->refl.value[reflOrder[i]], &zsum);
+    }
+    WrwpInternal_fitLayer(self, ctx, isKnmi, needWind, useFloat, nv, nz, zsum, &m);
+    WrwpInternal_storeLayer(self, result, yindex, isKnmi, &m);
+  }
+}
+
+/*@} End of Private functions */
+
+/*@{ Interface functions */
+void Wrwp_setDZ(Wrwp_t* self, int dz)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->dz = dz;
+}
+
+int Wrwp_getDZ(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->dz;
+}
+
+void Wrwp_setNODATA_VP(Wrwp_t* self, int nodata_VP)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->nodata_VP = nodata_VP;
+}
+
+int Wrwp_getNODATA_VP(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nodata_VP;
+}
+
+void Wrwp_setUNDETECT_VP(Wrwp_t* self, int undetect_VP)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->undetect_VP = undetect_VP;
+}
+
+int Wrwp_getUNDETECT_VP(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->undetect_VP;
+}
+
+void Wrwp_setGAIN_VP(Wrwp_t* self, double gain_VP)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  if (gain_VP == 0.0) {
+    RAVE_ERROR0("Trying to set gain to 0.0");
+    return;
+  }
+  self->gain_VP = gain_VP;
+}
+
+double Wrwp_getGAIN_VP(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->gain_VP;
+}
+
+void Wrwp_setOFFSET_VP(Wrwp_t* self, double offset_VP)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->offset_VP = offset_VP;
+}
+
+double Wrwp_getOFFSET_VP(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->offset_VP;
+}
+
+void Wrwp_setHMAX(Wrwp_t* self, int hmax)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->hmax = hmax;
+}
+
+int Wrwp_getHMAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->hmax;
+}
+
+void Wrwp_setDMIN(Wrwp_t* self, int dmin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->dmin = dmin;
+}
+
+int Wrwp_getDMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->dmin;
+}
+
+void Wrwp_setDMAX(Wrwp_t* self, int dmax)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->dmax = dmax;
+}
+
+int Wrwp_getDMAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->dmax;
+}
+
+void Wrwp_setNMIN_WND(Wrwp_t* self, int nmin_wnd)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->nmin_wnd = nmin_wnd;
+}
+
+int Wrwp_getNMIN_WND(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nmin_wnd;
+}
+
+void Wrwp_setNMIN_REF(Wrwp_t* self, int nmin_ref)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->nmin_ref = nmin_ref;
+}
+
+int Wrwp_getNMIN_REF(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nmin_ref;
+}
+
+void Wrwp_setEMIN(Wrwp_t* self, double emin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->emin = emin;
+}
+
+double Wrwp_getEMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->emin;
+}
+
+void Wrwp_setEMAX(Wrwp_t* self, double emax)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->emax = emax;
+}
+
+double Wrwp_getEMAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->emax;
+}
+
+void Wrwp_setECONDMAX(Wrwp_t* self, double econdmax)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->econdmax = econdmax;
+}
+
+double Wrwp_getECONDMAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->econdmax;
+}
+
+void Wrwp_setHTHR(Wrwp_t* self, double hthr)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->hthr = hthr;
+}
+
+double Wrwp_getHTHR(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->hthr;
+}
+
+void Wrwp_setNIMIN(Wrwp_t* self, double nimin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->nimin = nimin;
+}
+
+double Wrwp_getNIMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nimin;
+}
+
+void Wrwp_setNGAPBIN(Wrwp_t* self, int ngapbin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->ngapbin = ngapbin;
+}
+
+int Wrwp_getNGAPBIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->ngapbin;
+}
+
+void Wrwp_setNGAPMIN(Wrwp_t* self, int ngapmin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->ngapmin = ngapmin;
+}
+
+int Wrwp_getNGAPMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->ngapmin;
+}
+
+void Wrwp_setMAXNSTD(Wrwp_t* self, int maxnstd)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->maxnstd = maxnstd;
+}
+
+int Wrwp_getMAXNSTD(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->maxnstd;
+}
+
+void Wrwp_setMAXVDIFF(Wrwp_t* self, double maxvdiff)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->maxvdiff = maxvdiff;
+}
+
+double Wrwp_getMAXVDIFF(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->maxvdiff;
+}
+
+void Wrwp_setFF_MAX(Wrwp_t* self, double ff_max)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->ff_max = ff_max;
+}
+
+double Wrwp_getFF_MAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->ff_max;
+}
+
+void Wrwp_setVMIN(Wrwp_t* self, double vmin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->vmin = vmin;
+}
+
+double Wrwp_getVMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->vmin;
+}
+
+void Wrwp_setDealias(Wrwp_t* self, int dealias)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->dealias = dealias ? 1 : 0;
+}
+
+int Wrwp_getDealias(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->dealias;
+}
+
+void Wrwp_setBIO_DBZMAX(Wrwp_t* self, double bio_dbzmax)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->bio_dbzmax = bio_dbzmax;
+}
+
+double Wrwp_getBIO_DBZMAX(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->bio_dbzmax;
+}
+
+void Wrwp_setBIO_RCS(Wrwp_t* self, double bio_rcs)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->bio_rcs = bio_rcs;
+}
+
+double Wrwp_getBIO_RCS(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->bio_rcs;
+}
+
+void Wrwp_setBIO_STDMIN(Wrwp_t* self, double bio_stdmin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return;
+  }
+  self->bio_stdmin = bio_stdmin;
+}
+
+double Wrwp_getBIO_STDMIN(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->bio_stdmin;
+}
+
+int Wrwp_setSamplePrecision(Wrwp_t* self, WrwpSamplePrecision precision)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpInternal_isModifiable(self)) {
+    return 0;
+  }
+  if (precision != WrwpSamplePrecision_DOUBLE && precision != WrwpSamplePrecision_FLOAT) {
+    RAVE_ERROR1("Unsupported sample precision %d", (int)precision);
+    return 0;
+  }
+  self->precision = precision;
+  return 1;
+}
+
+WrwpSamplePrecision Wrwp_getSamplePrecision(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->precision;
+}
+
+int WrwpResult_getLevels(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->levels;
+}
+
+int WrwpResult_getInterval(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->interval;
+}
+
+int WrwpResult_hasField(WrwpResult_t* self, WrwpResultField field)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (field < 0 || field >= WrwpResultField_COUNT) {
+    return 0;
+  }
+  return self->wanted[field];
+}
+
+const double* WrwpResult_getData(WrwpResult_t* self, WrwpResultField field)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpResult_hasField(self, field)) {
+    return NULL;
+  }
+  return WrwpInternal_resultColumn(self, field);
+}
+
+const char* WrwpResult_getFieldName(WrwpResultField field)
+{
+  if (field < 0 || field >= WrwpResultField_COUNT) {
+    return NULL;
+  }
+  return WRWP_RESULT_FIELD_NAMES[field];
+}
+
+WrwpResultField WrwpResult_getFieldByName(const char* name, size_t len)
+{
+  int i = 0;
+  if (name == NULL) {
+    return WrwpResultField_COUNT;
+  }
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    if (strlen(WRWP_RESULT_FIELD_NAMES[i]) == len && strncmp(WRWP_RESULT_FIELD_NAMES[i], name, len) == 0) {
+      return (WrwpResultField)i;
+    }
+  }
+  return WrwpResultField_COUNT;
+}
+
+RaveDateTime_t* WrwpResult_getStartDateTime(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return RAVE_OBJECT_COPY(self->startDT);
+}
+
+RaveDateTime_t* WrwpResult_getEndDateTime(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return RAVE_OBJECT_COPY(self->endDT);
+}
+
+int WrwpResult_getEndTimeStamp(WrwpResult_t* self, long long* t)
+{
+  const char *date = NULL, *time = NULL;
+  int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((t != NULL), "t == NULL");
+  if (self->endDT == NULL) {
+    return 0;
+  }
+  date = RaveDateTime_getDate(self->endDT);
+  time = RaveDateTime_getTime(self->endDT);
+  if (date == NULL || time == NULL ||
+      sscanf(date, "%4d%2d%2d", &year, &month, &day) != 3 ||
+      sscanf(time, "%2d%2d%2d", &hour, &minute, &second) != 3) {
+    return 0;
+  }
+  *t = ((((year * 100LL + month) * 100LL + day) * 100LL + hour) * 100LL + minute) * 100LL + second;
+  return 1;
+}
+
+const char* WrwpResult_getAngles(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->angles;
+}
+
+const char* WrwpResult_getTasks(WrwpResult_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->tasks;
+}
+
+void Wrwp_lock(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  self->locked = 1;
+}
+
+int Wrwp_isLocked(Wrwp_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->locked;
+}
+
+VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  VerticalProfile_t* result = NULL;
+  WrwpContext_t* ctx = NULL;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+
+  ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+  if (ctx == NULL) {
+    RAVE_ERROR0("Failed to create wrwp context");
+    return NULL;
+  }
+  result = Wrwp_generateWithContext(self, ctx, inobj, wrwpMethod, fieldsToGenerate);
+  RAVE_OBJECT_RELEASE(ctx);
+  return result;
+}
+
+WrwpResult_t* Wrwp_generateResult(Wrwp_t* self, WrwpContext_t* ctx, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  WrwpResult_t* result = NULL;
+  RaveObjectList_t* inputs = WrwpInternal_createInputList(inobj);
+  if (inputs != NULL) {
+    result = Wrwp_generateResultFromScans(self, ctx, inputs, wrwpMethod, fieldsToGenerate);
+  }
+  RAVE_OBJECT_RELEASE(inputs);
+  return result;
+}
+
+/* Main code for vertical profile generation, the layers are derived into a result block */
+WrwpResult_t* Wrwp_generateResultFromScans(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  WrwpResult_t* result = NULL;
+  WrwpInternal_Metadata metadata;
+  int nv, nz, is;
+  double zsum;
+  int ysize = 0, yindex = 0;
+  int needWind = 0, needRefl = 0; /* if the wanted fields requires the wind fit and/or the reflectivity moments */
+  int isKnmi = 0;
+  int useFloat = 0; /* if samples should be gathered in single precision */
+  int complete = 0; /* if the result has been completely derived */
+  RaveList_t* wantedFields = NULL;
+
+  /* The sample buffers are owned by the context. In single precision mode, samples and design matrix are */
+  /* gathered into the float arrays. The KNMI method fits the samples themselves with LAPACK, so it always */
+  /* gathers into the double arrays. Accumulations are always done in double. For SMHI only the two first */
+  /* columns of the design matrix are stored, column by column (A and A+NOR), together with the */
+  /* observations in b (fv). */
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  RAVE_ASSERT((self->gain_VP != 0.0), "gain_VP == 0.0");
+
+  if (!WrwpInternal_validateInputs(inputs)) {
+    RAVE_ERROR0("Inputs must be a non empty list of polar volumes and/or polar scans");
+    return NULL;
+  }
+
+  if (!WrwpInternal_initMetadata(&metadata)) {
+    RAVE_ERROR0("Failed to allocate memory for the elevation angles");
+    return NULL;
+  }
+
+  wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+
+  /* Find out what is needed up front so that we only gather and calculate what actually is going to be used */
+  WrwpInternal_getRequiredMoments(wantedFields, &needWind, &needRefl);
+  isKnmi = (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0);
+  useFloat = (self->precision == WrwpSamplePrecision_FLOAT && !isKnmi);
+
+  /* Set the spacing */
+  ysize = self->hmax / self->dz;
+
+  result = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+  if (result == NULL || !WrwpInternal_initResult(result, ysize, self->dz, wantedFields)) {
+    RAVE_ERROR0("Failed to allocate memory for the result");
+    goto done;
+  }
+
+  if (!WrwpInternal_ensureSampleBuffers(ctx, needWind, needRefl, useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, WrwpInternal_isVvpWanted(wantedFields), self->dealias,
+                                         WrwpInternal_isQuantileWanted(wantedFields), WrwpInternal_isBioWanted(wantedFields))) {
+    RAVE_ERROR0("Failed to allocate memory for the samples");
+    goto done;
+  }
+
+  if (!WrwpInternal_collectScans(self, ctx, inputs, ysize, isKnmi, needWind, needRefl, &metadata)) {
+    goto done;
+  }
+
+  if (metadata.nscans == 0) { /* Emergency exit if no accepted scans were found */
+    RAVE_INFO0("Could not find any acceptable scans, dropping out...");
+    goto done;
+  }
+
+  // Loop over the atmospheric layers, the samples for a layer are gathered from the bins
+  // that have been sorted into the layer. Within each scan the rays are traversed in order
+  // and the bins in increasing order, i.e. the samples come in the same order as when
+  // looping over all bins.
+  for (yindex = 0; yindex < ysize; yindex++) {
+    WrwpInternal_LayerMoments m;
+    zsum = 0.0;
+    nv = 0;
+    nz = 0;
+
+    // Loop over the accepted scans
+    for (is = 0; is < ctx->nscans; is++) {
+      nv = WrwpInternal_gatherWind(self, ctx, &ctx->scans[is], yindex, isKnmi, useFloat, nv, NOR);
+      nz = WrwpInternal_gatherReflectivity(ctx, &ctx->scans[is], yindex, useFloat, nz, NOR, &zsum);
+    }
+
+    /* Perform radial wind calculations and reflectivity calculations */
+    WrwpInternal_fitLayer(self, ctx, isKnmi, needWind, useFloat, nv, nz, zsum, &m);
+    WrwpInternal_storeLayer(self, result, yindex, isKnmi, &m);
+  }
+
+  if (!WrwpInternal_moveMetadataToResult(&metadata, result)) {
+    RAVE_ERROR0("Failed to allocate memory for the tasks");
+    goto done;
+  }
+  complete = 1;
+
+done:
+  if (!complete) {
+    RAVE_OBJECT_RELEASE(result);
+  }
+  WrwpInternal_releaseScanInfos(ctx);
+  WrwpInternal_clearMetadata(&metadata);
+  RaveList_freeAndDestroy(&wantedFields);
+
+  return result;
+}
+
+VerticalProfile_t* Wrwp_createProfile(Wrwp_t* self, WrwpResult_t* result, PolarVolume_t* origin)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((result != NULL), "result == NULL");
+  RAVE_ASSERT((origin != NULL), "origin == NULL");
+  return WrwpInternal_createProfile(self, result, (RaveCoreObject*)origin);
+}
+
+VerticalProfile_t* Wrwp_generateWithContext(Wrwp_t* self, WrwpContext_t* ctx, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  VerticalProfile_t* result = NULL;
+  RaveObjectList_t* inputs = WrwpInternal_createInputList(inobj);
+  if (inputs != NULL) {
+    result = Wrwp_generateFromScans(self, ctx, inputs, wrwpMethod, fieldsToGenerate);
+  }
+  RAVE_OBJECT_RELEASE(inputs);
+  return result;
+}
+
+VerticalProfile_t* Wrwp_generateFromScans(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  VerticalProfile_t* result = NULL;
+  WrwpResult_t* block = NULL;
+  RaveCoreObject* first = NULL;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+
+  block = Wrwp_generateResultFromScans(self, ctx, inputs, wrwpMethod, fieldsToGenerate);
+  if (block != NULL) {
+    /* The location, source and nominal time are taken from the first input */
+    first = RaveObjectList_get(inputs, 0);
+    result = WrwpInternal_createProfile(self, block, first);
+  }
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(first);
+  return result;
+}
+
+RaveObjectList_t* Wrwp_generateResolutions(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod,
+                                           const char* fieldsToGenerate, int nresolutions, const int* dz, const int* hmax)
+{
+  RaveObjectList_t* result = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveCoreObject* first = NULL;
+  Wrwp_t* base = NULL;
+  Wrwp_t* generator = NULL;
+  WrwpResult_t* block = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpInternal_LayerSums* sums = NULL;
+  WrwpInternal_Metadata metadata;
+  RaveList_t* wantedFields = NULL;
+  int needWind = 0, needRefl = 0, useFloat = 0, isKnmi = 0, quantiles = 0;
+  int k = 0, i = 0, yindex = 0, g = 0, nbase = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  RAVE_ASSERT((self->gain_VP != 0.0), "gain_VP == 0.0");
+  memset(&metadata, 0, sizeof(metadata));
+
+  if (!WrwpInternal_validateInputs(inputs)) {
+    RAVE_ERROR0("Inputs must be a non empty list of polar volumes and/or polar scans");
+    return NULL;
+  }
+  if (self->dealias) {
+    RAVE_ERROR0("The radial winds can not be dealiased when generating several resolutions since the first guess needs the samples of each layer");
+    return NULL;
+  }
+  if (nresolutions <= 0 || dz == NULL || hmax == NULL) {
+    RAVE_ERROR0("At least one resolution must be given");
+    return NULL;
+  }
+  for (k = 0; k < nresolutions; k++) {
+    if (dz[k] <= 0 || hmax[k] < dz[k]) {
+      RAVE_ERROR0("The layer interval must be positive and not larger than the maximum height");
+      return NULL;
+    }
+    g = WrwpInternal_gcd(dz[k], g);
+  }
+
+  profiles = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (profiles == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the profiles");
+    goto done;
+  }
+
+  wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(wantedFields, &needWind, &needRefl);
+  isKnmi = (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0);
+  useFloat = (self->precision == WrwpSamplePrecision_FLOAT);
+  quantiles = WrwpInternal_isQuantileWanted(wantedFields);
+
+  if (isKnmi && needWind) {
+    /* The outlier removal of the KNMI method needs the samples of the actual layer, no aggregation possible */
+    for (k = 0; k < nresolutions; k++) {
+      generator = WrwpInternal_cloneWithLayers(self, dz[k], hmax[k]);
+      if (generator == NULL ||
+          (vp = Wrwp_generateFromScans(generator, ctx, inputs, wrwpMethod, fieldsToGenerate)) == NULL ||
+          !RaveObjectList_add(profiles, (RaveCoreObject*)vp)) {
+        goto done;
+      }
+      RAVE_OBJECT_RELEASE(vp);
+      RAVE_OBJECT_RELEASE(generator);
+    }
+    result = RAVE_OBJECT_COPY(profiles);
+    goto done;
+  }
+
+  /* The samples are gathered once into the thinnest layers that all resolutions can be built from */
+  for (k = 0; k < nresolutions; k++) {
+    int n = (hmax[k] / dz[k]) * (dz[k] / g);
+    if (n > nbase) {
+      nbase = n;
+    }
+  }
+  base = WrwpInternal_cloneWithLayers(self, g, nbase * g);
+  sums = WrwpInternal_createLayerSums(nbase, quantiles);
+  if (base == NULL || sums == NULL || !WrwpInternal_initMetadata(&metadata) ||
+      !WrwpInternal_ensureSampleBuffers(ctx, needWind, needRefl, useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, 0, 0, quantiles, 0)) {
+    RAVE_ERROR0("Failed to allocate memory for the layers");
+    goto done;
+  }
+  if (!WrwpInternal_collectScans(base, ctx, inputs, nbase, 0, needWind, needRefl, &metadata)) {
+    goto done;
+  }
+  if (metadata.nscans == 0) { /* Emergency exit if no accepted scans were found */
+    RAVE_INFO0("Could not find any acceptable scans, dropping out...");
+    goto done;
+  }
+  WrwpInternal_gatherLayerSums(base, ctx, nbase, useFloat, sums);
+  WrwpInternal_releaseScanInfos(ctx);
+
+  /* The sums of the thin layers are aggregated into each of the wanted resolutions */
+  first = RaveObjectList_get(inputs, 0);
+  for (k = 0; k < nresolutions; k++) {
+    int levels = hmax[k] / dz[k], ratio = dz[k] / g;
+    generator = WrwpInternal_cloneWithLayers(self, dz[k], hmax[k]);
+    block = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+    if (generator == NULL || block == NULL || !WrwpInternal_initResult(block, levels, dz[k], wantedFields)) {
+      RAVE_ERROR0("Failed to allocate memory for the result");
+      goto done;
+    }
+    for (yindex = 0; yindex < levels; yindex++) {
+      WrwpInternal_LayerSums total;
+      WrwpInternal_LayerMoments m;
+      WrwpQuantileSketch zsketch;
+      memset(&total, 0, sizeof(total));
+      if (quantiles) {
+        WrwpKernel_initSketch(&zsketch);
+        total.zsketch = &zsketch;
+      }
+      for (i = 0; i < ratio; i++) {
+        WrwpInternal_combineLayerSums(&total, &sums[yindex * ratio + i], 1);
+      }
+      WrwpInternal_momentsFromSums(&total, &m);
+      WrwpInternal_storeLayer(generator, block, yindex, isKnmi, &m);
+    }
+    if (!WrwpInternal_copyMetadataToResult(&metadata, block) ||
+        (vp = WrwpInternal_createProfile(generator, block, first)) == NULL ||
+        !RaveObjectList_add(profiles, (RaveCoreObject*)vp)) {
+      RAVE_ERROR0("Failed to create the profile");
+      goto done;
+    }
+    RAVE_OBJECT_RELEASE(vp);
+    RAVE_OBJECT_RELEASE(block);
+    RAVE_OBJECT_RELEASE(generator);
+  }
+  result = RAVE_OBJECT_COPY(profiles);
+
+done:
+  WrwpInternal_releaseScanInfos(ctx);
+  WrwpInternal_clearMetadata(&metadata);
+  RaveList_freeAndDestroy(&wantedFields);
+  RAVE_FREE(sums);
+  RAVE_OBJECT_RELEASE(first);
+  RAVE_OBJECT_RELEASE(base);
+  RAVE_OBJECT_RELEASE(generator);
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(vp);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+RaveObjectList_t* Wrwp_generateConfigurations(WrwpContext_t* ctx, RaveObjectList_t* inputs, RaveObjectList_t* generators,
+                                              const char** methods, const char* fieldsToGenerate)
+{
+  RaveObjectList_t* result = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveCoreObject* first = NULL;
+  PolarNavigator_t* polnav = NULL;
+  Wrwp_t* generator = NULL;
+  WrwpResult_t* block = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpInternal_Sweep sweep;
+  WrwpInternal_Metadata metadata;
+  RaveList_t* wantedFields = NULL;
+  int *windLayer = NULL, *windOrder = NULL, *windStart = NULL;
+  int *reflLayer = NULL, *reflOrder = NULL, *reflStart = NULL;
+  long ib = 0;
+  int nconfigs = 0, maxLayers = 0, k = 0, is = 0, needWind = 0, needRefl = 0;
+  double emin = 0.0, emax = 0.0, dmin = 0.0, dmax = 0.0, hmax = 0.0;
+  double lat0 = 0.0, lon0 = 0.0, alt0 = 0.0;
+
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  memset(&sweep, 0, sizeof(sweep));
+  memset(&metadata, 0, sizeof(metadata));
+
+  if (!WrwpInternal_validateInputs(inputs)) {
+    RAVE_ERROR0("Inputs must be a non empty list of polar volumes and/or polar scans");
+    return NULL;
+  }
+  nconfigs = (generators != NULL) ? RaveObjectList_size(generators) : 0;
+  if (nconfigs == 0) {
+    RAVE_ERROR0("At least one configuration must be given");
+    return NULL;
+  }
+
+  /* The union of the elevation, distance and height windows of all configurations */
+  for (k = 0; k < nconfigs; k++) {
+    generator = (Wrwp_t*)RaveObjectList_get(generators, k);
+    if (!RAVE_OBJECT_CHECK_TYPE(generator, &Wrwp_TYPE) || generator->gain_VP == 0.0 || generator->dz <= 0) {
+      RAVE_ERROR0("Configurations must be wrwp generators with gain_VP != 0 and dz > 0");
+      goto done;
+    }
+    if (k == 0 || generator->emin < emin) emin = generator->emin;
+    if (k == 0 || generator->emax > emax) emax = generator->emax;
+    if (k == 0 || generator->dmin < dmin) dmin = generator->dmin;
+    if (k == 0 || generator->dmax > dmax) dmax = generator->dmax;
+    if ((generator->hmax / generator->dz) * generator->dz > hmax) {
+      hmax = (generator->hmax / generator->dz) * generator->dz;
+    }
+    if (generator->hmax / generator->dz > maxLayers) {
+      maxLayers = generator->hmax / generator->dz;
+    }
+    RAVE_OBJECT_RELEASE(generator);
+  }
+
+  wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(wantedFields, &needWind, &needRefl);
+
+  polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  profiles = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (polnav == NULL || profiles == NULL) {
+    RAVE_ERROR0("Failed to allocate memory");
+    goto done;
+  }
+  first = RaveObjectList_get(inputs, 0);
+  WrwpInternal_getInputLocation(first, &lat0, &lon0, &alt0);
+  PolarNavigator_setLat0(polnav, lat0);
+  PolarNavigator_setLon0(polnav, lon0);
+  PolarNavigator_setAlt0(polnav, alt0);
+
+  // Decode the scans once, the configurations then only have to select among the samples
+  if (!WrwpInternal_decodeSweep(&sweep, inputs, polnav, emin, emax, dmin, dmax, hmax, needWind, needRefl)) {
+    goto done;
+  }
+
+  windLayer = RAVE_MALLOC(sizeof(int) * (sweep.wind.n + 1));
+  windOrder = RAVE_MALLOC(sizeof(int) * (sweep.wind.n + 1));
+  windStart = RAVE_MALLOC(sizeof(int) * (maxLayers + 1));
+  reflLayer = RAVE_MALLOC(sizeof(int) * (sweep.refl.n + 1));
+  reflOrder = RAVE_MALLOC(sizeof(int) * (sweep.refl.n + 1));
+  reflStart = RAVE_MALLOC(sizeof(int) * (maxLayers + 1));
+  if (windLayer == NULL || windOrder == NULL || windStart == NULL || reflLayer == NULL || reflOrder == NULL || reflStart == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the layers");
+    goto done;
+  }
+
+  // Evaluate each configuration on the decoded samples, the samples of a layer are selected in the
+  // same order as when gathered from the scans so the result is identical to a separate generation
+  for (k = 0; k < nconfigs; k++) {
+    int isKnmi = (methods != NULL && methods[k] != NULL && strcmp(methods[k], "KNMI") == 0);
+    int useFloat = 0, nlayers = 0;
+
+    generator = (Wrwp_t*)RaveObjectList_get(generators, k);
+    useFloat = (generator->precision == WrwpSamplePrecision_FLOAT && !isKnmi);
+    nlayers = generator->hmax / generator->dz;
+
+    if (!WrwpInternal_ensureSampleBuffers(ctx, needWind, needRefl, useFloat) ||
+        !WrwpInternal_ensureStageBuffers(ctx, WrwpInternal_isVvpWanted(wantedFields), generator->dealias,
+                                           WrwpInternal_isQuantileWanted(wantedFields), 0) ||
+        !WrwpInternal_initMetadata(&metadata)) {
+      RAVE_ERROR0("Failed to allocate memory for the samples");
+      goto done;
+    }
+    for (is = 0; is < sweep.nscans; is++) {
+      WrwpInternal_SweepScan* sscan = &sweep.scans[is];
+      char* taskString = NULL;
+      int accepted = WrwpInternal_isScanAccepted(generator, sscan->scan, &taskString);
+      for (ib = 0; ib < sscan->nbins; ib++) {
+        int l = -1;
+        if (accepted && sscan->d[ib] >= generator->dmin && sscan->d[ib] <= generator->dmax && sscan->h[ib] >= 0.0) {
+          l = WrwpInternal_layerIndex(sscan->h[ib], generator->dz);
+        }
+        sscan->binLayer[ib] = (l >= 0 && l < nlayers) ? l : -1;
+      }
+      if (accepted && !WrwpInternal_addScanMetadata(&metadata, sscan->scan, taskString)) {
+        RAVE_ERROR0("Failed to allocate memory for the metadata");
+        goto done;
+      }
+    }
+    if (metadata.nscans == 0) {
+      RAVE_ERROR1("Configuration %d does not accept any of the scans", k);
+      goto done;
+    }
+
+    WrwpInternal_sortSweepSamples(generator, sweep.scans, &sweep.wind, 1, isKnmi, nlayers, 0, windLayer, windStart, windOrder);
+    WrwpInternal_sortSweepSamples(generator, sweep.scans, &sweep.refl, 0, isKnmi, nlayers, 0, reflLayer, reflStart, reflOrder);
+
+    block = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+    if (block == NULL || !WrwpInternal_initResult(block, nlayers, generator->dz, wantedFields)) {
+      RAVE_ERROR0("Failed to allocate memory for the result");
+      goto done;
+    }
+    WrwpInternal_fitSweepLayers(generator, ctx, &sweep, isKnmi, needWind, useFloat, windStart, windOrder, reflStart, reflOrder, 0, block);
+
+    if (!WrwpInternal_moveMetadataToResult(&metadata, block) ||
+        (vp = WrwpInternal_createProfile(generator, block, first)) == NULL ||
+        !RaveObjectList_add(profiles, (RaveCoreObject*)vp)) {
+      RAVE_ERROR0("Failed to create the profile");
+      goto done;
+    }
+    RAVE_OBJECT_RELEASE(vp);
+    RAVE_OBJECT_RELEASE(block);
+    RAVE_OBJECT_RELEASE(generator);
+  }
+  result = RAVE_OBJECT_COPY(profiles);
+
+done:
+  WrwpInternal_clearSweep(&sweep);
+  RAVE_FREE(windLayer);
+  RAVE_FREE(windOrder);
+  RAVE_FREE(windStart);
+  RAVE_FREE(reflLayer);
+  RAVE_FREE(reflOrder);
+  RAVE_FREE(reflStart);
+  WrwpInternal_clearMetadata(&metadata);
+  RaveList_freeAndDestroy(&wantedFields);
+  RAVE_OBJECT_RELEASE(first);
+  RAVE_OBJECT_RELEASE(polnav);
+  RAVE_OBJECT_RELEASE(generator);
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(vp);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+RaveObjectList_t* Wrwp_generateSectors(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod,
+                                       const char* fieldsToGenerate, int nsectors, int nrings, const int* ranges)
+{
+  RaveObjectList_t* result = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveCoreObject* first = NULL;
+  PolarNavigator_t* polnav = NULL;
+  WrwpResult_t* block = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpInternal_Sweep sweep;
+  WrwpInternal_Metadata metadata;
+  RaveList_t* wantedFields = NULL;
+  double* edges = NULL;
+  int *windLayer = NULL, *windOrder = NULL, *windStart = NULL;
+  int *reflLayer = NULL, *reflOrder = NULL, *reflStart = NULL;
+  long ib = 0, ir = 0;
+  int needWind = 0, needRefl = 0, useFloat = 0, isKnmi = 0;
+  int nlayers = 0, nbuckets = 0, is = 0, r = 0, sector = 0;
+  double lat0 = 0.0, lon0 = 0.0, alt0 = 0.0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  RAVE_ASSERT((self->gain_VP != 0.0), "gain_VP == 0.0");
+  memset(&sweep, 0, sizeof(sweep));
+  memset(&metadata, 0, sizeof(metadata));
+
+  if (!WrwpInternal_validateInputs(inputs)) {
+    RAVE_ERROR0("Inputs must be a non empty list of polar volumes and/or polar scans");
+    return NULL;
+  }
+  if (nsectors <= 0 || nrings <= 0 || self->dz <= 0) {
+    RAVE_ERROR0("At least one sector and one range ring must be given");
+    return NULL;
+  }
+  isKnmi = (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0);
+  if (isKnmi && nsectors > 1) {
+    RAVE_ERROR0("The azimuth gap check of the KNMI method rejects all sectors, use one sector or the SMHI method");
+    return NULL;
+  }
+
+  /* The range rings, either the given limits or dmin - dmax split in rings of equal width */
+  edges = RAVE_MALLOC(sizeof(double) * (nrings + 1));
+  if (edges == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the range rings");
+    return NULL;
+  }
+  for (r = 0; r <= nrings; r++) {
+    edges[r] = (ranges != NULL) ? (double)ranges[r] : self->dmin + (double)(self->dmax - self->dmin) * r / nrings;
+    if (r > 0 && edges[r] <= edges[r - 1]) {
+      RAVE_ERROR0("The limits of the range rings must be increasing");
+      goto done;
+    }
+  }
+
+  nlayers = self->hmax / self->dz;
+  nbuckets = nsectors * nrings * nlayers;
+  useFloat = (self->precision == WrwpSamplePrecision_FLOAT && !isKnmi);
+  wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(wantedFields, &needWind, &needRefl);
+
+  polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  profiles = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (polnav == NULL || profiles == NULL) {
+    RAVE_ERROR0("Failed to allocate memory");
+    goto done;
+  }
+  first = RaveObjectList_get(inputs, 0);
+  WrwpInternal_getInputLocation(first, &lat0, &lon0, &alt0);
+  PolarNavigator_setLat0(polnav, lat0);
+  PolarNavigator_setLon0(polnav, lon0);
+  PolarNavigator_setAlt0(polnav, alt0);
+
+  if (!WrwpInternal_decodeSweep(&sweep, inputs, polnav, self->emin, self->emax, edges[0], edges[nrings],
+                                (double)nlayers * self->dz, needWind, needRefl) ||
+      !WrwpInternal_ensureSampleBuffers(ctx, needWind, needRefl, useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, WrwpInternal_isVvpWanted(wantedFields), self->dealias,
+                                         WrwpInternal_isQuantileWanted(wantedFields), 0) ||
+      !WrwpInternal_initMetadata(&metadata)) {
+    RAVE_ERROR0("Failed to decode the scans");
+    goto done;
+  }
+
+  // Each bin gets its ring and layer and each ray its sector so that a sample is routed to its
+  // (sector, ring, layer) bucket by the same counting sort as for a single profile
+  for (is = 0; is < sweep.nscans; is++) {
+    WrwpInternal_SweepScan* sscan = &sweep.scans[is];
+    char* taskString = NULL;
+    int accepted = WrwpInternal_isScanAccepted(self, sscan->scan, &taskString);
+
+    sscan->raySector = RAVE_MALLOC(sizeof(int) * (sscan->nrays > 0 ? sscan->nrays : 1));
+    if (sscan->raySector == NULL) {
+      RAVE_ERROR0("Failed to allocate memory for the sectors");
+      goto done;
+    }
+    for (ir = 0; ir < sscan->nrays; ir++) {
+      sector = (int)(360./sscan->nrays*ir * nsectors / 360.0);
+      sscan->raySector[ir] = (sector < nsectors) ? sector : nsectors - 1;
+    }
+    for (ib = 0; ib < sscan->nbins; ib++) {
+      int l = -1;
+      if (accepted && sscan->d[ib] >= edges[0] && sscan->d[ib] <= edges[nrings] && sscan->h[ib] >= 0.0) {
+        l = WrwpInternal_layerIndex(sscan->h[ib], self->dz);
+      }
+      if (l >= 0 && l < nlayers) {
+        for (r = 0; r < nrings - 1 && sscan->d[ib] >= edges[r + 1]; r++);
+        sscan->binLayer[ib] = r * nlayers + l;
+      } else {
+        sscan->binLayer[ib] = -1;
+      }
+    }
+    if (accepted && !WrwpInternal_addScanMetadata(&metadata, sscan->scan, taskString)) {
+      RAVE_ERROR0("Failed to allocate memory for the metadata");
+      goto done;
+    }
+  }
+  if (metadata.nscans == 0) {
+    RAVE_INFO0("No scan could be used for the profiles");
+    goto done;
+  }
+
+  windLayer = RAVE_MALLOC(sizeof(int) * (sweep.wind.n + 1));
+  windOrder = RAVE_MALLOC(sizeof(int) * (sweep.wind.n + 1));
+  windStart = RAVE_MALLOC(sizeof(int) * (nbuckets + 1));
+  reflLayer = RAVE_MALLOC(sizeof(int) * (sweep.refl.n + 1));
+  reflOrder = RAVE_MALLOC(sizeof(int) * (sweep.refl.n + 1));
+  reflStart = RAVE_MALLOC(sizeof(int) * (nbuckets + 1));
+  if (windLayer == NULL || windOrder == NULL || windStart == NULL || reflLayer == NULL || reflOrder == NULL || reflStart == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the layers");
+    goto done;
+  }
+  WrwpInternal_sortSweepSamples(self, sweep.scans, &sweep.wind, 1, isKnmi, nbuckets, nrings * nlayers, windLayer, windStart, windOrder);
+  WrwpInternal_sortSweepSamples(self, sweep.scans, &sweep.refl, 0, isKnmi, nbuckets, nrings * nlayers, reflLayer, reflStart, reflOrder);
+
+  for (sector = 0; sector < nsectors; sector++) {
+    for (r = 0; r < nrings; r++) {
+      block = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+      if (block == NULL || !WrwpInternal_initResult(block, nlayers, self->dz, wantedFields) ||
+          !WrwpInternal_copyMetadataToResult(&metadata, block)) {
+        RAVE_ERROR0("Failed to allocate memory for the result");
+        goto done;
+      }
+      WrwpInternal_fitSweepLayers(self, ctx, &sweep, isKnmi, needWind, useFloat, windStart, windOrder, reflStart, reflOrder,
+                                  (sector * nrings + r) * nlayers, block);
+
+      vp = WrwpInternal_createProfile(self, block, first);
+      if (vp == NULL ||
+          !WrwpInternal_addDoubleAttribute(vp, "how/minrange", edges[r] / 1000.0) || /* km */
+          !WrwpInternal_addDoubleAttribute(vp, "how/maxrange", edges[r + 1] / 1000.0) || /* km */
+          !WrwpInternal_addDoubleAttribute(vp, "how/startaz", 360.0 * sector / nsectors) ||
+          !WrwpInternal_addDoubleAttribute(vp, "how/stopaz", 360.0 * (sector + 1) / nsectors) ||
+          !RaveObjectList_add(profiles, (RaveCoreObject*)vp)) {
+        RAVE_ERROR0("Failed to create the profile");
+        goto done;
+      }
+      RAVE_OBJECT_RELEASE(vp);
+      RAVE_OBJECT_RELEASE(block);
+    }
+  }
+  result = RAVE_OBJECT_COPY(profiles);
+
+done:
+  WrwpInternal_clearSweep(&sweep);
+  RAVE_FREE(edges);
+  RAVE_FREE(windLayer);
+  RAVE_FREE(windOrder);
+  RAVE_FREE(windStart);
+  RAVE_FREE(reflLayer);
+  RAVE_FREE(reflOrder);
+  RAVE_FREE(reflStart);
+  WrwpInternal_clearMetadata(&metadata);
+  RaveList_freeAndDestroy(&wantedFields);
+  RAVE_OBJECT_RELEASE(first);
+  RAVE_OBJECT_RELEASE(polnav);
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(vp);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+int Wrwp_begin(Wrwp_t* self, WrwpContext_t* ctx, const char* wrwpMethod, const char* fieldsToGenerate)
+{
+  WrwpInternal_Stream* stream = NULL;
+  int i = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  RAVE_ASSERT((self->gain_VP != 0.0), "gain_VP == 0.0");
+
+  WrwpInternal_resetStream(ctx);
+  stream = &ctx->stream;
+
+  if (self->dealias) {
+    RAVE_ERROR0("The radial winds can not be dealiased in a stream since the first guess needs all samples of each layer");
+    return 0;
+  }
+  stream->wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(stream->wantedFields, &stream->needWind, &stream->needRefl);
+  stream->quantiles = WrwpInternal_isQuantileWanted(stream->wantedFields);
+  stream->isKnmi = (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0);
+  stream->useFloat = (self->precision == WrwpSamplePrecision_FLOAT && !stream->isKnmi);
+  stream->nlayers = self->hmax / self->dz;
+  stream->dz = self->dz;
+
+  if (stream->nlayers > stream->layersCapacity) {
+    WrwpInternal_StreamLayer* layers = RAVE_REALLOC(stream->layers, sizeof(WrwpInternal_StreamLayer) * stream->nlayers);
+    if (layers == NULL) {
+      goto fail;
+    }
+    memset(layers + stream->layersCapacity, 0, sizeof(WrwpInternal_StreamLayer) * (stream->nlayers - stream->layersCapacity));
+    stream->layers = layers;
+    stream->layersCapacity = stream->nlayers;
+  }
+  for (i = 0; i < stream->nlayers; i++) {
+    WrwpInternal_StreamLayer* layer = &stream->layers[i];
+    WrwpKernel_initNormalLanes(&layer->wind);
+    layer->nv = 0;
+    layer->nz = 0;
+    layer->zsum = 0.0;
+    layer->zmean = 0.0;
+    layer->zm2 = 0.0;
+    WrwpKernel_initSketch(&layer->zsketch);
+  }
+
+  stream->polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  if (stream->polnav == NULL ||
+      !WrwpInternal_initMetadata(&stream->metadata) ||
+      !WrwpInternal_ensureSampleBuffers(ctx, stream->needWind, stream->needRefl, stream->useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, 0, 0, stream->quantiles, 0)) {
+    goto fail;
+  }
+  stream->active = 1;
+  return 1;
+fail:
+  RAVE_ERROR0("Failed to allocate memory for the stream");
+  WrwpInternal_resetStream(ctx);
+  return 0;
+}
+
+int Wrwp_addScan(Wrwp_t* self, WrwpContext_t* ctx, PolarScan_t* scan)
+{
+  WrwpInternal_Stream* stream = NULL;
+  WrwpInternal_ScanInfo* info = NULL;
+  char* taskString = NULL;
+  int yindex = 0, n = 0, result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  stream = &ctx->stream;
+
+  if (!stream->active) {
+    RAVE_ERROR0("Wrwp_begin must be called before adding scans");
+    return 0;
+  }
+  if (scan == NULL) {
+    RAVE_ERROR0("No scan to add");
+    return 0;
+  }
+  if (!WrwpInternal_isScanAccepted(self, scan, &taskString)) {
+    return 1;
+  }
+
+  if (stream->metadata.nscans == 0) {
+    /* The first accepted scan defines the location. The navigator is set again by the next scan */
+    /* if this one fails. */
+    PolarNavigator_setLat0(stream->polnav, PolarScan_getLatitude(scan));
+    PolarNavigator_setLon0(stream->polnav, PolarScan_getLongitude(scan));
+    PolarNavigator_setAlt0(stream->polnav, PolarScan_getHeight(scan));
+  }
+
+  /* Everything that may fail is done before the stream is modified, a failed scan leaves the */
+  /* stream as it was */
+  info = WrwpInternal_addScanInfo(self, ctx, scan, NULL, stream->polnav, stream->nlayers,
+                                  stream->isKnmi, stream->needWind, stream->needRefl);
+  if (info == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the scan information");
+    goto done;
+  }
+  if (!WrwpInternal_reserveStreamLayers(stream, info)) {
+    RAVE_ERROR0("Failed to allocate memory for the wind samples");
+    goto done;
+  }
+  if (!WrwpInternal_addScanMetadata(&stream->metadata, scan, taskString)) {
+    RAVE_ERROR0("Failed to allocate memory for the scan metadata");
+    goto done;
+  }
+  if (stream->metadata.nscans == 1) {
+    /* The first accepted scan defines the source and nominal time */
+    stream->first = RAVE_OBJECT_COPY(scan);
+  }
+
+  /* Fold the samples of the scan into the partial state of each layer */
+  for (yindex = 0; yindex < stream->nlayers; yindex++) {
+    WrwpInternal_StreamLayer* layer = &stream->layers[yindex];
+
+    n = WrwpInternal_gatherWind(self, ctx, info, yindex, stream->isKnmi, stream->useFloat, 0, NOR - layer->nv);
+    if (n > 0 && stream->isKnmi) {
+      memcpy(layer->A + layer->nv * NOC, ctx->A, sizeof(double) * n * NOC);
+      memcpy(layer->v + layer->nv, ctx->v, sizeof(double) * n);
+      memcpy(layer->sector + layer->nv, ctx->sector, sizeof(int) * n);
+    } else if (n > 0) {
+      if (stream->useFloat) {
+        WrwpKernel_addToNormalLanesFloat(&layer->wind, n, ctx->fA, ctx->fA+NOR, NULL, ctx->fv);
+      } else {
+        WrwpKernel_addToNormalLanes(&layer->wind, n, ctx->A, ctx->A+NOR, NULL, ctx->b);
+      }
+    }
+    layer->nv += n;
+
+    /* The sum is continued over the scans so it gets the same value as in the complete volume, the */
+    /* squared deviations of the scan are combined with the previous ones using the scan mean */
+    n = WrwpInternal_gatherReflectivity(ctx, info, yindex, stream->useFloat, 0, NOR - layer->nz, &layer->zsum);
+    if (n > 0) {
+      double ssum = 0.0, smean = 0.0, delta = 0.0;
+      int i = 0, ntot = layer->nz + n;
+      for (i = 0; i < n; i++) {
+        ssum += stream->useFloat ? (double)ctx->fz[i] : ctx->z[i];
+      }
+      smean = ssum / n;
+      delta = smean - layer->zmean;
+      layer->zm2 += WrwpInternal_reflectivitySquaredDeviation(ctx, n, stream->useFloat, smean) +
+                    delta * delta * ((double)layer->nz * n / ntot);
+      layer->zmean += delta * n / ntot;
+      layer->nz = ntot;
+      if (stream->quantiles) {
+        WrwpInternal_addToSketch(ctx, n, stream->useFloat, &layer->zsketch);
+      }
+    }
+  }
+  result = 1;
+done:
+  WrwpInternal_releaseScanInfos(ctx);
+  return result;
+}
+
+WrwpResult_t* Wrwp_finalizeResult(Wrwp_t* self, WrwpContext_t* ctx)
+{
+  WrwpInternal_Stream* stream = NULL;
+  WrwpResult_t* result = NULL;
+  int yindex = 0, complete = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+  stream = &ctx->stream;
+
+  if (!stream->active) {
+    RAVE_ERROR0("Wrwp_begin must be called before finalizing");
+    return NULL;
+  }
+  if (stream->metadata.nscans == 0) { /* Emergency exit if no accepted scans were found */
+    RAVE_INFO0("Could not find any acceptable scans, dropping out...");
+    goto done;
+  }
+
+  result = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+  if (result == NULL || !WrwpInternal_initResult(result, stream->nlayers, stream->dz, stream->wantedFields)) {
+    RAVE_ERROR0("Failed to allocate memory for the result");
+    goto done;
+  }
+
+  for (yindex = 0; yindex < stream->nlayers; yindex++) {
+    WrwpInternal_StreamLayer* layer = &stream->layers[yindex];
+    WrwpInternal_LayerMoments m;
+    memset(&m, 0, sizeof(m));
+
+    m.nv = layer->nv;
+    if (stream->needWind && stream->isKnmi) {
+      memcpy(ctx->A, layer->A, sizeof(double) * layer->nv * NOC);
+      memcpy(ctx->v, layer->v, sizeof(double) * layer->nv);
+      memcpy(ctx->b, layer->v, sizeof(double) * layer->nv);
+      memcpy(ctx->sector, layer->sector, sizeof(int) * layer->nv);
+      m.nv = WrwpInternal_fitKnmi(self, ctx, layer->nv, m.x, &m.chisq);
+    } else if (layer->nv > 3) {
+      WrwpNormalEquations ne;
+      memset(&ne, 0, sizeof(ne));
+      WrwpKernel_reduceNormalLanes(&layer->wind, &ne);
+      if (!WrwpKernel_solveNormalEquations(&ne, m.x, &m.chisq)) {
+        m.nv = 0;
+      }
+    }
+    m.nz = layer->nz;
+    m.zsum = layer->zsum;
+    m.zsqdev = layer->zm2;
+    m.zsketch = layer->zsketch;
+    WrwpInternal_storeLayer(self, result, yindex, stream->isKnmi, &m);
+  }
+
+  if (!WrwpInternal_moveMetadataToResult(&stream->metadata, result)) {
+    RAVE_ERROR0("Failed to allocate memory for the tasks");
+    goto done;
+  }
+  complete = 1;
+done:
+  if (!complete) {
+    RAVE_OBJECT_RELEASE(result);
+  }
+  WrwpInternal_resetStream(ctx);
+  return result;
+}
+
+VerticalProfile_t* Wrwp_finalize(Wrwp_t* self, WrwpContext_t* ctx)
+{
+  VerticalProfile_t* result = NULL;
+  WrwpResult_t* block = NULL;
+  PolarScan_t* first = NULL;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+
+  first = RAVE_OBJECT_COPY(ctx->stream.first);
+  block = Wrwp_finalizeResult(self, ctx);
+  if (block != NULL) {
+    result = WrwpInternal_createProfile(self, block, (RaveCoreObject*)first);
+  }
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(first);
+  return result;
+}
+
+int WrwpWindow_init(WrwpWindow_t* self, Wrwp_t* wrwp, const char* wrwpMethod, const char* fieldsToGenerate, int length)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((wrwp != NULL), "wrwp == NULL");
+  RAVE_ASSERT((wrwp->gain_VP != 0.0), "gain_VP == 0.0");
+
+  if (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0) {
+    RAVE_ERROR0("The KNMI method can not be used in a rolling window since the outlier removal needs all samples");
+    return 0;
+  }
+  if (wrwp->dealias) {
+    RAVE_ERROR0("The radial winds can not be dealiased in a rolling window since the first guess needs all samples");
+    return 0;
+  }
+  if (length < 0) {
+    RAVE_ERROR0("The length of the window must not be negative");
+    return 0;
+  }
+
+  WrwpInternal_clearWindow(self);
+  RAVE_FREE(self->total);
+  RaveList_freeAndDestroy(&self->wantedFields);
+  RAVE_OBJECT_RELEASE(self->wrwp);
+
+  /* A locked copy so that the caller still may reconfigure its generator */
+  self->wrwp = RAVE_OBJECT_CLONE(wrwp);
+  if (self->wrwp == NULL) {
+    RAVE_ERROR0("Failed to copy the generator");
+    return 0;
+  }
+  Wrwp_lock(self->wrwp);
+  self->length = length;
+  self->wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(self->wantedFields, &self->needWind, &self->needRefl);
+  self->quantiles = WrwpInternal_isQuantileWanted(self->wantedFields);
+  self->useFloat = (wrwp->precision == WrwpSamplePrecision_FLOAT);
+  self->nlayers = wrwp->hmax / wrwp->dz;
+  self->total = WrwpInternal_createLayerSums(self->nlayers, self->quantiles);
+  if (self->total == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the window");
+    RAVE_OBJECT_RELEASE(self->wrwp);
+    return 0;
+  }
+  return 1;
+}
+
+int WrwpWindow_addScan(WrwpWindow_t* self, WrwpContext_t* ctx, PolarScan_t* scan)
+{
+  WrwpInternal_WindowScan* wscan = NULL;
+  char* taskString = NULL;
+  long endTime = 0;
+  int yindex = 0, result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+
+  if (self->wrwp == NULL) {
+    RAVE_ERROR0("WrwpWindow_init must be called before adding scans");
+    return 0;
+  }
+  if (scan == NULL) {
+    RAVE_ERROR0("No scan to add");
+    return 0;
+  }
+  if (!WrwpInternal_isScanAccepted(self->wrwp, scan, &taskString)) {
+    return 1;
+  }
+  if (!WrwpInternal_ensureWindowCapacity(self)) {
+    RAVE_ERROR0("Failed to allocate memory for the window");
+    return 0;
+  }
+
+  wscan = &self->scans[(self->head + self->nscans) % self->scansCapacity];
+  memset(wscan, 0, sizeof(WrwpInternal_WindowScan));
+  wscan->elangle = PolarScan_getElangle(scan);
+  wscan->startDT = WrwpInternal_getStartDateTimeFromScan(scan);
+  wscan->endDT = WrwpInternal_getEndDateTimeFromScan(scan);
+  if (!WrwpInternal_getSeconds(wscan->endDT, &endTime)) {
+    RAVE_ERROR0("The scan must have a valid end date/time");
+    goto done;
+  }
+  if (self->nscans > 0 && endTime < self->scans[(self->head + self->nscans - 1) % self->scansCapacity].endTime) {
+    RAVE_ERROR0("The scans must be added in time order");
+    goto done;
+  }
+  wscan->endTime = endTime;
+  if (taskString != NULL && (wscan->task = RAVE_STRDUP(taskString)) == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the task");
+    goto done;
+  }
+  wscan->layers = WrwpInternal_createLayerSums(self->nlayers, self->quantiles);
+  if (wscan->layers == NULL || !WrwpInternal_gatherWindowLayers(self, ctx, scan, wscan->layers)) {
+    RAVE_ERROR0("Failed to allocate memory for the scan");
+    goto done;
+  }
+
+  for (yindex = 0; yindex < self->nlayers; yindex++) {
+    WrwpInternal_combineLayerSums(&self->total[yindex], &wscan->layers[yindex], 1);
+  }
+  self->nscans++;
+  RAVE_OBJECT_RELEASE(self->latest);
+  self->latest = RAVE_OBJECT_COPY(scan);
+
+  /* Retire the scans that ended more than length seconds before this one */
+  while (self->nscans > 1 && endTime - self->scans[self->head].endTime >= self->length) {
+    WrwpInternal_retireWindowScan(self);
+  }
+  wscan = NULL;
+  result = 1;
+done:
+  if (wscan != NULL) {
+    WrwpInternal_clearWindowScan(wscan);
+  }
+  return result;
+}
+
+int WrwpWindow_getNumberOfScans(WrwpWindow_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nscans;
+}
+
+WrwpResult_t* WrwpWindow_getResult(WrwpWindow_t* self)
+{
+  WrwpResult_t* result = NULL;
+  WrwpInternal_Metadata metadata;
+  int i = 0, yindex = 0, complete = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  memset(&metadata, 0, sizeof(metadata));
+
+  if (self->nscans == 0) {
+    RAVE_INFO0("No scans in the window, dropping out...");
+    return NULL;
+  }
+
+  result = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+  if (result == NULL || !WrwpInternal_initResult(result, self->nlayers, self->wrwp->dz, self->wantedFields) ||
+      !WrwpInternal_initMetadata(&metadata)) {
+    RAVE_ERROR0("Failed to allocate memory for the result");
+    goto done;
+  }
+
+  for (i = 0; i < self->nscans; i++) {
+    WrwpInternal_WindowScan* wscan = &self->scans[(self->head + i) % self->scansCapacity];
+    if (!WrwpInternal_addMetadata(&metadata, wscan->elangle, wscan->task, wscan->startDT, wscan->endDT)) {
+      RAVE_ERROR0("Failed to allocate memory for the tasks");
+      goto done;
+    }
+  }
+
+  for (yindex = 0; yindex < self->nlayers; yindex++) {
+    WrwpInternal_LayerMoments m;
+    WrwpInternal_momentsFromSums(&self->total[yindex], &m);
+    WrwpInternal_storeLayer(self->wrwp, result, yindex, 0, &m);
+  }
+
+  if (!WrwpInternal_moveMetadataToResult(&metadata, result)) {
+    RAVE_ERROR0("Failed to allocate memory for the tasks");
+    goto done;
+  }
+  complete = 1;
+done:
+  if (!complete) {
+    RAVE_OBJECT_RELEASE(result);
+  }
+  WrwpInternal_clearMetadata(&metadata);
+  return result;
+}
+
+VerticalProfile_t* WrwpWindow_getProfile(WrwpWindow_t* self)
+{
+  VerticalProfile_t* result = NULL;
+  WrwpResult_t* block = NULL;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+
+  block = WrwpWindow_getResult(self);
+  if (block != NULL) {
+    result = WrwpInternal_createProfile(self->wrwp, block, (RaveCoreObject*)self->latest);
+  }
+  RAVE_OBJECT_RELEASE(block);
+  return result;
+}
+
+int WrwpComposite_init(WrwpComposite_t* self, Wrwp_t* wrwp, const char* wrwpMethod, const char* fieldsToGenerate, double lat, double lon)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((wrwp != NULL), "wrwp == NULL");
+  RAVE_ASSERT((wrwp->gain_VP != 0.0), "gain_VP == 0.0");
+
+  if (wrwpMethod != NULL && strcmp(wrwpMethod, "KNMI") == 0) {
+    RAVE_ERROR0("The KNMI method can not be used in a composite since the outlier removal needs all samples");
+    return 0;
+  }
+  if (wrwp->dealias) {
+    RAVE_ERROR0("The radial winds can not be dealiased in a composite since the first guess needs all samples");
+    return 0;
+  }
+
+  WrwpInternal_clearComposite(self);
+  RAVE_FREE(self->total);
+  RaveList_freeAndDestroy(&self->wantedFields);
+  RAVE_OBJECT_RELEASE(self->wrwp);
+
+  /* A locked copy so that the caller still may reconfigure its generator */
+  self->wrwp = RAVE_OBJECT_CLONE(wrwp);
+  if (self->wrwp == NULL) {
+    RAVE_ERROR0("Failed to copy the generator");
+    return 0;
+  }
+  Wrwp_lock(self->wrwp);
+  self->lat = lat;
+  self->lon = lon;
+  PolarNavigator_setLat0(self->polnav, lat);
+  PolarNavigator_setLon0(self->polnav, lon);
+  PolarNavigator_setAlt0(self->polnav, 0.0);
+  self->wantedFields = WrwpInternal_createFieldsList(fieldsToGenerate);
+  WrwpInternal_getRequiredMoments(self->wantedFields, &self->needWind, &self->needRefl);
+  self->quantiles = WrwpInternal_isQuantileWanted(self->wantedFields);
+  self->useFloat = (wrwp->precision == WrwpSamplePrecision_FLOAT);
+  self->nlayers = wrwp->hmax / wrwp->dz;
+  self->total = WrwpInternal_createLayerSums(self->nlayers, self->quantiles);
+  if (self->total == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the composite");
+    RAVE_OBJECT_RELEASE(self->wrwp);
+    return 0;
+  }
+  return 1;
+}
+
+int WrwpComposite_addVolume(WrwpComposite_t* self, WrwpContext_t* ctx, PolarVolume_t* pvol)
+{
+  Wrwp_t* radar = NULL;
+  PolarNavigator_t* polnav = NULL;
+  WrwpInternal_LayerSums* sums = NULL;
+  char node[WRWP_NODES_LENGTH] = {'\0'};
+  double d = 0.0, a = 0.0;
+  int nscansBefore = 0, nscans = 0, is = 0, yindex = 0, result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((ctx != NULL), "ctx == NULL");
+
+  if (self->wrwp == NULL) {
+    RAVE_ERROR0("WrwpComposite_init must be called before adding volumes");
+    return 0;
+  }
+  if (pvol == NULL) {
+    RAVE_ERROR0("No volume to add");
+    return 0;
+  }
+  nscansBefore = self->nscans;
+
+  /* The gates are limited by their distance to the target instead of to the radar */
+  PolarNavigator_llToDa(self->polnav, PolarVolume_getLatitude(pvol), PolarVolume_getLongitude(pvol), &d, &a);
+  radar = RAVE_OBJECT_CLONE(self->wrwp);
+  polnav = RAVE_OBJECT_NEW(&PolarNavigator_TYPE);
+  sums = WrwpInternal_createLayerSums(self->nlayers, self->quantiles);
+  if (radar == NULL || polnav == NULL || sums == NULL ||
+      !WrwpInternal_ensureSampleBuffers(ctx, self->needWind, self->needRefl, self->useFloat) ||
+      !WrwpInternal_ensureStageBuffers(ctx, 0, 0, self->quantiles, 0)) {
+    RAVE_ERROR0("Failed to allocate memory for the radar");
+    goto done;
+  }
+  Wrwp_setDMAX(radar, (int)ceil(d) + self->wrwp->dmax);
+  PolarNavigator_setLat0(polnav, PolarVolume_getLatitude(pvol));
+  PolarNavigator_setLon0(polnav, PolarVolume_getLongitude(pvol));
+  PolarNavigator_setAlt0(polnav, PolarVolume_getHeight(pvol));
+
+  nscans = PolarVolume_getNumberOfScans(pvol);
+  for (is = 0; is < nscans; is++) {
+    char* taskString = NULL;
+    PolarScan_t* scan = PolarVolume_getScan(pvol, is);
+    if (WrwpInternal_isScanAccepted(radar, scan, &taskString)) {
+      RaveDateTime_t* startDT = WrwpInternal_getStartDateTimeFromScan(scan);
+      RaveDateTime_t* endDT = WrwpInternal_getEndDateTimeFromScan(scan);
+      WrwpInternal_ScanInfo* info = NULL;
+      if (WrwpInternal_addCompositeScan(self, PolarScan_getElangle(scan), taskString, startDT, endDT)) {
+        info = WrwpInternal_addScanInfo(radar, ctx, scan, pvol, polnav, self->nlayers, 0, self->needWind, self->needRefl);
+      }
+      RAVE_OBJECT_RELEASE(startDT);
+      RAVE_OBJECT_RELEASE(endDT);
+      if (info == NULL) {
+        RAVE_ERROR0("Failed to allocate memory for the scan information");
+        RAVE_OBJECT_RELEASE(scan);
+        goto done;
+      }
+      info->hasTarget = 1;
+      info->tx = d * sin(a);
+      info->ty = d * cos(a);
+      info->tr = self->wrwp->dmax;
+    }
+    RAVE_OBJECT_RELEASE(scan);
+  }
+
+  /* One gather per radar, the sums of the radars are then added since they are disjoint */
+  WrwpInternal_gatherLayerSums(radar, ctx, self->nlayers, self->useFloat, sums);
+  for (yindex = 0; yindex < self->nlayers; yindex++) {
+    WrwpInternal_combineLayerSums(&self->total[yindex], &sums[yindex], 1);
+  }
+  WrwpInternal_getQuotedNode(PolarVolume_getSource(pvol), node, sizeof(node));
+  WrwpInternal_appendCompositeNodes(self, node);
+  if (self->first == NULL) {
+    self->first = RAVE_OBJECT_COPY(pvol);
+  }
+  self->nradars++;
+  result = 1;
+done:
+  if (!result) {
+    WrwpInternal_truncateCompositeScans(self, nscansBefore);
+  }
+  WrwpInternal_releaseScanInfos(ctx);
+  RAVE_FREE(sums);
+  RAVE_OBJECT_RELEASE(polnav);
+  RAVE_OBJECT_RELEASE(radar);
+  return result;
+}
+
+int WrwpComposite_merge(WrwpComposite_t* self, WrwpComposite_t* other)
+{
+  int nscansBefore = 0, i = 0, yindex = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((other != NULL), "other == NULL");
+
+  /* Each composite has its own locked copy of the generator, so the configurations are compared */
+  if (self == other || self->wrwp == NULL || other->wrwp == NULL ||
+      !WrwpInternal_isSameConfiguration(self->wrwp, other->wrwp) || self->lat != other->lat || self->lon != other->lon || self->needWind != other->needWind ||
+      self->needRefl != other->needRefl || self->quantiles != other->quantiles) {
+    RAVE_ERROR0("Only composites with the same generator configuration, target and fields can be merged");
+    return 0;
+  }
+
+  nscansBefore = self->nscans;
+  for (i = 0; i < other->nscans; i++) {
+    WrwpInternal_WindowScan* oscan = &other->scans[i];
+    if (!WrwpInternal_addCompositeScan(self, oscan->elangle, oscan->task, oscan->startDT, oscan->endDT)) {
+      RAVE_ERROR0("Failed to allocate memory for the composite");
+      WrwpInternal_truncateCompositeScans(self, nscansBefore);
+      return 0;
+    }
+  }
+  for (yindex = 0; yindex < self->nlayers; yindex++) {
+    WrwpInternal_combineLayerSums(&self->total[yindex], &other->total[yindex], 1);
+  }
+  WrwpInternal_appendCompositeNodes(self, other->nodes);
+  if (self->first == NULL) {
+    self->first = RAVE_OBJECT_COPY(other->first);
+  }
+  self->nradars += other->nradars;
+  return 1;
+}
+
+int WrwpComposite_getNumberOfRadars(WrwpComposite_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->nradars;
+}
+
+WrwpResult_t* WrwpComposite_getResult(WrwpComposite_t* self)
+{
+  WrwpResult_t* result = NULL;
+  WrwpInternal_Metadata metadata;
+  int i = 0, yindex = 0, complete = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  memset(&metadata, 0, sizeof(metadata));
+
+  if (self->nscans == 0) {
+    RAVE_INFO0("No scans in the composite, dropping out...");
+    return NULL;
+  }
+
+  result = RAVE_OBJECT_NEW(&WrwpResult_TYPE);
+  if (result == NULL || !WrwpInternal_initResult(result, self->nlayers, self->wrwp->dz, self->wantedFields) ||
+      !WrwpInternal_initMetadata(&metadata)) {
+    RAVE_ERROR0("Failed to allocate memory for the result");
+    goto done;
+  }
+
+  for (i = 0; i < self->nscans; i++) {
+    WrwpInternal_WindowScan* cscan = &self->scans[i];
+    if (!WrwpInternal_addMetadata(&metadata, cscan->elangle, cscan->task, cscan->startDT, cscan->endDT)) {
+      RAVE_ERROR0("Failed to allocate memory for the tasks");
+      goto done;
+    }
+  }
+
+  for (yindex = 0; yindex < self->nlayers; yindex++) {
+    WrwpInternal_LayerMoments m;
+    WrwpInternal_momentsFromSums(&self->total[yindex], &m);
+    WrwpInternal_storeLayer(self->wrwp, result, yindex, 0, &m);
+  }
+
+  if (!WrwpInternal_moveMetadataToResult(&metadata, result)) {
+    RAVE_ERROR0("Failed to allocate memory for the tasks");
+    goto done;
+  }
+  complete = 1;
+done:
+  if (!complete) {
+    RAVE_OBJECT_RELEASE(result);
+  }
+  WrwpInternal_clearMetadata(&metadata);
+  return result;
+}
+
+VerticalProfile_t* WrwpComposite_getProfile(WrwpComposite_t* self)
+{
+  VerticalProfile_t* result = NULL;
+  WrwpResult_t* block = NULL;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+
+  block = WrwpComposite_getResult(self);
+  if (block != NULL) {
+    result = WrwpInternal_createProfile(self->wrwp, block, (RaveCoreObject*)self->first);
+  }
+  if (result != NULL) {
+    VerticalProfile_setLatitude(result, self->lat);
+    VerticalProfile_setLongitude(result, self->lon);
+    VerticalProfile_setHeight(result, 0.0);
+    WrwpInternal_addStringAttribute(result, "how/nodes", self->nodes);
+  }
+  RAVE_OBJECT_RELEASE(block);
+  return result;
+}
+
+/*@} End of Interface functions */
+
+RaveCoreObjectType Wrwp_TYPE = {
+    "Wrwp",
+    sizeof(Wrwp_t),
+    Wrwp_constructor,
+    Wrwp_destructor,
+    Wrwp_copyconstructor
+};
+
+RaveCoreObjectType WrwpResult_TYPE = {
+    "WrwpResult",
+    sizeof(WrwpResult_t),
+    WrwpResult_constructor,
+    WrwpResult_destructor
+};
+
+RaveCoreObjectType WrwpContext_TYPE = {
+    "WrwpContext",
+    sizeof(WrwpContext_t),
+    WrwpContext_constructor,
+    WrwpContext_destructor
+};
+
+RaveCoreObjectType WrwpWindow_TYPE = {
+    "WrwpWindow",
+    sizeof(WrwpWindow_t),
+    WrwpWindow_constructor,
+    WrwpWindow_destructor
+};
+
+RaveCoreObjectType WrwpComposite_TYPE = {
+    "WrwpComposite",
+    sizeof(WrwpComposite_t),
+    WrwpComposite_constructor,
+    WrwpComposite_destructor
+};
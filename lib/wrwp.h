@@ -38,6 +38,7 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #include "rave_attribute.h"
 #include "cartesian.h"
 #include "polarvolume.h"
+#include "rave_object_list.h"
 #include "vertical_profile.h"
 #include "projectionregistry.h"
 #include "arearegistry.h"
@@ -58,6 +59,7 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #define RAD2DEG     57.295779513082321      /* Radians to degrees. From PROJ.4 */
 #define NOR         40000           /* Number of rows in matrix A used in the computation */
 #define NOC         3               /* Number of columns in matrix A used in the computation */
+#define NOC_VVP     6               /* Number of columns in matrix A of the extended VVP model */
 #define NRHS        1               /* Number of right-hand sides; that is, the number of columns in matrix B used in the computation */
 #define LDA         NOC             /* Leading dimension of the array specified for a */
 #define LDB         NRHS            /* Leading dimension of the array specified for b */
@@ -86,9 +88,26 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #define UNDETECT_VP -9999           /* Undetect value used in the vertical profile */
 #define GAIN_VP     1.0             /* Gain value for the fields UWND and VWND */
 #define OFFSET_VP   0.0             /* Offset value for the fields UWND and VWND */
+#define BIO_DBZMAX  20.0            /* Maximum reflectivity of biological echoes [dBZ] */
+#define BIO_RCS     11.0            /* Radar cross section of one biological scatterer [cm2] */
+#define BIO_STDMIN  2.0             /* Minimum standard deviation of the radial winds of biological echoes [m/s] */
 
 /**
- * Defines a weather radar wind product generator
+ * Precision used when storing the gathered samples and building the design matrix.
+ */
+typedef enum WrwpSamplePrecision {
+  WrwpSamplePrecision_DOUBLE = 0, /**< Samples are stored in double precision (default) */
+  WrwpSamplePrecision_FLOAT = 1   /**< Samples are stored in single precision, fit and moments are still accumulated in double */
+} WrwpSamplePrecision;
+
+/**
+ * Defines a weather radar wind product generator.
+ *
+ * Thread safety: the generator only holds configuration. Once it has been configured and
+ * locked with \ref Wrwp_lock it is never modified again and the same instance can be used for
+ * generating profiles concurrently from several threads, as long as each thread uses its own
+ * \ref WrwpContext_t and its own input volume. The setters will refuse to modify a locked generator.
+ * Use RAVE_OBJECT_CLONE to get an unlocked copy that can be reconfigured.
  */
 typedef struct _Wrwp_t Wrwp_t;
 
@@ -97,6 +116,193 @@ typedef struct _Wrwp_t Wrwp_t;
  */
 extern RaveCoreObjectType Wrwp_TYPE;
 
+/**
+ * Defines the execution context used while generating a profile. The context owns all
+ * scratch memory (sample buffers and design matrix) and the per scan geometry caches. It is
+ * reused between generations so that the buffers only have to be allocated once. A context
+ * must never be used by more than one thread at a time.
+ */
+typedef struct _WrwpContext_t WrwpContext_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpContext_TYPE;
+
+/**
+ * Defines a rolling window of scans that gives a refreshed profile after every added scan. Only the
+ * contribution of each scan to each layer is kept (the normal equations of the wind and the moments of
+ * the reflectivity), so adding a scan and retiring the oldest ones costs O(layers) regardless of the
+ * length of the window. Only the SMHI method is supported.
+ */
+typedef struct _WrwpWindow_t WrwpWindow_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpWindow_TYPE;
+
+/**
+ * Defines a composite of several radars around a target location, e.g. an airport. The samples of
+ * each radar that are within dmax of the target are gathered once per radar into the sums of each
+ * layer (heights above sea level) and the sums of all radars are fitted jointly, giving one profile.
+ * Partial composites built with different contexts, e.g. one per thread, can be merged. Only the SMHI
+ * method is supported.
+ */
+typedef struct _WrwpComposite_t WrwpComposite_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpComposite_TYPE;
+
+/**
+ * The fields in a derived profile, see \ref WrwpResult_t.
+ *
+ * The divergence, total deformation and axis of dilatation are derived from an extended VVP model with
+ * the linear wind field terms, fitted to the same samples in the same pass when any of them is wanted. The
+ * mean wind and fall speed columns of that model are projected on the beam with the elevation for both
+ * methods, so the fitted terms do not depend on the mean wind columns of the SMHI method. They are
+ * supported by the batch generation, \ref Wrwp_generateConfigurations and \ref Wrwp_generateSectors, and
+ * are nodata for the streamed, windowed and aggregated generations.
+ *
+ * The percentiles of the reflectivity are derived from a bounded memory quantile sketch with 0.5 dBZ bins.
+ * The sketch is mergeable so they are supported by all generations.
+ */
+typedef enum WrwpResultField {
+  WrwpResultField_HGHT = 0,  /**< Center height of the layer [km] */
+  WrwpResultField_NV,        /**< Number of wind samples, -1 if the wind could not be derived */
+  WrwpResultField_UWND,      /**< East component of the wind */
+  WrwpResultField_VWND,      /**< North component of the wind */
+  WrwpResultField_FF,        /**< Wind speed */
+  WrwpResultField_FF_DEV,    /**< Standard deviation of the wind speed */
+  WrwpResultField_DD,        /**< Wind direction */
+  WrwpResultField_DBZH,      /**< Mean reflectivity */
+  WrwpResultField_DBZH_DEV,  /**< Standard deviation of the reflectivity */
+  WrwpResultField_NZ,        /**< Number of reflectivity samples, -1 if the reflectivity could not be derived */
+  WrwpResultField_DIV,       /**< Divergence of the horizontal wind [s-1], from the extended VVP model */
+  WrwpResultField_DEF,       /**< Total deformation of the horizontal wind [s-1], from the extended VVP model */
+  WrwpResultField_AD,        /**< Axis of dilatation, clockwise from north [deg], from the extended VVP model */
+  WrwpResultField_DBZH_P10,  /**< 10th percentile of the reflectivity, from a quantile sketch */
+  WrwpResultField_DBZH_P50,  /**< Median of the reflectivity, from a quantile sketch */
+  WrwpResultField_DBZH_P90,  /**< 90th percentile of the reflectivity, from a quantile sketch */
+  WrwpResultField_ETA,       /**< Reflectivity per volume of the biological echoes [cm2/km3] */
+  WrwpResultField_DENS,      /**< Density of biological scatterers [1/km3] */
+  WrwpResultField_FF_BIO,    /**< Speed of the biological scatterers [m/s] */
+  WrwpResultField_DD_BIO,    /**< Direction of the biological scatterers [deg] */
+  WrwpResultField_BIO_FRAC,  /**< Fraction of the reflectivity samples classified as biological */
+  WrwpResultField_COUNT      /**< Number of fields, not a field */
+} WrwpResultField;
+
+/**
+ * Defines a derived profile stored as a struct of arrays, i.e. one contiguous column with one
+ * value per layer for each field. The values are the same as the ones that are written into the
+ * fields of the vertical profile, i.e. gain_VP/offset_VP has been applied and layers without
+ * enough samples contain nodata_VP (-1 for the sample counts).
+ */
+typedef struct _WrwpResult_t WrwpResult_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpResult_TYPE;
+
+/**
+ * Returns the number of layers in the result
+ * @param[in] self - self
+ * @return the number of layers
+ */
+int WrwpResult_getLevels(WrwpResult_t* self);
+
+/**
+ * Returns the height interval of the layers [m]
+ * @param[in] self - self
+ * @return the height interval
+ */
+int WrwpResult_getInterval(WrwpResult_t* self);
+
+/**
+ * Returns if the field was asked for when the result was generated
+ * @param[in] self - self
+ * @param[in] field - the field
+ * @return 1 if the field is available, otherwise 0
+ */
+int WrwpResult_hasField(WrwpResult_t* self, WrwpResultField field);
+
+/**
+ * Returns the column for the specified field. The column is owned by the result.
+ * @param[in] self - self
+ * @param[in] field - the field
+ * @return the levels values for the field or NULL if the field not is available
+ */
+const double* WrwpResult_getData(WrwpResult_t* self, WrwpResultField field);
+
+/**
+ * Returns the name of the field as used in the fieldsToGenerate list, e.g. "ff_dev".
+ * @param[in] field - the field
+ * @return the name or NULL if field is out of range
+ */
+const char* WrwpResult_getFieldName(WrwpResultField field);
+
+/**
+ * Returns the field with the specified name, see \ref WrwpResult_getFieldName.
+ * @param[in] name - the name, only the first len characters are used
+ * @param[in] len - the length of the name
+ * @return the field or WrwpResultField_COUNT if there is no field with that name
+ */
+WrwpResultField WrwpResult_getFieldByName(const char* name, size_t len);
+
+/**
+ * Returns the start date/time of the first used scan
+ * @param[in] self - self
+ * @return the start date/time, remember to release it
+ */
+RaveDateTime_t* WrwpResult_getStartDateTime(WrwpResult_t* self);
+
+/**
+ * Returns the end date/time of the last used scan
+ * @param[in] self - self
+ * @return the end date/time, remember to release it
+ */
+RaveDateTime_t* WrwpResult_getEndDateTime(WrwpResult_t* self);
+
+/**
+ * Returns the end date/time of the last used scan as an integer YYYYMMDDHHMMSS, which orders the
+ * same way as the date/time.
+ * @param[in] self - self
+ * @param[out] t - the end date/time
+ * @return 1 on success, 0 if the end date/time is missing or invalid
+ */
+int WrwpResult_getEndTimeStamp(WrwpResult_t* self, long long* t);
+
+/**
+ * Returns the comma separated list of the used elevation angles
+ * @param[in] self - self
+ * @return the angles
+ */
+const char* WrwpResult_getAngles(WrwpResult_t* self);
+
+/**
+ * Returns the comma separated list of the unique how/task attributes of the used scans
+ * @param[in] self - self
+ * @return the tasks or NULL if none of the scans had a task
+ */
+const char* WrwpResult_getTasks(WrwpResult_t* self);
+
+/**
+ * Locks the generator so that the configuration no longer can be modified. A locked generator
+ * can be shared between threads.
+ * @param[in] self - self
+ */
+void Wrwp_lock(Wrwp_t* self);
+
+/**
+ * Returns if the generator has been locked or not.
+ * @param[in] self - self
+ * @return 1 if the generator is locked, otherwise 0
+ */
+int Wrwp_isLocked(Wrwp_t* self);
+
 /**
  * Returns the height interval for deriving a profile [m]
  * @param[in] self - self
@@ -391,6 +597,92 @@ void Wrwp_setVMIN(Wrwp_t* self, double vmin);
  */
 double Wrwp_getVMIN(Wrwp_t* self);
 
+/**
+ * Sets if the radial winds should be dealiased before the fit. A first guess of the wind in each
+ * layer is found with torus mapping and each sample is unfolded to the multiple of twice the
+ * Nyquist interval closest to the first guess. When dealiasing, the KNMI method does not discard
+ * scans with a Nyquist interval below NIMIN. Dealiasing is supported by the batch generation,
+ * \ref Wrwp_generateConfigurations and \ref Wrwp_generateSectors. Since the first guess needs all
+ * samples of a layer, \ref Wrwp_begin, \ref Wrwp_generateResolutions, \ref WrwpWindow_init and
+ * \ref WrwpComposite_init fail when it is set.
+ * @param[in] self - self
+ * @param[in] dealias - 1 to dealias, 0 otherwise
+ */
+void Wrwp_setDealias(Wrwp_t* self, int dealias);
+
+/**
+ * Returns if the radial winds are dealiased before the fit
+ * @param[in] self - self
+ * @return 1 if dealiasing, otherwise 0 (default 0)
+ */
+int Wrwp_getDealias(Wrwp_t* self);
+
+/**
+ * Sets the maximum reflectivity of biological echoes, gates with a higher reflectivity are
+ * classified as precipitation. The biological profile (eta, dens, ff_bio, dd_bio and bio_frac) is
+ * derived in the same pass as the other fields, the wind samples at biological gates are fitted
+ * separately and the reflectivity of the biological gates is converted to a density with
+ * \ref Wrwp_setBIO_RCS. It is supported by the batch generation, the fields are nodata for the
+ * other generations.
+ * @param[in] self - self
+ * @param[in] bio_dbzmax - the maximum reflectivity [dBZ]
+ */
+void Wrwp_setBIO_DBZMAX(Wrwp_t* self, double bio_dbzmax);
+
+/**
+ * Returns the maximum reflectivity of biological echoes
+ * @param[in] self - self
+ * @return the maximum reflectivity [dBZ] (default BIO_DBZMAX)
+ */
+double Wrwp_getBIO_DBZMAX(Wrwp_t* self);
+
+/**
+ * Sets the radar cross section of one biological scatterer that the density is derived with
+ * @param[in] self - self
+ * @param[in] bio_rcs - the radar cross section [cm2]
+ */
+void Wrwp_setBIO_RCS(Wrwp_t* self, double bio_rcs);
+
+/**
+ * Returns the radar cross section of one biological scatterer
+ * @param[in] self - self
+ * @return the radar cross section [cm2] (default BIO_RCS)
+ */
+double Wrwp_getBIO_RCS(Wrwp_t* self);
+
+/**
+ * Sets the minimum standard deviation of the radial winds of the biological echoes around the fitted
+ * wind. Layers with a lower deviation are considered to be precipitation and get a density of 0.
+ * @param[in] self - self
+ * @param[in] bio_stdmin - the minimum standard deviation [m/s]
+ */
+void Wrwp_setBIO_STDMIN(Wrwp_t* self, double bio_stdmin);
+
+/**
+ * Returns the minimum standard deviation of the radial winds of the biological echoes
+ * @param[in] self - self
+ * @return the minimum standard deviation [m/s] (default BIO_STDMIN)
+ */
+double Wrwp_getBIO_STDMIN(Wrwp_t* self);
+
+/**
+ * Sets the precision used when storing the gathered samples. Single precision halves the
+ * memory traffic when gathering the samples while the fit and the moments still are
+ * accumulated in double precision. The KNMI method fits the samples themselves, so it
+ * always gathers them in double precision.
+ * @param[in] self - self
+ * @param[in] precision - the sample precision
+ * @return 1 on success, 0 if precision not is supported
+ */
+int Wrwp_setSamplePrecision(Wrwp_t* self, WrwpSamplePrecision precision);
+
+/**
+ * Returns the precision used when storing the gathered samples
+ * @param[in] self - self
+ * @return the sample precision (default WrwpSamplePrecision_DOUBLE)
+ */
+WrwpSamplePrecision Wrwp_getSamplePrecision(Wrwp_t* self);
+
 /**
  * Function for deriving wind and reflectivity profiles from polar volume data
  * @param[in] self - self
@@ -398,9 +690,299 @@ double Wrwp_getVMIN(Wrwp_t* self);
  * @param[in] wrwpMethod - method to use for wrwp extraction. Supported methods are "SMHI"
  * and "KNMI". If NULL, then defaults to "SMHI".
  * @param[in] fieldsToGenerate - an comma-separated list of quantities. If NULL, then default
- * behaviour is to add ff,ff_dev,dd,dbzh and dbzh_dev
+ * behaviour is to add ff,ff_dev,dd,dbzh and dbzh_dev. Only the data needed for the wanted fields is
+ * gathered, i.e. no VRAD without wind fields and no DBZH without reflectivity fields. The fields are:
+ * - HGHT - center height of the layer
+ * - NV - number of wind samples
+ * - UWND - east component of the wind
+ * - VWND - north component of the wind
+ * - ff - wind speed
+ * - ff_dev - standard deviation of the wind speed
+ * - dd - wind direction
+ * - DBZH - mean reflectivity
+ * - DBZH_dev - standard deviation of the reflectivity
+ * - NZ - number of reflectivity samples
+ * - div - divergence of the wind, see \ref WrwpResultField
+ * - def - total deformation of the wind, see \ref WrwpResultField
+ * - ad - axis of dilatation of the wind, see \ref WrwpResultField
+ * - DBZH_p10, DBZH_p50, DBZH_p90 - 10th, 50th and 90th percentile of the reflectivity, see \ref WrwpResultField
+ * - eta - reflectivity per volume of the biological echoes, see \ref Wrwp_setBIO_DBZMAX
+ * - dens - density of biological scatterers, see \ref Wrwp_setBIO_RCS
+ * - ff_bio - speed of the biological scatterers
+ * - dd_bio - direction of the biological scatterers
+ * - bio_frac - fraction of the reflectivity samples classified as biological
  * @returns the wind profile
  */
 VerticalProfile_t* Wrwp_generate(Wrwp_t* self, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate);
 
+/**
+ * Same as \ref Wrwp_generate but uses the provided execution context for all scratch memory
+ * instead of creating a temporary one. This is the function to use when generating profiles from
+ * several threads with a shared (locked) generator, each thread should then have its own context.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] iobj - input volume
+ * @param[in] wrwpMethod - method to use for wrwp extraction, see \ref Wrwp_generate
+ * @param[in] fieldsToGenerate - an comma-separated list of quantities, see \ref Wrwp_generate
+ * @returns the wind profile
+ */
+VerticalProfile_t* Wrwp_generateWithContext(Wrwp_t* self, WrwpContext_t* ctx, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate);
+
+/**
+ * Same as \ref Wrwp_generateWithContext but treats several inputs as one logical volume, e.g. the
+ * partial volumes from EDGE based radars that only contain some of the elevations each. The scans are
+ * used directly without being copied. The start and end times, the used angles and the tasks are
+ * collected over all inputs. The radar location, source and nominal date and time are taken from the
+ * first input so all inputs should come from the same radar.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] inputs - list of polar volumes and/or polar scans
+ * @param[in] wrwpMethod - method to use for wrwp extraction, see \ref Wrwp_generate
+ * @param[in] fieldsToGenerate - an comma-separated list of quantities, see \ref Wrwp_generate
+ * @returns the wind profile or NULL on failure, if no scan could be used or if inputs is empty or
+ * contains anything else than volumes and scans
+ */
+VerticalProfile_t* Wrwp_generateFromScans(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod, const char* fieldsToGenerate);
+
+/**
+ * Derives the profile into a result block without creating any vertical profile or fields. Useful
+ * for consumers that only need the values. \ref Wrwp_generateWithContext materialises the same block.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] iobj - input volume
+ * @param[in] wrwpMethod - method to use for wrwp extraction, see \ref Wrwp_generate
+ * @param[in] fieldsToGenerate - an comma-separated list of quantities, see \ref Wrwp_generate
+ * @returns the result block or NULL on failure or if no scan could be used
+ */
+WrwpResult_t* Wrwp_generateResult(Wrwp_t* self, WrwpContext_t* ctx, PolarVolume_t* inobj, const char* wrwpMethod, const char* fieldsToGenerate);
+
+/**
+ * Creates the vertical profile from a result block, i.e. the second half of \ref Wrwp_generateWithContext.
+ * Useful when the result block also is used for something else, e.g. published or archived.
+ * @param[in] self - self, the generator that the result was generated with
+ * @param[in] result - the result block
+ * @param[in] origin - the volume that the location, source and nominal time are taken from
+ * @returns the vertical profile or NULL on failure
+ */
+VerticalProfile_t* Wrwp_createProfile(Wrwp_t* self, WrwpResult_t* result, PolarVolume_t* origin);
+
+/**
+ * Same as \ref Wrwp_generateResult but for several inputs, see \ref Wrwp_generateFromScans.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] inputs - list of polar volumes and/or polar scans
+ * @param[in] wrwpMethod - method to use for wrwp extraction, see \ref Wrwp_generate
+ * @param[in] fieldsToGenerate - an comma-separated list of quantities, see \ref Wrwp_generate
+ * @returns the result block or NULL on failure or if no scan could be used
+ */
+WrwpResult_t* Wrwp_generateResultFromScans(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod, const char* fieldsToGenerate);
+
+/**
+ * Derives profiles with several layer intervals and maximum heights from the same inputs in one pass.
+ * The samples are gathered once into layers with the greatest common divisor of the intervals and
+ * the sums of these thin layers are aggregated into the layers of each resolution, which is exact for
+ * the SMHI wind fit and the reflectivity moments. Since the sample limit (NOR) applies to the thin
+ * layers, a thick layer may use more samples than when generated directly. When the KNMI method is
+ * used for the wind, each resolution is generated separately since its outlier removal needs the samples.
+ * The other settings are taken from the generator.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] inputs - list of polar volumes and/or polar scans, see \ref Wrwp_generateFromScans
+ * @param[in] wrwpMethod - the method, "KNMI" or "SMHI" (default)
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @param[in] nresolutions - number of resolutions
+ * @param[in] dz - the layer interval of each resolution [m]
+ * @param[in] hmax - the maximum height of each resolution [m]
+ * @returns a list with one vertical profile per resolution or NULL on failure or if the generator dealiases the radial winds
+ */
+RaveObjectList_t* Wrwp_generateResolutions(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod,
+                                           const char* fieldsToGenerate, int nresolutions, const int* dz, const int* hmax);
+
+/**
+ * Derives one profile per configuration from the same inputs, e.g. when sweeping vmin, the distance and
+ * elevation limits, maxvdiff or the method. The inputs are decoded once using the union of the windows of
+ * all configurations and each configuration then selects its own samples, in the same order as when
+ * generated separately, so the profiles are identical to those from \ref Wrwp_generateFromScans. The
+ * exception is the biological profile, see \ref Wrwp_setBIO_DBZMAX, whose fields are nodata here.
+ * @param[in] ctx - the execution context
+ * @param[in] inputs - list of polar volumes and/or polar scans, see \ref Wrwp_generateFromScans
+ * @param[in] generators - list of wrwp generators, one per configuration
+ * @param[in] methods - the method for each configuration, "KNMI" or "SMHI". If NULL or if an entry is NULL, SMHI is used
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @returns a list with one vertical profile per configuration or NULL on failure, e.g. if a configuration
+ * does not accept any scan
+ */
+RaveObjectList_t* Wrwp_generateConfigurations(WrwpContext_t* ctx, RaveObjectList_t* inputs, RaveObjectList_t* generators,
+                                              const char** methods, const char* fieldsToGenerate);
+
+/**
+ * Derives one profile per azimuth sector and range ring from the same inputs in one pass, e.g. 4 quadrants
+ * times 3 rings. The scans are decoded once and each sample is routed to its (sector, ring, layer) so the
+ * cost is close to that of a single profile. The sectors have equal width and start at north, clockwise.
+ * A sector only sees part of the azimuth circle so the wind fit is less well conditioned than for the full
+ * annulus. The KNMI method only supports one sector since its azimuth gap check would reject the others.
+ * With one sector and one ring the profile is identical to the one from \ref Wrwp_generateFromScans,
+ * except for the fields of the biological profile that are nodata.
+ * The profiles have the attributes how/minrange and how/maxrange [km] of the ring and how/startaz and
+ * how/stopaz [deg] of the sector.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] inputs - list of polar volumes and/or polar scans, see \ref Wrwp_generateFromScans
+ * @param[in] wrwpMethod - the method, "KNMI" or "SMHI" (default)
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @param[in] nsectors - number of azimuth sectors
+ * @param[in] nrings - number of range rings
+ * @param[in] ranges - the increasing limits of the rings [m], nrings + 1 values. If NULL, dmin - dmax is split in rings of equal width
+ * @returns a list with nsectors * nrings profiles, sector by sector and ring by ring within each sector, or NULL on failure
+ */
+RaveObjectList_t* Wrwp_generateSectors(Wrwp_t* self, WrwpContext_t* ctx, RaveObjectList_t* inputs, const char* wrwpMethod,
+                                       const char* fieldsToGenerate, int nsectors, int nrings, const int* ranges);
+
+/**
+ * Starts a streamed generation where the scans are added one at a time as they arrive, e.g. while
+ * the volume still is being scanned. Each added scan is folded into a partial state per layer and
+ * the scan itself is not needed afterwards. The stream state is kept in the context so a context can
+ * only be used for one stream at a time, and the generator must not be modified until the stream
+ * has been finalized (lock it with \ref Wrwp_lock).
+ * The result is the same as when generating from a volume with the same scans. The wind and the
+ * mean reflectivity are identical, the standard deviation of the reflectivity may differ in the
+ * last digits since it is combined from the deviations of each scan.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context that keeps the stream state
+ * @param[in] wrwpMethod - the method, "KNMI" or "SMHI" (default)
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @returns 1 on success, 0 on memory allocation failure or if the generator dealiases the radial winds
+ */
+int Wrwp_begin(Wrwp_t* self, WrwpContext_t* ctx, const char* wrwpMethod, const char* fieldsToGenerate);
+
+/**
+ * Adds a scan to the stream started with \ref Wrwp_begin. Scans that not are accepted by the
+ * elevation and task limits are ignored. The first accepted scan defines the location, source and
+ * nominal time of the profile.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @param[in] scan - the scan
+ * @returns 1 on success (also if the scan was ignored), 0 on failure
+ */
+int Wrwp_addScan(Wrwp_t* self, WrwpContext_t* ctx, PolarScan_t* scan);
+
+/**
+ * Finalizes the stream and creates the vertical profile from the added scans. The stream is
+ * ended regardless of the outcome and a new one can be started with \ref Wrwp_begin.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @returns the vertical profile or NULL if no scans were accepted or on failure
+ */
+VerticalProfile_t* Wrwp_finalize(Wrwp_t* self, WrwpContext_t* ctx);
+
+/**
+ * Same as \ref Wrwp_finalize but returns the result block without creating a vertical profile.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context
+ * @returns the result block or NULL if no scans were accepted or on failure
+ */
+WrwpResult_t* Wrwp_finalizeResult(Wrwp_t* self, WrwpContext_t* ctx);
+
+/**
+ * Initializes the rolling window, any scans already in the window are removed. The window uses a
+ * locked copy of the configuration of the generator, later changes to the generator do not affect it.
+ * @param[in] self - self
+ * @param[in] wrwp - the generator, it is not modified and must not dealias the radial winds
+ * @param[in] wrwpMethod - the method, only "SMHI" (or NULL) is supported
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @param[in] length - the length of the window [s], scans that ended this long before the latest scan are retired
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpWindow_init(WrwpWindow_t* self, Wrwp_t* wrwp, const char* wrwpMethod, const char* fieldsToGenerate, int length);
+
+/**
+ * Adds a scan to the window and retires the scans that are too old. The scans must be added in order
+ * of their end times but may come from different volumes. Scans that not are accepted by the elevation
+ * and task limits are ignored.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context used when gathering the samples of the scan
+ * @param[in] scan - the scan
+ * @returns 1 on success (also if the scan was ignored), 0 on failure
+ */
+int WrwpWindow_addScan(WrwpWindow_t* self, WrwpContext_t* ctx, PolarScan_t* scan);
+
+/**
+ * Returns the number of scans in the window
+ * @param[in] self - self
+ * @returns the number of scans
+ */
+int WrwpWindow_getNumberOfScans(WrwpWindow_t* self);
+
+/**
+ * Derives the profile from the scans in the window. The location, source and nominal time are taken
+ * from the latest added scan.
+ * @param[in] self - self
+ * @returns the vertical profile or NULL if the window is empty or on failure
+ */
+VerticalProfile_t* WrwpWindow_getProfile(WrwpWindow_t* self);
+
+/**
+ * Same as \ref WrwpWindow_getProfile but returns the result block.
+ * @param[in] self - self
+ * @returns the result block or NULL if the window is empty or on failure
+ */
+WrwpResult_t* WrwpWindow_getResult(WrwpWindow_t* self);
+
+/**
+ * Initializes the composite, any radars already added are removed. The composite uses a locked copy of
+ * the configuration of the generator, later changes to the generator do not affect it. Gates are used if
+ * they are at least dmin from their own radar and within dmax of the target.
+ * @param[in] self - self
+ * @param[in] wrwp - the generator, it is not modified and must not dealias the radial winds
+ * @param[in] wrwpMethod - the method, only "SMHI" (or NULL) is supported
+ * @param[in] fieldsToGenerate - comma separated list of wanted fields, NULL means all
+ * @param[in] lat - latitude of the target [rad]
+ * @param[in] lon - longitude of the target [rad]
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpComposite_init(WrwpComposite_t* self, Wrwp_t* wrwp, const char* wrwpMethod, const char* fieldsToGenerate, double lat, double lon);
+
+/**
+ * Gathers the samples of one radar into the composite. Scans that not are accepted by the elevation
+ * and task limits are ignored.
+ * @param[in] self - self
+ * @param[in] ctx - the execution context used when gathering the samples of the volume
+ * @param[in] pvol - the polar volume
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpComposite_addVolume(WrwpComposite_t* self, WrwpContext_t* ctx, PolarVolume_t* pvol);
+
+/**
+ * Adds the radars of another composite to this one, e.g. when the volumes have been gathered in
+ * parallel into one composite per thread. Both must have been initialized with generators with the
+ * same configuration, the same target and the same fields. They do not have to share the generator.
+ * @param[in] self - self
+ * @param[in] other - the other composite, not modified
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpComposite_merge(WrwpComposite_t* self, WrwpComposite_t* other);
+
+/**
+ * Returns the number of radars in the composite
+ * @param[in] self - self
+ * @returns the number of radars
+ */
+int WrwpComposite_getNumberOfRadars(WrwpComposite_t* self);
+
+/**
+ * Derives the profile from the radars in the composite. The location is the target at height 0, the
+ * source and nominal time are taken from the first added volume and the nodes of all radars are
+ * written to how/nodes.
+ * @param[in] self - self
+ * @returns the vertical profile or NULL if the composite is empty or on failure
+ */
+VerticalProfile_t* WrwpComposite_getProfile(WrwpComposite_t* self);
+
+/**
+ * Same as \ref WrwpComposite_getProfile but returns the result block.
+ * @param[in] self - self
+ * @returns the result block or NULL if the composite is empty or on failure
+ */
+WrwpResult_t* WrwpComposite_getResult(WrwpComposite_t* self);
+
 #endif
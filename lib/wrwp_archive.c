@@ -0,0 +1,501 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Append-only time-height archive of derived profiles.
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp_archive.h"
+#include "rave_debug.h"
+#include "rave_alloc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Identifies an archive file, followed by the version
+ */
+#define WRWP_ARCHIVE_MAGIC "WRWPARCH"
+
+/**
+ * Version of the file layout
+ */
+#define WRWP_ARCHIVE_VERSION 1
+
+/**
+ * Offset of the comma separated field names in the header, the names are nul terminated
+ */
+#define WRWP_ARCHIVE_FIELDS_OFFSET 32
+
+/**
+ * Represents an archive file
+ */
+struct _WrwpArchive_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  int fd;                                 /**< the file descriptor, -1 if closed */
+  int levels;                             /**< number of layers */
+  int interval;                           /**< height interval of the layers [m] */
+  int nfields;                            /**< number of archived fields */
+  int column[WrwpResultField_COUNT];      /**< column of each field in a record, -1 if the field not is archived */
+  WrwpResultField fields[WrwpResultField_COUNT]; /**< the field of each column */
+  char names[WRWP_ARCHIVE_HEADER_SIZE];   /**< the archived fields, comma separated */
+  size_t recordSize;                      /**< size of one record [bytes] */
+  int nprofiles;                          /**< number of complete records */
+  unsigned char* map;                     /**< the mapped file, NULL if not mapped */
+  size_t mapSize;                         /**< size of the mapping [bytes] */
+};
+
+/*@{ Private functions */
+/**
+ * Constructor
+ */
+static int WrwpArchive_constructor(RaveCoreObject* obj)
+{
+  WrwpArchive_t* archive = (WrwpArchive_t*)obj;
+  int i = 0;
+  archive->fd = -1;
+  archive->levels = archive->interval = archive->nfields = 0;
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    archive->column[i] = -1;
+  }
+  archive->names[0] = '\0';
+  archive->recordSize = 0;
+  archive->nprofiles = 0;
+  archive->map = NULL;
+  archive->mapSize = 0;
+  return 1;
+}
+
+/**
+ * Destructor
+ */
+static void WrwpArchive_destructor(RaveCoreObject* obj)
+{
+  WrwpArchive_close((WrwpArchive_t*)obj);
+}
+
+/**
+ * Sets the archived fields from a comma separated list of field names
+ * @param[in] self - self
+ * @param[in] fields - the field names
+ * @returns 1 on success, 0 if a field is unknown, repeated or the list is empty
+ */
+static int WrwpArchiveInternal_setFields(WrwpArchive_t* self, const char* fields)
+{
+  const char* p = fields;
+  int i = 0;
+
+  self->nfields = 0;
+  self->names[0] = '\0';
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    self->column[i] = -1;
+  }
+  while (p != NULL && *p != '\0') {
+    size_t len = strcspn(p, ",");
+    WrwpResultField found = WrwpResult_getFieldByName(p, len);
+    if (found == WrwpResultField_COUNT || self->column[found] >= 0) {
+      RAVE_ERROR1("Unknown or repeated field in archive: %s", p);
+      return 0;
+    }
+    self->column[found] = self->nfields;
+    self->fields[self->nfields++] = found;
+    if (self->names[0] != '\0') {
+      strcat(self->names, ",");
+    }
+    strcat(self->names, WrwpResult_getFieldName(found));
+    p += len;
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return (self->nfields > 0);
+}
+
+/**
+ * Calculates the record size and the number of complete records from the size of the file
+ * @param[in] self - self
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpArchiveInternal_updateSize(WrwpArchive_t* self)
+{
+  struct stat st;
+  if (fstat(self->fd, &st) != 0) {
+    RAVE_ERROR1("Failed to stat archive: %s", strerror(errno));
+    return 0;
+  }
+  self->recordSize = sizeof(int64_t) + sizeof(double) * (size_t)self->levels * self->nfields;
+  self->nprofiles = 0;
+  if ((size_t)st.st_size > WRWP_ARCHIVE_HEADER_SIZE) {
+    self->nprofiles = (int)(((size_t)st.st_size - WRWP_ARCHIVE_HEADER_SIZE) / self->recordSize);
+  }
+  return 1;
+}
+
+/**
+ * Makes sure that all complete records are mapped. Records appended by another process since the
+ * last call are picked up.
+ * @param[in] self - self
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpArchiveInternal_map(WrwpArchive_t* self)
+{
+  size_t size = 0;
+  if (self->fd < 0) {
+    RAVE_ERROR0("The archive is not open");
+    return 0;
+  }
+  if (!WrwpArchiveInternal_updateSize(self)) {
+    return 0;
+  }
+  size = WRWP_ARCHIVE_HEADER_SIZE + self->recordSize * self->nprofiles;
+  if (self->map != NULL && self->mapSize >= size) {
+    return 1;
+  }
+  if (self->map != NULL) {
+    munmap(self->map, self->mapSize);
+    self->map = NULL;
+    self->mapSize = 0;
+  }
+  self->map = mmap(NULL, size, PROT_READ, MAP_SHARED, self->fd, 0);
+  if (self->map == MAP_FAILED) {
+    RAVE_ERROR1("Failed to map archive: %s", strerror(errno));
+    self->map = NULL;
+    return 0;
+  }
+  self->mapSize = size;
+  return 1;
+}
+
+/**
+ * Returns the time stored in a mapped record
+ * @param[in] self - self
+ * @param[in] index - the index of the record
+ * @returns the time as YYYYMMDDHHMMSS
+ */
+static long long WrwpArchiveInternal_recordTime(WrwpArchive_t* self, int index)
+{
+  int64_t t = 0;
+  memcpy(&t, self->map + WRWP_ARCHIVE_HEADER_SIZE + self->recordSize * index, sizeof(int64_t));
+  return (long long)t;
+}
+
+/**
+ * Returns the index of the first mapped record with a time >= t
+ * @param[in] self - self
+ * @param[in] t - the time as YYYYMMDDHHMMSS
+ * @returns the index, nprofiles if all records are earlier
+ */
+static int WrwpArchiveInternal_lowerBound(WrwpArchive_t* self, long long t)
+{
+  int lo = 0, hi = self->nprofiles;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (WrwpArchiveInternal_recordTime(self, mid) < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Writes all bytes at an offset
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpArchiveInternal_writeAt(int fd, const void* buf, size_t len, off_t offset)
+{
+  const unsigned char* p = buf;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return 0;
+    }
+    p += n;
+    len -= (size_t)n;
+    offset += n;
+  }
+  return 1;
+}
+/*@} End of Private functions */
+
+/*@{ Interface functions */
+int WrwpArchive_create(WrwpArchive_t* self, const char* filename, int levels, int interval, const char* fields)
+{
+  unsigned char header[WRWP_ARCHIVE_HEADER_SIZE];
+  int32_t values[4] = {WRWP_ARCHIVE_VERSION, 0, 0, 0};
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  WrwpArchive_close(self);
+
+  if (filename == NULL || levels <= 0 || interval <= 0 || fields == NULL ||
+      strlen(fields) >= WRWP_ARCHIVE_HEADER_SIZE - WRWP_ARCHIVE_FIELDS_OFFSET) {
+    RAVE_ERROR0("An archive needs a filename, a positive number of levels and interval and the fields");
+    return 0;
+  }
+  if (!WrwpArchiveInternal_setFields(self, fields)) {
+    return 0;
+  }
+  self->levels = levels;
+  self->interval = interval;
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, WRWP_ARCHIVE_MAGIC, 8);
+  values[1] = levels;
+  values[2] = interval;
+  values[3] = self->nfields;
+  memcpy(header + 8, values, sizeof(values));
+  strcpy((char*)header + WRWP_ARCHIVE_FIELDS_OFFSET, self->names);
+
+  self->fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (self->fd < 0) {
+    RAVE_ERROR2("Failed to create archive %s: %s", filename, strerror(errno));
+    return 0;
+  }
+  if (!WrwpArchiveInternal_writeAt(self->fd, header, sizeof(header), 0) || !WrwpArchiveInternal_updateSize(self)) {
+    RAVE_ERROR1("Failed to write archive header of %s", filename);
+    WrwpArchive_close(self);
+    return 0;
+  }
+  return 1;
+}
+
+int WrwpArchive_open(WrwpArchive_t* self, const char* filename)
+{
+  unsigned char header[WRWP_ARCHIVE_HEADER_SIZE];
+  int32_t values[4] = {0, 0, 0, 0};
+  ssize_t n = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  WrwpArchive_close(self);
+
+  if (filename == NULL) {
+    RAVE_ERROR0("No archive filename");
+    return 0;
+  }
+  self->fd = open(filename, O_RDWR);
+  if (self->fd < 0) {
+    RAVE_ERROR2("Failed to open archive %s: %s", filename, strerror(errno));
+    return 0;
+  }
+  n = pread(self->fd, header, sizeof(header), 0);
+  memcpy(values, header + 8, sizeof(values));
+  header[WRWP_ARCHIVE_HEADER_SIZE - 1] = '\0';
+  if (n != (ssize_t)sizeof(header) || memcmp(header, WRWP_ARCHIVE_MAGIC, 8) != 0 ||
+      values[0] != WRWP_ARCHIVE_VERSION || values[1] <= 0 || values[2] <= 0 ||
+      !WrwpArchiveInternal_setFields(self, (const char*)header + WRWP_ARCHIVE_FIELDS_OFFSET) ||
+      self->nfields != values[3]) {
+    RAVE_ERROR1("%s is not a wrwp archive or has an unsupported version", filename);
+    WrwpArchive_close(self);
+    return 0;
+  }
+  self->levels = values[1];
+  self->interval = values[2];
+  if (!WrwpArchiveInternal_updateSize(self)) {
+    WrwpArchive_close(self);
+    return 0;
+  }
+  return 1;
+}
+
+void WrwpArchive_close(WrwpArchive_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (self->map != NULL) {
+    munmap(self->map, self->mapSize);
+    self->map = NULL;
+    self->mapSize = 0;
+  }
+  if (self->fd >= 0) {
+    close(self->fd);
+    self->fd = -1;
+  }
+  self->nprofiles = 0;
+}
+
+int WrwpArchive_getLevels(WrwpArchive_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->levels;
+}
+
+int WrwpArchive_getInterval(WrwpArchive_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->interval;
+}
+
+const char* WrwpArchive_getFields(WrwpArchive_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->names;
+}
+
+int WrwpArchive_hasField(WrwpArchive_t* self, WrwpResultField field)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return (field >= 0 && field < WrwpResultField_COUNT && self->column[field] >= 0);
+}
+
+int WrwpArchive_getNumberOfProfiles(WrwpArchive_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (self->fd >= 0) {
+    WrwpArchiveInternal_updateSize(self);
+  }
+  return self->nprofiles;
+}
+
+int WrwpArchive_append(WrwpArchive_t* self, WrwpResult_t* result)
+{
+  unsigned char* record = NULL;
+  int64_t last = 0, t64 = 0;
+  long long t = 0;
+  int i = 0, ok = 0, locked = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((result != NULL), "result == NULL");
+
+  if (self->fd < 0) {
+    RAVE_ERROR0("The archive is not open");
+    return 0;
+  }
+  if (WrwpResult_getLevels(result) != self->levels || WrwpResult_getInterval(result) != self->interval) {
+    RAVE_ERROR0("The profile does not have the levels and interval of the archive");
+    return 0;
+  }
+  for (i = 0; i < self->nfields; i++) {
+    if (!WrwpResult_hasField(result, self->fields[i])) {
+      RAVE_ERROR1("The profile does not have the archived field %s", WrwpResult_getFieldName(self->fields[i]));
+      return 0;
+    }
+  }
+  if (!WrwpResult_getEndTimeStamp(result, &t)) {
+    RAVE_ERROR0("The profile must have a valid end date/time");
+    return 0;
+  }
+  record = RAVE_MALLOC(self->recordSize);
+  if (record == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for the record");
+    return 0;
+  }
+  t64 = (int64_t)t;
+  memcpy(record, &t64, sizeof(t64));
+  for (i = 0; i < self->nfields; i++) {
+    memcpy(record + sizeof(int64_t) + sizeof(double) * (size_t)self->levels * i,
+           WrwpResult_getData(result, self->fields[i]), sizeof(double) * self->levels);
+  }
+
+  /* The size is checked and the record written under an exclusive lock so that several appenders,
+   * e.g. concurrent runs, never compute the same offset */
+  while (flock(self->fd, LOCK_EX) != 0) {
+    if (errno != EINTR) {
+      RAVE_ERROR1("Failed to lock archive: %s", strerror(errno));
+      goto done;
+    }
+  }
+  locked = 1;
+  if (!WrwpArchiveInternal_updateSize(self)) {
+    goto done;
+  }
+  if (self->nprofiles > 0 &&
+      (pread(self->fd, &last, sizeof(last), WRWP_ARCHIVE_HEADER_SIZE + (off_t)self->recordSize * (self->nprofiles - 1)) != (ssize_t)sizeof(last) ||
+       t <= (long long)last)) {
+    RAVE_ERROR0("The profiles must be appended in time order");
+    goto done;
+  }
+  /* Written after the last complete record, a partially written record is overwritten */
+  if (!WrwpArchiveInternal_writeAt(self->fd, record, self->recordSize,
+                                   WRWP_ARCHIVE_HEADER_SIZE + (off_t)self->recordSize * self->nprofiles)) {
+    RAVE_ERROR1("Failed to append to archive: %s", strerror(errno));
+    goto done;
+  }
+  self->nprofiles++;
+  ok = 1;
+done:
+  if (locked) {
+    flock(self->fd, LOCK_UN);
+  }
+  RAVE_FREE(record);
+  return ok;
+}
+
+int WrwpArchive_findRange(WrwpArchive_t* self, long long start, long long end, int* first)
+{
+  int last = 0;
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((first != NULL), "first == NULL");
+  *first = 0;
+  if (!WrwpArchiveInternal_map(self) || end < start) {
+    return 0;
+  }
+  *first = WrwpArchiveInternal_lowerBound(self, start);
+  last = (end < LLONG_MAX) ? WrwpArchiveInternal_lowerBound(self, end + 1) : self->nprofiles;
+  return last - *first;
+}
+
+long long WrwpArchive_getTime(WrwpArchive_t* self, int index)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpArchiveInternal_map(self) || index < 0 || index >= self->nprofiles) {
+    return -1;
+  }
+  return WrwpArchiveInternal_recordTime(self, index);
+}
+
+int WrwpArchive_read(WrwpArchive_t* self, WrwpResultField field, int first, int count, double* data)
+{
+  size_t offset = 0, columnSize = 0;
+  int i = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((data != NULL || count == 0), "data == NULL");
+
+  if (!WrwpArchive_hasField(self, field)) {
+    RAVE_ERROR1("The field %s is not archived", WrwpResult_getFieldName(field));
+    return 0;
+  }
+  if (!WrwpArchiveInternal_map(self) || first < 0 || count < 0 || first + count > self->nprofiles) {
+    RAVE_ERROR0("The profiles are out of range");
+    return 0;
+  }
+  columnSize = sizeof(double) * self->levels;
+  offset = WRWP_ARCHIVE_HEADER_SIZE + self->recordSize * first + sizeof(int64_t) + columnSize * self->column[field];
+  for (i = 0; i < count; i++) {
+    memcpy(data + (size_t)i * self->levels, self->map + offset, columnSize);
+    offset += self->recordSize;
+  }
+  return 1;
+}
+/*@} End of Interface functions */
+
+RaveCoreObjectType WrwpArchive_TYPE = {
+    "WrwpArchive",
+    sizeof(WrwpArchive_t),
+    WrwpArchive_constructor,
+    WrwpArchive_destructor
+};
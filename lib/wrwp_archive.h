@@ -0,0 +1,153 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Append-only time-height archive of derived profiles, one file per radar.
+ *
+ * The file starts with a header of \ref WRWP_ARCHIVE_HEADER_SIZE bytes followed by fixed size
+ * records, one per profile, in increasing time order. A record is the time as a 64 bit integer
+ * YYYYMMDDHHMMSS followed by one column of levels doubles for each archived field, i.e. the same
+ * struct of arrays layout as \ref WrwpResult_t. Since the records have a fixed size, a profile is
+ * found by a binary search on the times and the file is read through a memory mapping. A record
+ * that was only partially written, e.g. when the writer was killed, is ignored and overwritten by
+ * the next append.
+ * @file
+ * @date 2026-10-18
+ */
+#ifndef WRWP_ARCHIVE_H
+#define WRWP_ARCHIVE_H
+#include "wrwp.h"
+
+/**
+ * Size of the file header [bytes]
+ */
+#define WRWP_ARCHIVE_HEADER_SIZE 1024
+
+/**
+ * Defines an archive of profiles
+ */
+typedef struct _WrwpArchive_t WrwpArchive_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpArchive_TYPE;
+
+/**
+ * Creates a new archive file, fails if the file already exists.
+ * @param[in] self - self
+ * @param[in] filename - the file
+ * @param[in] levels - number of layers of the archived profiles
+ * @param[in] interval - height interval of the layers [m]
+ * @param[in] fields - comma separated list of the archived fields, e.g. "HGHT,ff,dd,NV", see \ref WrwpResult_getFieldName
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpArchive_create(WrwpArchive_t* self, const char* filename, int levels, int interval, const char* fields);
+
+/**
+ * Opens an existing archive file for appending and reading
+ * @param[in] self - self
+ * @param[in] filename - the file
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpArchive_open(WrwpArchive_t* self, const char* filename);
+
+/**
+ * Closes the archive file, also done when the archive is released
+ * @param[in] self - self
+ */
+void WrwpArchive_close(WrwpArchive_t* self);
+
+/**
+ * Returns the number of layers of the archived profiles
+ * @param[in] self - self
+ * @returns the number of layers
+ */
+int WrwpArchive_getLevels(WrwpArchive_t* self);
+
+/**
+ * Returns the height interval of the layers [m]
+ * @param[in] self - self
+ * @returns the height interval
+ */
+int WrwpArchive_getInterval(WrwpArchive_t* self);
+
+/**
+ * Returns the archived fields as a comma separated list, can be used as fieldsToGenerate
+ * @param[in] self - self
+ * @returns the fields, owned by the archive
+ */
+const char* WrwpArchive_getFields(WrwpArchive_t* self);
+
+/**
+ * Returns if the field is archived
+ * @param[in] self - self
+ * @param[in] field - the field
+ * @returns 1 if the field is archived, otherwise 0
+ */
+int WrwpArchive_hasField(WrwpArchive_t* self, WrwpResultField field);
+
+/**
+ * Returns the number of profiles in the archive
+ * @param[in] self - self
+ * @returns the number of profiles
+ */
+int WrwpArchive_getNumberOfProfiles(WrwpArchive_t* self);
+
+/**
+ * Appends a profile, the time is the end date/time of the result and must be later than the time
+ * of the last profile in the archive. The result must have the same levels and interval as the
+ * archive and all the archived fields. The archive file is locked while appending, so several
+ * processes may append to the same archive file, as may threads that each opened their own archive
+ * object. The lock does not protect an archive object, one object must not be used by several threads
+ * at the same time.
+ * @param[in] self - self
+ * @param[in] result - the result
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpArchive_append(WrwpArchive_t* self, WrwpResult_t* result);
+
+/**
+ * Finds the profiles with start <= time <= end
+ * @param[in] self - self
+ * @param[in] start - the start as YYYYMMDDHHMMSS
+ * @param[in] end - the end as YYYYMMDDHHMMSS
+ * @param[out] first - the index of the first profile
+ * @returns the number of profiles in the range
+ */
+int WrwpArchive_findRange(WrwpArchive_t* self, long long start, long long end, int* first);
+
+/**
+ * Returns the time of a profile
+ * @param[in] self - self
+ * @param[in] index - the index of the profile
+ * @returns the time as YYYYMMDDHHMMSS or -1 if the index is out of range
+ */
+long long WrwpArchive_getTime(WrwpArchive_t* self, int index);
+
+/**
+ * Reads a field of consecutive profiles as a contiguous 2-D array with one row of levels values
+ * per profile.
+ * @param[in] self - self
+ * @param[in] field - the field
+ * @param[in] first - the index of the first profile
+ * @param[in] count - the number of profiles
+ * @param[out] data - the values, count * levels entries
+ * @returns 1 on success, 0 if the field not is archived or the profiles are out of range
+ */
+int WrwpArchive_read(WrwpArchive_t* self, WrwpResultField field, int first, int count, double* data);
+
+#endif
@@ -0,0 +1,172 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Reading and writing ODIM-H5 files as in-memory images.
+ * @file
+ * @date 2026-10-18
+ */
+#define _GNU_SOURCE /* memfd_create */
+#include "wrwp_image.h"
+#include "polarvolume.h"
+#include "rave_debug.h"
+#include "rave_alloc.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*@{ Private functions */
+/**
+ * Creates an anonymous memory backed file
+ * @param[out] path - the path of the file through /proc/self/fd, 64 characters
+ * @returns the file descriptor or -1 on failure
+ */
+static int WrwpImageInternal_createFile(char* path)
+{
+  int fd = memfd_create("wrwp_image", MFD_CLOEXEC);
+  if (fd < 0) {
+    RAVE_ERROR1("Failed to create memory file: %s", strerror(errno));
+    return -1;
+  }
+  snprintf(path, 64, "/proc/self/fd/%d", fd);
+  return fd;
+}
+/*@} End of Private functions */
+
+/*@{ Interface functions */
+RaveIO_t* WrwpImage_open(const void* image, size_t size)
+{
+  RaveIO_t* result = NULL;
+  const char* p = image;
+  char path[64];
+  size_t written = 0;
+  int fd = -1;
+
+  RAVE_ASSERT((image != NULL), "image == NULL");
+
+  fd = WrwpImageInternal_createFile(path);
+  if (fd < 0) {
+    return NULL;
+  }
+  while (written < size) {
+    ssize_t n = write(fd, p + written, size - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      RAVE_ERROR1("Failed to write image to memory file: %s", strerror(errno));
+      goto done;
+    }
+    written += (size_t)n;
+  }
+  result = RaveIO_open(path, 0, NULL);
+  if (result == NULL) {
+    RAVE_ERROR0("Failed to read ODIM-H5 image");
+  }
+done:
+  close(fd);
+  return result;
+}
+
+int WrwpImage_save(RaveCoreObject* object, void** image, size_t* size)
+{
+  RaveIO_t* raveio = NULL;
+  struct stat st;
+  char* data = NULL;
+  char path[64];
+  size_t nread = 0;
+  int fd = -1, result = 0;
+
+  RAVE_ASSERT((object != NULL), "object == NULL");
+  RAVE_ASSERT((image != NULL), "image == NULL");
+  RAVE_ASSERT((size != NULL), "size == NULL");
+
+  fd = WrwpImageInternal_createFile(path);
+  if (fd < 0) {
+    return 0;
+  }
+  raveio = RAVE_OBJECT_NEW(&RaveIO_TYPE);
+  if (raveio == NULL || !RaveIO_setObject(raveio, object) || !RaveIO_save(raveio, path)) {
+    RAVE_ERROR0("Failed to write ODIM-H5 image");
+    goto done;
+  }
+  if (fstat(fd, &st) != 0) {
+    RAVE_ERROR1("Failed to get size of memory file: %s", strerror(errno));
+    goto done;
+  }
+  data = RAVE_MALLOC((size_t)st.st_size > 0 ? (size_t)st.st_size : 1);
+  if (data == NULL) {
+    RAVE_ERROR0("Failed to allocate memory for ODIM-H5 image");
+    goto done;
+  }
+  while (nread < (size_t)st.st_size) {
+    ssize_t n = pread(fd, data + nread, (size_t)st.st_size - nread, (off_t)nread);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      RAVE_ERROR1("Failed to read memory file: %s", strerror(errno));
+      RAVE_FREE(data);
+      goto done;
+    }
+    nread += (size_t)n;
+  }
+  *image = data;
+  *size = nread;
+  result = 1;
+done:
+  RAVE_OBJECT_RELEASE(raveio);
+  close(fd);
+  return result;
+}
+
+int WrwpImage_generate(Wrwp_t* self, WrwpContext_t* ctx, const void* image, size_t size, const char* wrwpMethod,
+                       const char* fieldsToGenerate, void** profile, size_t* profileSize)
+{
+  RaveIO_t* raveio = NULL;
+  RaveCoreObject* object = NULL;
+  VerticalProfile_t* vp = NULL;
+  int result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+
+  raveio = WrwpImage_open(image, size);
+  if (raveio == NULL) {
+    return 0;
+  }
+  object = RaveIO_getObject(raveio);
+  if (object == NULL || !RAVE_OBJECT_CHECK_TYPE(object, &PolarVolume_TYPE)) {
+    RAVE_ERROR0("The image is not a polar volume");
+    goto done;
+  }
+  if (ctx != NULL) {
+    vp = Wrwp_generateWithContext(self, ctx, (PolarVolume_t*)object, wrwpMethod, fieldsToGenerate);
+  } else {
+    vp = Wrwp_generate(self, (PolarVolume_t*)object, wrwpMethod, fieldsToGenerate);
+  }
+  if (vp != NULL) {
+    result = WrwpImage_save((RaveCoreObject*)vp, profile, profileSize);
+  }
+done:
+  RAVE_OBJECT_RELEASE(vp);
+  RAVE_OBJECT_RELEASE(object);
+  RAVE_OBJECT_RELEASE(raveio);
+  return result;
+}
+/*@} End of Interface functions */
@@ -0,0 +1,62 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Reading and writing ODIM-H5 files as in-memory images, e.g. received on a pipe.
+ *
+ * Rave reads and writes HDF5 through named files, so an image is placed in an anonymous
+ * memory backed file (memfd) that is opened through /proc/self/fd. Nothing touches the disk.
+ * @file
+ * @date 2026-10-18
+ */
+#ifndef WRWP_IMAGE_H
+#define WRWP_IMAGE_H
+#include "wrwp.h"
+#include "rave_io.h"
+
+/**
+ * Opens an ODIM-H5 image
+ * @param[in] image - the content of an ODIM-H5 file
+ * @param[in] size - the size of the image [bytes]
+ * @returns the loaded rave io, with the object and the ODIM versions, or NULL on failure
+ */
+RaveIO_t* WrwpImage_open(const void* image, size_t size);
+
+/**
+ * Saves an object, e.g. a vertical profile, as an ODIM-H5 image
+ * @param[in] object - the object
+ * @param[out] image - the content of the ODIM-H5 file, to be released with RAVE_FREE
+ * @param[out] size - the size of the image [bytes]
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpImage_save(RaveCoreObject* object, void** image, size_t* size);
+
+/**
+ * Generates a profile from a polar volume image and returns it as an image, see \ref Wrwp_generateWithContext
+ * @param[in] self - the generator
+ * @param[in] ctx - the context, may be NULL
+ * @param[in] image - the polar volume as ODIM-H5 image
+ * @param[in] size - the size of the image [bytes]
+ * @param[in] wrwpMethod - the method, may be NULL
+ * @param[in] fieldsToGenerate - the fields, may be NULL
+ * @param[out] profile - the vertical profile as ODIM-H5 image, to be released with RAVE_FREE
+ * @param[out] profileSize - the size of the profile image [bytes]
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpImage_generate(Wrwp_t* self, WrwpContext_t* ctx, const void* image, size_t size, const char* wrwpMethod,
+                       const char* fieldsToGenerate, void** profile, size_t* profileSize);
+
+#endif
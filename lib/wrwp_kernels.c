@@ -0,0 +1,237 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Numerical kernels used when deriving the wind profiles.
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp_kernels.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Radians to degrees, same value as RAD2DEG in wrwp.h
+ */
+#define WRWP_KERNEL_RAD2DEG 57.295779513082321
+
+/**
+ * The number of sector bins that can be handled without allocating memory
+ */
+#define WRWP_KERNEL_MAX_STATIC_SECTORS 360
+
+int WrwpKernel_sectorIndex(double az, int nbins)
+{
+  int m = 0;
+  if (nbins <= 0) {
+    return 0;
+  }
+  m = (az * WRWP_KERNEL_RAD2DEG * nbins) / 360.0;
+  return m % nbins;
+}
+
+double WrwpKernel_residuals(int n, const double* restrict A, const double* restrict x,
+                            const double* restrict v, double* restrict vfit)
+{
+  /* Four partial sums that are combined in a fixed order so that the result does not
+     depend on how the compiler vectorises the loop */
+  double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0, r = 0.0;
+  const double x0 = x[0], x1 = x[1], x2 = x[2];
+  int i = 0;
+
+  for (i = 0; i < n; i++) {
+    vfit[i] = x0 * A[3*i] + x1 * A[3*i+1] + x2 * A[3*i+2];
+  }
+  for (i = 0; i + 3 < n; i += 4) {
+    double r0 = v[i] - vfit[i], r1 = v[i+1] - vfit[i+1], r2 = v[i+2] - vfit[i+2], r3 = v[i+3] - vfit[i+3];
+    s0 += r0 * r0;
+    s1 += r1 * r1;
+    s2 += r2 * r2;
+    s3 += r3 * r3;
+  }
+  for (; i < n; i++) {
+    r = v[i] - vfit[i];
+    s0 += r * r;
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+int WrwpKernel_compactInliers(int n, double* A, const double* vfit, double vdifmax, double* v, int* sector)
+{
+  int i = 0, k = 0;
+  for (i = 0; i < n; i++) {
+    /* The write position never passes the read position so the data can be moved in place */
+    int keep = (fabs(v[i] - vfit[i]) < vdifmax);
+    double a0 = A[3*i], a1 = A[3*i+1], a2 = A[3*i+2];
+    v[k] = v[i];
+    sector[k] = sector[i];
+    A[3*k] = a0;
+    A[3*k+1] = a1;
+    A[3*k+2] = a2;
+    k += keep;
+  }
+  return k;
+}
+
+int WrwpKernel_sectorGap(int n, const int* sector, int nbins, int nmin)
+{
+  int staticCount[WRWP_KERNEL_MAX_STATIC_SECTORS];
+  int* count = staticCount;
+  int i = 0, gap = 0;
+
+  if (nbins <= 0) {
+    return 0;
+  }
+  if (nbins > WRWP_KERNEL_MAX_STATIC_SECTORS) {
+    count = malloc(sizeof(int) * nbins);
+    if (count == NULL) {
+      return 1;
+    }
+  }
+  memset(count, 0, sizeof(int) * nbins);
+
+  for (i = 0; i < n; i++) {
+    count[sector[i]]++;
+  }
+  for (i = 0; i < nbins; i++) {
+    if ((count[i] < nmin) && (count[(i + 1) % nbins] < nmin)) {
+      gap = 1;
+      break;
+    }
+  }
+
+  if (count != staticCount) {
+    free(count);
+  }
+  return gap;
+}
+
+void WrwpKernel_torusScores(int ngroups, const double* C, const double* S, const double* ka, const double* kb,
+                            int nu, const double* u, int nw, const double* w, double* work, double* scores)
+{
+  double *cu = work, *su = work + nu, *cw = work + 2 * nu, *sw = work + 2 * nu + nw;
+  int g = 0, iu = 0, iw = 0;
+
+  memset(scores, 0, sizeof(double) * nu * nw);
+  for (g = 0; g < ngroups; g++) {
+    for (iu = 0; iu < nu; iu++) {
+      cu[iu] = cos(ka[g] * u[iu]);
+      su[iu] = sin(ka[g] * u[iu]);
+    }
+    for (iw = 0; iw < nw; iw++) {
+      cw[iw] = cos(kb[g] * w[iw]);
+      sw[iw] = sin(kb[g] * w[iw]);
+    }
+    /* C cos(a+b) + S sin(a+b) = cos(b) (C cos(a) + S sin(a)) + sin(b) (S cos(a) - C sin(a)) */
+    for (iu = 0; iu < nu; iu++) {
+      const double p = C[g] * cu[iu] + S[g] * su[iu];
+      const double q = S[g] * cu[iu] - C[g] * su[iu];
+      double* restrict row = scores + iu * nw;
+      for (iw = 0; iw < nw; iw++) {
+        row[iw] += p * cw[iw] + q * sw[iw];
+      }
+    }
+  }
+}
+
+int WrwpKernel_unfold(int n, const double* az, const double* el, const double* ni, double u, double w, double* v)
+{
+  int i = 0, changed = 0;
+  for (i = 0; i < n; i++) {
+    if (ni[i] > 0.0) {
+      double m = cos(el[i]) * (u * sin(az[i]) + w * cos(az[i]));
+      double k = nearbyint((m - v[i]) / (2.0 * ni[i]));
+      v[i] += 2.0 * ni[i] * k;
+      changed += (k != 0.0);
+    }
+  }
+  return changed;
+}
+
+/**
+ * Returns the sketch bin of a reflectivity sample [Z]
+ */
+static int WrwpKernelInternal_sketchBin(double z)
+{
+  double b = 0.0;
+  if (z <= 0.0) {
+    return 0;
+  }
+  b = (10.0 * log10(z) - WRWP_KERNEL_SKETCH_MIN) / WRWP_KERNEL_SKETCH_WIDTH;
+  if (b < 0.0) {
+    return 0;
+  } else if (b >= WRWP_KERNEL_SKETCH_BINS) {
+    return WRWP_KERNEL_SKETCH_BINS - 1;
+  }
+  return (int)b;
+}
+
+void WrwpKernel_initSketch(WrwpQuantileSketch* sketch)
+{
+  memset(sketch, 0, sizeof(WrwpQuantileSketch));
+}
+
+void WrwpKernel_addToSketch(WrwpQuantileSketch* sketch, int n, const double* z)
+{
+  int i = 0;
+  for (i = 0; i < n; i++) {
+    sketch->counts[WrwpKernelInternal_sketchBin(z[i])]++;
+  }
+  sketch->n += (n > 0 ? n : 0);
+}
+
+void WrwpKernel_addToSketchFloat(WrwpQuantileSketch* sketch, int n, const float* z)
+{
+  int i = 0;
+  for (i = 0; i < n; i++) {
+    sketch->counts[WrwpKernelInternal_sketchBin((double)z[i])]++;
+  }
+  sketch->n += (n > 0 ? n : 0);
+}
+
+void WrwpKernel_combineSketch(WrwpQuantileSketch* total, const WrwpQuantileSketch* part, int sign)
+{
+  int i = 0;
+  if (part->n <= 0) {
+    return;
+  }
+  for (i = 0; i < WRWP_KERNEL_SKETCH_BINS; i++) {
+    total->counts[i] += sign * part->counts[i];
+  }
+  total->n += sign * part->n;
+  if (total->n <= 0) {
+    memset(total, 0, sizeof(WrwpQuantileSketch));
+  }
+}
+
+double WrwpKernel_sketchQuantile(const WrwpQuantileSketch* sketch, double q)
+{
+  double target = 0.0, cum = 0.0;
+  int i = 0;
+  if (sketch->n <= 0) {
+    return WRWP_KERNEL_SKETCH_MIN;
+  }
+  target = (q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q)) * sketch->n;
+  for (i = 0; i < WRWP_KERNEL_SKETCH_BINS; i++) {
+    int c = sketch->counts[i];
+    if (c > 0 && cum + c >= target) {
+      return WRWP_KERNEL_SKETCH_MIN + WRWP_KERNEL_SKETCH_WIDTH * (i + (target - cum) / c);
+    }
+    cum += c;
+  }
+  return WRWP_KERNEL_SKETCH_MIN + WRWP_KERNEL_SKETCH_WIDTH * WRWP_KERNEL_SKETCH_BINS;
+}
@@ -0,0 +1,290 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Numerical kernels used when deriving the wind profiles. The kernels work on plain
+ * arrays and have no dependencies to rave so that they can be benchmarked in isolation.
+ * @file
+ * @date 2026-10-18
+ */
+#ifndef WRWP_KERNELS_H
+#define WRWP_KERNELS_H
+
+/**
+ * Returns the azimuth sector bin that the azimuth belongs to, i.e. the azimuth is truncated
+ * to one of nbins sectors of 360/nbins degrees each.
+ * @param[in] az - the azimuth [rad]
+ * @param[in] nbins - the number of azimuth sector bins
+ * @returns the sector bin, 0 <= bin < nbins
+ */
+int WrwpKernel_sectorIndex(double az, int nbins);
+
+/**
+ * Evaluates the fit vfit = A * x for each sample and returns the sum of the squared
+ * residuals v - vfit. The design rows in A are the ones used for the fit so no
+ * trigonometric functions have to be evaluated.
+ * @param[in] n - the number of samples
+ * @param[in] A - the design matrix, n rows with 3 columns (row major)
+ * @param[in] x - the fitted parameters (3 values)
+ * @param[in] v - the observed values
+ * @param[out] vfit - the fitted values, n values
+ * @returns the sum of the squared residuals
+ */
+double WrwpKernel_residuals(int n, const double* A, const double* x, const double* v, double* vfit);
+
+/**
+ * Removes the samples with abs(v - vfit) >= vdifmax. The kept samples are moved to the front
+ * of A, v and sector while keeping their order. The compaction is branch free, the mask is
+ * evaluated for every sample and the write position is advanced by the mask.
+ * @param[in] n - the number of samples
+ * @param[in,out] A - the design matrix, n rows with 3 columns (row major)
+ * @param[in] vfit - the fitted values
+ * @param[in] vdifmax - the maximum allowed deviation
+ * @param[in,out] v - the observed values
+ * @param[in,out] sector - the azimuth sector bins
+ * @returns the number of kept samples
+ */
+int WrwpKernel_compactInliers(int n, double* A, const double* vfit, double vdifmax, double* v, int* sector);
+
+/**
+ * Detects gaps in the azimuthal distribution from the precalculated sector bins. A gap is
+ * detected when two consecutive sector bins contain less than nmin samples each.
+ * @param[in] n - the number of samples
+ * @param[in] sector - the sector bin for each sample
+ * @param[in] nbins - the number of sector bins
+ * @param[in] nmin - the minimum number of samples in a sector bin
+ * @returns 1 if a gap was detected, otherwise 0
+ */
+int WrwpKernel_sectorGap(int n, const int* sector, int nbins, int nmin);
+
+/**
+ * Evaluates the torus mapping score of a grid of candidate winds. Each group of samples shares the same
+ * geometry and Nyquist interval and contributes C cos(ka*u + kb*w) + S sin(ka*u + kb*w), where C and S are
+ * the sums of the cosines and sines of the sample phases pi*v/NI. The score is insensitive to the folding
+ * of the samples and is highest for the wind that fits them best. The inner loop has no trigonometric
+ * functions so that it can be vectorised.
+ * @param[in] ngroups - the number of groups
+ * @param[in] C - the sum of the cosines of the phases in each group
+ * @param[in] S - the sum of the sines of the phases in each group
+ * @param[in] ka - the phase per m/s of the east component for each group
+ * @param[in] kb - the phase per m/s of the north component for each group
+ * @param[in] nu - number of candidate east components
+ * @param[in] u - the candidate east components
+ * @param[in] nw - number of candidate north components
+ * @param[in] w - the candidate north components
+ * @param[in] work - scratch memory, 2 * (nu + nw) values
+ * @param[out] scores - the score of each candidate, scores[iu * nw + iw]
+ */
+void WrwpKernel_torusScores(int ngroups, const double* C, const double* S, const double* ka, const double* kb,
+                            int nu, const double* u, int nw, const double* w, double* work, double* scores);
+
+/**
+ * Unfolds the samples against a wind, i.e. adds the multiple of 2 * NI that brings each sample closest
+ * to cos(el) * (u * sin(az) + w * cos(az)). Samples with NI <= 0 are left as they are.
+ * @param[in] n - the number of samples
+ * @param[in] az - the azimuth of each sample [rad]
+ * @param[in] el - the elevation angle of each sample [rad]
+ * @param[in] ni - the Nyquist interval of each sample [m/s]
+ * @param[in] u - the east component of the wind [m/s]
+ * @param[in] w - the north component of the wind [m/s]
+ * @param[in,out] v - the samples
+ * @returns the number of samples that were changed
+ */
+int WrwpKernel_unfold(int n, const double* az, const double* el, const double* ni, double u, double w, double* v);
+
+/**
+ * Number of bins in a quantile sketch
+ */
+#define WRWP_KERNEL_SKETCH_BINS 256
+
+/**
+ * Lower edge of the first bin in a quantile sketch [dBZ], samples below end up in the first bin
+ */
+#define WRWP_KERNEL_SKETCH_MIN -32.0
+
+/**
+ * Width of the bins in a quantile sketch [dBZ], samples above the last bin end up in the last bin
+ */
+#define WRWP_KERNEL_SKETCH_WIDTH 0.5
+
+/**
+ * A bounded memory quantile sketch of reflectivity samples, a histogram with fixed bins in dBZ. The
+ * quantiles are resolved to a fraction of a bin and sketches of disjoint sets of samples can be added
+ * to and subtracted from each other, which gives the same sketch as if all samples were added to one.
+ */
+typedef struct WrwpQuantileSketch {
+  long n;                                /**< number of samples */
+  int counts[WRWP_KERNEL_SKETCH_BINS];   /**< number of samples in each bin */
+} WrwpQuantileSketch;
+
+/**
+ * Resets the sketch
+ * @param[in] sketch - the sketch
+ */
+void WrwpKernel_initSketch(WrwpQuantileSketch* sketch);
+
+/**
+ * Adds the samples to the sketch
+ * @param[in,out] sketch - the sketch
+ * @param[in] n - the number of samples
+ * @param[in] z - the reflectivity samples [Z]
+ */
+void WrwpKernel_addToSketch(WrwpQuantileSketch* sketch, int n, const double* z);
+
+/**
+ * Same as \ref WrwpKernel_addToSketch but for single precision samples.
+ */
+void WrwpKernel_addToSketchFloat(WrwpQuantileSketch* sketch, int n, const float* z);
+
+/**
+ * Adds (sign = 1) or subtracts (sign = -1) a sketch of a part of the samples to or from the total
+ * @param[in,out] total - the total
+ * @param[in] part - the sketch of the part
+ * @param[in] sign - 1 to add, -1 to subtract
+ */
+void WrwpKernel_combineSketch(WrwpQuantileSketch* total, const WrwpQuantileSketch* part, int sign);
+
+/**
+ * Returns the quantile of the samples in the sketch, interpolated linearly within the bin
+ * @param[in] sketch - the sketch
+ * @param[in] q - the quantile, 0 <= q <= 1
+ * @returns the quantile [dBZ], WRWP_KERNEL_SKETCH_MIN if the sketch is empty
+ */
+double WrwpKernel_sketchQuantile(const WrwpQuantileSketch* sketch, double q);
+
+/**
+ * The sufficient statistics of the linear least squares problem A x = b with three columns,
+ * i.e. the unique terms of the normal equations.
+ */
+typedef struct WrwpNormalEquations {
+  double n;      /**< number of samples */
+  double aa[6];  /**< the unique terms of AtA: a0a0, a0a1, a0a2, a1a1, a1a2, a2a2 */
+  double ab[3];  /**< Atb: a0b, a1b, a2b */
+  double bb;     /**< btb */
+} WrwpNormalEquations;
+
+/**
+ * Number of partial sums kept per term of the normal equations
+ */
+#define WRWP_KERNEL_LANES 8
+
+/**
+ * Number of accumulated terms of the normal equations, the 6 terms of AtA, the 3 terms of Atb and btb
+ */
+#define WRWP_KERNEL_TERMS 10
+
+/**
+ * The partial sums of the normal equations. Sample i (counted over all calls) goes to lane i % 8 so
+ * the samples can be added in several calls and still give the same sums as when added in one call.
+ */
+typedef struct WrwpNormalLanes {
+  long count; /**< number of samples added */
+  double lanes[WRWP_KERNEL_TERMS][WRWP_KERNEL_LANES]; /**< the partial sums */
+} WrwpNormalLanes;
+
+/**
+ * The instruction sets that the normal equations can be accumulated with
+ */
+typedef enum WrwpKernelInstructionSet {
+  WrwpKernelInstructionSet_AUTO = -1,  /**< Use the best one supported by the cpu */
+  WrwpKernelInstructionSet_SCALAR = 0, /**< Plain C */
+  WrwpKernelInstructionSet_SSE2 = 1,   /**< SSE2 */
+  WrwpKernelInstructionSet_AVX2 = 2,   /**< AVX2 */
+  WrwpKernelInstructionSet_AVX512 = 3  /**< AVX-512F */
+} WrwpKernelInstructionSet;
+
+/**
+ * Returns if the instruction set is supported by the cpu and the build
+ * @param[in] isa - the instruction set
+ * @returns 1 if supported, otherwise 0
+ */
+int WrwpKernel_isInstructionSetSupported(WrwpKernelInstructionSet isa);
+
+/**
+ * Forces the instruction set used by \ref WrwpKernel_accumulateNormalEquations. Intended for
+ * testing and benchmarking, the default is WrwpKernelInstructionSet_AUTO.
+ * @param[in] isa - the instruction set
+ * @returns 1 on success, 0 if the instruction set not is supported
+ */
+int WrwpKernel_setInstructionSet(WrwpKernelInstructionSet isa);
+
+/**
+ * Returns the instruction set that is used by \ref WrwpKernel_accumulateNormalEquations
+ * @returns the instruction set, never WrwpKernelInstructionSet_AUTO
+ */
+WrwpKernelInstructionSet WrwpKernel_getInstructionSet(void);
+
+/**
+ * Returns the name of the instruction set, e.g. "AVX2"
+ * @param[in] isa - the instruction set
+ * @returns the name
+ */
+const char* WrwpKernel_getInstructionSetName(WrwpKernelInstructionSet isa);
+
+/**
+ * Adds the samples to the normal equations. The sums are accumulated in 8 lanes, sample i goes
+ * to lane i % 8, and the lanes are combined in a fixed order. All instruction sets perform the
+ * same operations in the same order so the result is bit identical regardless of the cpu.
+ * @param[in] n - the number of samples
+ * @param[in] a0 - the first column of A
+ * @param[in] a1 - the second column of A
+ * @param[in] a2 - the third column of A, if NULL the column is assumed to be all ones
+ * @param[in] b - the observations
+ * @param[in,out] ne - the normal equations that the samples are added to
+ */
+void WrwpKernel_accumulateNormalEquations(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpNormalEquations* ne);
+
+/**
+ * Same as \ref WrwpKernel_accumulateNormalEquations but for single precision samples. The samples
+ * are converted to double precision in chunks and the result is identical to converting all
+ * samples first.
+ */
+void WrwpKernel_accumulateNormalEquationsFloat(int n, const float* a0, const float* a1, const float* a2, const float* b, WrwpNormalEquations* ne);
+
+/**
+ * Resets the partial sums
+ * @param[in] lanes - the partial sums
+ */
+void WrwpKernel_initNormalLanes(WrwpNormalLanes* lanes);
+
+/**
+ * Adds the samples to the partial sums, continuing in the lane after the last added sample.
+ * See \ref WrwpKernel_accumulateNormalEquations for the arguments.
+ */
+void WrwpKernel_addToNormalLanes(WrwpNormalLanes* lanes, int n, const double* a0, const double* a1, const double* a2, const double* b);
+
+/**
+ * Same as \ref WrwpKernel_addToNormalLanes but for single precision samples.
+ */
+void WrwpKernel_addToNormalLanesFloat(WrwpNormalLanes* lanes, int n, const float* a0, const float* a1, const float* a2, const float* b);
+
+/**
+ * Combines the lanes in a fixed order and adds them to the normal equations.
+ * @param[in] lanes - the partial sums
+ * @param[in,out] ne - the normal equations
+ */
+void WrwpKernel_reduceNormalLanes(const WrwpNormalLanes* lanes, WrwpNormalEquations* ne);
+
+/**
+ * Solves the normal equations with a Cholesky decomposition.
+ * @param[in] ne - the normal equations
+ * @param[out] x - the solution (3 values)
+ * @param[out] chisq - the mean squared residual, may be NULL
+ * @returns 1 on success, 0 if the system is singular
+ */
+int WrwpKernel_solveNormalEquations(const WrwpNormalEquations* ne, double* x, double* chisq);
+
+#endif
@@ -0,0 +1,482 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Ring buffer of the latest profiles in POSIX shared memory.
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp_shm.h"
+#include "rave_debug.h"
+#include "rave_alloc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Identifies a segment
+ */
+#define WRWP_SHM_MAGIC "WRWPRING"
+
+/**
+ * Version of the segment layout
+ */
+#define WRWP_SHM_VERSION 1
+
+/**
+ * Offset of the comma separated field names in the header
+ */
+#define WRWP_SHM_FIELDS_OFFSET 64
+
+/**
+ * Maximum length of a segment name
+ */
+#define WRWP_SHM_NAME_LENGTH 256
+
+/**
+ * The header of a segment, see \ref wrwp_shm.h
+ */
+typedef struct {
+  char magic[8];
+  int32_t version;
+  int32_t levels;
+  int32_t interval;
+  int32_t nfields;
+  int32_t nslots;
+  int32_t reserved;
+  uint64_t slotSize;
+  uint64_t sequence;
+  char pad[WRWP_SHM_FIELDS_OFFSET - 48];
+  char fields[WRWP_SHM_HEADER_SIZE - WRWP_SHM_FIELDS_OFFSET];
+} WrwpShmInternal_Header;
+
+/**
+ * Represents a mapped segment
+ */
+struct _WrwpShm_t
+{
+  RAVE_OBJECT_HEAD /** Always on top */
+  unsigned char* map;                     /**< the mapped segment, NULL if not mapped */
+  size_t mapSize;                         /**< size of the mapping [bytes] */
+  int writable;                           /**< if the segment was created for publishing */
+  int column[WrwpResultField_COUNT];      /**< column of each field in a slot, -1 if the field not is published */
+  WrwpResultField fields[WrwpResultField_COUNT]; /**< the field of each column */
+  int nfields;                            /**< number of published fields */
+  char names[WRWP_SHM_HEADER_SIZE];       /**< the published fields, comma separated */
+};
+
+/*@{ Private functions */
+/**
+ * Constructor
+ */
+static int WrwpShm_constructor(RaveCoreObject* obj)
+{
+  WrwpShm_t* shm = (WrwpShm_t*)obj;
+  int i = 0;
+  shm->map = NULL;
+  shm->mapSize = 0;
+  shm->writable = 0;
+  shm->nfields = 0;
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    shm->column[i] = -1;
+  }
+  shm->names[0] = '\0';
+  return 1;
+}
+
+/**
+ * Destructor
+ */
+static void WrwpShm_destructor(RaveCoreObject* obj)
+{
+  WrwpShm_close((WrwpShm_t*)obj);
+}
+
+/**
+ * Returns the header of the mapped segment
+ */
+static WrwpShmInternal_Header* WrwpShmInternal_header(WrwpShm_t* self)
+{
+  return (WrwpShmInternal_Header*)self->map;
+}
+
+/**
+ * Returns the slot of a profile
+ * @param[in] self - self
+ * @param[in] sequence - the sequence of the profile, > 0
+ * @returns the slot
+ */
+static unsigned char* WrwpShmInternal_slot(WrwpShm_t* self, unsigned long long sequence)
+{
+  WrwpShmInternal_Header* header = WrwpShmInternal_header(self);
+  return self->map + WRWP_SHM_HEADER_SIZE + header->slotSize * (sequence % (uint64_t)header->nslots);
+}
+
+/**
+ * Writes the segment name with a leading / into name
+ * @returns 1 on success, 0 if the name is missing or too long
+ */
+static int WrwpShmInternal_getName(const char* name, char* result)
+{
+  if (name == NULL || name[0] == '\0' ||
+      snprintf(result, WRWP_SHM_NAME_LENGTH, "%s%s", name[0] == '/' ? "" : "/", name) >= WRWP_SHM_NAME_LENGTH) {
+    RAVE_ERROR0("Missing or too long shared memory name");
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Sets the published fields from a comma separated list of field names
+ * @param[in] self - self
+ * @param[in] fields - the field names
+ * @returns 1 on success, 0 if a field is unknown, repeated or the list is empty
+ */
+static int WrwpShmInternal_setFields(WrwpShm_t* self, const char* fields)
+{
+  const char* p = fields;
+  int i = 0;
+
+  self->nfields = 0;
+  self->names[0] = '\0';
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    self->column[i] = -1;
+  }
+  while (p != NULL && *p != '\0') {
+    size_t len = strcspn(p, ",");
+    WrwpResultField found = WrwpResult_getFieldByName(p, len);
+    if (found == WrwpResultField_COUNT || self->column[found] >= 0) {
+      RAVE_ERROR1("Unknown or repeated field in shared memory ring: %s", p);
+      return 0;
+    }
+    self->column[found] = self->nfields;
+    self->fields[self->nfields++] = found;
+    if (self->names[0] != '\0') {
+      strcat(self->names, ",");
+    }
+    strcat(self->names, WrwpResult_getFieldName(found));
+    p += len;
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return (self->nfields > 0);
+}
+
+/**
+ * Maps a segment
+ * @param[in] self - self
+ * @param[in] fd - the shared memory object
+ * @param[in] size - the size to map
+ * @param[in] writable - if the mapping should be writable
+ * @returns 1 on success, 0 on failure
+ */
+static int WrwpShmInternal_map(WrwpShm_t* self, int fd, size_t size, int writable)
+{
+  void* map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    RAVE_ERROR1("Failed to map shared memory: %s", strerror(errno));
+    return 0;
+  }
+  self->map = map;
+  self->mapSize = size;
+  self->writable = writable;
+  return 1;
+}
+
+/**
+ * Returns if the header of the mapped segment is valid and matches the size of the mapping
+ */
+static int WrwpShmInternal_isValidHeader(WrwpShm_t* self)
+{
+  WrwpShmInternal_Header* header = WrwpShmInternal_header(self);
+  return (memcmp(header->magic, WRWP_SHM_MAGIC, 8) == 0 && header->version == WRWP_SHM_VERSION &&
+          header->levels > 0 && header->interval > 0 && header->nfields > 0 && header->nslots > 0 &&
+          header->slotSize == 2 * sizeof(uint64_t) + sizeof(double) * (size_t)header->levels * header->nfields &&
+          WRWP_SHM_HEADER_SIZE + header->slotSize * (size_t)header->nslots <= self->mapSize &&
+          memchr(header->fields, '\0', sizeof(header->fields)) != NULL);
+}
+/*@} End of Private functions */
+
+/*@{ Interface functions */
+int WrwpShm_create(WrwpShm_t* self, const char* name, int levels, int interval, const char* fields, int nslots)
+{
+  char shmname[WRWP_SHM_NAME_LENGTH];
+  WrwpShmInternal_Header* header = NULL;
+  struct stat st;
+  size_t slotSize = 0, size = 0;
+  int fd = -1, result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  WrwpShm_close(self);
+
+  if (!WrwpShmInternal_getName(name, shmname)) {
+    return 0;
+  }
+  if (levels <= 0 || interval <= 0 || nslots <= 0 || fields == NULL ||
+      strlen(fields) >= WRWP_SHM_HEADER_SIZE - WRWP_SHM_FIELDS_OFFSET) {
+    RAVE_ERROR0("A shared memory ring needs a positive number of levels, interval and slots and the fields");
+    return 0;
+  }
+  if (!WrwpShmInternal_setFields(self, fields)) {
+    return 0;
+  }
+  slotSize = 2 * sizeof(uint64_t) + sizeof(double) * (size_t)levels * self->nfields;
+  size = WRWP_SHM_HEADER_SIZE + slotSize * (size_t)nslots;
+
+  fd = shm_open(shmname, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    RAVE_ERROR2("Failed to open shared memory %s: %s", shmname, strerror(errno));
+    return 0;
+  }
+  if (fstat(fd, &st) != 0 || ((size_t)st.st_size != size && ftruncate(fd, (off_t)size) != 0)) {
+    RAVE_ERROR2("Failed to size shared memory %s: %s", shmname, strerror(errno));
+    goto done;
+  }
+  if (!WrwpShmInternal_map(self, fd, size, 1)) {
+    goto done;
+  }
+  header = WrwpShmInternal_header(self);
+  if ((size_t)st.st_size != size || !WrwpShmInternal_isValidHeader(self) || header->levels != levels ||
+      header->interval != interval || header->nslots != nslots || strcmp(header->fields, self->names) != 0) {
+    /* A new segment or another layout, the magic is written last so that readers never see a partial header */
+    memset(self->map, 0, size);
+    header->version = WRWP_SHM_VERSION;
+    header->levels = levels;
+    header->interval = interval;
+    header->nfields = self->nfields;
+    header->nslots = nslots;
+    header->slotSize = slotSize;
+    strcpy(header->fields, self->names);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, WRWP_SHM_MAGIC, 8);
+  }
+  result = 1;
+done:
+  if (!result) {
+    WrwpShm_close(self);
+  }
+  close(fd);
+  return result;
+}
+
+int WrwpShm_attach(WrwpShm_t* self, const char* name)
+{
+  char shmname[WRWP_SHM_NAME_LENGTH];
+  struct stat st;
+  int fd = -1, result = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  WrwpShm_close(self);
+
+  if (!WrwpShmInternal_getName(name, shmname)) {
+    return 0;
+  }
+  fd = shm_open(shmname, O_RDONLY, 0);
+  if (fd < 0) {
+    RAVE_ERROR2("Failed to open shared memory %s: %s", shmname, strerror(errno));
+    return 0;
+  }
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < WRWP_SHM_HEADER_SIZE) {
+    RAVE_ERROR1("Shared memory %s is not a wrwp ring", shmname);
+    goto done;
+  }
+  if (!WrwpShmInternal_map(self, fd, (size_t)st.st_size, 0)) {
+    goto done;
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (!WrwpShmInternal_isValidHeader(self) ||
+      !WrwpShmInternal_setFields(self, WrwpShmInternal_header(self)->fields) ||
+      self->nfields != WrwpShmInternal_header(self)->nfields) {
+    RAVE_ERROR1("Shared memory %s is not a wrwp ring or has an unsupported version", shmname);
+    goto done;
+  }
+  result = 1;
+done:
+  if (!result) {
+    WrwpShm_close(self);
+  }
+  close(fd);
+  return result;
+}
+
+void WrwpShm_close(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (self->map != NULL) {
+    munmap(self->map, self->mapSize);
+    self->map = NULL;
+    self->mapSize = 0;
+  }
+  self->writable = 0;
+}
+
+int WrwpShm_unlink(const char* name)
+{
+  char shmname[WRWP_SHM_NAME_LENGTH];
+  if (!WrwpShmInternal_getName(name, shmname)) {
+    return 0;
+  }
+  if (shm_unlink(shmname) != 0) {
+    RAVE_ERROR2("Failed to remove shared memory %s: %s", shmname, strerror(errno));
+    return 0;
+  }
+  return 1;
+}
+
+int WrwpShm_getLevels(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return (self->map != NULL) ? WrwpShmInternal_header(self)->levels : 0;
+}
+
+int WrwpShm_getInterval(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return (self->map != NULL) ? WrwpShmInternal_header(self)->interval : 0;
+}
+
+int WrwpShm_getNumberOfSlots(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return (self->map != NULL) ? WrwpShmInternal_header(self)->nslots : 0;
+}
+
+const char* WrwpShm_getFields(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return self->names;
+}
+
+int WrwpShm_hasField(WrwpShm_t* self, WrwpResultField field)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  return (self->map != NULL && field >= 0 && field < WrwpResultField_COUNT && self->column[field] >= 0);
+}
+
+unsigned long long WrwpShm_publish(WrwpShm_t* self, WrwpResult_t* result)
+{
+  WrwpShmInternal_Header* header = NULL;
+  unsigned char* slot = NULL;
+  uint64_t sequence = 0;
+  int64_t t64 = 0;
+  long long t = 0;
+  int i = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((result != NULL), "result == NULL");
+
+  if (self->map == NULL || !self->writable) {
+    RAVE_ERROR0("The shared memory ring is not created for publishing");
+    return 0;
+  }
+  header = WrwpShmInternal_header(self);
+  if (WrwpResult_getLevels(result) != header->levels || WrwpResult_getInterval(result) != header->interval) {
+    RAVE_ERROR0("The profile does not have the levels and interval of the shared memory ring");
+    return 0;
+  }
+  for (i = 0; i < self->nfields; i++) {
+    if (!WrwpResult_hasField(result, self->fields[i])) {
+      RAVE_ERROR1("The profile does not have the published field %s", WrwpResult_getFieldName(self->fields[i]));
+      return 0;
+    }
+  }
+  if (!WrwpResult_getEndTimeStamp(result, &t)) {
+    RAVE_ERROR0("The profile must have a valid end date/time");
+    return 0;
+  }
+
+  /* The slot is marked as being written before the values are overwritten and gets the new sequence
+     when they are complete, a reader compares the sequence of the slot before and after reading */
+  sequence = __atomic_load_n(&header->sequence, __ATOMIC_RELAXED) + 1;
+  slot = WrwpShmInternal_slot(self, sequence);
+  __atomic_store_n((uint64_t*)slot, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  t64 = (int64_t)t;
+  memcpy(slot + sizeof(uint64_t), &t64, sizeof(t64));
+  for (i = 0; i < self->nfields; i++) {
+    memcpy(slot + 2 * sizeof(uint64_t) + sizeof(double) * (size_t)header->levels * i,
+           WrwpResult_getData(result, self->fields[i]), sizeof(double) * header->levels);
+  }
+  __atomic_store_n((uint64_t*)slot, sequence, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->sequence, sequence, __ATOMIC_RELEASE);
+  return (unsigned long long)sequence;
+}
+
+unsigned long long WrwpShm_getSequence(WrwpShm_t* self)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (self->map == NULL) {
+    return 0;
+  }
+  return (unsigned long long)__atomic_load_n(&WrwpShmInternal_header(self)->sequence, __ATOMIC_ACQUIRE);
+}
+
+const double* WrwpShm_getData(WrwpShm_t* self, unsigned long long sequence, WrwpResultField field)
+{
+  unsigned char* slot = NULL;
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (!WrwpShm_hasField(self, field) || sequence == 0 || !WrwpShm_isValid(self, sequence)) {
+    return NULL;
+  }
+  slot = WrwpShmInternal_slot(self, sequence);
+  return (const double*)(slot + 2 * sizeof(uint64_t) + sizeof(double) * (size_t)WrwpShmInternal_header(self)->levels * self->column[field]);
+}
+
+int WrwpShm_isValid(WrwpShm_t* self, unsigned long long sequence)
+{
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  if (self->map == NULL || sequence == 0) {
+    return 0;
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (__atomic_load_n((uint64_t*)WrwpShmInternal_slot(self, sequence), __ATOMIC_ACQUIRE) == sequence);
+}
+
+int WrwpShm_read(WrwpShm_t* self, unsigned long long sequence, WrwpResultField field, double* data, long long* t)
+{
+  const double* values = NULL;
+  int64_t t64 = 0;
+
+  RAVE_ASSERT((self != NULL), "self == NULL");
+  RAVE_ASSERT((data != NULL), "data == NULL");
+
+  values = WrwpShm_getData(self, sequence, field);
+  if (values == NULL) {
+    return 0;
+  }
+  memcpy(data, values, sizeof(double) * WrwpShmInternal_header(self)->levels);
+  memcpy(&t64, WrwpShmInternal_slot(self, sequence) + sizeof(uint64_t), sizeof(t64));
+  if (!WrwpShm_isValid(self, sequence)) {
+    return 0;
+  }
+  if (t != NULL) {
+    *t = (long long)t64;
+  }
+  return 1;
+}
+/*@} End of Interface functions */
+
+RaveCoreObjectType WrwpShm_TYPE = {
+    "WrwpShm",
+    sizeof(WrwpShm_t),
+    WrwpShm_constructor,
+    WrwpShm_destructor
+};
@@ -0,0 +1,178 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Ring buffer of the latest profiles in POSIX shared memory, one segment per radar, e.g. /wrwp_seang.
+ *
+ * One process publishes and any number of local processes read. The segment is laid out as
+ * (native byte order, offsets in bytes):
+ * <pre>
+ *   0  char[8]   magic "WRWPRING"
+ *   8  int32     version, 1
+ *  12  int32     levels
+ *  16  int32     interval [m]
+ *  20  int32     nfields
+ *  24  int32     nslots
+ *  28  int32     reserved
+ *  32  uint64    slot size [bytes]
+ *  40  uint64    sequence of the latest published profile, 0 if none
+ *  64  char[192] the fields, comma separated and nul terminated
+ * 256  the slots, profile n is in slot n % nslots:
+ *        uint64  sequence of the profile in the slot, 0 while it is written
+ *        int64   end time YYYYMMDDHHMMSS
+ *        double  one column of levels values for each field
+ * </pre>
+ * A reader loads the latest sequence n, reads slot n % nslots and then checks that the sequence of the
+ * slot still is n. If not, the profile was overwritten while it was read (the reader was lapped by
+ * nslots publications) and the read fails.
+ * @file
+ * @date 2026-10-18
+ */
+#ifndef WRWP_SHM_H
+#define WRWP_SHM_H
+#include "wrwp.h"
+
+/**
+ * Size of the segment header [bytes]
+ */
+#define WRWP_SHM_HEADER_SIZE 256
+
+/**
+ * Defines a shared memory ring of profiles, either the publishing or a reading side
+ */
+typedef struct _WrwpShm_t WrwpShm_t;
+
+/**
+ * Type definition to use when creating a rave object.
+ */
+extern RaveCoreObjectType WrwpShm_TYPE;
+
+/**
+ * Creates the segment for publishing or opens it if it already exists with the same layout, in which
+ * case the sequence continues from the last published profile.
+ * @param[in] self - self
+ * @param[in] name - the name of the segment, a leading / is added if missing
+ * @param[in] levels - number of layers of the profiles
+ * @param[in] interval - height interval of the layers [m]
+ * @param[in] fields - comma separated list of the published fields, see \ref WrwpResult_getFieldName
+ * @param[in] nslots - number of profiles kept in the ring
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpShm_create(WrwpShm_t* self, const char* name, int levels, int interval, const char* fields, int nslots);
+
+/**
+ * Attaches to an existing segment for reading
+ * @param[in] self - self
+ * @param[in] name - the name of the segment, a leading / is added if missing
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpShm_attach(WrwpShm_t* self, const char* name);
+
+/**
+ * Unmaps the segment, also done when the object is released. The segment itself is kept.
+ * @param[in] self - self
+ */
+void WrwpShm_close(WrwpShm_t* self);
+
+/**
+ * Removes the segment, mapped segments stay valid until they are closed.
+ * @param[in] name - the name of the segment, a leading / is added if missing
+ * @returns 1 on success, 0 on failure
+ */
+int WrwpShm_unlink(const char* name);
+
+/**
+ * Returns the number of layers of the profiles
+ * @param[in] self - self
+ * @returns the number of layers
+ */
+int WrwpShm_getLevels(WrwpShm_t* self);
+
+/**
+ * Returns the height interval of the layers [m]
+ * @param[in] self - self
+ * @returns the height interval
+ */
+int WrwpShm_getInterval(WrwpShm_t* self);
+
+/**
+ * Returns the number of profiles kept in the ring
+ * @param[in] self - self
+ * @returns the number of slots
+ */
+int WrwpShm_getNumberOfSlots(WrwpShm_t* self);
+
+/**
+ * Returns the published fields as a comma separated list, can be used as fieldsToGenerate
+ * @param[in] self - self
+ * @returns the fields, owned by the object
+ */
+const char* WrwpShm_getFields(WrwpShm_t* self);
+
+/**
+ * Returns if the field is published
+ * @param[in] self - self
+ * @param[in] field - the field
+ * @returns 1 if the field is published, otherwise 0
+ */
+int WrwpShm_hasField(WrwpShm_t* self, WrwpResultField field);
+
+/**
+ * Publishes a profile in the next slot. The result must have the same levels and interval as the
+ * segment and all the published fields.
+ * @param[in] self - self, created with \ref WrwpShm_create
+ * @param[in] result - the result
+ * @returns the sequence of the published profile or 0 on failure
+ */
+unsigned long long WrwpShm_publish(WrwpShm_t* self, WrwpResult_t* result);
+
+/**
+ * Returns the sequence of the latest published profile
+ * @param[in] self - self
+ * @returns the sequence, 0 if nothing has been published
+ */
+unsigned long long WrwpShm_getSequence(WrwpShm_t* self);
+
+/**
+ * Copies a field of a published profile
+ * @param[in] self - self
+ * @param[in] sequence - the sequence of the profile
+ * @param[in] field - the field
+ * @param[out] data - the values, levels entries
+ * @param[out] t - the end time YYYYMMDDHHMMSS of the profile, may be NULL
+ * @returns 1 on success, 0 if the profile is not (or no longer) in the ring or the field is not published
+ */
+int WrwpShm_read(WrwpShm_t* self, unsigned long long sequence, WrwpResultField field, double* data, long long* t);
+
+/**
+ * Returns a field of a published profile without copying it. The values may be overwritten at any time
+ * by the publisher, so \ref WrwpShm_isValid must be checked after they have been used.
+ * @param[in] self - self
+ * @param[in] sequence - the sequence of the profile
+ * @param[in] field - the field
+ * @returns the levels values in the shared memory or NULL if the profile is not in the ring or the field is not published
+ */
+const double* WrwpShm_getData(WrwpShm_t* self, unsigned long long sequence, WrwpResultField field);
+
+/**
+ * Returns if a profile still is in the ring, i.e. if what was read from it by \ref WrwpShm_getData is consistent
+ * @param[in] self - self
+ * @param[in] sequence - the sequence of the profile
+ * @returns 1 if the profile is in the ring, otherwise 0
+ */
+int WrwpShm_isValid(WrwpShm_t* self, unsigned long long sequence);
+
+#endif
@@ -0,0 +1,413 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Accumulation of the normal equations with explicit SIMD kernels that are selected at runtime.
+ * All kernels keep 8 partial sums per term and perform the same multiplications and additions
+ * in the same order, this file must therefore be compiled without floating point contraction
+ * (-ffp-contract=off) so that no fused multiply-add is introduced on some of the paths.
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define WRWP_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define WRWP_SIMD_X86 0
+#endif
+
+/**
+ * Number of partial sums per term
+ */
+#define WRWP_SIMD_LANES WRWP_KERNEL_LANES
+
+/**
+ * Number of accumulated terms, the 6 terms of AtA, the 3 terms of Atb and btb
+ */
+#define WRWP_SIMD_TERMS WRWP_KERNEL_TERMS
+
+/**
+ * Number of samples converted at a time for single precision input
+ */
+#define WRWP_SIMD_CHUNK 512
+
+/**
+ * The partial sums, lanes[t][k] is the sum of term t for the samples with index i % 8 == k
+ */
+typedef WrwpNormalLanes WrwpSimdLanes;
+
+typedef void (*WrwpSimdAccumulator)(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L);
+
+/**
+ * The instruction set forced by WrwpKernel_setInstructionSet, AUTO if not forced.
+ */
+static int wrwpSimdForced = WrwpKernelInstructionSet_AUTO;
+
+/**
+ * The best instruction set supported by the cpu, -2 until it has been detected.
+ */
+static int wrwpSimdDetected = -2;
+
+/**
+ * Adds the samples from index start to n to the lanes, one sample at a time. Sample i goes to
+ * lane (base + i) % 8.
+ */
+static void WrwpSimd_scalarRange(int start, int n, long base, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L)
+{
+  int i = 0;
+  for (i = start; i < n; i++) {
+    int k = (int)((base + i) & (WRWP_SIMD_LANES - 1));
+    double x = a0[i], y = a1[i], z = (a2 != NULL) ? a2[i] : 1.0, w = b[i];
+    L->lanes[0][k] += x * x;
+    L->lanes[1][k] += x * y;
+    L->lanes[2][k] += x * z;
+    L->lanes[3][k] += y * y;
+    L->lanes[4][k] += y * z;
+    L->lanes[5][k] += z * z;
+    L->lanes[6][k] += x * w;
+    L->lanes[7][k] += y * w;
+    L->lanes[8][k] += z * w;
+    L->lanes[9][k] += w * w;
+  }
+}
+
+static void WrwpSimd_scalar(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L)
+{
+  WrwpSimd_scalarRange(0, n, 0, a0, a1, a2, b, L);
+}
+
+#if WRWP_SIMD_X86
+__attribute__((target("sse2")))
+static void WrwpSimd_sse2(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L)
+{
+  __m128d acc[WRWP_SIMD_TERMS][4];
+  const __m128d one = _mm_set1_pd(1.0);
+  int i = 0, t = 0, j = 0, nfull = n - (n % WRWP_SIMD_LANES);
+
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    for (j = 0; j < 4; j++) {
+      acc[t][j] = _mm_loadu_pd(&L->lanes[t][2*j]);
+    }
+  }
+  for (i = 0; i < nfull; i += WRWP_SIMD_LANES) {
+    for (j = 0; j < 4; j++) {
+      __m128d x = _mm_loadu_pd(a0 + i + 2*j);
+      __m128d y = _mm_loadu_pd(a1 + i + 2*j);
+      __m128d z = (a2 != NULL) ? _mm_loadu_pd(a2 + i + 2*j) : one;
+      __m128d w = _mm_loadu_pd(b + i + 2*j);
+      acc[0][j] = _mm_add_pd(acc[0][j], _mm_mul_pd(x, x));
+      acc[1][j] = _mm_add_pd(acc[1][j], _mm_mul_pd(x, y));
+      acc[2][j] = _mm_add_pd(acc[2][j], _mm_mul_pd(x, z));
+      acc[3][j] = _mm_add_pd(acc[3][j], _mm_mul_pd(y, y));
+      acc[4][j] = _mm_add_pd(acc[4][j], _mm_mul_pd(y, z));
+      acc[5][j] = _mm_add_pd(acc[5][j], _mm_mul_pd(z, z));
+      acc[6][j] = _mm_add_pd(acc[6][j], _mm_mul_pd(x, w));
+      acc[7][j] = _mm_add_pd(acc[7][j], _mm_mul_pd(y, w));
+      acc[8][j] = _mm_add_pd(acc[8][j], _mm_mul_pd(z, w));
+      acc[9][j] = _mm_add_pd(acc[9][j], _mm_mul_pd(w, w));
+    }
+  }
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    for (j = 0; j < 4; j++) {
+      _mm_storeu_pd(&L->lanes[t][2*j], acc[t][j]);
+    }
+  }
+  WrwpSimd_scalarRange(nfull, n, 0, a0, a1, a2, b, L);
+}
+
+__attribute__((target("avx2")))
+static void WrwpSimd_avx2(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L)
+{
+  __m256d acc[WRWP_SIMD_TERMS][2];
+  const __m256d one = _mm256_set1_pd(1.0);
+  int i = 0, t = 0, j = 0, nfull = n - (n % WRWP_SIMD_LANES);
+
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    for (j = 0; j < 2; j++) {
+      acc[t][j] = _mm256_loadu_pd(&L->lanes[t][4*j]);
+    }
+  }
+  for (i = 0; i < nfull; i += WRWP_SIMD_LANES) {
+    for (j = 0; j < 2; j++) {
+      __m256d x = _mm256_loadu_pd(a0 + i + 4*j);
+      __m256d y = _mm256_loadu_pd(a1 + i + 4*j);
+      __m256d z = (a2 != NULL) ? _mm256_loadu_pd(a2 + i + 4*j) : one;
+      __m256d w = _mm256_loadu_pd(b + i + 4*j);
+      acc[0][j] = _mm256_add_pd(acc[0][j], _mm256_mul_pd(x, x));
+      acc[1][j] = _mm256_add_pd(acc[1][j], _mm256_mul_pd(x, y));
+      acc[2][j] = _mm256_add_pd(acc[2][j], _mm256_mul_pd(x, z));
+      acc[3][j] = _mm256_add_pd(acc[3][j], _mm256_mul_pd(y, y));
+      acc[4][j] = _mm256_add_pd(acc[4][j], _mm256_mul_pd(y, z));
+      acc[5][j] = _mm256_add_pd(acc[5][j], _mm256_mul_pd(z, z));
+      acc[6][j] = _mm256_add_pd(acc[6][j], _mm256_mul_pd(x, w));
+      acc[7][j] = _mm256_add_pd(acc[7][j], _mm256_mul_pd(y, w));
+      acc[8][j] = _mm256_add_pd(acc[8][j], _mm256_mul_pd(z, w));
+      acc[9][j] = _mm256_add_pd(acc[9][j], _mm256_mul_pd(w, w));
+    }
+  }
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    for (j = 0; j < 2; j++) {
+      _mm256_storeu_pd(&L->lanes[t][4*j], acc[t][j]);
+    }
+  }
+  WrwpSimd_scalarRange(nfull, n, 0, a0, a1, a2, b, L);
+}
+
+__attribute__((target("avx512f")))
+static void WrwpSimd_avx512(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpSimdLanes* L)
+{
+  __m512d acc[WRWP_SIMD_TERMS];
+  const __m512d one = _mm512_set1_pd(1.0);
+  int i = 0, t = 0, nfull = n - (n % WRWP_SIMD_LANES);
+
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    acc[t] = _mm512_loadu_pd(&L->lanes[t][0]);
+  }
+  for (i = 0; i < nfull; i += WRWP_SIMD_LANES) {
+    __m512d x = _mm512_loadu_pd(a0 + i);
+    __m512d y = _mm512_loadu_pd(a1 + i);
+    __m512d z = (a2 != NULL) ? _mm512_loadu_pd(a2 + i) : one;
+    __m512d w = _mm512_loadu_pd(b + i);
+    acc[0] = _mm512_add_pd(acc[0], _mm512_mul_pd(x, x));
+    acc[1] = _mm512_add_pd(acc[1], _mm512_mul_pd(x, y));
+    acc[2] = _mm512_add_pd(acc[2], _mm512_mul_pd(x, z));
+    acc[3] = _mm512_add_pd(acc[3], _mm512_mul_pd(y, y));
+    acc[4] = _mm512_add_pd(acc[4], _mm512_mul_pd(y, z));
+    acc[5] = _mm512_add_pd(acc[5], _mm512_mul_pd(z, z));
+    acc[6] = _mm512_add_pd(acc[6], _mm512_mul_pd(x, w));
+    acc[7] = _mm512_add_pd(acc[7], _mm512_mul_pd(y, w));
+    acc[8] = _mm512_add_pd(acc[8], _mm512_mul_pd(z, w));
+    acc[9] = _mm512_add_pd(acc[9], _mm512_mul_pd(w, w));
+  }
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    _mm512_storeu_pd(&L->lanes[t][0], acc[t]);
+  }
+  WrwpSimd_scalarRange(nfull, n, 0, a0, a1, a2, b, L);
+}
+#endif
+
+/**
+ * Detects the best instruction set supported by the cpu
+ */
+static int WrwpSimd_detect(void)
+{
+  int result = __atomic_load_n(&wrwpSimdDetected, __ATOMIC_RELAXED);
+  if (result == -2) {
+    result = WrwpKernelInstructionSet_SCALAR;
+#if WRWP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      result = WrwpKernelInstructionSet_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+      result = WrwpKernelInstructionSet_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+      result = WrwpKernelInstructionSet_SSE2;
+    }
+#endif
+    __atomic_store_n(&wrwpSimdDetected, result, __ATOMIC_RELAXED);
+  }
+  return result;
+}
+
+static WrwpSimdAccumulator WrwpSimd_getAccumulator(void)
+{
+#if WRWP_SIMD_X86
+  switch (WrwpKernel_getInstructionSet()) {
+  case WrwpKernelInstructionSet_AVX512:
+    return WrwpSimd_avx512;
+  case WrwpKernelInstructionSet_AVX2:
+    return WrwpSimd_avx2;
+  case WrwpKernelInstructionSet_SSE2:
+    return WrwpSimd_sse2;
+  default:
+    break;
+  }
+#endif
+  return WrwpSimd_scalar;
+}
+
+int WrwpKernel_isInstructionSetSupported(WrwpKernelInstructionSet isa)
+{
+  if (isa == WrwpKernelInstructionSet_AUTO || isa == WrwpKernelInstructionSet_SCALAR) {
+    return 1;
+  }
+  return (isa > WrwpKernelInstructionSet_SCALAR && isa <= WrwpSimd_detect()) ? 1 : 0;
+}
+
+int WrwpKernel_setInstructionSet(WrwpKernelInstructionSet isa)
+{
+  if (!WrwpKernel_isInstructionSetSupported(isa)) {
+    return 0;
+  }
+  __atomic_store_n(&wrwpSimdForced, (int)isa, __ATOMIC_RELAXED);
+  return 1;
+}
+
+WrwpKernelInstructionSet WrwpKernel_getInstructionSet(void)
+{
+  int isa = __atomic_load_n(&wrwpSimdForced, __ATOMIC_RELAXED);
+  if (isa == WrwpKernelInstructionSet_AUTO) {
+    isa = WrwpSimd_detect();
+  }
+  return (WrwpKernelInstructionSet)isa;
+}
+
+const char* WrwpKernel_getInstructionSetName(WrwpKernelInstructionSet isa)
+{
+  switch (isa) {
+  case WrwpKernelInstructionSet_AUTO:
+    return "AUTO";
+  case WrwpKernelInstructionSet_SCALAR:
+    return "SCALAR";
+  case WrwpKernelInstructionSet_SSE2:
+    return "SSE2";
+  case WrwpKernelInstructionSet_AVX2:
+    return "AVX2";
+  case WrwpKernelInstructionSet_AVX512:
+    return "AVX512";
+  }
+  return "UNKNOWN";
+}
+
+void WrwpKernel_initNormalLanes(WrwpNormalLanes* lanes)
+{
+  memset(lanes, 0, sizeof(WrwpNormalLanes));
+}
+
+void WrwpKernel_addToNormalLanes(WrwpNormalLanes* lanes, int n, const double* a0, const double* a1, const double* a2, const double* b)
+{
+  int head = 0;
+  if (n <= 0) {
+    return;
+  }
+  /* Samples are added one at a time until the next sample goes to the first lane, the rest is
+   * handled by the selected kernel that always starts in the first lane. */
+  head = (int)((WRWP_SIMD_LANES - (lanes->count & (WRWP_SIMD_LANES - 1))) & (WRWP_SIMD_LANES - 1));
+  if (head > n) {
+    head = n;
+  }
+  WrwpSimd_scalarRange(0, head, lanes->count, a0, a1, a2, b, lanes);
+  if (n > head) {
+    WrwpSimd_getAccumulator()(n - head, a0 + head, a1 + head, (a2 != NULL) ? a2 + head : NULL, b + head, lanes);
+  }
+  lanes->count += n;
+}
+
+void WrwpKernel_addToNormalLanesFloat(WrwpNormalLanes* lanes, int n, const float* a0, const float* a1, const float* a2, const float* b)
+{
+  double x[WRWP_SIMD_CHUNK], y[WRWP_SIMD_CHUNK], z[WRWP_SIMD_CHUNK], w[WRWP_SIMD_CHUNK];
+  int start = 0, i = 0;
+
+  for (start = 0; start < n; start += WRWP_SIMD_CHUNK) {
+    int len = (n - start < WRWP_SIMD_CHUNK) ? n - start : WRWP_SIMD_CHUNK;
+    for (i = 0; i < len; i++) {
+      x[i] = a0[start + i];
+      y[i] = a1[start + i];
+      w[i] = b[start + i];
+    }
+    if (a2 != NULL) {
+      for (i = 0; i < len; i++) {
+        z[i] = a2[start + i];
+      }
+    }
+    WrwpKernel_addToNormalLanes(lanes, len, x, y, (a2 != NULL) ? z : NULL, w);
+  }
+}
+
+void WrwpKernel_reduceNormalLanes(const WrwpNormalLanes* lanes, WrwpNormalEquations* ne)
+{
+  double sums[WRWP_SIMD_TERMS];
+  int t = 0;
+  for (t = 0; t < WRWP_SIMD_TERMS; t++) {
+    const double* l = lanes->lanes[t];
+    sums[t] = ((l[0] + l[1]) + (l[2] + l[3])) + ((l[4] + l[5]) + (l[6] + l[7]));
+  }
+  ne->n += lanes->count;
+  for (t = 0; t < 6; t++) {
+    ne->aa[t] += sums[t];
+  }
+  for (t = 0; t < 3; t++) {
+    ne->ab[t] += sums[6 + t];
+  }
+  ne->bb += sums[9];
+}
+
+void WrwpKernel_accumulateNormalEquations(int n, const double* a0, const double* a1, const double* a2, const double* b, WrwpNormalEquations* ne)
+{
+  WrwpNormalLanes L;
+  if (n <= 0) {
+    return;
+  }
+  WrwpKernel_initNormalLanes(&L);
+  WrwpKernel_addToNormalLanes(&L, n, a0, a1, a2, b);
+  WrwpKernel_reduceNormalLanes(&L, ne);
+}
+
+void WrwpKernel_accumulateNormalEquationsFloat(int n, const float* a0, const float* a1, const float* a2, const float* b, WrwpNormalEquations* ne)
+{
+  WrwpNormalLanes L;
+  if (n <= 0) {
+    return;
+  }
+  WrwpKernel_initNormalLanes(&L);
+  WrwpKernel_addToNormalLanesFloat(&L, n, a0, a1, a2, b);
+  WrwpKernel_reduceNormalLanes(&L, ne);
+}
+
+int WrwpKernel_solveNormalEquations(const WrwpNormalEquations* ne, double* x, double* chisq)
+{
+  /* AtA = L Lt, the lower triangle is stored row by row */
+  double l00, l10, l11, l20, l21, l22, y0, y1, y2, d, rss;
+  const double* aa = ne->aa;
+  const double* ab = ne->ab;
+
+  if (ne->n <= 0.0 || aa[0] <= 0.0) {
+    return 0;
+  }
+  l00 = sqrt(aa[0]);
+  l10 = aa[1] / l00;
+  l20 = aa[2] / l00;
+  d = aa[3] - l10 * l10;
+  if (d <= 0.0) {
+    return 0;
+  }
+  l11 = sqrt(d);
+  l21 = (aa[4] - l20 * l10) / l11;
+  d = aa[5] - l20 * l20 - l21 * l21;
+  if (d <= 0.0) {
+    return 0;
+  }
+  l22 = sqrt(d);
+
+  y0 = ab[0] / l00;
+  y1 = (ab[1] - l10 * y0) / l11;
+  y2 = (ab[2] - l20 * y0 - l21 * y1) / l22;
+
+  x[2] = y2 / l22;
+  x[1] = (y1 - l21 * x[2]) / l11;
+  x[0] = (y0 - l10 * x[1] - l20 * x[2]) / l00;
+
+  if (chisq != NULL) {
+    /* |b - Ax|^2 = btb - 2 xtAtb + xtAtAx, with AtAx = Atb at the solution this is btb - |y|^2 */
+    rss = ne->bb - (y0 * y0 + y1 * y1 + y2 * y2);
+    *chisq = (rss > 0.0 ? rss : 0.0) / ne->n;
+  }
+  return 1;
+}
@@ -53,6 +53,7 @@ import _wrwp
 import _rave
 import _raveio
 import _polarvolume
+import _polarscan
 import string
 import logging
 import rave_pgf_logger
@@ -62,6 +63,12 @@ import math
 import os
 import sys
 import fnmatch
+import threading
+import hashlib
+import shutil
+import tempfile
+import atexit
+import collections
 import xml.etree.cElementTree as ET    
 from rave_defines import CENTER_ID, GAIN, OFFSET
 from rave_defines import RAVE_IO_DEFAULT_VERSION
@@ -78,6 +85,72 @@ try:
 except:
   logger.exception("Failed to initialize rave db")
 
+# Maximum number of profiles kept by the result cache, 0 disables it
+WRWP_CACHE_SIZE=int(os.environ.get("WRWP_CACHE_SIZE", "64"))
+
+## Local cache of generated profiles with least recently used eviction. The beast may trigger the generation
+# several times for the same volume, e.g. for re-sent files and overlapping routes, the repeated requests are
+# then answered with a copy of the cached profile instead of generating it again.
+class ResultCache(object):
+  ## Constructor
+  #@param size the maximum number of profiles
+  def __init__(self, size):
+    self.size = size
+    self.lock = threading.Lock()
+    self.entries = collections.OrderedDict()
+    self.directory = None
+
+  ## Returns the key of a volume and the effective parameters
+  #@param objs the loaded volume, see load_volume
+  #@param wrwp the generator, all its settings() are part of the key
+  #@param method the method
+  #@param fields the fields
+  #@return the key
+  def key(self, objs, wrwp, method, fields):
+    h = hashlib.sha1()
+    h.update(("%s;%s;"%(method, fields)).encode("utf-8"))
+    h.update(";".join("%s=%s"%(name, value) for name, value in sorted(wrwp.settings().items())).encode("utf-8"))
+    for obj in objs:
+      scans = [obj.getScan(i) for i in range(obj.getNumberOfScans())] if _polarvolume.isPolarVolume(obj) else [obj]
+      h.update(("%s;%s;%s;"%(obj.source, obj.date, obj.time)).encode("utf-8"))
+      for scan in scans:
+        h.update(("%s;%s;%s;"%(scan.elangle, scan.startdate, scan.starttime)).encode("utf-8"))
+        for name in sorted(scan.getParameterNames()):
+          h.update(name.encode("utf-8"))
+          h.update(scan.getParameter(name).getData().tobytes())
+    return h.hexdigest()
+
+  ## Returns a copy of a cached profile
+  #@param key the key
+  #@return a new temporary h5 file or None if the profile is not cached
+  def get(self, key):
+    with self.lock:
+      if key not in self.entries:
+        return None
+      self.entries.move_to_end(key)
+      fileno, outfile = rave_tempfile.mktemp(suffix='.h5', close="True")
+      shutil.copyfile(self.entries[key], outfile)
+      return outfile
+
+  ## Adds a generated profile, the least recently used profile is evicted when the cache is full
+  #@param key the key
+  #@param outfile the generated profile, the caller keeps it
+  def put(self, key, outfile):
+    with self.lock:
+      if self.directory is None:
+        self.directory = tempfile.mkdtemp(prefix="wrwp_cache_", dir=os.path.dirname(outfile))
+        atexit.register(shutil.rmtree, self.directory, True)
+      cached = os.path.join(self.directory, key + ".h5")
+      shutil.copyfile(outfile, cached)
+      self.entries[key] = cached
+      self.entries.move_to_end(key)
+      while len(self.entries) > self.size:
+        evicted, evictedfile = self.entries.popitem(last=False)
+        if os.path.exists(evictedfile):
+          os.remove(evictedfile)
+
+resultcache = ResultCache(WRWP_CACHE_SIZE)
+
 # Locates a file (pattern) in a directory tree (path)
 def find(pattern, path):
   result = []
@@ -112,11 +185,10 @@ def strToNumber(sval):
     except ValueError:
       return float(sval)
 
-## Creates a vertical profile
-#@param files the list of files to be used for generating the vertical profile
+## Creates the generator from wrwp_config.xml and the arguments
 #@param arguments the arguments defining the vertical profile
-#@return a temporary h5 file with the vertical profile
-def generate(files, arguments):
+#@return a tuple (wrwp, method, fields) or None if no wrwp_config.xml could be found
+def create_generator(arguments):
   args = arglist2dict(arguments)
   wrwp = _wrwp.new()
   fields = None
@@ -240,32 +312,119 @@ def generate(files, arguments):
       method = WRWPMETHOD # If no method is given in the web-GUI, we build wrwp with the default method
     if fields == None:
       fields = QUANTITIES # If no fields are given in the web-GUI, we build wrwp with all the supported quantities
-    
-  if len(files) != 1:
-    raise AttributeError("Must call plugin with _one_ polar volume")
-  
-  logger.debug("Start generating vertical profile from polar volume %s"%files[0])
 
-  obj = None
-  if ravebdb != None:
-    obj = ravebdb.get_rave_object(files[0])
-  else:
-    rio = _raveio.open(files[0])
-    obj = rio.object
+  return wrwp, method, fields
+
+## Loads the files of one logical volume
+#@param files the list of files, several files are e.g. the partial volumes from EDGE based radars
+#@return the list of polar volumes/scans
+def load_volume(files):
+  if len(files) < 1:
+    raise AttributeError("Must call plugin with at least one polar volume")
+
+  objs = []
+  for f in files:
+    obj = None
+    if ravebdb != None:
+      obj = ravebdb.get_rave_object(f)
+    else:
+      rio = _raveio.open(f)
+      obj = rio.object
+
+    if not _polarvolume.isPolarVolume(obj) and not (len(files) > 1 and _polarscan.isPolarScan(obj)):
+      raise AttributeError("Must call plugin with a polar volume")
+    objs.append(obj)
+  return objs
 
-  if not _polarvolume.isPolarVolume(obj):
-    raise AttributeError("Must call plugin with a polar volume")
+## Generates the vertical profile of a loaded volume
+#@param wrwp the generator
+#@param objs the result of load_volume
+#@param method the method
+#@param fields the fields
+#@param context the execution context, None for the default one of the generator
+#@return the vertical profile
+def generate_profile(wrwp, objs, method, fields, context=None):
+  if len(objs) == 1:
+    return wrwp.generate(objs[0], method, fields, context)
+  return wrwp.generate_multi(objs, method, fields, context)
+
+## Saves a vertical profile in a temporary file
+#@param profile the vertical profile
+#@return the temporary h5 file
+def save_profile(profile):
+  fileno, outfile = rave_tempfile.mktemp(suffix='.h5', close="True")
+  ios = _raveio.new()
+  ios.object = profile
+  ios.filename = outfile
+  ios.version = RAVE_IO_DEFAULT_VERSION
+  ios.save()
+  return outfile
+
+## Creates a vertical profile
+#@param files the list of files to be used for generating the vertical profile
+#@param arguments the arguments defining the vertical profile
+#@return a temporary h5 file with the vertical profile
+def generate(files, arguments):
+  generator = create_generator(arguments)
+  if generator is None:
+    return None
+  wrwp, method, fields = generator
+
+  logger.debug("Start generating vertical profile from polar volume %s"%",".join(files))
+
+  # Several files are treated as one logical volume, e.g. the partial volumes from EDGE based radars
+  objs = load_volume(files)
+
+  key = None
+  if WRWP_CACHE_SIZE > 0:
+    key = resultcache.key(objs, wrwp, method, fields)
+    outfile = resultcache.get(key)
+    if outfile != None:
+      logger.debug("Returning cached vertical profile of polar volume %s"%",".join(files))
+      return outfile
 
   try:
-    profile = wrwp.generate(obj, method, fields)
-    fileno, outfile = rave_tempfile.mktemp(suffix='.h5', close="True")
-    ios = _raveio.new()
-    ios.object = profile
-    ios.filename = outfile
-    ios.version = RAVE_IO_DEFAULT_VERSION
-    ios.save()
-    logger.debug("Finished generating vertical profile from polar volume %s"%files[0])
+    outfile = save_profile(generate_profile(wrwp, objs, method, fields))
+    if key != None:
+      try:
+        resultcache.put(key, outfile)
+      except Exception:
+        logger.exception("Failed to cache vertical profile of polar volume %s"%",".join(files))
+    logger.debug("Finished generating vertical profile from polar volume %s"%",".join(files))
     return outfile
   except:
-    logger.info("No vertical profile could be generated from polar volume %s"%files[0])
+    logger.info("No vertical profile could be generated from polar volume %s"%",".join(files))
     return None
+
+## Creates the vertical profiles of several volumes, e.g. when reprocessing. Loading the next volumes,
+# generating on several workers and saving the finished profiles overlap, see wrwp_pipeline.
+#@param volumes a list with the list of files of each volume
+#@param arguments the arguments defining the vertical profiles, the same for all volumes
+#@param workers the number of compute workers
+#@param depth the maximum number of volumes, and profiles, waiting between two stages
+#@return a list with the temporary h5 file of each volume, None for the volumes that failed
+def generate_batch(volumes, arguments, workers=2, depth=2):
+  import wrwp_pipeline
+  generator = create_generator(arguments)
+  if generator is None:
+    return [None] * len(volumes)
+  wrwp, method, fields = generator
+  wrwp.lock()
+  local = threading.local()
+
+  def compute(index, objs):
+    if not hasattr(local, "context"):
+      local.context = _wrwp.newcontext()
+    return generate_profile(wrwp, objs, method, fields, local.context)
+
+  result = [None] * len(volumes)
+  def done(index, outfile, error):
+    if error is None:
+      result[index] = outfile
+      logger.debug("Finished generating vertical profile from polar volume %s"%",".join(volumes[index]))
+    else:
+      logger.info("No vertical profile could be generated from polar volume %s"%",".join(volumes[index]))
+
+  wrwp_pipeline.Pipeline(lambda index: load_volume(volumes[index]), compute, lambda index, profile: save_profile(profile),
+                         workers, depth).run(range(len(volumes)), done)
+  return result
@@ -32,8 +32,13 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #include "pywrwp.h"
 
 #include <pypolarvolume.h>
+#include <pypolarscan.h>
 #include <pyverticalprofile.h>
 #include "wrwp.h"
+#include "wrwp_kernels.h"
+#include "wrwp_archive.h"
+#include "wrwp_shm.h"
+#include "wrwp_image.h"
 
 #include <arrayobject.h>
 #include "pyrave_debug.h"
@@ -149,35 +154,1539 @@ static PyObject* _pywrwp_new(PyObject* self, PyObject* args)
 }
 
 
+/**
+ * Deallocates the wrwp context
+ * @param[in] obj the object to deallocate.
+ */
+static void _pywrwpcontext_dealloc(PyWrwpContext* obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+  PYRAVE_DEBUG_OBJECT_DESTROYED;
+  RAVE_OBJECT_RELEASE(obj->ctx);
+  PyObject_Del(obj);
+}
+
+/**
+ * Creates a new execution context for the wrwp generator.
+ * @param[in] self this instance.
+ * @param[in] args arguments for creation (NOT USED).
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_newcontext(PyObject* self, PyObject* args)
+{
+  PyWrwpContext* result = PyObject_NEW(PyWrwpContext, &PyWrwpContext_Type);
+  if (result == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for PyWrwpContext.");
+  }
+  PYRAVE_DEBUG_OBJECT_CREATED;
+  result->inuse = 0;
+  result->ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+  if (result->ctx == NULL) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp context.");
+  }
+  return (PyObject*)result;
+}
+
+/**
+ * Forces the instruction set used when accumulating the normal equations
+ * @param[in] self - this instance
+ * @param[in] args - the instruction set
+ * @returns None on success, otherwise NULL
+ */
+static PyObject* _pywrwp_setinstructionset(PyObject* self, PyObject* args)
+{
+  int isa = WrwpKernelInstructionSet_AUTO;
+  if (!PyArg_ParseTuple(args, "i", &isa)) {
+    return NULL;
+  }
+  if (isa < WrwpKernelInstructionSet_AUTO || isa > WrwpKernelInstructionSet_AVX512 ||
+      !WrwpKernel_setInstructionSet((WrwpKernelInstructionSet)isa)) {
+    raiseException_returnNULL(PyExc_ValueError, "Instruction set not supported");
+  }
+  Py_RETURN_NONE;
+}
+
+/**
+ * Returns the instruction set used when accumulating the normal equations
+ * @param[in] self - this instance
+ * @param[in] args - N/A
+ * @returns the instruction set
+ */
+static PyObject* _pywrwp_getinstructionset(PyObject* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpKernel_getInstructionSet());
+}
+
+/**
+ * Returns if the instruction set is supported by this cpu
+ * @param[in] self - this instance
+ * @param[in] args - the instruction set
+ * @returns True or False
+ */
+static PyObject* _pywrwp_isinstructionsetsupported(PyObject* self, PyObject* args)
+{
+  int isa = WrwpKernelInstructionSet_AUTO;
+  if (!PyArg_ParseTuple(args, "i", &isa)) {
+    return NULL;
+  }
+  if (isa < WrwpKernelInstructionSet_AUTO || isa > WrwpKernelInstructionSet_AVX512) {
+    return PyBool_FromLong(0);
+  }
+  return PyBool_FromLong(WrwpKernel_isInstructionSetSupported((WrwpKernelInstructionSet)isa));
+}
+
+/**
+ * Returns the native context to use for a generation and marks the python context as used.
+ * @param[in] pyctx - the python context, may be NULL or None in which case a temporary context is created
+ * @returns the context or NULL on failure (python exception set), release it with \ref _pywrwp_releaseContext
+ */
+static WrwpContext_t* _pywrwp_acquireContext(PyObject* pyctx)
+{
+  WrwpContext_t* ctx = NULL;
+  if (pyctx != NULL && pyctx != Py_None) {
+    PyWrwpContext* context = NULL;
+    if (!PyWrwpContext_Check(pyctx)) {
+      raiseException_returnNULL(PyExc_AttributeError, "Context must be created with _wrwp.newcontext()");
+    }
+    context = (PyWrwpContext*)pyctx;
+    if (context->inuse) {
+      raiseException_returnNULL(PyExc_RuntimeError, "Context is already in use by another thread");
+    }
+    context->inuse = 1;
+    ctx = RAVE_OBJECT_COPY(context->ctx);
+  } else {
+    ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+    if (ctx == NULL) {
+      raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp context.");
+    }
+  }
+  return ctx;
+}
+
+/**
+ * Releases a context acquired with \ref _pywrwp_acquireContext
+ * @param[in] pyctx - the python context or NULL/None
+ * @param[in,out] ctx - the native context, will be released
+ */
+static void _pywrwp_releaseContext(PyObject* pyctx, WrwpContext_t** ctx)
+{
+  if (pyctx != NULL && pyctx != Py_None && PyWrwpContext_Check(pyctx)) {
+    ((PyWrwpContext*)pyctx)->inuse = 0;
+  }
+  RAVE_OBJECT_RELEASE(*ctx);
+}
+
+/**
+ * Deallocates the rolling window
+ * @param[in] obj the object to deallocate.
+ */
+static void _pywrwpwindow_dealloc(PyWrwpWindow* obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+  PYRAVE_DEBUG_OBJECT_DESTROYED;
+  RAVE_OBJECT_RELEASE(obj->window);
+  PyObject_Del(obj);
+}
+
+/**
+ * Creates a new rolling window
+ * @param[in] self this instance.
+ * @param[in] args the generator, the length [s] and optionally the method and the fields
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_newwindow(PyObject* self, PyObject* args)
+{
+  PyObject* pywrwp = NULL;
+  PyWrwpWindow* result = NULL;
+  char* wrwpMethod = NULL;
+  char* fieldsToGenerate = NULL;
+  int length = 0;
+
+  if (!PyArg_ParseTuple(args, "Oi|zz", &pywrwp, &length, &wrwpMethod, &fieldsToGenerate)) {
+    return NULL;
+  }
+  if (!PyWrwp_Check(pywrwp)) {
+    raiseException_returnNULL(PyExc_AttributeError, "First argument must be a wrwp generator");
+  }
+  result = PyObject_NEW(PyWrwpWindow, &PyWrwpWindow_Type);
+  if (result == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for PyWrwpWindow.");
+  }
+  PYRAVE_DEBUG_OBJECT_CREATED;
+  result->window = RAVE_OBJECT_NEW(&WrwpWindow_TYPE);
+  if (result->window == NULL) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp window.");
+  }
+  if (!WrwpWindow_init(result->window, ((PyWrwp*)pywrwp)->wrwp, wrwpMethod, fieldsToGenerate, length)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_AttributeError, "Failed to initialize wrwp window, only the SMHI method without dealiasing is supported");
+  }
+  return (PyObject*)result;
+}
+
+static PyObject* _pywrwpwindow_addScan(PyWrwpWindow* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  WrwpContext_t* ctx = NULL;
+  int result = 0;
+
+  if (!PyArg_ParseTuple(args, "O|O", &obj, &pyctx)) {
+    return NULL;
+  }
+  if (!PyPolarScan_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar scan");
+  }
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  result = WrwpWindow_addScan(self->window, ctx, ((PyPolarScan*)obj)->scan);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (!result) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to add scan to window");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwpwindow_getNumberOfScans(PyWrwpWindow* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpWindow_getNumberOfScans(self->window));
+}
+
+static PyObject* _pywrwpwindow_getProfile(PyWrwpWindow* self, PyObject* args)
+{
+  PyVerticalProfile* pyvp = NULL;
+  VerticalProfile_t* vp = NULL;
+
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  vp = WrwpWindow_getProfile(self->window);
+  if (vp == NULL) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  pyvp = PyVerticalProfile_New(vp);
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+/**
+ * Deallocates the composite
+ * @param[in] obj the object to deallocate.
+ */
+static void _pywrwpcomposite_dealloc(PyWrwpComposite* obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+  PYRAVE_DEBUG_OBJECT_DESTROYED;
+  RAVE_OBJECT_RELEASE(obj->composite);
+  PyObject_Del(obj);
+}
+
+/**
+ * Creates a new composite
+ * @param[in] self this instance.
+ * @param[in] args the generator, the latitude and longitude of the target [rad] and optionally the method and the fields
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_newcomposite(PyObject* self, PyObject* args)
+{
+  PyObject* pywrwp = NULL;
+  PyWrwpComposite* result = NULL;
+  char* wrwpMethod = NULL;
+  char* fieldsToGenerate = NULL;
+  double lat = 0.0, lon = 0.0;
+
+  if (!PyArg_ParseTuple(args, "Odd|zz", &pywrwp, &lat, &lon, &wrwpMethod, &fieldsToGenerate)) {
+    return NULL;
+  }
+  if (!PyWrwp_Check(pywrwp)) {
+    raiseException_returnNULL(PyExc_AttributeError, "First argument must be a wrwp generator");
+  }
+  result = PyObject_NEW(PyWrwpComposite, &PyWrwpComposite_Type);
+  if (result == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for PyWrwpComposite.");
+  }
+  PYRAVE_DEBUG_OBJECT_CREATED;
+  result->composite = RAVE_OBJECT_NEW(&WrwpComposite_TYPE);
+  if (result->composite == NULL) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp composite.");
+  }
+  if (!WrwpComposite_init(result->composite, ((PyWrwp*)pywrwp)->wrwp, wrwpMethod, fieldsToGenerate, lat, lon)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_AttributeError, "Failed to initialize wrwp composite, only the SMHI method without dealiasing is supported");
+  }
+  return (PyObject*)result;
+}
+
+static PyObject* _pywrwpcomposite_addVolume(PyWrwpComposite* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  WrwpContext_t* ctx = NULL;
+  int result = 0;
+
+  if (!PyArg_ParseTuple(args, "O|O", &obj, &pyctx)) {
+    return NULL;
+  }
+  if (!PyPolarVolume_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar volume");
+  }
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  result = WrwpComposite_addVolume(self->composite, ctx, ((PyPolarVolume*)obj)->pvol);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (!result) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to add volume to composite");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwpcomposite_merge(PyWrwpComposite* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "O", &obj)) {
+    return NULL;
+  }
+  if (!PyWrwpComposite_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a wrwp composite");
+  }
+  if (!WrwpComposite_merge(self->composite, ((PyWrwpComposite*)obj)->composite)) {
+    raiseException_returnNULL(PyExc_AttributeError, "Only composites with the same generator configuration, target and fields can be merged");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwpcomposite_getNumberOfRadars(PyWrwpComposite* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpComposite_getNumberOfRadars(self->composite));
+}
+
+static PyObject* _pywrwpcomposite_getProfile(PyWrwpComposite* self, PyObject* args)
+{
+  PyVerticalProfile* pyvp = NULL;
+  VerticalProfile_t* vp = NULL;
+
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  vp = WrwpComposite_getProfile(self->composite);
+  if (vp == NULL) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  pyvp = PyVerticalProfile_New(vp);
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+/**
+ * Deallocates the archive
+ * @param[in] obj the object to deallocate.
+ */
+static void _pywrwparchive_dealloc(PyWrwpArchive* obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+  PYRAVE_DEBUG_OBJECT_DESTROYED;
+  RAVE_OBJECT_RELEASE(obj->archive);
+  PyObject_Del(obj);
+}
+
+/**
+ * Creates an archive object without any file
+ * @return the object on success, otherwise NULL
+ */
+static PyWrwpArchive* _pywrwparchive_newObject(void)
+{
+  PyWrwpArchive* result = PyObject_NEW(PyWrwpArchive, &PyWrwpArchive_Type);
+  if (result == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for PyWrwpArchive.");
+  }
+  PYRAVE_DEBUG_OBJECT_CREATED;
+  result->archive = RAVE_OBJECT_NEW(&WrwpArchive_TYPE);
+  if (result->archive == NULL) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp archive.");
+  }
+  return result;
+}
+
+/**
+ * Creates a new archive file
+ * @param[in] self this instance.
+ * @param[in] args the filename, the levels, the interval [m] and the fields
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_createarchive(PyObject* self, PyObject* args)
+{
+  PyWrwpArchive* result = NULL;
+  char* filename = NULL;
+  char* fields = NULL;
+  int levels = 0, interval = 0;
+
+  if (!PyArg_ParseTuple(args, "siis", &filename, &levels, &interval, &fields)) {
+    return NULL;
+  }
+  result = _pywrwparchive_newObject();
+  if (result != NULL && !WrwpArchive_create(result->archive, filename, levels, interval, fields)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_IOError, "Failed to create wrwp archive");
+  }
+  return (PyObject*)result;
+}
+
+/**
+ * Opens an existing archive file
+ * @param[in] self this instance.
+ * @param[in] args the filename
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_openarchive(PyObject* self, PyObject* args)
+{
+  PyWrwpArchive* result = NULL;
+  char* filename = NULL;
+
+  if (!PyArg_ParseTuple(args, "s", &filename)) {
+    return NULL;
+  }
+  result = _pywrwparchive_newObject();
+  if (result != NULL && !WrwpArchive_open(result->archive, filename)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_IOError, "Failed to open wrwp archive");
+  }
+  return (PyObject*)result;
+}
+
+/**
+ * Generates a profile with the archived fields and appends it to the archive
+ * @param[in] self - self
+ * @param[in] args - wrwp, pvol, method, context
+ * @return None
+ */
+static PyObject* _pywrwparchive_append(PyWrwpArchive* self, PyObject* args)
+{
+  PyObject* pywrwp = NULL;
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  WrwpContext_t* ctx = NULL;
+  WrwpResult_t* block = NULL;
+  char* wrwpMethod = NULL;
+  int result = 0;
+
+  if (!PyArg_ParseTuple(args, "OO|zO", &pywrwp, &obj, &wrwpMethod, &pyctx)) {
+    return NULL;
+  }
+  if (!PyWrwp_Check(pywrwp)) {
+    raiseException_returnNULL(PyExc_AttributeError, "First argument must be a wrwp generator");
+  }
+  if (!PyPolarVolume_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "Second argument must be a polar volume");
+  }
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  block = Wrwp_generateResult(((PyWrwp*)pywrwp)->wrwp, ctx, ((PyPolarVolume*)obj)->pvol, wrwpMethod,
+                              WrwpArchive_getFields(self->archive));
+  Py_END_ALLOW_THREADS
+
+  /* Appended while holding the GIL, the file lock only serialises different archive objects */
+  if (block != NULL) {
+    result = WrwpArchive_append(self->archive, block);
+  }
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (block == NULL) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  RAVE_OBJECT_RELEASE(block);
+  if (!result) {
+    raiseException_returnNULL(PyExc_IOError, "Failed to append the profile to the archive");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwparchive_getNumberOfProfiles(PyWrwpArchive* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpArchive_getNumberOfProfiles(self->archive));
+}
+
+static PyObject* _pywrwparchive_getLevels(PyWrwpArchive* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpArchive_getLevels(self->archive));
+}
+
+static PyObject* _pywrwparchive_getInterval(PyWrwpArchive* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpArchive_getInterval(self->archive));
+}
+
+static PyObject* _pywrwparchive_getFields(PyWrwpArchive* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyString_FromString(WrwpArchive_getFields(self->archive));
+}
+
+static PyObject* _pywrwparchive_find(PyWrwpArchive* self, PyObject* args)
+{
+  long long start = 0, end = 0;
+  int first = 0, count = 0;
+
+  if (!PyArg_ParseTuple(args, "LL", &start, &end)) {
+    return NULL;
+  }
+  count = WrwpArchive_findRange(self->archive, start, end, &first);
+  return Py_BuildValue("(ii)", first, count);
+}
+
+static PyObject* _pywrwparchive_getTimes(PyWrwpArchive* self, PyObject* args)
+{
+  PyObject* result = NULL;
+  npy_intp dims[1] = {0};
+  int first = 0, count = 0, i = 0;
+
+  if (!PyArg_ParseTuple(args, "ii", &first, &count)) {
+    return NULL;
+  }
+  if (first < 0 || count < 0 || first + count > WrwpArchive_getNumberOfProfiles(self->archive)) {
+    raiseException_returnNULL(PyExc_IndexError, "The profiles are out of range");
+  }
+  dims[0] = count;
+  result = PyArray_SimpleNew(1, dims, NPY_INT64);
+  if (result == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < count; i++) {
+    ((npy_int64*)PyArray_DATA((PyArrayObject*)result))[i] = (npy_int64)WrwpArchive_getTime(self->archive, first + i);
+  }
+  return result;
+}
+
+static PyObject* _pywrwparchive_read(PyWrwpArchive* self, PyObject* args)
+{
+  PyObject* result = NULL;
+  npy_intp dims[2] = {0, 0};
+  char* name = NULL;
+  int first = 0, count = 0, ok = 0;
+  WrwpResultField field = WrwpResultField_COUNT;
+
+  if (!PyArg_ParseTuple(args, "sii", &name, &first, &count)) {
+    return NULL;
+  }
+  field = WrwpResult_getFieldByName(name, strlen(name));
+  if (!WrwpArchive_hasField(self->archive, field)) {
+    raiseException_returnNULL(PyExc_KeyError, "The field is not archived");
+  }
+  if (count < 0) {
+    raiseException_returnNULL(PyExc_IndexError, "The profiles are out of range");
+  }
+  dims[0] = count;
+  dims[1] = WrwpArchive_getLevels(self->archive);
+  result = PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+  if (result == NULL) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ok = WrwpArchive_read(self->archive, field, first, count, (double*)PyArray_DATA((PyArrayObject*)result));
+  Py_END_ALLOW_THREADS
+  if (!ok) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_IndexError, "The profiles are out of range");
+  }
+  return result;
+}
+
+static PyObject* _pywrwparchive_close(PyWrwpArchive* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  WrwpArchive_close(self->archive);
+  Py_RETURN_NONE;
+}
+
+/**
+ * Deallocates the shared memory ring
+ * @param[in] obj the object to deallocate.
+ */
+static void _pywrwpshm_dealloc(PyWrwpShm* obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+  PYRAVE_DEBUG_OBJECT_DESTROYED;
+  RAVE_OBJECT_RELEASE(obj->shm);
+  PyObject_Del(obj);
+}
+
+/**
+ * Creates a shared memory ring object without any segment
+ * @return the object on success, otherwise NULL
+ */
+static PyWrwpShm* _pywrwpshm_newObject(void)
+{
+  PyWrwpShm* result = PyObject_NEW(PyWrwpShm, &PyWrwpShm_Type);
+  if (result == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for PyWrwpShm.");
+  }
+  PYRAVE_DEBUG_OBJECT_CREATED;
+  result->shm = RAVE_OBJECT_NEW(&WrwpShm_TYPE);
+  if (result->shm == NULL) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to allocate memory for wrwp shared memory ring.");
+  }
+  return result;
+}
+
+/**
+ * Creates or reuses a shared memory ring for publishing
+ * @param[in] self this instance.
+ * @param[in] args the name, the levels, the interval [m], the fields and the number of slots
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_createshm(PyObject* self, PyObject* args)
+{
+  PyWrwpShm* result = NULL;
+  char* name = NULL;
+  char* fields = NULL;
+  int levels = 0, interval = 0, nslots = 16;
+
+  if (!PyArg_ParseTuple(args, "siis|i", &name, &levels, &interval, &fields, &nslots)) {
+    return NULL;
+  }
+  result = _pywrwpshm_newObject();
+  if (result != NULL && !WrwpShm_create(result->shm, name, levels, interval, fields, nslots)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_IOError, "Failed to create wrwp shared memory ring");
+  }
+  return (PyObject*)result;
+}
+
+/**
+ * Attaches to an existing shared memory ring for reading
+ * @param[in] self this instance.
+ * @param[in] args the name
+ * @return the object on success, otherwise NULL
+ */
+static PyObject* _pywrwp_attachshm(PyObject* self, PyObject* args)
+{
+  PyWrwpShm* result = NULL;
+  char* name = NULL;
+
+  if (!PyArg_ParseTuple(args, "s", &name)) {
+    return NULL;
+  }
+  result = _pywrwpshm_newObject();
+  if (result != NULL && !WrwpShm_attach(result->shm, name)) {
+    Py_DECREF(result);
+    raiseException_returnNULL(PyExc_IOError, "Failed to attach to wrwp shared memory ring");
+  }
+  return (PyObject*)result;
+}
+
+/**
+ * Removes a shared memory ring
+ * @param[in] self this instance.
+ * @param[in] args the name
+ * @return None
+ */
+static PyObject* _pywrwp_unlinkshm(PyObject* self, PyObject* args)
+{
+  char* name = NULL;
+
+  if (!PyArg_ParseTuple(args, "s", &name)) {
+    return NULL;
+  }
+  if (!WrwpShm_unlink(name)) {
+    raiseException_returnNULL(PyExc_IOError, "Failed to remove wrwp shared memory ring");
+  }
+  Py_RETURN_NONE;
+}
+
+/**
+ * Generates a profile, publishes it in the ring and returns it as a vertical profile
+ * @param[in] self - self
+ * @param[in] args - wrwp, pvol, method, fields, context
+ * @return the vertical profile on success, otherwise NULL
+ */
+static PyObject* _pywrwpshm_publish(PyWrwpShm* self, PyObject* args)
+{
+  PyObject* pywrwp = NULL;
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  PyVerticalProfile* pyvp = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpContext_t* ctx = NULL;
+  WrwpResult_t* block = NULL;
+  char* wrwpMethod = NULL;
+  char* fieldsToGenerate = NULL;
+  unsigned long long sequence = 0;
+
+  if (!PyArg_ParseTuple(args, "OO|zzO", &pywrwp, &obj, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+  if (!PyWrwp_Check(pywrwp)) {
+    raiseException_returnNULL(PyExc_AttributeError, "First argument must be a wrwp generator");
+  }
+  if (!PyPolarVolume_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "Second argument must be a polar volume");
+  }
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  /* The ring is published before the profile object is created so that readers get it as early as possible */
+  Py_BEGIN_ALLOW_THREADS
+  block = Wrwp_generateResult(((PyWrwp*)pywrwp)->wrwp, ctx, ((PyPolarVolume*)obj)->pvol, wrwpMethod,
+                              fieldsToGenerate != NULL ? fieldsToGenerate : WrwpShm_getFields(self->shm));
+  if (block != NULL) {
+    sequence = WrwpShm_publish(self->shm, block);
+    if (sequence != 0) {
+      vp = Wrwp_createProfile(((PyWrwp*)pywrwp)->wrwp, block, ((PyPolarVolume*)obj)->pvol);
+    }
+  }
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (block == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  if (sequence == 0) {
+    raiseException_gotoTag(done, PyExc_IOError, "Failed to publish the profile in the shared memory ring");
+  }
+  if (vp == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to create vertical profile");
+  }
+  pyvp = PyVerticalProfile_New(vp);
+done:
+  RAVE_OBJECT_RELEASE(block);
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+static PyObject* _pywrwpshm_getSequence(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyLong_FromUnsignedLongLong(WrwpShm_getSequence(self->shm));
+}
+
+static PyObject* _pywrwpshm_getLevels(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpShm_getLevels(self->shm));
+}
+
+static PyObject* _pywrwpshm_getInterval(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpShm_getInterval(self->shm));
+}
+
+static PyObject* _pywrwpshm_getNumberOfSlots(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyInt_FromLong(WrwpShm_getNumberOfSlots(self->shm));
+}
+
+static PyObject* _pywrwpshm_getFields(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  return PyString_FromString(WrwpShm_getFields(self->shm));
+}
+
+static PyObject* _pywrwpshm_read(PyWrwpShm* self, PyObject* args)
+{
+  PyObject* result = NULL;
+  PyObject* fields = NULL;
+  unsigned long long sequence = 0;
+  long long t = 0;
+  int i = 0;
+
+  if (!PyArg_ParseTuple(args, "|K", &sequence)) {
+    return NULL;
+  }
+  if (sequence == 0) {
+    sequence = WrwpShm_getSequence(self->shm);
+  }
+  fields = PyDict_New();
+  if (fields == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    if (WrwpShm_hasField(self->shm, (WrwpResultField)i)) {
+      npy_intp dims[1] = {WrwpShm_getLevels(self->shm)};
+      PyObject* arr = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+      if (arr == NULL) {
+        goto done;
+      }
+      if (!WrwpShm_read(self->shm, sequence, (WrwpResultField)i, (double*)PyArray_DATA((PyArrayObject*)arr), &t)) {
+        Py_DECREF(arr);
+        raiseException_gotoTag(done, PyExc_IndexError, "The profile is not in the shared memory ring");
+      }
+      PyDict_SetItemString(fields, WrwpResult_getFieldName((WrwpResultField)i), arr);
+      Py_DECREF(arr);
+    }
+  }
+  result = Py_BuildValue("(KLO)", sequence, t, fields);
+done:
+  Py_DECREF(fields);
+  return result;
+}
+
+static PyObject* _pywrwpshm_close(PyWrwpShm* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  WrwpShm_close(self->shm);
+  Py_RETURN_NONE;
+}
+
 static PyObject* _pywrwp_generate(PyWrwp* self, PyObject* args)
 {
   PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  PyVerticalProfile* pyvp = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpContext_t* ctx = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+
+  if(!PyArg_ParseTuple(args, "O|zzO", &obj, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  if (!PyPolarVolume_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar volume");
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  /* The generation does not touch any python objects so other threads may run meanwhile */
+  Py_BEGIN_ALLOW_THREADS
+  vp = Wrwp_generateWithContext(self->wrwp, ctx, ((PyPolarVolume*)obj)->pvol, wrwpMethod, fieldsToGenerate);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (vp == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+
+  pyvp = PyVerticalProfile_New(vp);
+
+done:
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+/**
+ * Creates the list of inputs from a polar volume or a sequence of polar volumes and/or polar scans
+ * @param[in] obj - the python object
+ * @returns the list or NULL on failure (python exception set)
+ */
+static RaveObjectList_t* _pywrwp_createInputList(PyObject* obj)
+{
+  PyObject* seq = NULL;
+  RaveObjectList_t* inputs = NULL;
+  RaveObjectList_t* result = NULL;
+  Py_ssize_t i = 0, n = 0;
+
+  inputs = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (inputs == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to create input list");
+  }
+  if (PyPolarVolume_Check(obj)) {
+    if (!RaveObjectList_add(inputs, (RaveCoreObject*)((PyPolarVolume*)obj)->pvol)) {
+      raiseException_gotoTag(done, PyExc_MemoryError, "Failed to add input to list");
+    }
+    result = RAVE_OBJECT_COPY(inputs);
+    goto done;
+  }
+
+  seq = PySequence_Fast(obj, "In argument must be a sequence of polar volumes and/or polar scans");
+  if (seq == NULL) {
+    goto done;
+  }
+  n = PySequence_Fast_GET_SIZE(seq);
+  if (n == 0) {
+    raiseException_gotoTag(done, PyExc_AttributeError, "In argument must contain at least one polar volume or polar scan");
+  }
+  for (i = 0; i < n; i++) {
+    PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+    RaveCoreObject* input = NULL;
+    if (PyPolarVolume_Check(item)) {
+      input = (RaveCoreObject*)((PyPolarVolume*)item)->pvol;
+    } else if (PyPolarScan_Check(item)) {
+      input = (RaveCoreObject*)((PyPolarScan*)item)->scan;
+    } else {
+      raiseException_gotoTag(done, PyExc_AttributeError, "In argument must only contain polar volumes and polar scans");
+    }
+    if (!RaveObjectList_add(inputs, input)) {
+      raiseException_gotoTag(done, PyExc_MemoryError, "Failed to add input to list");
+    }
+  }
+  result = RAVE_OBJECT_COPY(inputs);
+done:
+  Py_XDECREF(seq);
+  RAVE_OBJECT_RELEASE(inputs);
+  return result;
+}
+
+/**
+ * Derives a profile from several volumes and/or scans that are treated as one logical volume
+ * @param[in] self - self
+ * @param[in] args - sequence of volumes and scans, method, fields, context
+ * @return a vertical profile on success otherwise NULL
+ */
+static PyObject* _pywrwp_generate_multi(PyWrwp* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  PyVerticalProfile* pyvp = NULL;
+  VerticalProfile_t* vp = NULL;
+  WrwpContext_t* ctx = NULL;
+  RaveObjectList_t* inputs = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+
+  if(!PyArg_ParseTuple(args, "O|zzO", &obj, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  inputs = _pywrwp_createInputList(obj);
+  if (inputs == NULL) {
+    return NULL;
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    goto done;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  vp = Wrwp_generateFromScans(self->wrwp, ctx, inputs, wrwpMethod, fieldsToGenerate);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (vp == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+
+  pyvp = PyVerticalProfile_New(vp);
+
+done:
+  RAVE_OBJECT_RELEASE(inputs);
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+static PyObject* _pywrwp_generate_resolutions(PyWrwp* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyresolutions = NULL;
+  PyObject* seq = NULL;
+  PyObject* pyctx = NULL;
+  PyObject* result = NULL;
+  PyObject* pyprofiles = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveObjectList_t* inputs = NULL;
+  WrwpContext_t* ctx = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+  int *dz = NULL, *hmax = NULL;
+  Py_ssize_t i = 0, n = 0;
+
+  if(!PyArg_ParseTuple(args, "OO|zzO", &obj, &pyresolutions, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  seq = PySequence_Fast(pyresolutions, "Resolutions must be a sequence of (dz, hmax) tuples");
+  if (seq == NULL) {
+    return NULL;
+  }
+  n = PySequence_Fast_GET_SIZE(seq);
+  dz = RAVE_MALLOC(sizeof(int) * (n > 0 ? n : 1));
+  hmax = RAVE_MALLOC(sizeof(int) * (n > 0 ? n : 1));
+  if (dz == NULL || hmax == NULL) {
+    raiseException_gotoTag(done, PyExc_MemoryError, "Failed to allocate memory for the resolutions");
+  }
+  for (i = 0; i < n; i++) {
+    if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "ii", &dz[i], &hmax[i])) {
+      goto done;
+    }
+  }
+
+  inputs = _pywrwp_createInputList(obj);
+  if (inputs == NULL) {
+    goto done;
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    goto done;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  profiles = Wrwp_generateResolutions(self->wrwp, ctx, inputs, wrwpMethod, fieldsToGenerate, (int)n, dz, hmax);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (profiles == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profiles");
+  }
+
+  pyprofiles = PyList_New(0);
+  if (pyprofiles == NULL) {
+    goto done;
+  }
+  for (i = 0; i < RaveObjectList_size(profiles); i++) {
+    VerticalProfile_t* vp = (VerticalProfile_t*)RaveObjectList_get(profiles, (int)i);
+    PyObject* pyvp = (PyObject*)PyVerticalProfile_New(vp);
+    RAVE_OBJECT_RELEASE(vp);
+    if (pyvp == NULL || PyList_Append(pyprofiles, pyvp) != 0) {
+      Py_XDECREF(pyvp);
+      goto done;
+    }
+    Py_DECREF(pyvp);
+  }
+  result = pyprofiles;
+  pyprofiles = NULL;
+
+done:
+  Py_XDECREF(seq);
+  Py_XDECREF(pyprofiles);
+  RAVE_FREE(dz);
+  RAVE_FREE(hmax);
+  RAVE_OBJECT_RELEASE(inputs);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+static PyObject* _pywrwp_generate_sectors(PyWrwp* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyrings = NULL;
+  PyObject* seq = NULL;
+  PyObject* pyctx = NULL;
+  PyObject* result = NULL;
+  PyObject* pyprofiles = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveObjectList_t* inputs = NULL;
+  WrwpContext_t* ctx = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+  int* ranges = NULL;
+  int nsectors = 0, nrings = 0;
+  Py_ssize_t i = 0, n = 0;
+
+  if(!PyArg_ParseTuple(args, "OiO|zzO", &obj, &nsectors, &pyrings, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  if (PyLong_Check(pyrings)) {
+    nrings = (int)PyLong_AsLong(pyrings);
+  } else {
+    seq = PySequence_Fast(pyrings, "Rings must be the number of rings or a sequence of range limits");
+    if (seq == NULL) {
+      return NULL;
+    }
+    n = PySequence_Fast_GET_SIZE(seq);
+    if (n < 2) {
+      raiseException_gotoTag(done, PyExc_AttributeError, "At least two range limits must be given");
+    }
+    ranges = RAVE_MALLOC(sizeof(int) * n);
+    if (ranges == NULL) {
+      raiseException_gotoTag(done, PyExc_MemoryError, "Failed to allocate memory for the range limits");
+    }
+    for (i = 0; i < n; i++) {
+      ranges[i] = (int)PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+      if (PyErr_Occurred()) {
+        goto done;
+      }
+    }
+    nrings = (int)n - 1;
+  }
+
+  inputs = _pywrwp_createInputList(obj);
+  if (inputs == NULL) {
+    goto done;
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    goto done;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  profiles = Wrwp_generateSectors(self->wrwp, ctx, inputs, wrwpMethod, fieldsToGenerate, nsectors, nrings, ranges);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (profiles == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profiles");
+  }
+
+  pyprofiles = PyList_New(0);
+  if (pyprofiles == NULL) {
+    goto done;
+  }
+  for (i = 0; i < RaveObjectList_size(profiles); i++) {
+    VerticalProfile_t* vp = (VerticalProfile_t*)RaveObjectList_get(profiles, (int)i);
+    PyObject* pyvp = (PyObject*)PyVerticalProfile_New(vp);
+    RAVE_OBJECT_RELEASE(vp);
+    if (pyvp == NULL || PyList_Append(pyprofiles, pyvp) != 0) {
+      Py_XDECREF(pyvp);
+      goto done;
+    }
+    Py_DECREF(pyvp);
+  }
+  result = pyprofiles;
+  pyprofiles = NULL;
+
+done:
+  Py_XDECREF(seq);
+  Py_XDECREF(pyprofiles);
+  RAVE_FREE(ranges);
+  RAVE_OBJECT_RELEASE(inputs);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+/**
+ * Derives one profile per configuration from the same inputs
+ * @param[in] self - this instance
+ * @param[in] args - the inputs, a list of (wrwp, method) tuples and optionally the fields and the context
+ * @returns a list of vertical profiles on success, otherwise NULL
+ */
+static PyObject* _pywrwp_generate_configurations(PyObject* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyconfigs = NULL;
+  PyObject* seq = NULL;
+  PyObject* pyctx = NULL;
+  PyObject* result = NULL;
+  PyObject* pyprofiles = NULL;
+  RaveObjectList_t* profiles = NULL;
+  RaveObjectList_t* inputs = NULL;
+  RaveObjectList_t* generators = NULL;
+  WrwpContext_t* ctx = NULL;
+  char* fieldsToGenerate = NULL;
+  const char** methods = NULL;
+  Py_ssize_t i = 0, n = 0;
+
+  if(!PyArg_ParseTuple(args, "OO|zO", &obj, &pyconfigs, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  seq = PySequence_Fast(pyconfigs, "Configurations must be a sequence of (wrwp, method) tuples");
+  if (seq == NULL) {
+    return NULL;
+  }
+  n = PySequence_Fast_GET_SIZE(seq);
+  methods = RAVE_MALLOC(sizeof(char*) * (n > 0 ? n : 1));
+  generators = RAVE_OBJECT_NEW(&RaveObjectList_TYPE);
+  if (methods == NULL || generators == NULL) {
+    raiseException_gotoTag(done, PyExc_MemoryError, "Failed to allocate memory for the configurations");
+  }
+  for (i = 0; i < n; i++) {
+    PyObject* pywrwp = NULL;
+    char* method = NULL;
+    if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "O|z", &pywrwp, &method)) {
+      goto done;
+    }
+    if (!PyWrwp_Check(pywrwp)) {
+      raiseException_gotoTag(done, PyExc_AttributeError, "Configurations must contain wrwp generators");
+    }
+    if (!RaveObjectList_add(generators, (RaveCoreObject*)((PyWrwp*)pywrwp)->wrwp)) {
+      raiseException_gotoTag(done, PyExc_MemoryError, "Failed to add configuration");
+    }
+    methods[i] = method; /* owned by the tuple which is kept alive by seq */
+  }
+
+  inputs = _pywrwp_createInputList(obj);
+  if (inputs == NULL) {
+    goto done;
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    goto done;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  profiles = Wrwp_generateConfigurations(ctx, inputs, generators, methods, fieldsToGenerate);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (profiles == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profiles");
+  }
+
+  pyprofiles = PyList_New(0);
+  if (pyprofiles == NULL) {
+    goto done;
+  }
+  for (i = 0; i < RaveObjectList_size(profiles); i++) {
+    VerticalProfile_t* vp = (VerticalProfile_t*)RaveObjectList_get(profiles, (int)i);
+    PyObject* pyvp = (PyObject*)PyVerticalProfile_New(vp);
+    RAVE_OBJECT_RELEASE(vp);
+    if (pyvp == NULL || PyList_Append(pyprofiles, pyvp) != 0) {
+      Py_XDECREF(pyvp);
+      goto done;
+    }
+    Py_DECREF(pyvp);
+  }
+  result = pyprofiles;
+  pyprofiles = NULL;
+
+done:
+  Py_XDECREF(seq);
+  Py_XDECREF(pyprofiles);
+  RAVE_FREE(methods);
+  RAVE_OBJECT_RELEASE(generators);
+  RAVE_OBJECT_RELEASE(inputs);
+  RAVE_OBJECT_RELEASE(profiles);
+  return result;
+}
+
+/**
+ * Same as \ref _pywrwp_acquireContext but a context is required since it keeps the stream state.
+ * @param[in] pyctx - the python context
+ * @returns the context or NULL on failure (python exception set)
+ */
+static WrwpContext_t* _pywrwp_acquireStreamContext(PyObject* pyctx)
+{
+  if (pyctx == NULL || pyctx == Py_None) {
+    raiseException_returnNULL(PyExc_AttributeError, "A context created with _wrwp.newcontext() is required when streaming");
+  }
+  return _pywrwp_acquireContext(pyctx);
+}
+
+static PyObject* _pywrwp_begin(PyWrwp* self, PyObject* args)
+{
+  PyObject* pyctx = NULL;
+  WrwpContext_t* ctx = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+  int result = 0;
+
+  if(!PyArg_ParseTuple(args, "zzO", &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+  if (Wrwp_getDealias(self->wrwp)) {
+    raiseException_returnNULL(PyExc_AttributeError, "The radial winds can not be dealiased in a stream");
+  }
+  ctx = _pywrwp_acquireStreamContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+  result = Wrwp_begin(self->wrwp, ctx, wrwpMethod, fieldsToGenerate);
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (!result) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to begin stream");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwp_addScan(PyWrwp* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  WrwpContext_t* ctx = NULL;
+  int result = 0;
+
+  if(!PyArg_ParseTuple(args, "OO", &obj, &pyctx)) {
+    return NULL;
+  }
+  if (!PyPolarScan_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar scan");
+  }
+  ctx = _pywrwp_acquireStreamContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  result = Wrwp_addScan(self->wrwp, ctx, ((PyPolarScan*)obj)->scan);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  if (!result) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to add scan");
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* _pywrwp_finalize(PyWrwp* self, PyObject* args)
+{
+  PyObject* pyctx = NULL;
   PyVerticalProfile* pyvp = NULL;
   VerticalProfile_t* vp = NULL;
+  WrwpContext_t* ctx = NULL;
+
+  if(!PyArg_ParseTuple(args, "O", &pyctx)) {
+    return NULL;
+  }
+  ctx = _pywrwp_acquireStreamContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  vp = Wrwp_finalize(self->wrwp, ctx);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (vp == NULL) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  pyvp = PyVerticalProfile_New(vp);
+  RAVE_OBJECT_RELEASE(vp);
+  return (PyObject*)pyvp;
+}
+
+/**
+ * Derives the profile into a dictionary of numpy arrays without creating a vertical profile
+ * @param[in] self - self
+ * @param[in] args - pvol, method, fields, context
+ * @return a dictionary with one array for each wanted field
+ */
+static PyObject* _pywrwp_generate_result(PyWrwp* self, PyObject* args)
+{
+  PyObject* obj = NULL;
+  PyObject* pyctx = NULL;
+  PyObject* result = NULL;
+  WrwpContext_t* ctx = NULL;
+  WrwpResult_t* block = NULL;
+  char* fieldsToGenerate = NULL;
+  char* wrwpMethod = NULL;
+  int i = 0;
+
+  if(!PyArg_ParseTuple(args, "O|zzO", &obj, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  if (!PyPolarVolume_Check(obj)) {
+    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar volume");
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  block = Wrwp_generateResult(self->wrwp, ctx, ((PyPolarVolume*)obj)->pvol, wrwpMethod, fieldsToGenerate);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+
+  if (block == NULL) {
+    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+
+  result = PyDict_New();
+  if (result == NULL) {
+    goto done;
+  }
+  for (i = 0; i < WrwpResultField_COUNT; i++) {
+    const double* data = WrwpResult_getData(block, (WrwpResultField)i);
+    if (data != NULL) {
+      npy_intp dims[1] = {WrwpResult_getLevels(block)};
+      PyObject* arr = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+      if (arr == NULL) {
+        Py_DECREF(result);
+        result = NULL;
+        goto done;
+      }
+      if (dims[0] > 0) {
+        memcpy(PyArray_DATA((PyArrayObject*)arr), data, sizeof(double) * dims[0]);
+      }
+      PyDict_SetItemString(result, WrwpResult_getFieldName((WrwpResultField)i), arr);
+      Py_DECREF(arr);
+    }
+  }
+
+done:
+  RAVE_OBJECT_RELEASE(block);
+  return result;
+}
+
+/**
+ * Generates a profile from a polar volume given as an ODIM-H5 image and returns the profile as an image
+ * @param[in] self - self
+ * @param[in] args - the image as bytes, method, fields, context
+ * @return the profile image as bytes on success otherwise NULL
+ */
+static PyObject* _pywrwp_generate_image(PyWrwp* self, PyObject* args)
+{
+  Py_buffer image;
+  PyObject* pyctx = NULL;
+  PyObject* result = NULL;
+  WrwpContext_t* ctx = NULL;
   char* fieldsToGenerate = NULL;
   char* wrwpMethod = NULL;
+  void* profile = NULL;
+  size_t profileSize = 0;
+  int ok = 0;
+
+  if(!PyArg_ParseTuple(args, "y*|zzO", &image, &wrwpMethod, &fieldsToGenerate, &pyctx)) {
+    return NULL;
+  }
+
+  ctx = _pywrwp_acquireContext(pyctx);
+  if (ctx == NULL) {
+    PyBuffer_Release(&image);
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  ok = WrwpImage_generate(self->wrwp, ctx, image.buf, (size_t)image.len, wrwpMethod, fieldsToGenerate, &profile, &profileSize);
+  Py_END_ALLOW_THREADS
+
+  _pywrwp_releaseContext(pyctx, &ctx);
+  PyBuffer_Release(&image);
+
+  if (!ok) {
+    raiseException_returnNULL(PyExc_RuntimeError, "Failed to generate vertical profile");
+  }
+  result = PyBytes_FromStringAndSize((const char*)profile, (Py_ssize_t)profileSize);
+  RAVE_FREE(profile);
+  return result;
+}
+
+/**
+ * Locks the generator so that the configuration no longer can be modified
+ * @param[in] self - self
+ * @param[in] args - N/A
+ * @return None
+ */
+static PyObject* _pywrwp_lock(PyWrwp* self, PyObject* args)
+{
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
+  }
+  Wrwp_lock(self->wrwp);
+  Py_RETURN_NONE;
+}
 
-  if(!PyArg_ParseTuple(args, "O|zz", &obj, &wrwpMethod, &fieldsToGenerate)) {
+/**
+ * Returns an unlocked copy of the generator
+ * @param[in] self - self
+ * @param[in] args - N/A
+ * @return the copy
+ */
+static PyObject* _pywrwp_clone(PyWrwp* self, PyObject* args)
+{
+  PyObject* result = NULL;
+  Wrwp_t* cpy = NULL;
+  if (!PyArg_ParseTuple(args, "")) {
     return NULL;
   }
-
-  if (!PyPolarVolume_Check(obj)) {
-    raiseException_returnNULL(PyExc_AttributeError, "In argument must be a polar volume");
+  cpy = RAVE_OBJECT_CLONE(self->wrwp);
+  if (cpy == NULL) {
+    raiseException_returnNULL(PyExc_MemoryError, "Failed to clone wrwp generator");
   }
+  result = (PyObject*)PyWrwp_New(cpy);
+  RAVE_OBJECT_RELEASE(cpy);
+  return result;
+}
 
-  vp = Wrwp_generate(self->wrwp, ((PyPolarVolume*)obj)->pvol, wrwpMethod, fieldsToGenerate);
-
-  if (vp == NULL) {
-    raiseException_gotoTag(done, PyExc_RuntimeError, "Failed to generate vertical profile");
+/**
+ * Returns all configuration attributes of the generator, i.e. the attributes listed without a
+ * function in the methods of the type except locked.
+ * @param[in] self - self
+ * @param[in] args - N/A
+ * @return a dictionary with the attribute names and values
+ */
+static PyObject* _pywrwp_settings(PyWrwp* self, PyObject* args)
+{
+  PyObject* result = NULL;
+  PyMethodDef* def = NULL;
+  if (!PyArg_ParseTuple(args, "")) {
+    return NULL;
   }
-
-  pyvp = PyVerticalProfile_New(vp);
-
-  RAVE_OBJECT_RELEASE(vp);
-    
-done:
-  RAVE_OBJECT_RELEASE(vp);
-  return (PyObject*)pyvp;
+  result = PyDict_New();
+  if (result == NULL) {
+    return NULL;
+  }
+  for (def = Py_TYPE(self)->tp_methods; def != NULL && def->ml_name != NULL; def++) {
+    PyObject* value = NULL;
+    if (def->ml_meth != NULL || strcmp(def->ml_name, "locked") == 0) {
+      continue;
+    }
+    value = PyObject_GetAttrString((PyObject*)self, def->ml_name);
+    if (value == NULL || PyDict_SetItemString(result, def->ml_name, value) < 0) {
+      Py_XDECREF(value);
+      Py_DECREF(result);
+      return NULL;
+    }
+    Py_DECREF(value);
+  }
+  return result;
 }
 
 /**
@@ -199,6 +1708,10 @@ static struct PyMethodDef _pywrwp_methods[] =
   {"maxnstd", NULL, METH_VARARGS},
   {"maxvdiff", NULL, METH_VARARGS},
   {"vmin", NULL, METH_VARARGS},
+  {"dealias", NULL, METH_VARARGS},
+  {"bio_dbzmax", NULL, METH_VARARGS},
+  {"bio_rcs", NULL, METH_VARARGS},
+  {"bio_stdmin", NULL, METH_VARARGS},
   {"nmin_wnd", NULL, METH_VARARGS},
   {"nmin_ref", NULL, METH_VARARGS},
   {"ff_max", NULL, METH_VARARGS},
@@ -206,13 +1719,93 @@ static struct PyMethodDef _pywrwp_methods[] =
   {"undetect_VP", NULL, METH_VARARGS},
   {"gain_VP", NULL, METH_VARARGS},
   {"offset_VP", NULL, METH_VARARGS},
+  {"sampleprecision", NULL, METH_VARARGS},
+  {"locked", NULL, METH_VARARGS},
   {"generate", (PyCFunction)_pywrwp_generate, 1,
-    "generate(pvol,method,fields) -> vp\n\n"
+    "generate(pvol,method,fields,context) -> vp\n\n"
     "Function for deriving wind and reflectivity profiles from polar volume data\n\n"
-    "pvol   - A polar volume\n"
-    "method - Method used for deriving WRWP. Currently SMHI and KNMI are supported. Defaults to SMHI if None.\n"
-    "fields - A comma separated list of fields to be generated. Currently, the following fields can be generated\n"
-    "         NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ. If None, then a default setup will be generated."
+    "pvol    - A polar volume\n"
+    "method  - Method used for deriving WRWP. Currently SMHI and KNMI are supported. Defaults to SMHI if None.\n"
+    "fields  - A comma separated list of fields to be generated. Currently, the following fields can be generated\n"
+    "          NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ,div,def,ad,\n"
+    "          DBZH_p10,DBZH_p50,DBZH_p90,eta,dens,ff_bio,dd_bio,bio_frac. If None, then a default setup will be generated.\n"
+    "          div, def and ad (divergence, total deformation and axis of dilatation) are fitted with an extended VVP model.\n"
+    "          DBZH_p10, DBZH_p50 and DBZH_p90 are percentiles of the reflectivity from a bounded memory quantile sketch.\n"
+    "          eta, dens, ff_bio, dd_bio and bio_frac are the biological profile, derived from the gates with a reflectivity\n"
+    "          below bio_dbzmax.\n"
+    "context - An execution context created with _wrwp.newcontext(). Optional, if None a temporary context is used.\n"
+    "          A context can only be used by one thread at a time.\n\n"
+    "The GIL is released while the profile is generated."
+  },
+  {"generate_multi", (PyCFunction)_pywrwp_generate_multi, 1,
+    "generate_multi(inputs,method,fields,context) -> vp\n\n"
+    "Same as generate but derives one profile from several polar volumes and/or polar scans that are treated\n"
+    "as one logical volume, e.g. the partial volumes from EDGE based radars. No data is copied. The start and\n"
+    "end times, angles and tasks are collected from all inputs while the location, source and nominal date and\n"
+    "time are taken from the first one.\n\n"
+    "inputs  - A list of polar volumes and/or polar scans from the same radar\n"
+    "The other arguments are the same as for generate."
+  },
+  {"generate_resolutions", (PyCFunction)_pywrwp_generate_resolutions, 1,
+    "generate_resolutions(inputs,resolutions,method,fields,context) -> list of vp\n\n"
+    "Derives one profile per resolution from the same inputs in one pass. The samples are gathered once into\n"
+    "layers with the greatest common divisor of the intervals and aggregated into the layers of each resolution.\n"
+    "For the KNMI wind each resolution is generated separately.\n\n"
+    "inputs      - A polar volume or a list of polar volumes and/or polar scans\n"
+    "resolutions - A list of (dz, hmax) tuples in meters, the profiles are returned in the same order\n"
+    "The other arguments are the same as for generate."
+  },
+  {"generate_sectors", (PyCFunction)_pywrwp_generate_sectors, 1,
+    "generate_sectors(inputs,nsectors,rings,method,fields,context) -> list of vp\n\n"
+    "Derives one profile per azimuth sector and range ring in one pass, e.g. 4 quadrants times 3 rings. The sectors\n"
+    "have equal width and start at north, clockwise. The KNMI method only supports one sector. The profiles are\n"
+    "returned sector by sector and ring by ring within each sector, with the attributes how/minrange, how/maxrange,\n"
+    "how/startaz and how/stopaz.\n\n"
+    "inputs   - A polar volume or a list of polar volumes and/or polar scans\n"
+    "nsectors - Number of azimuth sectors\n"
+    "rings    - Number of range rings of equal width between dmin and dmax or a list of increasing range limits in meters\n"
+    "The other arguments are the same as for generate."
+  },
+  {"begin", (PyCFunction)_pywrwp_begin, 1,
+    "begin(method,fields,context)\n\n"
+    "Starts a streamed generation where the scans are added one at a time with addScan as they arrive. Each scan\n"
+    "is folded into the partial state of the layers directly and the profile is created with finalize. The result is\n"
+    "the same as from generate with a volume containing the same scans, DBZH_dev may differ in the last digits.\n"
+    "The stream state is kept in the context so it is required, and the generator should be locked.\n\n"
+    "method  - Method used for deriving WRWP, SMHI or KNMI. Defaults to SMHI if None.\n"
+    "fields  - A comma separated list of fields to be generated, see generate.\n"
+    "context - An execution context created with _wrwp.newcontext()."
+  },
+  {"addScan", (PyCFunction)_pywrwp_addScan, 1,
+    "addScan(scan,context)\n\n"
+    "Adds a polar scan to the stream started with begin. Scans outside the elevation limits are ignored."
+  },
+  {"finalize", (PyCFunction)_pywrwp_finalize, 1,
+    "finalize(context) -> vp\n\n"
+    "Ends the stream started with begin and returns the vertical profile derived from the added scans."
+  },
+  {"generate_image", (PyCFunction)_pywrwp_generate_image, 1,
+    "generate_image(image,method,fields,context) -> bytes\n\n"
+    "Same as generate but the polar volume is given as the content of an ODIM-H5 file, e.g. read from a pipe, and the\n"
+    "vertical profile is returned the same way. The images are kept in memory and never written to disk."
+  },
+  {"generate_result", (PyCFunction)_pywrwp_generate_result, 1,
+    "generate_result(pvol,method,fields,context) -> dictionary\n\n"
+    "Same as generate but returns the derived values without creating a vertical profile. The dictionary\n"
+    "contains one numpy array (float64) with one value per layer for each of the wanted fields, keyed by\n"
+    "the field name (e.g. 'ff', 'NV'). The values are the same as in the fields of the vertical profile."
+  },
+  {"lock", (PyCFunction)_pywrwp_lock, 1,
+    "lock()\n\n"
+    "Locks the generator so that the configuration no longer can be changed. A locked generator can be shared between threads."
+  },
+  {"clone", (PyCFunction)_pywrwp_clone, 1,
+    "clone() -> WrwpCore\n\n"
+    "Returns an unlocked copy of the generator."
+  },
+  {"settings", (PyCFunction)_pywrwp_settings, 1,
+    "settings() -> dictionary\n\n"
+    "Returns all configuration attributes of the generator, e.g. to identify the profiles it generates."
   },
   {NULL, NULL } /* sentinel */
 };
@@ -251,6 +1844,14 @@ static PyObject* _pywrwp_getattro(PyWrwp* self, PyObject* name)
     return PyFloat_FromDouble(Wrwp_getMAXVDIFF(self->wrwp));
   } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("vmin", name) == 0) {
     return PyFloat_FromDouble(Wrwp_getVMIN(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("dealias", name) == 0) {
+    return PyBool_FromLong(Wrwp_getDealias(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_dbzmax", name) == 0) {
+    return PyFloat_FromDouble(Wrwp_getBIO_DBZMAX(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_rcs", name) == 0) {
+    return PyFloat_FromDouble(Wrwp_getBIO_RCS(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_stdmin", name) == 0) {
+    return PyFloat_FromDouble(Wrwp_getBIO_STDMIN(self->wrwp));
   } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("nmin_wnd", name) == 0) {
     return PyInt_FromLong(Wrwp_getNMIN_WND(self->wrwp));
   } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("nmin_ref", name) == 0) {
@@ -265,6 +1866,10 @@ static PyObject* _pywrwp_getattro(PyWrwp* self, PyObject* name)
     return PyFloat_FromDouble(Wrwp_getGAIN_VP(self->wrwp));
   } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("offset_VP", name) == 0) {
     return PyFloat_FromDouble(Wrwp_getOFFSET_VP(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("sampleprecision", name) == 0) {
+    return PyInt_FromLong(Wrwp_getSamplePrecision(self->wrwp));
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("locked", name) == 0) {
+    return PyBool_FromLong(Wrwp_isLocked(self->wrwp));
   }
   return PyObject_GenericGetAttr((PyObject*)self, name);
 }
@@ -278,6 +1883,9 @@ static int _pywrwp_setattro(PyWrwp* self, PyObject* name, PyObject* val)
   if (name == NULL) {
     goto done;
   }
+  if (Wrwp_isLocked(self->wrwp)) {
+    raiseException_gotoTag(done, PyExc_AttributeError, "wrwp generator is locked, use clone() to get a modifiable copy");
+  }
   if (PY_COMPARE_STRING_WITH_ATTRO_NAME("dz", name) == 0) {
     if (PyInt_Check(val)) {
       Wrwp_setDZ(self->wrwp, PyInt_AsLong(val));
@@ -376,6 +1984,36 @@ static int _pywrwp_setattro(PyWrwp* self, PyObject* name, PyObject* val)
     } else {
       raiseException_gotoTag(done, PyExc_TypeError, "vmin must be an integer or a float");
     }
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("dealias", name) == 0) {
+    if (PyBool_Check(val) || PyInt_Check(val)) {
+      Wrwp_setDealias(self->wrwp, PyObject_IsTrue(val));
+    } else {
+      raiseException_gotoTag(done, PyExc_TypeError, "dealias must be a bool or an integer");
+    }
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_dbzmax", name) == 0) {
+    if (PyFloat_Check(val)) {
+      Wrwp_setBIO_DBZMAX(self->wrwp, PyFloat_AsDouble(val));
+    } else if (PyInt_Check(val)) {
+      Wrwp_setBIO_DBZMAX(self->wrwp, (double)PyInt_AsLong(val));
+    } else {
+      raiseException_gotoTag(done, PyExc_TypeError, "bio_dbzmax must be an integer or a float");
+    }
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_rcs", name) == 0) {
+    if (PyFloat_Check(val)) {
+      Wrwp_setBIO_RCS(self->wrwp, PyFloat_AsDouble(val));
+    } else if (PyInt_Check(val)) {
+      Wrwp_setBIO_RCS(self->wrwp, (double)PyInt_AsLong(val));
+    } else {
+      raiseException_gotoTag(done, PyExc_TypeError, "bio_rcs must be an integer or a float");
+    }
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("bio_stdmin", name) == 0) {
+    if (PyFloat_Check(val)) {
+      Wrwp_setBIO_STDMIN(self->wrwp, PyFloat_AsDouble(val));
+    } else if (PyInt_Check(val)) {
+      Wrwp_setBIO_STDMIN(self->wrwp, (double)PyInt_AsLong(val));
+    } else {
+      raiseException_gotoTag(done, PyExc_TypeError, "bio_stdmin must be an integer or a float");
+    }
   } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("nmin_wnd", name) == 0) {
     if (PyInt_Check(val)) {
       Wrwp_setNMIN_WND(self->wrwp, PyInt_AsLong(val));
@@ -424,7 +2062,15 @@ static int _pywrwp_setattro(PyWrwp* self, PyObject* name, PyObject* val)
     } else {
       raiseException_gotoTag(done, PyExc_TypeError, "offset_VP must be an integer or a float");
     }
-  } 
+  } else if (PY_COMPARE_STRING_WITH_ATTRO_NAME("sampleprecision", name) == 0) {
+    if (PyInt_Check(val)) {
+      if (!Wrwp_setSamplePrecision(self->wrwp, (WrwpSamplePrecision)PyInt_AsLong(val))) {
+        raiseException_gotoTag(done, PyExc_ValueError, "sampleprecision must be WrwpSamplePrecision_DOUBLE or WrwpSamplePrecision_FLOAT");
+      }
+    } else {
+      raiseException_gotoTag(done, PyExc_TypeError, "sampleprecision must be an integer");
+    }
+  }
 
   result = 0;
 done:
@@ -458,6 +2104,18 @@ PyDoc_STRVAR(_pywrwp_type_doc,
   "undetect_VP- Undetect value used in the vertical profile, default -9999\n"
   "gain_VP    - Gain value for the fields UWND and VWND, default 1.0\n"
   "offset_VP  - Offset value for the fields UWND and VWND, default 0.0\n"
+  "sampleprecision - Precision used for the gathered samples, WrwpSamplePrecision_DOUBLE (default) or WrwpSamplePrecision_FLOAT.\n"
+  "             In single precision the fit and the moments are still accumulated in double precision.\n"
+  "dealias    - If the radial winds are dealiased against a torus mapping first guess of each layer, default False.\n"
+  "             When dealiasing, the KNMI method does not discard scans with a Nyquist interval below nimin.\n"
+  "             Streams, windows, composites and generate_resolutions do not support dealiasing.\n"
+  "bio_dbzmax - Maximum reflectivity of biological echoes [dBZ], default 20.0\n"
+  "bio_rcs    - Radar cross section of one biological scatterer [cm2], default 11.0\n"
+  "bio_stdmin - Minimum standard deviation of the radial winds of biological echoes [m/s], default 2.0\n"
+  "locked     - If the configuration has been locked with lock() (read only)\n"
+  "\n"
+  "Thread safety: configure the generator, call lock() and then the same generator can be used from several threads\n"
+  "at the same time. Each thread should use its own context (_wrwp.newcontext()) and its own polar volume.\n"
   "\n"
   "Usage:\n"
   "import _wrwp\n"
@@ -513,17 +2171,392 @@ PyTypeObject PyWrwp_Type =
   0,                            /*tp_is_gc*/
 };
 
+PyTypeObject PyWrwpContext_Type =
+{
+  PyVarObject_HEAD_INIT(NULL, 0) /*ob_size*/
+  "WrwpContextCore", /*tp_name*/
+  sizeof(PyWrwpContext), /*tp_size*/
+  0, /*tp_itemsize*/
+  /* methods */
+  (destructor)_pywrwpcontext_dealloc, /*tp_dealloc*/
+  0, /*tp_print*/
+  (getattrfunc)0,               /*tp_getattr*/
+  (setattrfunc)0,               /*tp_setattr*/
+  0,                            /*tp_compare*/
+  0,                            /*tp_repr*/
+  0,                            /*tp_as_number */
+  0,
+  0,                            /*tp_as_mapping */
+  0,                            /*tp_hash*/
+  (ternaryfunc)0,               /*tp_call*/
+  (reprfunc)0,                  /*tp_str*/
+  (getattrofunc)0,              /*tp_getattro*/
+  (setattrofunc)0,              /*tp_setattro*/
+  0,                            /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT, /*tp_flags*/
+  "Execution context owning the scratch memory used when generating profiles", /*tp_doc*/
+};
+
+/**
+ * All methods a rolling window can have
+ */
+static struct PyMethodDef _pywrwpwindow_methods[] =
+{
+  {"addScan", (PyCFunction)_pywrwpwindow_addScan, 1,
+    "addScan(scan,context)\n\n"
+    "Adds a polar scan to the window and retires the scans that ended more than length seconds before it.\n"
+    "The scans must be added in time order. The context is optional, see generate."
+  },
+  {"getNumberOfScans", (PyCFunction)_pywrwpwindow_getNumberOfScans, 1,
+    "getNumberOfScans() -> the number of scans in the window"
+  },
+  {"getProfile", (PyCFunction)_pywrwpwindow_getProfile, 1,
+    "getProfile() -> vp\n\n"
+    "Returns the vertical profile derived from the scans in the window. The location, source and nominal\n"
+    "time are taken from the latest added scan."
+  },
+  {NULL, NULL } /* sentinel */
+};
+
+PyTypeObject PyWrwpWindow_Type =
+{
+  PyVarObject_HEAD_INIT(NULL, 0) /*ob_size*/
+  "WrwpWindowCore", /*tp_name*/
+  sizeof(PyWrwpWindow), /*tp_size*/
+  0, /*tp_itemsize*/
+  /* methods */
+  (destructor)_pywrwpwindow_dealloc, /*tp_dealloc*/
+  0, /*tp_print*/
+  (getattrfunc)0,               /*tp_getattr*/
+  (setattrfunc)0,               /*tp_setattr*/
+  0,                            /*tp_compare*/
+  0,                            /*tp_repr*/
+  0,                            /*tp_as_number */
+  0,
+  0,                            /*tp_as_mapping */
+  0,                            /*tp_hash*/
+  (ternaryfunc)0,               /*tp_call*/
+  (reprfunc)0,                  /*tp_str*/
+  (getattrofunc)0,              /*tp_getattro*/
+  (setattrofunc)0,              /*tp_setattro*/
+  0,                            /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT, /*tp_flags*/
+  "Rolling window of scans giving a refreshed wind profile after every added scan", /*tp_doc*/
+  (traverseproc)0,              /*tp_traverse*/
+  (inquiry)0,                   /*tp_clear*/
+  0,                            /*tp_richcompare*/
+  0,                            /*tp_weaklistoffset*/
+  0,                            /*tp_iter*/
+  0,                            /*tp_iternext*/
+  _pywrwpwindow_methods,        /*tp_methods*/
+};
+
+/**
+ * All methods a composite can have
+ */
+static struct PyMethodDef _pywrwpcomposite_methods[] =
+{
+  {"addVolume", (PyCFunction)_pywrwpcomposite_addVolume, 1,
+    "addVolume(pvol,context)\n\n"
+    "Gathers the samples of the polar volume that are within dmax of the target into the composite. The context\n"
+    "is optional, see generate. Volumes may be added to different composites in parallel if each thread uses its\n"
+    "own context, the composites are then combined with merge."
+  },
+  {"merge", (PyCFunction)_pywrwpcomposite_merge, 1,
+    "merge(other)\n\n"
+    "Adds the radars of another composite created with a generator with the same configuration and with the same\n"
+    "target and fields."
+  },
+  {"getNumberOfRadars", (PyCFunction)_pywrwpcomposite_getNumberOfRadars, 1,
+    "getNumberOfRadars() -> the number of radars in the composite"
+  },
+  {"getProfile", (PyCFunction)_pywrwpcomposite_getProfile, 1,
+    "getProfile() -> vp\n\n"
+    "Returns the vertical profile fitted jointly to the samples of all radars. The location is the target at\n"
+    "height 0, the source and nominal time are taken from the first added volume and the nodes of the radars\n"
+    "are written to how/nodes."
+  },
+  {NULL, NULL } /* sentinel */
+};
+
+PyTypeObject PyWrwpComposite_Type =
+{
+  PyVarObject_HEAD_INIT(NULL, 0) /*ob_size*/
+  "WrwpCompositeCore", /*tp_name*/
+  sizeof(PyWrwpComposite), /*tp_size*/
+  0, /*tp_itemsize*/
+  /* methods */
+  (destructor)_pywrwpcomposite_dealloc, /*tp_dealloc*/
+  0, /*tp_print*/
+  (getattrfunc)0,               /*tp_getattr*/
+  (setattrfunc)0,               /*tp_setattr*/
+  0,                            /*tp_compare*/
+  0,                            /*tp_repr*/
+  0,                            /*tp_as_number */
+  0,
+  0,                            /*tp_as_mapping */
+  0,                            /*tp_hash*/
+  (ternaryfunc)0,               /*tp_call*/
+  (reprfunc)0,                  /*tp_str*/
+  (getattrofunc)0,              /*tp_getattro*/
+  (setattrofunc)0,              /*tp_setattro*/
+  0,                            /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT, /*tp_flags*/
+  "Composite of several radars around a target giving one jointly fitted wind profile", /*tp_doc*/
+  (traverseproc)0,              /*tp_traverse*/
+  (inquiry)0,                   /*tp_clear*/
+  0,                            /*tp_richcompare*/
+  0,                            /*tp_weaklistoffset*/
+  0,                            /*tp_iter*/
+  0,                            /*tp_iternext*/
+  _pywrwpcomposite_methods,     /*tp_methods*/
+};
+
+/**
+ * All methods an archive can have
+ */
+static struct PyMethodDef _pywrwparchive_methods[] =
+{
+  {"append", (PyCFunction)_pywrwparchive_append, 1,
+    "append(wrwp,pvol,method,context)\n\n"
+    "Generates a profile with the archived fields from the polar volume and appends it. The end time of the\n"
+    "profile must be later than the last one in the archive. The method and the context are optional, see generate."
+  },
+  {"getNumberOfProfiles", (PyCFunction)_pywrwparchive_getNumberOfProfiles, 1,
+    "getNumberOfProfiles() -> the number of profiles in the archive"
+  },
+  {"getLevels", (PyCFunction)_pywrwparchive_getLevels, 1,
+    "getLevels() -> the number of layers of the archived profiles"
+  },
+  {"getInterval", (PyCFunction)_pywrwparchive_getInterval, 1,
+    "getInterval() -> the height interval of the layers [m]"
+  },
+  {"getFields", (PyCFunction)_pywrwparchive_getFields, 1,
+    "getFields() -> the archived fields as a comma separated list"
+  },
+  {"find", (PyCFunction)_pywrwparchive_find, 1,
+    "find(start,end) -> (first,count)\n\n"
+    "Finds the profiles with start <= time <= end, the times are integers YYYYMMDDHHMMSS."
+  },
+  {"getTimes", (PyCFunction)_pywrwparchive_getTimes, 1,
+    "getTimes(first,count) -> int64 array\n\n"
+    "Returns the end times YYYYMMDDHHMMSS of count profiles starting with first."
+  },
+  {"read", (PyCFunction)_pywrwparchive_read, 1,
+    "read(field,first,count) -> 2-D array\n\n"
+    "Returns the field of count profiles starting with first as an array with one row of levels values per profile."
+  },
+  {"close", (PyCFunction)_pywrwparchive_close, 1,
+    "close()\n\n"
+    "Closes the archive file, also done when the object is deleted."
+  },
+  {NULL, NULL } /* sentinel */
+};
+
+PyTypeObject PyWrwpArchive_Type =
+{
+  PyVarObject_HEAD_INIT(NULL, 0) /*ob_size*/
+  "WrwpArchiveCore", /*tp_name*/
+  sizeof(PyWrwpArchive), /*tp_size*/
+  0, /*tp_itemsize*/
+  /* methods */
+  (destructor)_pywrwparchive_dealloc, /*tp_dealloc*/
+  0, /*tp_print*/
+  (getattrfunc)0,               /*tp_getattr*/
+  (setattrfunc)0,               /*tp_setattr*/
+  0,                            /*tp_compare*/
+  0,                            /*tp_repr*/
+  0,                            /*tp_as_number */
+  0,
+  0,                            /*tp_as_mapping */
+  0,                            /*tp_hash*/
+  (ternaryfunc)0,               /*tp_call*/
+  (reprfunc)0,                  /*tp_str*/
+  (getattrofunc)0,              /*tp_getattro*/
+  (setattrofunc)0,              /*tp_setattro*/
+  0,                            /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT, /*tp_flags*/
+  "Append-only time-height archive of profiles with range queries", /*tp_doc*/
+  (traverseproc)0,              /*tp_traverse*/
+  (inquiry)0,                   /*tp_clear*/
+  0,                            /*tp_richcompare*/
+  0,                            /*tp_weaklistoffset*/
+  0,                            /*tp_iter*/
+  0,                            /*tp_iternext*/
+  _pywrwparchive_methods,       /*tp_methods*/
+};
+
+/**
+ * All methods a shared memory ring can have
+ */
+static struct PyMethodDef _pywrwpshm_methods[] =
+{
+  {"publish", (PyCFunction)_pywrwpshm_publish, 1,
+    "publish(wrwp,pvol,method,fields,context) -> vp\n\n"
+    "Generates a profile from the polar volume, publishes it in the next slot of the ring and returns it. The fields\n"
+    "must include the published ones and default to them. The method and the context are optional, see generate."
+  },
+  {"getSequence", (PyCFunction)_pywrwpshm_getSequence, 1,
+    "getSequence() -> the sequence of the latest published profile, 0 if none"
+  },
+  {"getLevels", (PyCFunction)_pywrwpshm_getLevels, 1,
+    "getLevels() -> the number of layers of the published profiles"
+  },
+  {"getInterval", (PyCFunction)_pywrwpshm_getInterval, 1,
+    "getInterval() -> the height interval of the layers [m]"
+  },
+  {"getNumberOfSlots", (PyCFunction)_pywrwpshm_getNumberOfSlots, 1,
+    "getNumberOfSlots() -> the number of profiles kept in the ring"
+  },
+  {"getFields", (PyCFunction)_pywrwpshm_getFields, 1,
+    "getFields() -> the published fields as a comma separated list"
+  },
+  {"read", (PyCFunction)_pywrwpshm_read, 1,
+    "read(sequence) -> (sequence,time,dictionary)\n\n"
+    "Copies a published profile, by default the latest. The time is the end time as an integer YYYYMMDDHHMMSS and\n"
+    "the dictionary has an array per field. Raises IndexError if the profile has been overwritten."
+  },
+  {"close", (PyCFunction)_pywrwpshm_close, 1,
+    "close()\n\n"
+    "Unmaps the segment, also done when the object is deleted. The segment is kept until unlinkshm is called."
+  },
+  {NULL, NULL } /* sentinel */
+};
+
+PyTypeObject PyWrwpShm_Type =
+{
+  PyVarObject_HEAD_INIT(NULL, 0) /*ob_size*/
+  "WrwpShmCore", /*tp_name*/
+  sizeof(PyWrwpShm), /*tp_size*/
+  0, /*tp_itemsize*/
+  /* methods */
+  (destructor)_pywrwpshm_dealloc, /*tp_dealloc*/
+  0, /*tp_print*/
+  (getattrfunc)0,               /*tp_getattr*/
+  (setattrfunc)0,               /*tp_setattr*/
+  0,                            /*tp_compare*/
+  0,                            /*tp_repr*/
+  0,                            /*tp_as_number */
+  0,
+  0,                            /*tp_as_mapping */
+  0,                            /*tp_hash*/
+  (ternaryfunc)0,               /*tp_call*/
+  (reprfunc)0,                  /*tp_str*/
+  (getattrofunc)0,              /*tp_getattro*/
+  (setattrofunc)0,              /*tp_setattro*/
+  0,                            /*tp_as_buffer*/
+  Py_TPFLAGS_DEFAULT, /*tp_flags*/
+  "Shared memory ring buffer of the latest profiles for local readers", /*tp_doc*/
+  (traverseproc)0,              /*tp_traverse*/
+  (inquiry)0,                   /*tp_clear*/
+  0,                            /*tp_richcompare*/
+  0,                            /*tp_weaklistoffset*/
+  0,                            /*tp_iter*/
+  0,                            /*tp_iternext*/
+  _pywrwpshm_methods,           /*tp_methods*/
+};
+
 /*@} End of Type definitions */
 
 /// --------------------------------------------------------------------
 /// Module setup
 /// --------------------------------------------------------------------
 /*@{ Module setup */
+/**
+ * Adds a long constant to the module dictionary
+ * @param[in] dictionary - the module dictionary
+ * @param[in] name - the name of the constant
+ * @param[in] value - the value
+ */
+static void add_long_constant(PyObject* dictionary, const char* name, long value)
+{
+  PyObject* tmp = NULL;
+  tmp = PyInt_FromLong(value);
+  if (tmp != NULL) {
+    PyDict_SetItemString(dictionary, name, tmp);
+  }
+  Py_XDECREF(tmp);
+}
+
 static PyMethodDef functions[] = {
   {"new", (PyCFunction)_pywrwp_new, 1,
      "new() -> new instance of the WrwpCore object\n\n"
      "Creates a new instance of the WrwpCore object"
   },
+  {"newcontext", (PyCFunction)_pywrwp_newcontext, 1,
+     "newcontext() -> new instance of the WrwpContextCore object\n\n"
+     "Creates a new execution context that can be passed to generate. A context keeps the scratch memory\n"
+     "between generations and may only be used by one thread at a time."
+  },
+  {"newwindow", (PyCFunction)_pywrwp_newwindow, 1,
+     "newwindow(wrwp,length,method,fields) -> new instance of the WrwpWindowCore object\n\n"
+     "Creates a rolling window that gives a refreshed profile after every added scan from the scans that ended\n"
+     "within length seconds of the latest one, across volume boundaries. Only the contribution of each scan to\n"
+     "each layer is kept so adding and retiring scans is cheap. Only the SMHI method is supported. The window uses\n"
+     "a copy of the configuration of wrwp, later changes to wrwp do not affect it."
+  },
+  {"createarchive", (PyCFunction)_pywrwp_createarchive, 1,
+     "createarchive(filename,levels,interval,fields) -> new instance of the WrwpArchiveCore object\n\n"
+     "Creates an append-only archive file for the profiles of one radar, fails if the file exists. Each profile is\n"
+     "a fixed size record with the time and one column per field, so time ranges are found by a binary search and\n"
+     "read through a memory mapping.\n\n"
+     "filename - The archive file\n"
+     "levels   - Number of layers, hmax / dz of the generator\n"
+     "interval - Height interval of the layers [m], dz of the generator\n"
+     "fields   - Comma separated list of the archived fields, see generate"
+  },
+  {"openarchive", (PyCFunction)_pywrwp_openarchive, 1,
+     "openarchive(filename) -> new instance of the WrwpArchiveCore object\n\n"
+     "Opens an archive created with createarchive for appending and reading."
+  },
+  {"createshm", (PyCFunction)_pywrwp_createshm, 1,
+     "createshm(name,levels,interval,fields,nslots) -> new instance of the WrwpShmCore object\n\n"
+     "Creates a POSIX shared memory ring buffer, e.g. wrwp_seang, for publishing the latest profiles of one radar\n"
+     "to local readers. An existing segment with the same layout is reused and its sequence continues. The binary\n"
+     "layout is documented in wrwp_shm.h.\n\n"
+     "name     - The name of the segment\n"
+     "levels   - Number of layers, hmax / dz of the generator\n"
+     "interval - Height interval of the layers [m], dz of the generator\n"
+     "fields   - Comma separated list of the published fields, see generate\n"
+     "nslots   - Number of profiles kept in the ring, default 16"
+  },
+  {"attachshm", (PyCFunction)_pywrwp_attachshm, 1,
+     "attachshm(name) -> new instance of the WrwpShmCore object\n\n"
+     "Attaches to a ring created with createshm for reading."
+  },
+  {"unlinkshm", (PyCFunction)_pywrwp_unlinkshm, 1,
+     "unlinkshm(name)\n\n"
+     "Removes a ring created with createshm, attached objects stay valid until they are closed."
+  },
+  {"newcomposite", (PyCFunction)_pywrwp_newcomposite, 1,
+     "newcomposite(wrwp,lat,lon,method,fields) -> new instance of the WrwpCompositeCore object\n\n"
+     "Creates a composite of several radars around the target at lat/lon [rad], e.g. an airport. The gates of each\n"
+     "radar that are at least dmin from the radar and within dmax of the target are gathered into a common height\n"
+     "grid and one wind profile is fitted jointly to all of them. Only the SMHI method is supported. The composite\n"
+     "uses a copy of the configuration of wrwp, later changes to wrwp do not affect it."
+  },
+  {"generate_configurations", (PyCFunction)_pywrwp_generate_configurations, 1,
+     "generate_configurations(inputs,configurations,fields,context) -> list of vp\n\n"
+     "Derives one profile per configuration from the same inputs, e.g. when sweeping vmin, dmin/dmax, emin/emax,\n"
+     "maxvdiff or the method. The inputs are decoded once using the union of the windows of the configurations and\n"
+     "each profile is the same as when generated separately with generate_multi.\n\n"
+     "inputs         - A polar volume or a list of polar volumes and/or polar scans\n"
+     "configurations - A list of (wrwp, method) tuples, method is SMHI or KNMI and defaults to SMHI if None\n"
+     "fields         - A comma separated list of fields to be generated, see generate.\n"
+     "context        - An execution context created with _wrwp.newcontext(). Optional."
+  },
+  {"setinstructionset", (PyCFunction)_pywrwp_setinstructionset, 1,
+     "setinstructionset(isa)\n\n"
+     "Forces the instruction set used when accumulating the normal equations of the wind fit. One of\n"
+     "WrwpInstructionSet_AUTO (default), _SCALAR, _SSE2, _AVX2 or _AVX512. The result is the same for all\n"
+     "instruction sets, this is intended for testing and benchmarking. Affects all generators in the process."
+  },
+  {"getinstructionset", (PyCFunction)_pywrwp_getinstructionset, 1,
+     "getinstructionset() -> the instruction set used when accumulating the normal equations"
+  },
+  {"isinstructionsetsupported", (PyCFunction)_pywrwp_isinstructionsetsupported, 1,
+     "isinstructionsetsupported(isa) -> True if the instruction set is supported by this cpu"
+  },
   {NULL,NULL} /*Sentinel*/
 };
 
@@ -537,6 +2570,26 @@ MOD_INIT(_wrwp)
 
   MOD_INIT_VERIFY_TYPE_READY(&PyWrwp_Type);
 
+  MOD_INIT_SETUP_TYPE(PyWrwpContext_Type, &PyType_Type);
+
+  MOD_INIT_VERIFY_TYPE_READY(&PyWrwpContext_Type);
+
+  MOD_INIT_SETUP_TYPE(PyWrwpWindow_Type, &PyType_Type);
+
+  MOD_INIT_VERIFY_TYPE_READY(&PyWrwpWindow_Type);
+
+  MOD_INIT_SETUP_TYPE(PyWrwpComposite_Type, &PyType_Type);
+
+  MOD_INIT_VERIFY_TYPE_READY(&PyWrwpComposite_Type);
+
+  MOD_INIT_SETUP_TYPE(PyWrwpArchive_Type, &PyType_Type);
+
+  MOD_INIT_VERIFY_TYPE_READY(&PyWrwpArchive_Type);
+
+  MOD_INIT_SETUP_TYPE(PyWrwpShm_Type, &PyType_Type);
+
+  MOD_INIT_VERIFY_TYPE_READY(&PyWrwpShm_Type);
+
   MOD_INIT_DEF(module, "_wrwp", _pywrwp_type_doc, functions);
   if (module == NULL) {
     return MOD_INIT_ERROR;
@@ -556,8 +2609,17 @@ MOD_INIT(_wrwp)
     return MOD_INIT_ERROR;
   }
 
+  add_long_constant(dictionary, "WrwpSamplePrecision_DOUBLE", WrwpSamplePrecision_DOUBLE);
+  add_long_constant(dictionary, "WrwpSamplePrecision_FLOAT", WrwpSamplePrecision_FLOAT);
+  add_long_constant(dictionary, "WrwpInstructionSet_AUTO", WrwpKernelInstructionSet_AUTO);
+  add_long_constant(dictionary, "WrwpInstructionSet_SCALAR", WrwpKernelInstructionSet_SCALAR);
+  add_long_constant(dictionary, "WrwpInstructionSet_SSE2", WrwpKernelInstructionSet_SSE2);
+  add_long_constant(dictionary, "WrwpInstructionSet_AVX2", WrwpKernelInstructionSet_AVX2);
+  add_long_constant(dictionary, "WrwpInstructionSet_AVX512", WrwpKernelInstructionSet_AVX512);
+
   import_array();
   import_pypolarvolume();
+  import_pypolarscan();
   import_pyverticalprofile();
   PYRAVE_DEBUG_INITIALIZE;
   return MOD_INIT_SUCCESS(module);
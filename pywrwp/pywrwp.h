@@ -26,6 +26,8 @@ along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
 #define PYWRWP_H
 #include <Python.h>
 #include "wrwp.h"
+#include "wrwp_archive.h"
+#include "wrwp_shm.h"
 
 /**
  * The wrwp generator
@@ -35,6 +37,47 @@ typedef struct {
   Wrwp_t* wrwp;  /**< the c-api wrwp generator */
 } PyWrwp;
 
+/**
+ * The execution context used by the wrwp generator
+ */
+typedef struct {
+  PyObject_HEAD /*Always has to be on top*/
+  WrwpContext_t* ctx;  /**< the c-api wrwp context */
+  int inuse;           /**< if the context currently is used by a generation */
+} PyWrwpContext;
+
+/**
+ * A rolling window of scans
+ */
+typedef struct {
+  PyObject_HEAD /*Always has to be on top*/
+  WrwpWindow_t* window;  /**< the c-api rolling window */
+} PyWrwpWindow;
+
+/**
+ * A composite of several radars around a target
+ */
+typedef struct {
+  PyObject_HEAD /*Always has to be on top*/
+  WrwpComposite_t* composite;  /**< the c-api composite */
+} PyWrwpComposite;
+
+/**
+ * An append-only archive of profiles
+ */
+typedef struct {
+  PyObject_HEAD /*Always has to be on top*/
+  WrwpArchive_t* archive;  /**< the c-api archive */
+} PyWrwpArchive;
+
+/**
+ * A shared memory ring of profiles
+ */
+typedef struct {
+  PyObject_HEAD /*Always has to be on top*/
+  WrwpShm_t* shm;  /**< the c-api shared memory ring */
+} PyWrwpShm;
+
 #define PyWrwp_Type_NUM 0                     /**< index for Type */
 
 #define PyWrwp_GetNative_NUM 1                /**< index for GetNative fp */
@@ -56,6 +99,36 @@ extern PyTypeObject PyWrwp_Type;
 /** checks if the object is a PyWrwp type or not */
 #define PyWrwp_Check(op) ((op)->ob_type == &PyWrwp_Type)
 
+/** declared in pywrwp module */
+extern PyTypeObject PyWrwpContext_Type;
+
+/** checks if the object is a PyWrwpContext type or not */
+#define PyWrwpContext_Check(op) ((op)->ob_type == &PyWrwpContext_Type)
+
+/** declared in pywrwp module */
+extern PyTypeObject PyWrwpWindow_Type;
+
+/** checks if the object is a PyWrwpWindow type or not */
+#define PyWrwpWindow_Check(op) ((op)->ob_type == &PyWrwpWindow_Type)
+
+/** declared in pywrwp module */
+extern PyTypeObject PyWrwpComposite_Type;
+
+/** checks if the object is a PyWrwpComposite type or not */
+#define PyWrwpComposite_Check(op) ((op)->ob_type == &PyWrwpComposite_Type)
+
+/** declared in pywrwp module */
+extern PyTypeObject PyWrwpArchive_Type;
+
+/** checks if the object is a PyWrwpArchive type or not */
+#define PyWrwpArchive_Check(op) ((op)->ob_type == &PyWrwpArchive_Type)
+
+/** declared in pywrwp module */
+extern PyTypeObject PyWrwpShm_Type;
+
+/** checks if the object is a PyWrwpShm type or not */
+#define PyWrwpShm_Check(op) ((op)->ob_type == &PyWrwpShm_Type)
+
 /** Prototype for PyWrwp modules GetNative function */
 static PyWrwp_GetNative_RETURN PyWrwp_GetNative PyWrwp_GetNative_PROTO;
 
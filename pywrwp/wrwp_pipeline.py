@@ -0,0 +1,140 @@
+'''
+Copyright (C) 2026- Swedish Meteorological and Hydrological Institute (SMHI)
+
+This file is part of baltrad-wrwp.
+
+baltrad-wrwp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+baltrad-wrwp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+## Pipeline overlapping the reading of polar volumes, the generation of the vertical profiles and
+## the writing of them. A loader thread reads ahead, compute workers generate and the calling thread
+## writes behind, so the CPU does not idle during the HDF5 I/O and vice versa.
+##
+## pipeline = wrwp_pipeline.Pipeline(load, compute, write, workers=4, depth=2)
+## pipeline.run(files, done)
+##
+## The queues between the stages hold at most depth items, so at most depth + workers + 1 loaded
+## volumes and depth + 1 generated profiles are in memory at any time.
+##
+## @file
+## @date 2026-10-18
+
+import queue
+import threading
+
+## Marks the end of the items in a queue
+_END = object()
+
+class Pipeline(object):
+  ## Constructor
+  #@param load function(item) returning the loaded data of an item, called by the loader thread in item order
+  #@param compute function(item, data) returning the result, called concurrently by the compute workers
+  #@param write function(item, result) returning the outcome, called by the calling thread
+  #@param workers the number of compute workers
+  #@param depth the maximum number of items waiting between two stages
+  def __init__(self, load, compute, write, workers=1, depth=2):
+    self._load = load
+    self._compute = compute
+    self._write = write
+    self._workers = max(workers, 1)
+    self._loaded = queue.Queue(max(depth, 1))
+    self._computed = queue.Queue(max(depth, 1))
+    self._stop = threading.Event()
+
+  ## Puts a value on a queue, gives up if the pipeline is stopped
+  #@return True if the value was put
+  def _put(self, q, value):
+    while not self._stop.is_set():
+      try:
+        q.put(value, timeout=0.1)
+        return True
+      except queue.Full:
+        pass
+    return False
+
+  ## Gets a value from a queue
+  #@return the value or _END if the pipeline is stopped
+  def _get(self, q):
+    while not self._stop.is_set():
+      try:
+        return q.get(timeout=0.1)
+      except queue.Empty:
+        pass
+    return _END
+
+  def _loader(self, items):
+    try:
+      for item in items:
+        if self._stop.is_set():
+          break
+        try:
+          entry = (item, self._load(item), None)
+        except Exception as e:
+          entry = (item, None, e)
+        if not self._put(self._loaded, entry):
+          break
+    finally:
+      for i in range(self._workers):
+        self._put(self._loaded, _END)
+
+  def _worker(self):
+    try:
+      while True:
+        entry = self._get(self._loaded)
+        if entry is _END:
+          break
+        item, data, error = entry
+        result = None
+        if error is None:
+          try:
+            result = self._compute(item, data)
+          except Exception as e:
+            error = e
+        data = None
+        if not self._put(self._computed, (item, result, error)):
+          break
+    finally:
+      self._put(self._computed, _END)
+
+  ## Runs all items through the pipeline and returns when all have been written
+  #@param items an iterable of items, consumed by the loader as it gets to them
+  #@param done function(item, outcome, error) called by the calling thread after each item, error is None on success
+  #@throws the exception raised by done, the pipeline is then stopped
+  def run(self, items, done):
+    self._stop.clear()
+    threads = [threading.Thread(target=self._loader, args=(items,))]
+    threads.extend(threading.Thread(target=self._worker) for i in range(self._workers))
+    for t in threads:
+      t.daemon = True
+      t.start()
+    try:
+      remaining = self._workers
+      while remaining > 0:
+        entry = self._get(self._computed)
+        if entry is _END:
+          remaining = remaining - 1
+          continue
+        item, result, error = entry
+        outcome = None
+        if error is None:
+          try:
+            outcome = self._write(item, result)
+          except Exception as e:
+            error = e
+        result = None
+        done(item, outcome, error)
+    finally:
+      self._stop.set()
+      for t in threads:
+        t.join()
@@ -32,6 +32,9 @@ import _raveio, _rave
 import xml.etree.cElementTree as ET
 import sys
 import os
+import tempfile
+import subprocess
+import shutil
 
 sys.path.append(os.path.realpath(__file__))
 
@@ -328,6 +331,42 @@ class WrwpTest(unittest.TestCase):
     obj.nmin_ref = 20
     self.assertEqual(20, obj.nmin_ref, 4)
 
+  def test_sampleprecision(self):
+    obj = _wrwp.new()
+    self.assertEqual(_wrwp.WrwpSamplePrecision_DOUBLE, obj.sampleprecision)
+    obj.sampleprecision = _wrwp.WrwpSamplePrecision_FLOAT
+    self.assertEqual(_wrwp.WrwpSamplePrecision_FLOAT, obj.sampleprecision)
+    try:
+      obj.sampleprecision = 99
+      self.fail("Expected ValueError")
+    except ValueError:
+      pass
+    self.assertEqual(_wrwp.WrwpSamplePrecision_FLOAT, obj.sampleprecision)
+
+  def test_generate_single_precision(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,ff,dd,DBZH,NZ"
+
+    for method in ["SMHI", "KNMI"]:
+      wrwp.sampleprecision = _wrwp.WrwpSamplePrecision_DOUBLE
+      vp_double = wrwp.generate(pvol, method, fields)
+      wrwp.sampleprecision = _wrwp.WrwpSamplePrecision_FLOAT
+      vp_float = wrwp.generate(pvol, method, fields)
+
+      self.assertEqual(vp_double.getNV().getData().tolist(), vp_float.getNV().getData().tolist())
+      self.assertEqual(vp_double.getNZ().getData().tolist(), vp_float.getNZ().getData().tolist())
+      ffd = vp_double.getFF().getData().tolist()
+      fff = vp_float.getFF().getData().tolist()
+      dbzd = vp_double.getDBZ().getData().tolist()
+      dbzf = vp_float.getDBZ().getData().tolist()
+      if method == "KNMI": # The KNMI method always gathers in double precision
+        self.assertEqual(ffd, fff)
+        self.assertEqual(dbzd, dbzf)
+      for i in range(len(ffd)):
+        self.assertAlmostEqual(ffd[i][0], fff[i][0], 2)
+        self.assertAlmostEqual(dbzd[i][0], dbzf[i][0], 2)
+
   def test_generate(self):
     pvol = _raveio.open(self.FIXTURE).object
     wrwp = load_wrwp_defaults_to_obj()
@@ -456,6 +495,929 @@ class WrwpTest(unittest.TestCase):
     self.assertEqual(True, exceptionTest)
 
     
+  def test_generate_reflectivity_only(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+
+    vp_all = wrwp.generate(pvol, "SMHI", "ff,DBZH,DBZH_dev,NZ")
+    vp = wrwp.generate(pvol, "SMHI", "DBZH,DBZH_dev,NZ")
+
+    self.assertTrue(vp.getFF() is None)
+    self.assertTrue(vp.getNV() is None)
+    self.assertEqual(vp_all.getDBZ().getData().tolist(), vp.getDBZ().getData().tolist())
+    self.assertEqual(vp_all.getDBZDev().getData().tolist(), vp.getDBZDev().getData().tolist())
+    self.assertEqual(vp_all.getNZ().getData().tolist(), vp.getNZ().getData().tolist())
+
+  def test_generate_wind_only(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+
+    for method in ["SMHI", "KNMI"]:
+      vp_all = wrwp.generate(pvol, method, "ff,dd,UWND,VWND,DBZH")
+      vp = wrwp.generate(pvol, method, "ff,dd,UWND,VWND")
+
+      self.assertTrue(vp.getDBZ() is None)
+      self.assertTrue(vp.getNZ() is None)
+      self.assertEqual(vp_all.getFF().getData().tolist(), vp.getFF().getData().tolist())
+      self.assertEqual(vp_all.getDD().getData().tolist(), vp.getDD().getData().tolist())
+      self.assertEqual(vp_all.getUWND().getData().tolist(), vp.getUWND().getData().tolist())
+      self.assertEqual(vp_all.getVWND().getData().tolist(), vp.getVWND().getData().tolist())
+
+  def test_generate_default_method(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+
+    vp_smhi = wrwp.generate(pvol, "SMHI", "ff")
+    vp = wrwp.generate(pvol, None, "ff")
+
+    self.assertEqual(vp_smhi.getFF().getData().tolist(), vp.getFF().getData().tolist())
+
+  def test_lock(self):
+    obj = _wrwp.new()
+    obj.dz = 250
+    self.assertFalse(obj.locked)
+    obj.lock()
+    self.assertTrue(obj.locked)
+    try:
+      obj.dz = 100
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+    self.assertEqual(250, obj.dz)
+
+  def test_clone(self):
+    obj = load_wrwp_defaults_to_obj()
+    obj.dz = 250
+    obj.lock()
+    cpy = obj.clone()
+    self.assertFalse(cpy.locked)
+    self.assertEqual(250, cpy.dz)
+    self.assertEqual(obj.hmax, cpy.hmax)
+    self.assertEqual(obj.vmin, cpy.vmin)
+    cpy.dz = 100
+    self.assertEqual(100, cpy.dz)
+    self.assertEqual(250, obj.dz)
+
+  def test_generate_with_context(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    ctx = _wrwp.newcontext()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+    for method in ["SMHI", "KNMI"]:
+      vp = wrwp.generate(pvol, method, fields)
+      vp_ctx = wrwp.generate(pvol, method, fields, ctx)
+      vp_ctx2 = wrwp.generate(pvol, method, fields, ctx) # reused scratch memory
+      for getter in ["getNV", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev", "getNZ"]:
+        expected = getattr(vp, getter)().getData().tolist()
+        self.assertEqual(expected, getattr(vp_ctx, getter)().getData().tolist())
+        self.assertEqual(expected, getattr(vp_ctx2, getter)().getData().tolist())
+
+  def test_generate_image(self):
+    wrwp = load_wrwp_defaults_to_obj()
+    with open(self.FIXTURE, "rb") as fp:
+      image = fp.read()
+    profile = wrwp.generate_image(image, "SMHI", "ff,dd,NV")
+    self.assertEqual(b"\x89HDF\r\n\x1a\n", profile[:8])
+
+    # The image is only written to a file to verify it with raveio
+    fd, filename = tempfile.mkstemp(suffix=".h5")
+    try:
+      with os.fdopen(fd, "wb") as fp:
+        fp.write(profile)
+      vp = _raveio.open(filename).object
+      expected = wrwp.generate(_raveio.open(self.FIXTURE).object, "SMHI", "ff,dd,NV")
+      self.assertEqual(expected.getFF().getData().tolist(), vp.getFF().getData().tolist())
+      self.assertEqual(expected.getDD().getData().tolist(), vp.getDD().getData().tolist())
+      self.assertEqual(expected.date, vp.date)
+      self.assertEqual(expected.time, vp.time)
+    finally:
+      os.remove(filename)
+    try:
+      wrwp.generate_image(b"not hdf5", "SMHI")
+      self.fail("Expected RuntimeError")
+    except RuntimeError:
+      pass
+
+  def test_generate_result(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+    getters = {"NV":"getNV", "HGHT":"getHGHT", "UWND":"getUWND", "VWND":"getVWND", "ff":"getFF", "ff_dev":"getFFDev",
+               "dd":"getDD", "DBZH":"getDBZ", "DBZH_dev":"getDBZDev", "NZ":"getNZ"}
+
+    for method in ["SMHI", "KNMI"]:
+      vp = wrwp.generate(pvol, method, fields)
+      result = wrwp.generate_result(pvol, method, fields)
+      self.assertEqual(sorted(getters.keys()), sorted(result.keys()))
+      for name in getters:
+        expected = [x[0] for x in getattr(vp, getters[name])().getData().tolist()]
+        self.assertEqual(vp.getLevels(), len(result[name]))
+        self.assertEqual(expected, result[name].tolist())
+
+    result = wrwp.generate_result(pvol, "SMHI", "ff,NZ")
+    self.assertEqual(["NZ", "ff"], sorted(result.keys()))
+
+  def test_generate_multi(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+    nscans = pvol.getNumberOfScans()
+
+    # Split the volume into two partial volumes, the lower and the upper elevations
+    lower = _raveio.open(self.FIXTURE).object
+    upper = _raveio.open(self.FIXTURE).object
+    for i in reversed(range(nscans//2, nscans)):
+      lower.removeScan(i)
+    for i in reversed(range(0, nscans//2)):
+      upper.removeScan(i)
+
+    for method in ["SMHI", "KNMI"]:
+      expected = wrwp.generate(pvol, method, fields)
+      for inputs in [[lower, upper], [pvol.getScan(i) for i in range(nscans)]]:
+        vp = wrwp.generate_multi(inputs, method, fields)
+        self.assertEqual(expected.getLevels(), vp.getLevels())
+        if inputs[0] == lower:
+          self.assertEqual(expected.source, vp.source)
+        self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+        self.assertEqual(expected.startdate, vp.startdate)
+        self.assertEqual(expected.starttime, vp.starttime)
+        self.assertEqual(expected.enddate, vp.enddate)
+        self.assertEqual(expected.endtime, vp.endtime)
+        for getter in ["getNV", "getHGHT", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev", "getNZ"]:
+          self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+
+  def test_generate_multi_invalid_inputs(self):
+    wrwp = load_wrwp_defaults_to_obj()
+    for inputs in [[], [wrwp]]:
+      try:
+        wrwp.generate_multi(inputs, "SMHI", "ff")
+        self.fail("Expected AttributeError")
+      except AttributeError:
+        pass
+
+  def test_generate_resolutions(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+    resolutions = [(200, 12000), (400, 12000), (1000, 6000)]
+
+    for method in ["SMHI", "KNMI"]:
+      vps = wrwp.generate_resolutions(pvol, resolutions, method, fields)
+      self.assertEqual(len(resolutions), len(vps))
+      for (dz, hmax), vp in zip(resolutions, vps):
+        direct = load_wrwp_defaults_to_obj()
+        direct.dz = dz
+        direct.hmax = hmax
+        expected = direct.generate(pvol, method, fields)
+        self.assertEqual(expected.getLevels(), vp.getLevels())
+        self.assertEqual(expected.interval, vp.interval)
+        self.assertEqual(expected.maxheight, vp.maxheight)
+        self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+        for getter in ["getNV", "getHGHT", "getNZ"]:
+          self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+        # The thicker layers are aggregated from the thin ones, i.e. summed in another order
+        for getter in ["getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev"]:
+          for a, b in zip(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist()):
+            self.assertAlmostEqual(a, b, 4)
+
+  def test_generate_resolutions_invalid(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    for resolutions in [[], [(0, 12000)], [(200, 100)]]:
+      try:
+        wrwp.generate_resolutions(pvol, resolutions, "SMHI", "ff")
+        self.fail("Expected RuntimeError")
+      except RuntimeError:
+        pass
+
+  def test_generate_streaming(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.lock()
+    ctx = _wrwp.newcontext()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+    for method in ["SMHI", "KNMI"]:
+      expected = wrwp.generate(pvol, method, fields)
+      wrwp.begin(method, fields, ctx)
+      for i in range(pvol.getNumberOfScans()):
+        wrwp.addScan(pvol.getScan(i), ctx)
+      vp = wrwp.finalize(ctx)
+      self.assertEqual(expected.getLevels(), vp.getLevels())
+      self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+      self.assertEqual(expected.starttime, vp.starttime)
+      self.assertEqual(expected.endtime, vp.endtime)
+      for getter in ["getNV", "getHGHT", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getNZ"]:
+        self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+      # The deviations are combined scan by scan
+      for a, b in zip(expected.getDBZDev().getData().tolist(), vp.getDBZDev().getData().tolist()):
+        self.assertAlmostEqual(a, b, 4)
+
+  def test_generate_streaming_requires_begin(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    ctx = _wrwp.newcontext()
+    try:
+      wrwp.addScan(pvol.getScan(0), ctx)
+      self.fail("Expected RuntimeError")
+    except RuntimeError:
+      pass
+    try:
+      wrwp.begin("SMHI", "ff", None)
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+
+  def test_window(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+    expected = wrwp.generate(pvol, "SMHI", fields)
+
+    window = _wrwp.newwindow(wrwp, 3600, "SMHI", fields)
+    self.assertFalse(wrwp.locked)
+    wrwp.dz = 500  # does not affect the window
+    for i in range(pvol.getNumberOfScans()):
+      window.addScan(pvol.getScan(i))
+    self.assertEqual(pvol.getNumberOfScans(), window.getNumberOfScans())
+    vp = window.getProfile()
+    self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+    self.assertEqual(expected.starttime, vp.starttime)
+    self.assertEqual(expected.endtime, vp.endtime)
+    for getter in ["getNV", "getHGHT", "getNZ"]:
+      self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+    # The sums are combined scan by scan
+    for getter in ["getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev"]:
+      for a, b in zip(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist()):
+        self.assertAlmostEqual(a, b, 4)
+
+  def test_window_retires_old_scans(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    window = _wrwp.newwindow(wrwp, 0, "SMHI", "NV,ff,DBZH,NZ")
+    for i in range(pvol.getNumberOfScans()):
+      window.addScan(pvol.getScan(i))
+    self.assertEqual(1, window.getNumberOfScans())
+    vp = window.getProfile()
+    self.assertEqual(1, len(vp.getAttribute("how/angles").split(",")))
+
+  def test_window_knmi_not_supported(self):
+    wrwp = load_wrwp_defaults_to_obj()
+    try:
+      _wrwp.newwindow(wrwp, 600, "KNMI")
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+
+  def test_composite(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,dd,DBZH,NZ"
+    expected = wrwp.generate(pvol, "SMHI", fields)
+
+    # A single radar with the target at its own location uses the same gates
+    composite = _wrwp.newcomposite(wrwp, pvol.latitude, pvol.longitude, "SMHI", fields)
+    self.assertFalse(wrwp.locked)
+    wrwp.dz = wrwp.dz  # the generator may still be configured
+    composite.addVolume(pvol)
+    self.assertEqual(1, composite.getNumberOfRadars())
+    vp = composite.getProfile()
+    self.assertEqual("'SE50'", vp.getAttribute("how/nodes"))
+    self.assertAlmostEqual(pvol.latitude, vp.latitude, 6)
+    self.assertAlmostEqual(0.0, vp.height, 4)
+    for getter in ["getNV", "getHGHT", "getNZ"]:
+      self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+    for getter in ["getUWND", "getVWND", "getFF", "getDD", "getDBZ"]:
+      for a, b in zip(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist()):
+        self.assertAlmostEqual(a, b, 4)
+
+    # Partial composites gathered with separate contexts are merged into one fit
+    other = _wrwp.newcomposite(wrwp, pvol.latitude, pvol.longitude, "SMHI", fields)
+    other.addVolume(pvol, _wrwp.newcontext())
+    composite.merge(other)
+    self.assertEqual(2, composite.getNumberOfRadars())
+    merged = composite.getProfile()
+    self.assertEqual("'SE50','SE50'", merged.getAttribute("how/nodes"))
+    for a, b in zip(expected.getNV().getData().tolist(), merged.getNV().getData().tolist()):
+      self.assertEqual(2 * a if a > 0 else a, b)
+    for a, b in zip(expected.getFF().getData().tolist(), merged.getFF().getData().tolist()):
+      self.assertAlmostEqual(a, b, 4)
+
+  def test_composite_merge_compares_configuration(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    fields = "NV,ff"
+    composite = _wrwp.newcomposite(load_wrwp_defaults_to_obj(), pvol.latitude, pvol.longitude, "SMHI", fields)
+    composite.addVolume(pvol)
+
+    # Separately created generators with the same configuration
+    other = _wrwp.newcomposite(load_wrwp_defaults_to_obj(), pvol.latitude, pvol.longitude, "SMHI", fields)
+    other.addVolume(pvol)
+    composite.merge(other)
+    self.assertEqual(2, composite.getNumberOfRadars())
+
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.dmin = wrwp.dmin + 1000
+    different = _wrwp.newcomposite(wrwp, pvol.latitude, pvol.longitude, "SMHI", fields)
+    different.addVolume(pvol)
+    try:
+      composite.merge(different)
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+    self.assertEqual(2, composite.getNumberOfRadars())
+
+  def test_composite_excludes_gates_far_from_target(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    composite = _wrwp.newcomposite(wrwp, pvol.latitude + 0.05, pvol.longitude, "SMHI", "NV,ff")
+    composite.addVolume(pvol)
+    vp = composite.getProfile()
+    self.assertEqual("'SE50'", vp.getAttribute("how/nodes"))
+    expected = wrwp.generate(pvol, "SMHI", "NV,ff")
+    self.assertNotEqual(expected.getNV().getData().tolist(), vp.getNV().getData().tolist())
+
+  def test_composite_knmi_not_supported(self):
+    wrwp = load_wrwp_defaults_to_obj()
+    try:
+      _wrwp.newcomposite(wrwp, 1.0, 0.2, "KNMI")
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+
+  def test_archive(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    later = _raveio.open(self.FIXTURE2).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "HGHT,ff,dd,NV"
+    filename = os.path.join(tempfile.mkdtemp(), "seang.wrwparc")
+    try:
+      archive = _wrwp.createarchive(filename, wrwp.hmax // wrwp.dz, wrwp.dz, fields)
+      try:
+        _wrwp.createarchive(filename, wrwp.hmax // wrwp.dz, wrwp.dz, fields)
+        self.fail("Expected IOError")
+      except IOError:
+        pass
+      archive.append(wrwp, pvol, "SMHI")
+      try:
+        archive.append(wrwp, pvol, "SMHI")  # not later than the last profile
+        self.fail("Expected IOError")
+      except IOError:
+        pass
+      archive.append(wrwp, later, "SMHI")
+      archive.close()
+
+      archive = _wrwp.openarchive(filename)
+      self.assertEqual(2, archive.getNumberOfProfiles())
+      self.assertEqual(fields, archive.getFields())
+      self.assertEqual(wrwp.hmax // wrwp.dz, archive.getLevels())
+      first, count = archive.find(20090501000000, 20090502000000)
+      self.assertEqual((0, 1), (first, count))
+      self.assertEqual(2009050112, archive.getTimes(first, count)[0] // 10000)
+
+      expected = wrwp.generate_result(pvol, "SMHI", fields)
+      for name in fields.split(","):
+        data = archive.read(name, first, count)
+        self.assertEqual((1, archive.getLevels()), data.shape)
+        self.assertEqual(expected[name].tolist(), data[0].tolist())
+      self.assertEqual((2, archive.getLevels()), archive.read("ff", 0, 2).shape)
+      try:
+        archive.read("DBZH", 0, 1)
+        self.fail("Expected KeyError")
+      except KeyError:
+        pass
+    finally:
+      if os.path.exists(filename):
+        os.remove(filename)
+      os.rmdir(os.path.dirname(filename))
+
+  def test_archive_several_appenders(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    later = _raveio.open(self.FIXTURE2).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "HGHT,ff,dd,NV"
+    filename = os.path.join(tempfile.mkdtemp(), "seang.wrwparc")
+    try:
+      _wrwp.createarchive(filename, wrwp.hmax // wrwp.dz, wrwp.dz, fields).close()
+      first = _wrwp.openarchive(filename)
+      second = _wrwp.openarchive(filename)
+      first.append(wrwp, pvol, "SMHI")
+      try:
+        second.append(wrwp, pvol, "SMHI")  # sees the profile appended by the other appender
+        self.fail("Expected IOError")
+      except IOError:
+        pass
+      second.append(wrwp, later, "SMHI")
+      first.close()
+      second.close()
+
+      archive = _wrwp.openarchive(filename)
+      self.assertEqual(2, archive.getNumberOfProfiles())
+      times = archive.getTimes(0, 2)
+      self.assertTrue(times[0] < times[1])
+      archive.close()
+    finally:
+      if os.path.exists(filename):
+        os.remove(filename)
+      os.rmdir(os.path.dirname(filename))
+
+  def test_shm(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    later = _raveio.open(self.FIXTURE2).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "HGHT,ff,dd,NV"
+    name = "wrwp_test_%d"%os.getpid()
+    try:
+      ring = _wrwp.createshm(name, wrwp.hmax // wrwp.dz, wrwp.dz, fields, 2)
+      reader = _wrwp.attachshm(name)
+      self.assertEqual(0, reader.getSequence())
+      self.assertEqual(fields, reader.getFields())
+      self.assertEqual(2, reader.getNumberOfSlots())
+
+      vp = ring.publish(wrwp, pvol, "SMHI")
+      self.assertEqual(1, reader.getSequence())
+      self.assertEqual(wrwp.hmax // wrwp.dz, vp.getLevels())
+      ring.publish(wrwp, later, "SMHI")
+      ring.publish(wrwp, pvol, "SMHI")
+
+      expected = wrwp.generate_result(pvol, "SMHI", fields)
+      sequence, t, result = reader.read()
+      self.assertEqual(3, sequence)
+      self.assertEqual(2009050112, t // 10000)
+      for f in fields.split(","):
+        self.assertEqual(expected[f].tolist(), result[f].tolist())
+      self.assertEqual(2, reader.read(2)[0])
+      try:
+        reader.read(1)  # overwritten by the third profile
+        self.fail("Expected IndexError")
+      except IndexError:
+        pass
+      try:
+        reader.publish(wrwp, pvol, "SMHI")
+        self.fail("Expected IOError")
+      except IOError:
+        pass
+    finally:
+      _wrwp.unlinkshm(name)
+
+  def test_native_cli(self):
+    binary = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp")
+    if not os.path.exists(binary):
+      self.skipTest("The native wrwp binary is not built")
+    outpath = tempfile.mkdtemp()
+    try:
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      subprocess.check_call([binary, "--infiles", self.FIXTURE, "--outpath", outpath, "--outfname", "seang_vp"], env=env, stdout=subprocess.DEVNULL)
+      vp = _raveio.open(os.path.join(outpath, "seang_vp.h5")).object
+      expected = load_wrwp_defaults_to_obj().generate(_raveio.open(self.FIXTURE).object, WRWPMETHOD, QUANTITIES)
+      self.assertEqual(expected.getLevels(), vp.getLevels())
+      self.assertEqual(expected.getFF().getData().tolist(), vp.getFF().getData().tolist())
+      self.assertEqual(expected.getDD().getData().tolist(), vp.getDD().getData().tolist())
+      self.assertEqual(expected.getNV().getData().tolist(), vp.getNV().getData().tolist())
+    finally:
+      for f in os.listdir(outpath):
+        os.remove(os.path.join(outpath, f))
+      os.rmdir(outpath)
+
+  def test_main_jobs_continues_after_failure(self):
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp_main")
+    outpath = tempfile.mkdtemp()
+    try:
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      infiles = ",".join([self.FIXTURE, "fixtures/wrwp_config.xml", self.FIXTURE2])
+      code = subprocess.call([sys.executable, script, "--infiles", infiles, "--outpath", outpath, "--jobs", "2"], env=env, stdout=subprocess.DEVNULL)
+      self.assertNotEqual(0, code)
+      self.assertEqual(2, len([f for f in os.listdir(outpath) if f.endswith(".h5")]))
+    finally:
+      for f in os.listdir(outpath):
+        os.remove(os.path.join(outpath, f))
+      os.rmdir(outpath)
+
+  def test_native_cli_continues_after_failure(self):
+    binary = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp")
+    if not os.path.exists(binary):
+      self.skipTest("The native wrwp binary is not built")
+    outpath = tempfile.mkdtemp()
+    try:
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      infiles = ",".join([self.FIXTURE, "fixtures/wrwp_config.xml", self.FIXTURE2])
+      code = subprocess.call([binary, "--infiles", infiles, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+      self.assertNotEqual(0, code)
+      self.assertEqual(2, len([f for f in os.listdir(outpath) if f.endswith(".h5")]))
+    finally:
+      for f in os.listdir(outpath):
+        os.remove(os.path.join(outpath, f))
+      os.rmdir(outpath)
+
+  def test_native_cli_odim21_input_only_skips_that_file(self):
+    binary = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp")
+    if not os.path.exists(binary):
+      self.skipTest("The native wrwp binary is not built")
+    outpath = tempfile.mkdtemp()
+    inpath = tempfile.mkdtemp()
+    try:
+      # A ver2.1 input implies a ver2.1 profile, which is skipped, but not for the following inputs
+      rio = _raveio.new()
+      rio.object = _raveio.open(self.FIXTURE).object
+      rio.version = _raveio.RaveIO_ODIM_Version_2_1
+      rio.h5radversion = _raveio.RaveIO_ODIM_H5rad_Version_2_1
+      rio.save(os.path.join(inpath, "seang_odim21.h5"))
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      infiles = ",".join([os.path.join(inpath, "seang_odim21.h5"), self.FIXTURE2])
+      subprocess.call([binary, "--infiles", infiles, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+      self.assertEqual(1, len([f for f in os.listdir(outpath) if f.endswith(".h5")]))
+    finally:
+      for d in [outpath, inpath]:
+        for f in os.listdir(d):
+          os.remove(os.path.join(d, f))
+        os.rmdir(d)
+
+  def test_archive_reprocessing(self):
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp_main")
+    outpath = tempfile.mkdtemp()
+    try:
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      listfile = os.path.join(outpath, "volumes.txt")
+      with open(listfile, "w") as fp:
+        fp.write(os.path.abspath(self.FIXTURE) + "\n")
+      subprocess.check_call([sys.executable, script, "--archive", listfile, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL)
+      with open(os.path.join(outpath, "wrwp_manifest.txt")) as fp:
+        lines = fp.readlines()
+      self.assertEqual(1, len(lines))
+      outfile = lines[0].rstrip("\n").split("\t")[3]
+      mtime = os.stat(outfile).st_mtime_ns
+
+      # Same parameters, the profile is not generated again
+      subprocess.check_call([sys.executable, script, "--archive", listfile, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL)
+      self.assertEqual(mtime, os.stat(outfile).st_mtime_ns)
+
+      # Changed parameters, the profile is generated again
+      subprocess.check_call([sys.executable, script, "--archive", listfile, "--outpath", outpath, "--dmin", "4000"], env=env, stdout=subprocess.DEVNULL)
+      with open(os.path.join(outpath, "wrwp_manifest.txt")) as fp:
+        self.assertEqual(2, len(fp.readlines()))
+    finally:
+      for f in os.listdir(outpath):
+        os.remove(os.path.join(outpath, f))
+      os.rmdir(outpath)
+
+  def test_archive_reprocessing_config_file_change(self):
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../bin/wrwp_main")
+    outpath = tempfile.mkdtemp()
+    try:
+      listfile = os.path.join(outpath, "volumes.txt")
+      with open(listfile, "w") as fp:
+        fp.write(os.path.abspath(self.FIXTURE) + "\n")
+      env = dict(os.environ, WRWP_CONFIG_FILE=os.path.abspath("fixtures/wrwp_config.xml"))
+      subprocess.check_call([sys.executable, script, "--archive", listfile, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL)
+
+      # A setting only changed in the config file, not on the command line, invalidates the manifest entry
+      tree = ET.parse("fixtures/wrwp_config.xml")
+      for param in tree.getroot().findall('param'):
+        if param.get('name') == 'FF_MAX':
+          param.find('value').text = "30.0"
+      configfile = os.path.join(outpath, "wrwp_config_changed.xml")
+      tree.write(configfile)
+      env = dict(os.environ, WRWP_CONFIG_FILE=configfile)
+      subprocess.check_call([sys.executable, script, "--archive", listfile, "--outpath", outpath], env=env, stdout=subprocess.DEVNULL)
+      with open(os.path.join(outpath, "wrwp_manifest.txt")) as fp:
+        lines = fp.readlines()
+      self.assertEqual(2, len(lines))
+      self.assertNotEqual(lines[0].split("\t")[0], lines[1].split("\t")[0])
+    finally:
+      for f in os.listdir(outpath):
+        os.remove(os.path.join(outpath, f))
+      os.rmdir(outpath)
+
+  def test_generate_configurations(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+    configurations = []
+    for method, attribute, value in [("SMHI", None, None), ("KNMI", None, None), ("SMHI", "vmin", 4.0), ("SMHI", "vmin", 2.5),
+                                     ("KNMI", "dmin", 10000), ("SMHI", "emax", 10.0), ("KNMI", "maxvdiff", 5.0)]:
+      wrwp = load_wrwp_defaults_to_obj()
+      if attribute is not None:
+        setattr(wrwp, attribute, value)
+      configurations.append((wrwp, method))
+
+    vps = _wrwp.generate_configurations(pvol, configurations, fields)
+    self.assertEqual(len(configurations), len(vps))
+    for (wrwp, method), vp in zip(configurations, vps):
+      expected = wrwp.generate(pvol, method, fields)
+      self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+      self.assertEqual(expected.starttime, vp.starttime)
+      self.assertEqual(expected.endtime, vp.endtime)
+      for getter in ["getNV", "getHGHT", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev", "getNZ"]:
+        self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+
+  def test_generate_configurations_no_scans(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.emin = 80.0
+    wrwp.emax = 90.0
+    try:
+      _wrwp.generate_configurations(pvol, [(load_wrwp_defaults_to_obj(), "SMHI"), (wrwp, "SMHI")], "ff")
+      self.fail("Expected RuntimeError")
+    except RuntimeError:
+      pass
+
+  def test_generate_sectors(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+    # One sector and one ring is the ordinary profile
+    for method in ["SMHI", "KNMI"]:
+      expected = wrwp.generate(pvol, method, fields)
+      vps = wrwp.generate_sectors(pvol, 1, 1, method, fields)
+      self.assertEqual(1, len(vps))
+      for getter in ["getNV", "getHGHT", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev", "getNZ"]:
+        self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vps[0], getter)().getData().tolist())
+
+    vps = wrwp.generate_sectors(pvol, 4, [wrwp.dmin, 10000, 20000, wrwp.dmax], "SMHI", fields)
+    self.assertEqual(12, len(vps))
+    self.assertAlmostEqual(90.0, vps[3].getAttribute("how/startaz"), 4)
+    self.assertAlmostEqual(180.0, vps[3].getAttribute("how/stopaz"), 4)
+    self.assertAlmostEqual(10.0, vps[4].getAttribute("how/minrange"), 4)
+    self.assertAlmostEqual(20.0, vps[4].getAttribute("how/maxrange"), 4)
+    for vp in vps:
+      self.assertEqual(expected.getLevels(), vp.getLevels())
+      self.assertEqual(expected.getAttribute("how/angles"), vp.getAttribute("how/angles"))
+
+  def test_generate_sectors_invalid(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    for nsectors, rings, method in [(0, 1, "SMHI"), (4, 0, "SMHI"), (4, 1, "KNMI"), (1, [20000, 10000], "SMHI")]:
+      try:
+        wrwp.generate_sectors(pvol, nsectors, rings, method, "ff")
+        self.fail("Expected RuntimeError")
+      except RuntimeError:
+        pass
+
+  def test_generate_vvp(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+    for method in ["SMHI", "KNMI"]:
+      expected = wrwp.generate(pvol, method, fields)
+      vp = wrwp.generate(pvol, method, fields + ",div,def,ad")
+      # The extended model does not change the ordinary fields
+      for getter in ["getNV", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getNZ"]:
+        self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+
+      div = vp.getField("div").getData().tolist()
+      deformation = vp.getField("def").getData().tolist()
+      ad = vp.getField("ad").getData().tolist()
+      self.assertEqual(vp.getLevels(), len(div))
+      self.assertTrue(any(d != wrwp.nodata_VP for d in div))
+      for i in range(len(div)):
+        if div[i] != wrwp.nodata_VP:
+          self.assertTrue(abs(div[i]) < 0.01)
+          self.assertTrue(deformation[i] >= 0.0)
+          self.assertTrue(0.0 <= ad[i] < 180.0)
+
+  def test_generate_vvp_linear_wind_field(self):
+    import numpy, math
+    # A linear wind field u = u0 + ux*x + uy*y, v = v0 + vx*x + vy*y written into the radial winds of the fixture
+    u0, v0, ux, uy, vx, vy = 5.0, -3.0, 1.0e-4, 2.0e-4, 0.0, 3.0e-4
+    R = 4.0 / 3.0 * 6371000.0
+    pvol = _raveio.open(self.FIXTURE).object
+    for i in range(pvol.getNumberOfScans()):
+      scan = pvol.getScan(i)
+      name = "VRAD" if scan.hasParameter("VRAD") else "VRADH"
+      if not scan.hasParameter(name):
+        continue
+      param = scan.getParameter(name)
+      data = param.getData()
+      r = (numpy.arange(data.shape[1]) + 0.5) * scan.rscale
+      h = numpy.sqrt(r * r + R * R + 2.0 * r * R * math.sin(scan.elangle)) - R
+      d = R * numpy.arcsin(r * math.cos(scan.elangle) / (R + h))
+      az = numpy.radians(360.0 / data.shape[0] * numpy.arange(data.shape[0]))[:, numpy.newaxis]
+      x, y = d * numpy.sin(az), d * numpy.cos(az)
+      vr = ((u0 + ux * x + uy * y) * numpy.sin(az) + (v0 + vx * x + vy * y) * numpy.cos(az)) * math.cos(scan.elangle)
+      raw = numpy.round((vr - param.offset) / param.gain)
+      valid = (data != param.nodata) & (data != param.undetect) & (raw != param.nodata) & (raw != param.undetect)
+      param.setData(numpy.where(valid, raw, data).astype(data.dtype))
+
+    wrwp = load_wrwp_defaults_to_obj()
+    stretching, shearing = ux - vy, uy + vx
+    for method in ["SMHI", "KNMI"]:
+      vp = wrwp.generate(pvol, method, "NV,HGHT,div,def")
+      div = vp.getField("div").getData().tolist()
+      deformation = vp.getField("def").getData().tolist()
+      self.assertTrue(any(dv != wrwp.nodata_VP for dv in div))
+      for i in range(len(div)):
+        if div[i] != wrwp.nodata_VP:
+          self.assertAlmostEqual(ux + vy, div[i], delta=0.1 * (ux + vy))
+          self.assertAlmostEqual(math.hypot(stretching, shearing), deformation[i], delta=0.1 * math.hypot(stretching, shearing))
+
+  ## Folds the radial winds of all scans of a volume into the Nyquist interval NI
+  def fold_volume(self, pvol, NI):
+    import numpy
+    for i in range(pvol.getNumberOfScans()):
+      scan = pvol.getScan(i)
+      name = "VRAD" if scan.hasParameter("VRAD") else "VRADH"
+      if not scan.hasParameter(name):
+        continue
+      param = scan.getParameter(name)
+      data = param.getData()
+      valid = (data != param.nodata) & (data != param.undetect)
+      v = data.astype(numpy.float64) * param.gain + param.offset
+      folded = numpy.mod(v + NI, 2 * NI) - NI
+      raw = numpy.round((folded - param.offset) / param.gain)
+      param.setData(numpy.where(valid, raw, data).astype(data.dtype))
+      scan.addAttribute("how/NI", NI)
+
+  def test_generate_dealias(self):
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,HGHT,UWND,VWND,ff,ff_dev,dd"
+    self.assertFalse(wrwp.dealias)
+    dealiasing = wrwp.clone()
+    dealiasing.dealias = True
+    self.assertTrue(dealiasing.dealias)
+    self.assertTrue(dealiasing.clone().dealias)
+
+    # Fold the radial winds with a Nyquist interval well below the strongest winds
+    folded = _raveio.open(self.FIXTURE).object
+    vmax = 0.0
+    for i in range(folded.getNumberOfScans()):
+      scan = folded.getScan(i)
+      name = "VRAD" if scan.hasParameter("VRAD") else "VRADH"
+      if scan.hasParameter(name):
+        param = scan.getParameter(name)
+        data = param.getData()
+        values = data[(data != param.nodata) & (data != param.undetect)] * param.gain + param.offset
+        if len(values) > 0:
+          vmax = max(vmax, float(abs(values).max()))
+    NI = max(0.5 * vmax, 8.0)
+    self.assertTrue(vmax > NI)
+    self.fold_volume(folded, NI)
+
+    for method in ["SMHI", "KNMI"]:
+      reference = wrwp.generate(_raveio.open(self.FIXTURE).object, method, fields)
+      dealiased = dealiasing.generate(folded, method, fields)
+      aliased = wrwp.generate(folded, method, fields)
+      nodata = wrwp.nodata_VP
+
+      rff, rdd = reference.getFF().getData().flatten().tolist(), reference.getDD().getData().flatten().tolist()
+      dff, ddd = dealiased.getFF().getData().flatten().tolist(), dealiased.getDD().getData().flatten().tolist()
+      compared = 0
+      for i in range(len(rff)):
+        if rff[i] == nodata or dff[i] == nodata:
+          continue
+        compared = compared + 1
+        self.assertAlmostEqual(rff[i], dff[i], delta=2.0, msg="%s: ff differs at level %d"%(method, i))
+        if rff[i] > 3.0:
+          diff = abs(rdd[i] - ddd[i]) % 360.0
+          self.assertTrue(min(diff, 360.0 - diff) < 20.0, "%s: dd differs at level %d"%(method, i))
+      self.assertTrue(compared > 0)
+
+      # Without dealiasing the folded winds give another profile
+      self.assertNotEqual(rff, aliased.getFF().getData().flatten().tolist())
+
+  def test_dealias_not_supported(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.dealias = True
+    ctx = _wrwp.newcontext()
+    try:
+      wrwp.begin("SMHI", "ff", ctx)
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+    try:
+      wrwp.generate_resolutions(pvol, [(200, 12000), (500, 12000)], "SMHI", "ff")
+      self.fail("Expected RuntimeError")
+    except RuntimeError:
+      pass
+    try:
+      _wrwp.newwindow(wrwp, 600, "SMHI")
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+    try:
+      _wrwp.newcomposite(wrwp, 1.0, 0.2, "SMHI")
+      self.fail("Expected AttributeError")
+    except AttributeError:
+      pass
+
+  def test_generate_percentiles(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.lock()
+    ctx = _wrwp.newcontext()
+    fields = "NZ,DBZH,DBZH_p10,DBZH_p50,DBZH_p90"
+    percentiles = ["DBZH_p10", "DBZH_p50", "DBZH_p90"]
+
+    expected = wrwp.generate(pvol, "SMHI", "NZ,DBZH")
+    result = dict((k, v.tolist()) for k, v in wrwp.generate_result(pvol, "SMHI", fields).items())
+    self.assertEqual(expected.getDBZ().getData().tolist(), [[x] for x in result["DBZH"]])
+    self.assertTrue(any(p != wrwp.nodata_VP for p in result["DBZH_p50"]))
+    for p10, p50, p90 in zip(*[result[name] for name in percentiles]):
+      if p50 != wrwp.nodata_VP:
+        self.assertTrue(p10 <= p50 <= p90)
+
+    # The sketch is mergeable so streaming and aggregating the layers gives the same percentiles
+    wrwp.begin("SMHI", fields, ctx)
+    for i in range(pvol.getNumberOfScans()):
+      wrwp.addScan(pvol.getScan(i), ctx)
+    vp = wrwp.finalize(ctx)
+    for name in percentiles:
+      self.assertEqual(result[name], [x[0] for x in vp.getField(name).getData().tolist()])
+
+    vps = wrwp.generate_resolutions(pvol, [(wrwp.dz, wrwp.hmax)], "SMHI", fields)
+    for name in percentiles:
+      self.assertEqual(result[name], [x[0] for x in vps[0].getField(name).getData().tolist()])
+
+  def test_generate_bio(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    self.assertAlmostEqual(20.0, wrwp.bio_dbzmax, 4)
+    self.assertAlmostEqual(11.0, wrwp.bio_rcs, 4)
+    self.assertAlmostEqual(2.0, wrwp.bio_stdmin, 4)
+    fields = "NV,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+    for method in ["SMHI", "KNMI"]:
+      expected = wrwp.generate(pvol, method, fields)
+      vp = wrwp.generate(pvol, method, fields + ",eta,dens,ff_bio,dd_bio,bio_frac")
+      # The biological profile does not change the ordinary fields
+      for getter in ["getNV", "getUWND", "getVWND", "getFF", "getFFDev", "getDD", "getDBZ", "getDBZDev", "getNZ"]:
+        self.assertEqual(getattr(expected, getter)().getData().tolist(), getattr(vp, getter)().getData().tolist())
+
+      eta = [x[0] for x in vp.getField("eta").getData().tolist()]
+      dens = [x[0] for x in vp.getField("dens").getData().tolist()]
+      frac = [x[0] for x in vp.getField("bio_frac").getData().tolist()]
+      self.assertEqual(vp.getLevels(), len(eta))
+      self.assertTrue(any(f != wrwp.nodata_VP for f in frac))
+      for i in range(len(eta)):
+        if frac[i] != wrwp.nodata_VP:
+          self.assertTrue(0.0 <= frac[i] <= 1.0)
+          self.assertTrue(eta[i] >= 0.0)
+          self.assertTrue(dens[i] == 0.0 or abs(dens[i] - eta[i] / wrwp.bio_rcs) < 1e-6 * max(1.0, eta[i]))
+
+    # Nothing is biological when the reflectivity threshold is below all echoes
+    wrwp.bio_dbzmax = -100.0
+    vp = wrwp.generate(pvol, "SMHI", "eta,dens,ff_bio,bio_frac")
+    for f in vp.getField("bio_frac").getData().tolist():
+      self.assertTrue(f[0] in [0.0, wrwp.nodata_VP])
+    for f in vp.getField("ff_bio").getData().tolist():
+      self.assertEqual(wrwp.nodata_VP, f[0])
+
+  def test_generate_instruction_sets(self):
+    pvol = _raveio.open(self.FIXTURE).object
+    wrwp = load_wrwp_defaults_to_obj()
+    fields = "NV,UWND,VWND,ff,ff_dev,dd"
+    isas = [_wrwp.WrwpInstructionSet_SCALAR, _wrwp.WrwpInstructionSet_SSE2, _wrwp.WrwpInstructionSet_AVX2, _wrwp.WrwpInstructionSet_AVX512]
+    self.assertTrue(_wrwp.isinstructionsetsupported(_wrwp.WrwpInstructionSet_SCALAR))
+    try:
+      expected = None
+      for isa in isas:
+        if not _wrwp.isinstructionsetsupported(isa):
+          continue
+        _wrwp.setinstructionset(isa)
+        self.assertEqual(isa, _wrwp.getinstructionset())
+        result = dict((k, v.tolist()) for k, v in wrwp.generate_result(pvol, "SMHI", fields).items())
+        if expected is None:
+          expected = result
+        self.assertEqual(expected, result) # bit identical regardless of instruction set
+    finally:
+      _wrwp.setinstructionset(_wrwp.WrwpInstructionSet_AUTO)
+
+  def test_generate_concurrently(self):
+    import threading
+    if hasattr(_rave, "setTrackObjectCreation"):
+      _rave.setTrackObjectCreation(False) # object tracking is not thread safe
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.lock()
+    fields = "NV,ff,dd,DBZH,NZ"
+    pvol = _raveio.open(self.FIXTURE).object
+    expected = {}
+    for method in ["SMHI", "KNMI"]:
+      vp = wrwp.generate(pvol, method, fields)
+      expected[method] = (vp.getNV().getData().tolist(), vp.getFF().getData().tolist(),
+                          vp.getDD().getData().tolist(), vp.getDBZ().getData().tolist())
+
+    errors = []
+    def worker(method):
+      try:
+        ctx = _wrwp.newcontext()
+        volume = _raveio.open(self.FIXTURE).object # volumes must not be shared between threads
+        for i in range(3):
+          vp = wrwp.generate(volume, method, fields, ctx)
+          result = (vp.getNV().getData().tolist(), vp.getFF().getData().tolist(),
+                    vp.getDD().getData().tolist(), vp.getDBZ().getData().tolist())
+          if result != expected[method]:
+            errors.append("Result differs for %s"%method)
+      except Exception as e:
+        errors.append(str(e))
+
+    threads = [threading.Thread(target=worker, args=(["SMHI", "KNMI"][i%2],)) for i in range(8)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    self.assertEqual([], errors)
+
   def X_test_generate_2(self):
     pvol = _raveio.open(self.FIXTURE).object
     wrwp = load_wrwp_defaults_to_obj()
@@ -470,6 +1432,101 @@ class WrwpTest(unittest.TestCase):
     robj.object = vp
     robj.save("slasktest.h5")
 
+  def test_pipeline(self):
+    import wrwp_pipeline
+    if hasattr(_rave, "setTrackObjectCreation"):
+      _rave.setTrackObjectCreation(False) # object tracking is not thread safe
+    wrwp = load_wrwp_defaults_to_obj()
+    wrwp.lock()
+    expected = wrwp.generate(_raveio.open(self.FIXTURE).object, WRWPMETHOD, QUANTITIES).getFF().getData().tolist()
+
+    def load(item):
+      if item == "missing":
+        raise IOError("No such volume")
+      return _raveio.open(self.FIXTURE).object
+    def compute(item, pvol):
+      return wrwp.generate(pvol, WRWPMETHOD, QUANTITIES, _wrwp.newcontext())
+    def write(item, vp):
+      return vp.getFF().getData().tolist()
+
+    results = {}
+    errors = {}
+    def done(item, outcome, error):
+      if error is None:
+        results[item] = outcome
+      else:
+        errors[item] = str(error)
+
+    wrwp_pipeline.Pipeline(load, compute, write, workers=2, depth=1).run(["a", "b", "missing", "c"], done)
+    self.assertEqual(["a", "b", "c"], sorted(results.keys()))
+    for item in results:
+      self.assertEqual(expected, results[item])
+    self.assertEqual({"missing" : "No such volume"}, errors)
+
+  def test_settings(self):
+    wrwp = _wrwp.new()
+    settings = wrwp.settings()
+    for name in ["dz", "hmax", "dmin", "emin", "vmin", "sampleprecision", "dealias", "bio_dbzmax", "bio_rcs", "bio_stdmin"]:
+      self.assertEqual(getattr(wrwp, name), settings[name])
+    self.assertFalse("locked" in settings)
+    wrwp.dealias = True
+    self.assertEqual(True, wrwp.settings()["dealias"])
+
+  def test_pgf_plugin_cache(self):
+    import baltrad_wrwp_pgf_plugin as plugin
+    cache = plugin.ResultCache(2)
+    saved = (plugin.resultcache, plugin.WRWP_CACHE_SIZE, plugin.ravebdb, plugin.generate_profile, os.environ.get("WRWP_CONFIG_FILE"))
+    calls = []
+    def counting_generate_profile(*args, **kwargs):
+      calls.append(1)
+      return saved[3](*args, **kwargs)
+    plugin.resultcache, plugin.WRWP_CACHE_SIZE, plugin.ravebdb, plugin.generate_profile = cache, 2, None, counting_generate_profile
+    os.environ["WRWP_CONFIG_FILE"] = os.path.abspath("fixtures/wrwp_config.xml")
+    arguments = ["fields", QUANTITIES]
+    outfiles = []
+    try:
+      # A repeated request is a hit and returns a new copy of the same profile
+      outfiles.append(plugin.generate([self.FIXTURE], arguments))
+      outfiles.append(plugin.generate([self.FIXTURE], arguments))
+      self.assertEqual(1, len(calls))
+      self.assertNotEqual(outfiles[0], outfiles[1])
+      with open(outfiles[0], "rb") as a, open(outfiles[1], "rb") as b:
+        self.assertEqual(a.read(), b.read())
+
+      # A changed parameter is a miss
+      outfiles.append(plugin.generate([self.FIXTURE], arguments + ["interval", "100"]))
+      self.assertEqual(2, len(calls))
+
+      # The key covers every setting of the generator
+      wrwp = _wrwp.new()
+      objs = [_raveio.open(self.FIXTURE).object]
+      key = cache.key(objs, wrwp, WRWPMETHOD, QUANTITIES)
+      for name, value in [("dealias", True), ("sampleprecision", _wrwp.WrwpSamplePrecision_FLOAT), ("bio_rcs", 5.0)]:
+        changed = wrwp.clone()
+        setattr(changed, name, value)
+        self.assertNotEqual(key, cache.key(objs, changed, WRWPMETHOD, QUANTITIES))
+
+      # The least recently used profile is evicted and its file removed
+      oldest = cache.entries[next(iter(cache.entries))]
+      outfiles.append(plugin.generate([self.FIXTURE2], arguments))
+      self.assertEqual(3, len(calls))
+      self.assertEqual(2, len(cache.entries))
+      self.assertFalse(os.path.exists(oldest))
+      self.assertEqual(sorted(os.path.basename(f) for f in cache.entries.values()), sorted(os.listdir(cache.directory)))
+      outfiles.append(plugin.generate([self.FIXTURE], arguments))
+      self.assertEqual(4, len(calls))
+    finally:
+      plugin.resultcache, plugin.WRWP_CACHE_SIZE, plugin.ravebdb, plugin.generate_profile = saved[:4]
+      if saved[4] is None:
+        del os.environ["WRWP_CONFIG_FILE"]
+      else:
+        os.environ["WRWP_CONFIG_FILE"] = saved[4]
+      for f in outfiles:
+        if f is not None and os.path.exists(f):
+          os.remove(f)
+      if cache.directory is not None:
+        shutil.rmtree(cache.directory, True)
+
   def test_generate_with_several_howattributes(self):
     pvol = _raveio.open(self.FIXTURE2).object
     wrwp = load_wrwp_defaults_to_obj()
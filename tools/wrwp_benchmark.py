@@ -0,0 +1,108 @@
+'''
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI,
+
+This file is part of baltrad-wrwp.
+
+baltrad-wrwp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+baltrad-wrwp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+Benchmarks for the wrwp generator. Should be executed with the run_python_script.sh
+so that the build paths are used, e.g.
+
+  ./tools/run_python_script.sh tools/wrwp_benchmark.py test/pytest
+
+or by running make benchmark.
+
+@file
+@date 2026-10-18
+'''
+import _wrwp
+import _raveio
+import time
+import sys
+from optparse import OptionParser
+
+DEFAULT_VOLUMES = "fixtures/pvol_seang_20090501T120000Z.h5,fixtures/selul_pvol_20151114T1615Z.h5"
+
+def timeit(func, repeats):
+  # Runs func repeats times and returns the best time together with the result of the last call
+  best = None
+  result = None
+  for i in range(repeats):
+    t0 = time.time()
+    result = func()
+    t1 = time.time() - t0
+    if best is None or t1 < best:
+      best = t1
+  return best, result
+
+def field_values(vp, name):
+  getter = {"ff":vp.getFF, "dd":vp.getDD, "DBZH":vp.getDBZ}[name]
+  return [x[0] for x in getter().getData().tolist()]
+
+def max_deviation(a, b, nodata, circular=False):
+  # Returns the max absolute deviation and the number of levels where only one of a and b has data
+  result = 0.0
+  mismatch = 0
+  for i in range(len(a)):
+    if a[i] == nodata and b[i] == nodata:
+      continue
+    if a[i] == nodata or b[i] == nodata:
+      mismatch = mismatch + 1
+      continue
+    d = abs(a[i] - b[i])
+    if circular and d > 180.0:
+      d = 360.0 - d
+    result = max(result, d)
+  return result, mismatch
+
+def benchmark_precision(volumes, options):
+  print("Sample precision, float32 vs float64 (best of %d)"%options.repeats)
+  print("%-45s %-5s %10s %10s %8s %10s %10s %10s %6s"%("volume", "meth", "double[s]", "float[s]", "speedup", "max dff", "max ddd", "max dDBZH", "nodata"))
+  for fname in volumes:
+    pvol = _raveio.open(fname).object
+    for method in options.methods.split(","):
+      wrwp = _wrwp.new()
+      wrwp.sampleprecision = _wrwp.WrwpSamplePrecision_DOUBLE
+      td, vpd = timeit(lambda: wrwp.generate(pvol, method, "ff,dd,DBZH"), options.repeats)
+      wrwp.sampleprecision = _wrwp.WrwpSamplePrecision_FLOAT
+      tf, vpf = timeit(lambda: wrwp.generate(pvol, method, "ff,dd,DBZH"), options.repeats)
+      nodata = wrwp.nodata_VP
+      dff, m1 = max_deviation(field_values(vpd, "ff"), field_values(vpf, "ff"), nodata)
+      ddd, m2 = max_deviation(field_values(vpd, "dd"), field_values(vpf, "dd"), nodata, True)
+      ddbz, m3 = max_deviation(field_values(vpd, "DBZH"), field_values(vpf, "DBZH"), nodata)
+      print("%-45s %-5s %10.4f %10.4f %8.2f %10.2e %10.2e %10.2e %6d"%(fname[-45:], method, td, tf, td/tf, dff, ddd, ddbz, m1+m2+m3))
+
+BENCHMARKS = {
+  "precision" : benchmark_precision
+}
+
+if __name__ == "__main__":
+  parser = OptionParser(usage="usage: %prog [--volumes a.h5,b.h5] [--repeats N] [--methods SMHI,KNMI] [benchmark ...]\nAvailable benchmarks: " + ", ".join(sorted(BENCHMARKS.keys())))
+  parser.add_option("--volumes", dest="volumes", default=DEFAULT_VOLUMES, help="Comma separated list of polar volumes to use")
+  parser.add_option("--repeats", dest="repeats", type="int", default=5, help="Number of repetitions, the best time is reported")
+  parser.add_option("--methods", dest="methods", default="SMHI,KNMI", help="Comma separated list of methods to benchmark")
+  (options, args) = parser.parse_args()
+
+  names = args
+  if len(names) == 0:
+    names = sorted(BENCHMARKS.keys())
+
+  volumes = options.volumes.split(",")
+  for name in names:
+    if name not in BENCHMARKS:
+      print("Unknown benchmark: %s"%name)
+      sys.exit(127)
+    BENCHMARKS[name](volumes, options)
+    print("")
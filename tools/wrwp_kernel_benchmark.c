@@ -0,0 +1,264 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Microbenchmark of the wind profile kernels on synthetic layers. Built and executed
+ * by make benchmark in the lib directory.
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp_kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEG2RAD .017453292519943296
+#define BENCH_RAD2DEG 57.295779513082321
+#define BENCH_NGAPBIN 8
+#define BENCH_NGAPMIN 5
+
+/**
+ * The samples of one synthetic layer
+ */
+typedef struct {
+  int n;
+  double *A, *v, *az, *el, *vfit;
+  int* sector;
+} BenchLayer;
+
+static double bench_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Creates a layer with n samples from a uniform wind with some noise and a few outliers
+ */
+static void bench_createLayer(BenchLayer* layer, int n)
+{
+  const double x[3] = {5.0, -8.0, 0.5};
+  int i = 0;
+  layer->n = n;
+  layer->A = malloc(sizeof(double) * 3 * n);
+  layer->v = malloc(sizeof(double) * n);
+  layer->az = malloc(sizeof(double) * n);
+  layer->el = malloc(sizeof(double) * n);
+  layer->vfit = malloc(sizeof(double) * n);
+  layer->sector = malloc(sizeof(int) * n);
+  srand(4711);
+  for (i = 0; i < n; i++) {
+    double az = 360.0 / 360 * (i % 360) * BENCH_DEG2RAD;
+    double el = (0.5 + (i / 360) % 10) * BENCH_DEG2RAD;
+    layer->az[i] = az;
+    layer->el[i] = el;
+    layer->A[3*i] = sin(az) * cos(el);
+    layer->A[3*i+1] = cos(az) * cos(el);
+    layer->A[3*i+2] = sin(el);
+    layer->v[i] = x[0] * layer->A[3*i] + x[1] * layer->A[3*i+1] + x[2] * layer->A[3*i+2] + ((rand() % 200) - 100) / 100.0;
+    if (i % 97 == 0) {
+      layer->v[i] += 25.0;
+    }
+    layer->sector[i] = WrwpKernel_sectorIndex(az, BENCH_NGAPBIN);
+  }
+}
+
+static void bench_destroyLayer(BenchLayer* layer)
+{
+  free(layer->A);
+  free(layer->v);
+  free(layer->az);
+  free(layer->el);
+  free(layer->vfit);
+  free(layer->sector);
+}
+
+/**
+ * The residual, compaction and gap detection as done before the kernels were introduced
+ */
+static int bench_reference(BenchLayer* layer, double* v, double* az, double* el, double* Atmp, const double* x)
+{
+  int i = 0, n = 0, m = 0, p = 0, nv = layer->n, gap = 0;
+  int Nsector[BENCH_NGAPBIN];
+  double chisq = 0.0, Vdifmax = 10.0;
+  for (i = 0; i < nv; i++) {
+    layer->vfit[i] = x[0] * sin(az[i]) * cos(el[i]) + x[1] * cos(az[i]) * cos(el[i]) + x[2] * sin(el[i]);
+    chisq += (v[i] - layer->vfit[i]) * (v[i] - layer->vfit[i]);
+  }
+  for (m = 0; m < nv; m++) {
+    if (fabs(v[m] - layer->vfit[m]) < Vdifmax) {
+      v[n] = v[m];
+      az[n] = az[m];
+      el[n] = el[m];
+      for (p = 0; p < 3; p++) {
+        Atmp[p + 3 * n] = layer->A[p + 3 * m];
+      }
+      n++;
+    }
+  }
+  for (m = 0; m < BENCH_NGAPBIN; m++) {
+    Nsector[m] = 0;
+  }
+  for (i = 0; i < n; i++) {
+    m = (az[i] * BENCH_RAD2DEG * BENCH_NGAPBIN) / 360.0;
+    Nsector[m % BENCH_NGAPBIN]++;
+  }
+  for (m = 0; m < BENCH_NGAPBIN; m++) {
+    if ((Nsector[m] < BENCH_NGAPMIN) && (Nsector[(m + 1) % BENCH_NGAPBIN] < BENCH_NGAPMIN)) {
+      gap = 1;
+    }
+  }
+  return gap ? 0 : n + (chisq > 0.0);
+}
+
+/**
+ * The same work done with the kernels
+ */
+static int bench_kernels(BenchLayer* layer, double* v, double* A, int* sector, const double* x)
+{
+  int n = 0;
+  double chisq = WrwpKernel_residuals(layer->n, A, x, v, layer->vfit);
+  n = WrwpKernel_compactInliers(layer->n, A, layer->vfit, 10.0, v, sector);
+  return WrwpKernel_sectorGap(n, sector, BENCH_NGAPBIN, BENCH_NGAPMIN) ? 0 : n + (chisq > 0.0);
+}
+
+/**
+ * Accumulates the normal equations of an SMHI layer with every supported instruction set and
+ * reports the throughput. The sums must be bit identical for all instruction sets.
+ */
+static void bench_normalEquations(int repeats)
+{
+  const int n = 40000;
+  double *a0 = malloc(sizeof(double) * n), *a1 = malloc(sizeof(double) * n), *b = malloc(sizeof(double) * n);
+  float *fa0 = malloc(sizeof(float) * n), *fa1 = malloc(sizeof(float) * n), *fb = malloc(sizeof(float) * n);
+  WrwpNormalEquations first;
+  int i = 0, r = 0, isa = 0, haveFirst = 0;
+  WrwpKernelInstructionSet original = WrwpKernel_getInstructionSet();
+
+  srand(4711);
+  for (i = 0; i < n; i++) {
+    double az = (i % 360) * BENCH_DEG2RAD;
+    a0[i] = sin(az);
+    a1[i] = cos(az);
+    b[i] = 5.0 * a0[i] - 8.0 * a1[i] + 0.5 + ((rand() % 200) - 100) / 100.0;
+    fa0[i] = (float)a0[i];
+    fa1[i] = (float)a1[i];
+    fb[i] = (float)b[i];
+  }
+
+  printf("\nNormal equations, %d gates (best of %d)\n", n, repeats);
+  printf("%10s %14s %14s %s\n", "isa", "double[Mg/s]", "float[Mg/s]", "");
+  for (isa = WrwpKernelInstructionSet_SCALAR; isa <= WrwpKernelInstructionSet_AVX512; isa++) {
+    double bestD = 1e9, bestF = 1e9;
+    WrwpNormalEquations ne, fne;
+    int identical = 1;
+    if (!WrwpKernel_setInstructionSet((WrwpKernelInstructionSet)isa)) {
+      printf("%10s %14s %14s\n", WrwpKernel_getInstructionSetName((WrwpKernelInstructionSet)isa), "-", "-");
+      continue;
+    }
+    for (r = 0; r < repeats; r++) {
+      double t0 = 0.0;
+      memset(&ne, 0, sizeof(ne));
+      t0 = bench_now();
+      WrwpKernel_accumulateNormalEquations(n, a0, a1, NULL, b, &ne);
+      t0 = bench_now() - t0;
+      if (t0 < bestD) bestD = t0;
+
+      memset(&fne, 0, sizeof(fne));
+      t0 = bench_now();
+      WrwpKernel_accumulateNormalEquationsFloat(n, fa0, fa1, NULL, fb, &fne);
+      t0 = bench_now() - t0;
+      if (t0 < bestF) bestF = t0;
+    }
+    if (!haveFirst) {
+      first = ne;
+      haveFirst = 1;
+    }
+    identical = (memcmp(&first, &ne, sizeof(ne)) == 0);
+    printf("%10s %14.1f %14.1f %s\n", WrwpKernel_getInstructionSetName((WrwpKernelInstructionSet)isa),
+           n / bestD * 1e-6, n / bestF * 1e-6, identical ? "" : "(results differ from SCALAR)");
+  }
+  WrwpKernel_setInstructionSet(original);
+
+  free(a0);
+  free(a1);
+  free(b);
+  free(fa0);
+  free(fa1);
+  free(fb);
+}
+
+int main(int argc, char** argv)
+{
+  const int sizes[] = {1000, 5000, 20000, 40000};
+  const double x[3] = {5.1, -7.9, 0.4};
+  int repeats = 200, s = 0, r = 0;
+
+  if (argc > 1) {
+    repeats = atoi(argv[1]);
+  }
+
+  printf("KNMI residual, outlier and gap kernels (best of %d)\n", repeats);
+  printf("%10s %14s %14s %8s\n", "samples", "reference[us]", "kernels[us]", "speedup");
+  for (s = 0; s < (int)(sizeof(sizes)/sizeof(sizes[0])); s++) {
+    BenchLayer layer;
+    double bestRef = 1e9, bestKern = 1e9;
+    int resRef = 0, resKern = 0;
+    double *v = NULL, *az = NULL, *el = NULL, *A = NULL;
+    int* sector = NULL;
+
+    bench_createLayer(&layer, sizes[s]);
+    v = malloc(sizeof(double) * layer.n);
+    az = malloc(sizeof(double) * layer.n);
+    el = malloc(sizeof(double) * layer.n);
+    A = malloc(sizeof(double) * 3 * layer.n);
+    sector = malloc(sizeof(int) * layer.n);
+
+    for (r = 0; r < repeats; r++) {
+      double t0 = 0.0;
+      memcpy(v, layer.v, sizeof(double) * layer.n);
+      memcpy(az, layer.az, sizeof(double) * layer.n);
+      memcpy(el, layer.el, sizeof(double) * layer.n);
+      t0 = bench_now();
+      resRef = bench_reference(&layer, v, az, el, A, x);
+      t0 = bench_now() - t0;
+      if (t0 < bestRef) bestRef = t0;
+
+      memcpy(v, layer.v, sizeof(double) * layer.n);
+      memcpy(A, layer.A, sizeof(double) * 3 * layer.n);
+      memcpy(sector, layer.sector, sizeof(int) * layer.n);
+      t0 = bench_now();
+      resKern = bench_kernels(&layer, v, A, sector, x);
+      t0 = bench_now() - t0;
+      if (t0 < bestKern) bestKern = t0;
+    }
+    printf("%10d %14.1f %14.1f %8.2f%s\n", layer.n, bestRef * 1e6, bestKern * 1e6, bestRef / bestKern,
+           resRef == resKern ? "" : "  (results differ)");
+
+    free(v);
+    free(az);
+    free(el);
+    free(A);
+    free(sector);
+    bench_destroyLayer(&layer);
+  }
+
+  bench_normalEquations(repeats);
+  return 0;
+}
@@ -0,0 +1,261 @@
+/* --------------------------------------------------------------------
+Copyright (C) 2026 Swedish Meteorological and Hydrological Institute, SMHI
+
+This is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This software is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with baltrad-wrwp.  If not, see <http://www.gnu.org/licenses/>.
+------------------------------------------------------------------------*/
+
+/** Stress test of one locked generator shared by several threads. Each thread has its own context
+ * and its own synthetic volume and generates profiles with both methods, as a whole volume and
+ * streamed scan by scan. Every result must be identical to the one generated the same way by the
+ * main thread up front. Built with -fsanitize=thread and executed by make tsan in the lib directory.
+ *
+ * wrwp_thread_stress [nthreads [iterations]]
+ * @file
+ * @date 2026-10-18
+ */
+#include "wrwp.h"
+#include "rave_debug.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRESS_DEG2RAD .017453292519943296
+#define STRESS_NRAYS 360
+#define STRESS_NBINS 120
+#define STRESS_FIELDS "NV,HGHT,UWND,VWND,ff,ff_dev,dd,DBZH,DBZH_dev,NZ"
+
+static const char* STRESS_METHODS[] = {"SMHI", "KNMI"};
+#define STRESS_NMETHODS 2
+
+/**
+ * The shared state of the test
+ */
+typedef struct {
+  Wrwp_t* wrwp;                             /**< the locked generator shared by all threads */
+  WrwpResult_t* expected[STRESS_NMETHODS];  /**< the results generated by the main thread */
+  WrwpResult_t* streamed[STRESS_NMETHODS];  /**< the results streamed by the main thread */
+  int iterations;                           /**< the number of generations per method and thread */
+} StressShared;
+
+/**
+ * The state of one thread
+ */
+typedef struct {
+  StressShared* shared;
+  int index;
+  int failures;
+} StressThread;
+
+/**
+ * Creates a parameter with a value for each bin and ray
+ */
+static PolarScanParam_t* stress_createParameter(const char* quantity, double gain, double offset, double elangle, int vrad)
+{
+  PolarScanParam_t* param = RAVE_OBJECT_NEW(&PolarScanParam_TYPE);
+  int ray = 0, bin = 0;
+  if (param == NULL ||
+      !PolarScanParam_createData(param, STRESS_NBINS, STRESS_NRAYS, RaveDataType_UCHAR) ||
+      !PolarScanParam_setQuantity(param, quantity)) {
+    RAVE_OBJECT_RELEASE(param);
+    return NULL;
+  }
+  PolarScanParam_setGain(param, gain);
+  PolarScanParam_setOffset(param, offset);
+  PolarScanParam_setNodata(param, 255.0);
+  PolarScanParam_setUndetect(param, 0.0);
+  for (ray = 0; ray < STRESS_NRAYS; ray++) {
+    double az = ray * STRESS_DEG2RAD;
+    for (bin = 0; bin < STRESS_NBINS; bin++) {
+      /* A uniform wind of 10 m/s from the south west, a reflectivity that decreases with range */
+      double value = vrad ? (7.0 * sin(az) + 7.0 * cos(az)) * cos(elangle) : 30.0 - bin * 0.2;
+      PolarScanParam_setValue(param, bin, ray, floor((value - offset) / gain + 0.5));
+    }
+  }
+  return param;
+}
+
+/**
+ * Creates a synthetic volume with a radial wind and reflectivity in each scan
+ */
+static PolarVolume_t* stress_createVolume(void)
+{
+  const double elangles[] = {0.5, 1.5, 2.5, 4.0, 8.0};
+  PolarVolume_t* pvol = RAVE_OBJECT_NEW(&PolarVolume_TYPE);
+  int i = 0, ok = (pvol != NULL);
+
+  if (ok) {
+    PolarVolume_setLongitude(pvol, 14.0 * STRESS_DEG2RAD);
+    PolarVolume_setLatitude(pvol, 60.0 * STRESS_DEG2RAD);
+    PolarVolume_setHeight(pvol, 100.0);
+    ok = PolarVolume_setDate(pvol, "20261018") && PolarVolume_setTime(pvol, "120000") &&
+         PolarVolume_setSource(pvol, "NOD:sestr,WMO:00000");
+  }
+  for (i = 0; ok && i < (int)(sizeof(elangles) / sizeof(elangles[0])); i++) {
+    double elangle = elangles[i] * STRESS_DEG2RAD;
+    PolarScan_t* scan = RAVE_OBJECT_NEW(&PolarScan_TYPE);
+    PolarScanParam_t* vrad = stress_createParameter("VRADH", 0.5, -64.0, elangle, 1);
+    PolarScanParam_t* dbzh = stress_createParameter("DBZH", 0.5, -32.0, elangle, 0);
+    ok = (scan != NULL && vrad != NULL && dbzh != NULL);
+    if (ok) {
+      PolarScan_setElangle(scan, elangle);
+      PolarScan_setRscale(scan, 500.0);
+      PolarScan_setBeamwidth(scan, 1.0 * STRESS_DEG2RAD);
+      ok = PolarScan_setDate(scan, "20261018") && PolarScan_setTime(scan, "120000") &&
+           PolarScan_setStartDate(scan, "20261018") && PolarScan_setStartTime(scan, "120000") &&
+           PolarScan_setEndDate(scan, "20261018") && PolarScan_setEndTime(scan, "120030") &&
+           PolarScan_addParameter(scan, vrad) && PolarScan_addParameter(scan, dbzh) &&
+           PolarVolume_addScan(pvol, scan);
+    }
+    RAVE_OBJECT_RELEASE(vrad);
+    RAVE_OBJECT_RELEASE(dbzh);
+    RAVE_OBJECT_RELEASE(scan);
+  }
+  if (!ok) {
+    RAVE_OBJECT_RELEASE(pvol);
+  }
+  return pvol;
+}
+
+/**
+ * Streams the scans of the volume through the context
+ */
+static WrwpResult_t* stress_stream(Wrwp_t* wrwp, WrwpContext_t* ctx, PolarVolume_t* pvol, const char* method)
+{
+  int i = 0, ok = Wrwp_begin(wrwp, ctx, method, STRESS_FIELDS);
+  for (i = 0; ok && i < PolarVolume_getNumberOfScans(pvol); i++) {
+    PolarScan_t* scan = PolarVolume_getScan(pvol, i);
+    ok = Wrwp_addScan(wrwp, ctx, scan);
+    RAVE_OBJECT_RELEASE(scan);
+  }
+  return ok ? Wrwp_finalizeResult(wrwp, ctx) : NULL;
+}
+
+/**
+ * Compares two results field by field
+ * @returns 1 if the results are identical
+ */
+static int stress_isIdentical(WrwpResult_t* a, WrwpResult_t* b)
+{
+  int f = 0, n = 0;
+  if (a == NULL || b == NULL || WrwpResult_getLevels(a) != WrwpResult_getLevels(b)) {
+    return 0;
+  }
+  n = WrwpResult_getLevels(a);
+  for (f = 0; f < WrwpResultField_COUNT; f++) {
+    if (WrwpResult_hasField(a, (WrwpResultField)f) != WrwpResult_hasField(b, (WrwpResultField)f)) {
+      return 0;
+    }
+    if (WrwpResult_hasField(a, (WrwpResultField)f) &&
+        memcmp(WrwpResult_getData(a, (WrwpResultField)f), WrwpResult_getData(b, (WrwpResultField)f), sizeof(double) * n) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void* stress_run(void* arg)
+{
+  StressThread* thread = (StressThread*)arg;
+  StressShared* shared = thread->shared;
+  WrwpContext_t* ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+  PolarVolume_t* pvol = stress_createVolume();
+  int i = 0, m = 0;
+
+  if (ctx == NULL || pvol == NULL) {
+    thread->failures++;
+    goto done;
+  }
+  for (i = 0; i < shared->iterations; i++) {
+    for (m = 0; m < STRESS_NMETHODS; m++) {
+      /* Alternate the method between the threads so that the context switches between the modes */
+      int method = (m + thread->index + i) % STRESS_NMETHODS;
+      WrwpResult_t* result = Wrwp_generateResult(shared->wrwp, ctx, pvol, STRESS_METHODS[method], STRESS_FIELDS);
+      WrwpResult_t* streamed = stress_stream(shared->wrwp, ctx, pvol, STRESS_METHODS[method]);
+      if (!stress_isIdentical(shared->expected[method], result) || !stress_isIdentical(shared->streamed[method], streamed)) {
+        fprintf(stderr, "thread %d: %s profile %d differs\n", thread->index, STRESS_METHODS[method], i);
+        thread->failures++;
+      }
+      RAVE_OBJECT_RELEASE(result);
+      RAVE_OBJECT_RELEASE(streamed);
+    }
+  }
+done:
+  RAVE_OBJECT_RELEASE(pvol);
+  RAVE_OBJECT_RELEASE(ctx);
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  int nthreads = argc > 1 ? atoi(argv[1]) : 8;
+  StressShared shared;
+  StressThread* threads = NULL;
+  pthread_t* ids = NULL;
+  WrwpContext_t* ctx = NULL;
+  PolarVolume_t* pvol = NULL;
+  int i = 0, m = 0, failures = 0;
+
+  Rave_initializeDebugger();
+  Rave_setDebugLevel(Rave_Debug_Warning);
+
+  memset(&shared, 0, sizeof(shared));
+  shared.iterations = argc > 2 ? atoi(argv[2]) : 20;
+  shared.wrwp = RAVE_OBJECT_NEW(&Wrwp_TYPE);
+  ctx = RAVE_OBJECT_NEW(&WrwpContext_TYPE);
+  pvol = stress_createVolume();
+  threads = calloc(nthreads > 0 ? nthreads : 1, sizeof(StressThread));
+  ids = calloc(nthreads > 0 ? nthreads : 1, sizeof(pthread_t));
+  if (shared.wrwp == NULL || ctx == NULL || pvol == NULL || threads == NULL || ids == NULL) {
+    fprintf(stderr, "Failed to set up the test\n");
+    return 1;
+  }
+  Wrwp_lock(shared.wrwp);
+
+  for (m = 0; m < STRESS_NMETHODS; m++) {
+    shared.expected[m] = Wrwp_generateResult(shared.wrwp, ctx, pvol, STRESS_METHODS[m], STRESS_FIELDS);
+    shared.streamed[m] = stress_stream(shared.wrwp, ctx, pvol, STRESS_METHODS[m]);
+    if (shared.expected[m] == NULL || shared.streamed[m] == NULL) {
+      fprintf(stderr, "Failed to generate the %s reference profile\n", STRESS_METHODS[m]);
+      return 1;
+    }
+  }
+
+  for (i = 0; i < nthreads; i++) {
+    threads[i].shared = &shared;
+    threads[i].index = i;
+    if (pthread_create(&ids[i], NULL, stress_run, &threads[i]) != 0) {
+      fprintf(stderr, "Failed to start thread %d\n", i);
+      return 1;
+    }
+  }
+  for (i = 0; i < nthreads; i++) {
+    pthread_join(ids[i], NULL);
+    failures += threads[i].failures;
+  }
+
+  printf("%d threads x %d iterations x %d methods: %d failures\n", nthreads, shared.iterations, STRESS_NMETHODS, failures);
+
+  for (m = 0; m < STRESS_NMETHODS; m++) {
+    RAVE_OBJECT_RELEASE(shared.expected[m]);
+    RAVE_OBJECT_RELEASE(shared.streamed[m]);
+  }
+  RAVE_OBJECT_RELEASE(pvol);
+  RAVE_OBJECT_RELEASE(ctx);
+  RAVE_OBJECT_RELEASE(shared.wrwp);
+  free(threads);
+  free(ids);
+  return failures ? 1 : 0;
+}